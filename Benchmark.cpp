@@ -0,0 +1,289 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : Benchmark.cpp
+ * @brief      : Headless render benchmark. Renders synthetic pose sets of
+ *               growing size along a fixed world camera path and prints
+ *               timings as JSON
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include "TagViewer.h"
+#include "QuaternionKernel.h"
+#include "OffscreenContext.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <sys/resource.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                        GLOBAL VARIABLE DEFINITIONS                         //
+//----------------------------------------------------------------------------//
+using namespace std;
+
+// timings of one pose set
+struct BenchmarkRun {
+    size_t cameras;
+    double loadMs;
+    double firstFrameMs;
+    double frameMsMean;
+    double frameMsP50;
+    double frameMsP99;
+    double frameCpuMsMean;
+    double drawCallsMean;
+    double visibleMean;
+    long peakRssKb;
+};
+//----------------------------------------------------------------------------//
+//                      END GLOBAL VARIABLE DEFINITIONS                       //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief wall clock in milliseconds
+ */
+static double wallMs(){
+    return chrono::duration<double, milli>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief CPU time of the whole process (including GL driver threads) in
+ *        milliseconds
+ */
+static double cpuMs(){
+    timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return t.tv_sec * 1000.0 + t.tv_nsec / 1000000.0;
+}
+
+/**
+ * @brief peak resident set size of the process in kB
+ */
+static long peakRssKb(){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * @brief value at fraction q of sorted samples
+ */
+static double percentile(const vector<double> & sorted, double q){
+    if(sorted.empty()){
+        return 0.0;
+    }
+    size_t i = (size_t)(q * (sorted.size() - 1) + 0.5);
+    return sorted[min(i, sorted.size() - 1)];
+}
+
+/**
+ * @brief generates n poses along a noisy spiral trajectory
+ * @param n number of poses
+ * @param positions output n*3
+ * @param rotations output n*4 (unit quaternions x,y,z,w)
+ * @action deterministic (fixed seed) so runs are comparable. the spiral
+ *         fills a ~200 unit cube regardless of n, so density grows with n
+ */
+static void generatePoses(size_t n, vector<double> & positions,
+                          vector<double> & rotations){
+    positions.resize(n * 3);
+    rotations.resize(n * 4);
+    uint64_t state = 88172645463325252ULL;
+    for(size_t i = 0; i < n; i++){
+        double noise[7];
+        for(int k = 0; k < 7; k++){
+            // xorshift64
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            noise[k] = (state >> 11) * (1.0 / 9007199254740992.0) - 0.5;
+        }
+        double t = (double)i / n;
+        double angle = t * 40.0 * PI;
+        double radius = 20.0 + 80.0 * t;
+        positions[3*i+0] = radius * cos(angle) + 10.0 * noise[0];
+        positions[3*i+1] = 200.0 * t - 100.0 + 10.0 * noise[1];
+        positions[3*i+2] = radius * sin(angle) + 10.0 * noise[2];
+
+        double norm = 0.0;
+        for(int k = 0; k < 4; k++){
+            norm += noise[3+k] * noise[3+k];
+        }
+        norm = (norm > 0.0) ? sqrt(norm) : 1.0;
+        for(int k = 0; k < 4; k++){
+            rotations[4*i+k] = noise[3+k] / norm;
+        }
+    }
+}
+
+/**
+ * @brief renders one pose set along the fixed orbit
+ * @param n number of cameras
+ * @param frames frames rendered along the orbit
+ * @param width,height offscreen size
+ * @param run output timings
+ * @return false if no GL context could be created
+ * @action one full orbit around the scene while zooming from far away to
+ *         inside the trajectory and back, so culling and level of detail
+ *         are exercised on every run
+ */
+static bool runBenchmark(size_t n, int frames, int width, int height,
+                         BenchmarkRun & run){
+    vector<double> positions;
+    vector<double> rotations;
+    generatePoses(n, positions, rotations);
+
+    TagViewer * viewer = new TagViewer(width, height);
+    if(!viewer->initOffscreen()){
+        delete viewer;
+        return false;
+    }
+    double start = wallMs();
+    viewer->addCameras(&positions[0], &rotations[0], n);
+    run.cameras = n;
+    run.loadMs = wallMs() - start;
+
+    // first frame pays for the full instance upload
+    start = wallMs();
+    viewer->drawFrame();
+    run.firstFrameMs = wallMs() - start;
+
+    vector<double> frameMs;
+    double cpuTotal = 0.0;
+    double drawCalls = 0.0;
+    double visible = 0.0;
+    for(int f = 0; f < frames; f++){
+        double t = (double)f / frames;
+        viewer->worldCamera.r = 0.35;
+        viewer->worldCamera.theta = 2.0 * PI * t;
+        viewer->worldCamera.distance = 20.0 + 280.0 * fabs(1.0 - 2.0 * t);
+
+        double wall = wallMs();
+        double cpu = cpuMs();
+        viewer->drawFrame();
+        cpuTotal += cpuMs() - cpu;
+        frameMs.push_back(wallMs() - wall);
+        drawCalls += viewer->frameDrawCalls();
+        visible += viewer->cullStats().visibleCameras;
+    }
+    delete viewer;
+
+    double sum = 0.0;
+    for(size_t i = 0; i < frameMs.size(); i++){
+        sum += frameMs[i];
+    }
+    sort(frameMs.begin(), frameMs.end());
+    run.frameMsMean = frames ? sum / frames : 0.0;
+    run.frameMsP50 = percentile(frameMs, 0.50);
+    run.frameMsP99 = percentile(frameMs, 0.99);
+    run.frameCpuMsMean = frames ? cpuTotal / frames : 0.0;
+    run.drawCallsMean = frames ? drawCalls / frames : 0.0;
+    run.visibleMean = frames ? visible / frames : 0.0;
+    run.peakRssKb = peakRssKb();
+    return true;
+}
+
+/**
+ * @brief writes benchmark results as JSON
+ */
+static void writeJSON(ostream & out, const vector<BenchmarkRun> & runs,
+                      const string & renderer, int width, int height,
+                      int frames){
+    out << "{\n";
+    out << "  \"renderer\": \"" << renderer << "\",\n";
+    out << "  \"quaternion_kernel\": \"" << quaternionKernelName() << "\",\n";
+    out << "  \"width\": " << width << ",\n";
+    out << "  \"height\": " << height << ",\n";
+    out << "  \"frames\": " << frames << ",\n";
+    out << "  \"runs\": [\n";
+    for(size_t i = 0; i < runs.size(); i++){
+        const BenchmarkRun & r = runs[i];
+        out << "    {\"cameras\": " << r.cameras
+            << ", \"load_ms\": " << r.loadMs
+            << ", \"first_frame_ms\": " << r.firstFrameMs
+            << ", \"frame_ms_mean\": " << r.frameMsMean
+            << ", \"frame_ms_p50\": " << r.frameMsP50
+            << ", \"frame_ms_p99\": " << r.frameMsP99
+            << ", \"frame_cpu_ms_mean\": " << r.frameCpuMsMean
+            << ", \"draw_calls_mean\": " << r.drawCallsMean
+            << ", \"visible_cameras_mean\": " << r.visibleMean
+            << ", \"peak_rss_kb\": " << r.peakRssKb << "}"
+            << (i + 1 < runs.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+
+int main(int argv, char** argc){
+    // parse options
+    size_t minCameras = 1000;
+    size_t maxCameras = 10000000;
+    int frames = 60;
+    int width = 640;
+    int height = 480;
+    const char * output = 0;
+    for(int i = 1; i < argv; i++){
+        const char * arg = argc[i];
+        bool hasValue = (i + 1 < argv);
+        if(strcmp(arg, "-min") == 0 && hasValue){
+            minCameras = strtoull(argc[++i], 0, 10);
+        } else if(strcmp(arg, "-max") == 0 && hasValue){
+            maxCameras = strtoull(argc[++i], 0, 10);
+        } else if(strcmp(arg, "-frames") == 0 && hasValue){
+            frames = atoi(argc[++i]);
+        } else if(strcmp(arg, "-size") == 0 && hasValue){
+            sscanf(argc[++i], "%dx%d", &width, &height);
+        } else if(strcmp(arg, "-o") == 0 && hasValue){
+            output = argc[++i];
+        } else {
+            cerr << "usage: " << argc[0] << " [-min N] [-max N] [-frames N]"
+                 << " [-size WxH] [-o result.json]" << endl;
+            return 1;
+        }
+    }
+
+    // sizes grow by 10x so peak RSS after each run belongs to that run
+    vector<BenchmarkRun> runs;
+    string renderer = "unknown";
+    for(size_t n = max(minCameras, (size_t)1); n <= maxCameras; n *= 10){
+        BenchmarkRun run;
+        if(!runBenchmark(n, frames, width, height, run)){
+            cerr << "benchmark: could not create offscreen GL context" << endl;
+            return 1;
+        }
+        cerr << n << " cameras: " << run.frameMsP50 << " ms p50, "
+             << run.frameMsP99 << " ms p99" << endl;
+        runs.push_back(run);
+    }
+    {
+        // renderer string needs a current context
+        OffscreenContext context;
+        if(context.create(1, 1)){
+            renderer = context.renderer();
+        }
+    }
+
+    if(output){
+        ofstream file(output);
+        if(!file){
+            cerr << "benchmark: could not write " << output << endl;
+            return 1;
+        }
+        writeJSON(file, runs, renderer, width, height, frames);
+    } else {
+        writeJSON(cout, runs, renderer, width, height, frames);
+    }
+    return 0;
+}
@@ -0,0 +1,953 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : CameraOctree.cpp
+ * @brief      : Definition file for camera octree and frustum culling
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cmath>
+#include <algorithm>
+#include "CameraOctree.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// half size of the first root node
+static const double INITIAL_HALF_SIZE = 16.0;
+// cameras farther out are not indexed. the root reaches any indexed camera
+// within MAX_GROWTH doublings
+static const double MAX_COORDINATE = 1e30;
+static const int MAX_GROWTH = 128;
+
+static void cross(const double * a, const double * b, double * out){
+    out[0] = a[1]*b[2] - a[2]*b[1];
+    out[1] = a[2]*b[0] - a[0]*b[2];
+    out[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static double dot(const double * a, const double * b){
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+static void normalize(double * v){
+    double n = sqrt(dot(v, v));
+    if(n > 0){
+        v[0] /= n;
+        v[1] /= n;
+        v[2] /= n;
+    }
+}
+
+/**
+ * @brief distance from p to nearest / farthest point of box [lo, hi]
+ */
+static double boxDistance(const double * p, const double * lo,
+                          const double * hi, bool farthest){
+    double d2 = 0;
+    for(int k = 0; k < 3; k++){
+        double d;
+        if(farthest){
+            d = max(fabs(p[k] - lo[k]), fabs(p[k] - hi[k]));
+        } else {
+            d = max(max(lo[k] - p[k], p[k] - hi[k]), 0.0);
+        }
+        d2 += d * d;
+    }
+    return sqrt(d2);
+}
+
+/**
+ * @brief projected size in pixels of an object of given world size
+ */
+static double projectedPixels(const LodParams & lod, double size,
+                              double distance){
+    if(distance <= 0){
+        return HUGE_VAL;
+    }
+    return size * lod.pixelsPerUnit / distance;
+}
+
+/**
+ * @brief sets plane through point with normal facing towards inside
+ */
+static void setPlane(double * plane, const double * normal,
+                     const double * point){
+    double n[3] = {normal[0], normal[1], normal[2]};
+    normalize(n);
+    plane[0] = n[0];
+    plane[1] = n[1];
+    plane[2] = n[2];
+    plane[3] = -dot(n, point);
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+/**
+ * @brief builds frustum planes
+ * @param eye camera position
+ * @param target look at point
+ * @param up up vector
+ * @param fovy vertical field of view in degrees
+ * @param aspect width / height
+ * @param zNear near plane distance
+ * @param zFar far plane distance
+ */
+void Frustum::set(const double * eye, const double * target,
+                  const double * up, double fovy, double aspect,
+                  double zNear, double zFar){
+    // camera basis as in gluLookAt
+    double f[3] = {target[0]-eye[0], target[1]-eye[1], target[2]-eye[2]};
+    normalize(f);
+    double s[3];
+    cross(f, up, s);
+    normalize(s);
+    double u[3];
+    cross(s, f, u);
+
+    double tanY = tan(fovy * 0.5 * M_PI / 180.0);
+    double tanX = tanY * aspect;
+
+    // near / far
+    double nearPoint[3] = {eye[0]+f[0]*zNear, eye[1]+f[1]*zNear,
+                           eye[2]+f[2]*zNear};
+    double farPoint[3] = {eye[0]+f[0]*zFar, eye[1]+f[1]*zFar,
+                          eye[2]+f[2]*zFar};
+    double back[3] = {-f[0], -f[1], -f[2]};
+    setPlane(planes[0], f, nearPoint);
+    setPlane(planes[1], back, farPoint);
+
+    // side planes contain the eye, an edge direction and the other axis
+    const double * axes[4] = {s, s, u, u};
+    const double * others[4] = {u, u, s, s};
+    double tans[4] = {tanX, -tanX, tanY, -tanY};
+    for(int i = 0; i < 4; i++){
+        double edge[3];
+        for(int k = 0; k < 3; k++){
+            edge[k] = f[k] + axes[i][k] * tans[i];
+        }
+        double n[3];
+        cross(edge, others[i], n);
+        if(dot(n, f) < 0){
+            n[0] = -n[0];
+            n[1] = -n[1];
+            n[2] = -n[2];
+        }
+        setPlane(planes[2 + i], n, eye);
+    }
+};
+
+/**
+ * @brief tests sphere against frustum
+ * @return true unless sphere is completely outside a plane
+ */
+bool Frustum::contains(const double * center, double radius) const{
+    for(int i = 0; i < 6; i++){
+        if(dot(planes[i], center) + planes[i][3] < -radius){
+            return false;
+        }
+    }
+    return true;
+};
+
+/**
+ * @brief classifies axis aligned box against frustum
+ * @param lo box minimum
+ * @param hi box maximum
+ * @return OUTSIDE, INTERSECT or INSIDE
+ */
+Frustum::Result Frustum::classify(const double * lo, const double * hi) const{
+    Result result = INSIDE;
+    for(int i = 0; i < 6; i++){
+        const double * p = planes[i];
+        // box corners furthest along / against the plane normal
+        double positive[3];
+        double negative[3];
+        for(int k = 0; k < 3; k++){
+            positive[k] = (p[k] >= 0) ? hi[k] : lo[k];
+            negative[k] = (p[k] >= 0) ? lo[k] : hi[k];
+        }
+        if(dot(p, positive) + p[3] < 0){
+            return OUTSIDE;
+        }
+        if(dot(p, negative) + p[3] < 0){
+            result = INTERSECT;
+        }
+    }
+    return result;
+};
+
+bool CameraOctree::Node::isLeaf() const{
+    return children[0] < 0 && children[1] < 0 && children[2] < 0 &&
+           children[3] < 0 && children[4] < 0 && children[5] < 0 &&
+           children[6] < 0 && children[7] < 0;
+}
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+CameraOctree::CameraOctree(){
+    root = -1;
+    count = 0;
+};
+
+/**
+ * @brief removes all cameras and nodes
+ */
+void CameraOctree::clear(){
+    nodes.clear();
+    root = -1;
+    count = 0;
+};
+
+/**
+ * @brief adds camera
+ * @param index camera index in the pose store
+ * @param position x,y,z of camera
+ * @return false if position is not finite or beyond MAX_COORDINATE. the
+ *         camera is not indexed then, so culling and picking never see it
+ */
+bool CameraOctree::insert(uint32_t index, const double * position){
+    Entry entry;
+    for(int k = 0; k < 3; k++){
+        if(!(fabs(position[k]) <= MAX_COORDINATE)){
+            return false;
+        }
+        entry.position[k] = (float)position[k];
+    }
+    entry.index = index;
+    if(root < 0){
+        root = newNode(position, INITIAL_HALF_SIZE);
+    }
+    if(!growToContain(entry.position)){
+        return false;
+    }
+    insertEntry(root, entry, 0);
+    count++;
+    return true;
+};
+
+/**
+ * @brief adds cameras with consecutive indices
+ * @param first index of the first camera
+ * @param positions n * x,y,z
+ * @param n number of cameras
+ * @return number of cameras indexed, positions insert rejects are left out
+ * @action the root grows once to the bounds of the batch, then the batch
+ *         is partitioned down the tree instead of walking it once per
+ *         camera
+ */
+size_t CameraOctree::insert(uint32_t first, const double * positions,
+                            size_t n){
+    vector<Entry> entries;
+    entries.reserve(n);
+    float lo[3] = {0, 0, 0};
+    float hi[3] = {0, 0, 0};
+    const double * start = 0;
+    for(size_t i = 0; i < n; i++){
+        const double * p = positions + 3 * i;
+        if(!(fabs(p[0]) <= MAX_COORDINATE && fabs(p[1]) <= MAX_COORDINATE &&
+             fabs(p[2]) <= MAX_COORDINATE)){
+            continue;
+        }
+        Entry entry;
+        for(int k = 0; k < 3; k++){
+            entry.position[k] = (float)p[k];
+            lo[k] = start ? min(lo[k], entry.position[k]) : entry.position[k];
+            hi[k] = start ? max(hi[k], entry.position[k]) : entry.position[k];
+        }
+        entry.index = first + (uint32_t)i;
+        entries.push_back(entry);
+        start = start ? start : p;
+    }
+    if(entries.empty()){
+        return 0;
+    }
+    if(root < 0){
+        root = newNode(start, INITIAL_HALF_SIZE);
+    }
+    // accepted positions are always reached within MAX_GROWTH
+    if(!growToContain(lo) || !growToContain(hi)){
+        return 0;
+    }
+    insertEntries(root, &entries[0], entries.size(), 0, lo, hi);
+    count += entries.size();
+    return entries.size();
+};
+
+/**
+ * @brief moves camera
+ * @param index camera index
+ * @param oldPosition position the camera was inserted / last moved with
+ * @param newPosition new position
+ * @return false if newPosition is rejected by insert. the camera is no
+ *         longer indexed then
+ */
+bool CameraOctree::move(uint32_t index, const double * oldPosition,
+                        const double * newPosition){
+    float p[3] = {(float)oldPosition[0], (float)oldPosition[1],
+                  (float)oldPosition[2]};
+    if(root >= 0 && removeEntry(root, index, p)){
+        count--;
+    }
+    return insert(index, newPosition);
+};
+
+/**
+ * @brief collects cameras visible in frustum
+ * @param frustum world space view frustum
+ * @param lod projected size thresholds
+ * @param result output camera indices / cluster proxies (cleared first)
+ * @param stats counters for this cull
+ * @param first,last index range of cameras to consider
+ * @return true if all cameras of the range are visible as pyramids. result
+ *         is left empty then
+ * @action subtrees whose index bounds miss the range are skipped, so a
+ *         short range costs little even on a large tree
+ */
+bool CameraOctree::cull(const Frustum & frustum, const LodParams & lod,
+                        CullResult & result, CullStats & stats,
+                        uint32_t first, uint32_t last) const{
+    result.pyramids.clear();
+    result.lines.clear();
+    result.clusters.clear();
+    // rejected positions leave holes in the indices, so count the range
+    size_t inRange = (root >= 0) ? countInRange(root, first, last) : 0;
+    stats.totalCameras = inRange;
+    stats.visibleCameras = 0;
+    stats.totalNodes = nodes.size();
+    stats.visitedNodes = 0;
+    stats.pyramidCameras = 0;
+    stats.lineCameras = 0;
+    stats.clusteredCameras = 0;
+    stats.clusterProxies = 0;
+    if(root < 0 || inRange == 0){
+        return true;
+    }
+
+    // whole range in view at full detail: skip building the index list
+    const Node & r = nodes[root];
+    double lo[3], hi[3];
+    for(int k = 0; k < 3; k++){
+        lo[k] = r.center[k] - r.halfSize - CAMERA_RADIUS;
+        hi[k] = r.center[k] + r.halfSize + CAMERA_RADIUS;
+    }
+    double farthest = boxDistance(lod.eye, lo, hi, true);
+    if(r.minIndex >= first && r.maxIndex < last &&
+       frustum.classify(lo, hi) == Frustum::INSIDE &&
+       projectedPixels(lod, 2 * CAMERA_RADIUS, farthest) >=
+       lod.pyramidPixels){
+        stats.visitedNodes = 1;
+        stats.visibleCameras = inRange;
+        stats.pyramidCameras = inRange;
+        return true;
+    }
+    cullNode(root, frustum, lod, first, last, result, stats, false);
+    stats.pyramidCameras = result.pyramids.size();
+    stats.lineCameras = result.lines.size();
+    stats.visibleCameras = stats.pyramidCameras + stats.lineCameras +
+                           stats.clusteredCameras;
+    return result.pyramids.size() == inRange;
+};
+
+/**
+ * @brief collects cameras near a point
+ * @param center query point
+ * @param radius distance from center up to which cameras are collected
+ * @param indices output, appended to
+ * @param first,last index range of cameras to consider
+ */
+void CameraOctree::collectNear(const double * center, double radius,
+                               vector<uint32_t> & indices, uint32_t first,
+                               uint32_t last) const{
+    if(root >= 0){
+        collectNear(root, center, radius, indices, first, last);
+    }
+};
+
+/**
+ * @brief finds nearest camera hit by ray
+ * @param origin ray origin
+ * @param dir ray direction (need not be normalized)
+ * @param test exact hit test for candidate cameras
+ * @param index hit camera index
+ * @param t distance of hit along normalized dir
+ * @return true if a camera was hit
+ */
+bool CameraOctree::raycast(const double * origin, const double * dir,
+                           RayHitTest & test, uint32_t & index,
+                           double & t) const{
+    if(root < 0){
+        return false;
+    }
+    double d[3] = {dir[0], dir[1], dir[2]};
+    normalize(d);
+    double inverse[3];
+    for(int k = 0; k < 3; k++){
+        inverse[k] = 1.0 / d[k];
+    }
+    double best = HUGE_VAL;
+    raycastNode(root, origin, d, inverse, test, index, best);
+    if(best == HUGE_VAL){
+        return false;
+    }
+    t = best;
+    return true;
+};
+
+/**
+ * @brief child octant of point
+ */
+int CameraOctree::octant(const Node & node, const float * p) const{
+    return (p[0] >= node.center[0] ? 1 : 0) |
+           (p[1] >= node.center[1] ? 2 : 0) |
+           (p[2] >= node.center[2] ? 4 : 0);
+}
+
+/**
+ * @brief checks whether point is inside node bounds
+ */
+bool CameraOctree::contains(const Node & node, const float * p) const{
+    for(int k = 0; k < 3; k++){
+        if(p[k] < node.center[k] - node.halfSize ||
+           p[k] >= node.center[k] + node.halfSize){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief doubles root towards p until it contains p
+ * @return false if p is still outside after MAX_GROWTH doublings
+ * @action old root becomes a child of the new root, so existing nodes and
+ *         entries stay where they are
+ */
+bool CameraOctree::growToContain(const float * p){
+    for(int grown = 0; !contains(nodes[root], p); grown++){
+        if(grown == MAX_GROWTH){
+            return false;
+        }
+        double half = nodes[root].halfSize;
+        double center[3];
+        int childOctant = 0;
+        for(int k = 0; k < 3; k++){
+            double sign = (p[k] >= nodes[root].center[k]) ? 1.0 : -1.0;
+            center[k] = nodes[root].center[k] + sign * half;
+            // old root lies on the opposite side of the new center
+            if(sign < 0){
+                childOctant |= (1 << k);
+            }
+        }
+        int32_t parent = newNode(center, half * 2.0);
+        nodes[parent].children[childOctant] = root;
+        nodes[parent].count = nodes[root].count;
+        for(int k = 0; k < 3; k++){
+            nodes[parent].sum[k] = nodes[root].sum[k];
+        }
+        nodes[parent].minIndex = nodes[root].minIndex;
+        nodes[parent].maxIndex = nodes[root].maxIndex;
+        root = parent;
+    }
+    return true;
+}
+
+/**
+ * @brief inserts entry below node
+ */
+void CameraOctree::insertEntry(int32_t node, const Entry & entry, int depth){
+    while(true){
+        addToNode(node, entry.position, 1.0);
+        nodes[node].minIndex = min(nodes[node].minIndex, entry.index);
+        nodes[node].maxIndex = max(nodes[node].maxIndex, entry.index);
+        if(nodes[node].isLeaf()){
+            nodes[node].entries.push_back(entry);
+            if(nodes[node].entries.size() > LEAF_CAPACITY &&
+               depth < MAX_DEPTH){
+                split(node, depth);
+            }
+            return;
+        }
+        int o = octant(nodes[node], entry.position);
+        int32_t child = nodes[node].children[o];
+        if(child < 0){
+            double half = nodes[node].halfSize * 0.5;
+            double center[3];
+            for(int k = 0; k < 3; k++){
+                center[k] = nodes[node].center[k] +
+                            (((o >> k) & 1) ? half : -half);
+            }
+            child = newNode(center, half);
+            nodes[node].children[o] = child;
+        }
+        node = child;
+        depth++;
+    }
+}
+
+/**
+ * @brief inserts n entries below node
+ * @param lo,hi bounds of the entries (may be loose)
+ * @action node totals are updated once for the batch. a leaf going over
+ *         LEAF_CAPACITY becomes an inner node and its entries go down
+ *         with the batch, as split would have moved them
+ */
+void CameraOctree::insertEntries(int32_t node, Entry * entries, size_t n,
+                                 int depth, const float * lo,
+                                 const float * hi){
+    Node & target = nodes[node];
+    target.count += n;
+    for(size_t i = 0; i < n; i++){
+        for(int k = 0; k < 3; k++){
+            target.sum[k] += entries[i].position[k];
+        }
+        target.minIndex = min(target.minIndex, entries[i].index);
+        target.maxIndex = max(target.maxIndex, entries[i].index);
+    }
+    if(!target.isLeaf()){
+        distribute(node, entries, n, depth, lo, hi);
+        return;
+    }
+    if(target.entries.size() + n <= LEAF_CAPACITY || depth >= MAX_DEPTH){
+        target.entries.insert(target.entries.end(), entries, entries + n);
+        return;
+    }
+    vector<Entry> all;
+    all.swap(target.entries);
+    all.insert(all.end(), entries, entries + n);
+    float allLo[3], allHi[3];
+    for(int k = 0; k < 3; k++){
+        allLo[k] = lo[k];
+        allHi[k] = hi[k];
+    }
+    for(size_t i = 0; i + n < all.size(); i++){
+        for(int k = 0; k < 3; k++){
+            allLo[k] = min(allLo[k], all[i].position[k]);
+            allHi[k] = max(allHi[k], all[i].position[k]);
+        }
+    }
+    distribute(node, &all[0], all.size(), depth, allLo, allHi);
+}
+
+/**
+ * @brief sorts n entries into the octants of inner node and inserts them
+ *        into its children
+ * @param lo,hi bounds of the entries (may be loose)
+ * @action the entries are partitioned in place along the axes their bounds
+ *         cross the center on, children are created for octants that get
+ *         entries. a batch within one octant passes down untouched
+ */
+void CameraOctree::distribute(int32_t node, Entry * entries, size_t n,
+                              int depth, const float * lo, const float * hi){
+    double center[3];
+    for(int k = 0; k < 3; k++){
+        center[k] = nodes[node].center[k];
+    }
+    double half = nodes[node].halfSize * 0.5;
+    // ranges [begin, end) of octant[r]
+    Entry * begin[8];
+    Entry * end[8];
+    int octants[8];
+    begin[0] = entries;
+    end[0] = entries + n;
+    octants[0] = 0;
+    int ranges = 1;
+    for(int k = 0; k < 3; k++){
+        if(lo[k] >= center[k] || hi[k] < center[k]){
+            // every entry on one side
+            for(int r = 0; r < ranges; r++){
+                octants[r] |= (lo[k] >= center[k]) ? (1 << k) : 0;
+            }
+            continue;
+        }
+        for(int r = 0; r < ranges; r++){
+            // below the center first, like octant()
+            Entry * below = begin[r];
+            Entry * above = end[r];
+            while(below < above){
+                if(below->position[k] < center[k]){
+                    below++;
+                } else {
+                    swap(*below, *--above);
+                }
+            }
+            begin[ranges + r] = below;
+            end[ranges + r] = end[r];
+            octants[ranges + r] = octants[r] | (1 << k);
+            end[r] = below;
+        }
+        ranges *= 2;
+    }
+    for(int r = 0; r < ranges; r++){
+        if(begin[r] == end[r]){
+            continue;
+        }
+        int o = octants[r];
+        int32_t child = nodes[node].children[o];
+        if(child < 0){
+            double c[3];
+            for(int k = 0; k < 3; k++){
+                c[k] = center[k] + (((o >> k) & 1) ? half : -half);
+            }
+            child = newNode(c, half);
+            nodes[node].children[o] = child;
+        }
+        // the octant's part of the bounds
+        float childLo[3], childHi[3];
+        for(int k = 0; k < 3; k++){
+            bool above = (o >> k) & 1;
+            childLo[k] = above ? max(lo[k], (float)center[k]) : lo[k];
+            childHi[k] = above ? hi[k] : min(hi[k], (float)center[k]);
+        }
+        insertEntries(child, begin[r], end[r] - begin[r], depth + 1,
+                      childLo, childHi);
+    }
+}
+
+/**
+ * @brief removes entry with index found at point p below node
+ * @return true if found
+ */
+bool CameraOctree::removeEntry(int32_t node, uint32_t index, const float * p){
+    vector<int32_t> path;
+    while(node >= 0 && !nodes[node].isLeaf()){
+        path.push_back(node);
+        node = nodes[node].children[octant(nodes[node], p)];
+    }
+    if(node < 0){
+        return false;
+    }
+    vector<Entry> & entries = nodes[node].entries;
+    for(size_t i = 0; i < entries.size(); i++){
+        if(entries[i].index == index){
+            entries[i] = entries.back();
+            entries.pop_back();
+            addToNode(node, p, -1.0);
+            for(size_t j = 0; j < path.size(); j++){
+                addToNode(path[j], p, -1.0);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief adds (sign 1) or removes (sign -1) a camera at p from node totals
+ */
+void CameraOctree::addToNode(int32_t node, const float * p, double sign){
+    Node & n = nodes[node];
+    if(sign > 0){
+        n.count++;
+    } else {
+        n.count--;
+    }
+    for(int k = 0; k < 3; k++){
+        n.sum[k] += sign * p[k];
+    }
+}
+
+/**
+ * @brief turns leaf into internal node and pushes its entries down
+ */
+void CameraOctree::split(int32_t node, int depth){
+    vector<Entry> entries;
+    entries.swap(nodes[node].entries);
+    // make node internal by creating its first child, then re-insert
+    double half = nodes[node].halfSize * 0.5;
+    int o = octant(nodes[node], entries[0].position);
+    double center[3];
+    for(int k = 0; k < 3; k++){
+        center[k] = nodes[node].center[k] + (((o >> k) & 1) ? half : -half);
+    }
+    int32_t child = newNode(center, half);
+    nodes[node].children[o] = child;
+    for(size_t i = 0; i < entries.size(); i++){
+        addToNode(node, entries[i].position, -1.0);
+        insertEntry(node, entries[i], depth);
+    }
+}
+
+/**
+ * @brief appends every camera below node without testing
+ */
+void CameraOctree::collect(int32_t node, vector<uint32_t> & visible,
+                           CullStats & stats) const{
+    const Node & n = nodes[node];
+    for(size_t i = 0; i < n.entries.size(); i++){
+        visible.push_back(n.entries[i].index);
+    }
+    for(int c = 0; c < 8; c++){
+        if(n.children[c] >= 0){
+            stats.visitedNodes++;
+            collect(n.children[c], visible, stats);
+        }
+    }
+}
+
+/**
+ * @brief number of cameras below node with indices in [first, last)
+ * @action subtrees whose index bounds lie inside the range add their
+ *         count, subtrees missing it are skipped
+ */
+size_t CameraOctree::countInRange(int32_t node, uint32_t first,
+                                  uint32_t last) const{
+    const Node & n = nodes[node];
+    if(n.count == 0 || n.maxIndex < first || n.minIndex >= last){
+        return 0;
+    }
+    if(n.minIndex >= first && n.maxIndex < last){
+        return n.count;
+    }
+    size_t inRange = 0;
+    for(size_t i = 0; i < n.entries.size(); i++){
+        inRange += (n.entries[i].index >= first &&
+                    n.entries[i].index < last);
+    }
+    for(int c = 0; c < 8; c++){
+        if(n.children[c] >= 0){
+            inRange += countInRange(n.children[c], first, last);
+        }
+    }
+    return inRange;
+}
+
+/**
+ * @brief recursive part of collectNear, skips nodes farther than radius
+ */
+void CameraOctree::collectNear(int32_t node, const double * center,
+                               double radius, vector<uint32_t> & indices,
+                               uint32_t first, uint32_t last) const{
+    const Node & n = nodes[node];
+    if(n.count == 0 || n.maxIndex < first || n.minIndex >= last){
+        return;
+    }
+    double lo[3], hi[3];
+    for(int k = 0; k < 3; k++){
+        lo[k] = n.center[k] - n.halfSize;
+        hi[k] = n.center[k] + n.halfSize;
+    }
+    if(boxDistance(center, lo, hi, false) > radius){
+        return;
+    }
+    double radius2 = radius * radius;
+    for(size_t i = 0; i < n.entries.size(); i++){
+        const Entry & e = n.entries[i];
+        double d[3] = {e.position[0] - center[0], e.position[1] - center[1],
+                       e.position[2] - center[2]};
+        if(e.index >= first && e.index < last &&
+           d[0] * d[0] + d[1] * d[1] + d[2] * d[2] <= radius2){
+            indices.push_back(e.index);
+        }
+    }
+    for(int c = 0; c < 8; c++){
+        if(n.children[c] >= 0){
+            collectNear(n.children[c], center, radius, indices, first, last);
+        }
+    }
+}
+
+/**
+ * @brief recursive frustum test and lod selection
+ * @action nodes are loose by the camera radius so a camera whose center
+ *         lies in a culled node can never reach into the view. a node whose
+ *         cameras are all below pyramid size and which itself covers less
+ *         than clusterPixels becomes one proxy at the mean camera position.
+ *         below a fully inside node no frustum tests are needed. nodes
+ *         partly out of the index range neither cluster nor collect, their
+ *         cameras are tested one by one
+ */
+void CameraOctree::cullNode(int32_t node, const Frustum & frustum,
+                            const LodParams & lod, uint32_t first,
+                            uint32_t last, CullResult & result,
+                            CullStats & stats, bool fullyInside) const{
+    const Node & n = nodes[node];
+    if(n.count == 0 || n.maxIndex < first || n.minIndex >= last){
+        return;
+    }
+    bool inRange = (n.minIndex >= first && n.maxIndex < last);
+    stats.visitedNodes++;
+    double lo[3], hi[3];
+    for(int k = 0; k < 3; k++){
+        lo[k] = n.center[k] - n.halfSize - CAMERA_RADIUS;
+        hi[k] = n.center[k] + n.halfSize + CAMERA_RADIUS;
+    }
+    Frustum::Result inside = fullyInside ? Frustum::INSIDE
+                                         : frustum.classify(lo, hi);
+    if(inside == Frustum::OUTSIDE){
+        return;
+    }
+
+    const double cameraSize = 2 * CAMERA_RADIUS;
+    double nearest = boxDistance(lod.eye, lo, hi, false);
+    if(projectedPixels(lod, cameraSize, nearest) < lod.pyramidPixels){
+        // every camera below is a line or part of a cluster
+        double nodeSize = 2 * sqrt(3.0) * n.halfSize + cameraSize;
+        if(n.count > 1 && inRange &&
+           projectedPixels(lod, nodeSize, nearest) < lod.clusterPixels){
+            for(int k = 0; k < 3; k++){
+                result.clusters.push_back((float)(n.sum[k] / n.count));
+            }
+            result.clusters.push_back((float)n.count);
+            stats.clusteredCameras += n.count;
+            stats.clusterProxies++;
+            return;
+        }
+        // without clusters nothing below changes representation
+        if(inside == Frustum::INSIDE && inRange && lod.clusterPixels <= 0){
+            collect(node, result.lines, stats);
+            return;
+        }
+    } else if(inside == Frustum::INSIDE && inRange &&
+              projectedPixels(lod, cameraSize,
+                              boxDistance(lod.eye, lo, hi, true)) >=
+              lod.pyramidPixels){
+        collect(node, result.pyramids, stats);
+        return;
+    }
+
+    for(size_t i = 0; i < n.entries.size(); i++){
+        uint32_t index = n.entries[i].index;
+        if(index < first || index >= last){
+            continue;
+        }
+        double p[3] = {n.entries[i].position[0], n.entries[i].position[1],
+                       n.entries[i].position[2]};
+        if(inside != Frustum::INSIDE && !frustum.contains(p, CAMERA_RADIUS)){
+            continue;
+        }
+        double d = sqrt((p[0] - lod.eye[0]) * (p[0] - lod.eye[0]) +
+                        (p[1] - lod.eye[1]) * (p[1] - lod.eye[1]) +
+                        (p[2] - lod.eye[2]) * (p[2] - lod.eye[2]));
+        if(projectedPixels(lod, cameraSize, d) >= lod.pyramidPixels){
+            result.pyramids.push_back(index);
+        } else {
+            result.lines.push_back(index);
+        }
+    }
+    for(int c = 0; c < 8; c++){
+        if(n.children[c] >= 0){
+            cullNode(n.children[c], frustum, lod, first, last, result,
+                     stats, inside == Frustum::INSIDE);
+        }
+    }
+}
+
+/**
+ * @brief recursive front to back ray traversal
+ * @param best distance of nearest hit so far, HUGE_VAL if none
+ */
+void CameraOctree::raycastNode(int32_t node, const double * origin,
+                               const double * dir, const double * inverse,
+                               RayHitTest & test, uint32_t & index,
+                               double & best) const{
+    const Node & n = nodes[node];
+    for(size_t i = 0; i < n.entries.size(); i++){
+        // bounding sphere first
+        double toCenter[3];
+        for(int k = 0; k < 3; k++){
+            toCenter[k] = n.entries[i].position[k] - origin[k];
+        }
+        double along = dot(toCenter, dir);
+        double d2 = dot(toCenter, toCenter) - along * along;
+        double r2 = CAMERA_RADIUS * CAMERA_RADIUS;
+        if(d2 > r2 || along + CAMERA_RADIUS < 0 ||
+           along - sqrt(r2 - d2) > best){
+            continue;
+        }
+        double t;
+        if(test.hit(n.entries[i].index, t) && t >= 0 && t < best){
+            best = t;
+            index = n.entries[i].index;
+        }
+    }
+
+    // children ordered by entry distance
+    int order[8];
+    double enter[8];
+    int children = 0;
+    for(int c = 0; c < 8; c++){
+        double e;
+        if(n.children[c] < 0 || nodes[n.children[c]].count == 0 ||
+           !rayBox(n.children[c], origin, inverse, e)){
+            continue;
+        }
+        int j = children++;
+        while(j > 0 && enter[j - 1] > e){
+            enter[j] = enter[j - 1];
+            order[j] = order[j - 1];
+            j--;
+        }
+        enter[j] = e;
+        order[j] = n.children[c];
+    }
+    for(int i = 0; i < children; i++){
+        if(enter[i] > best){
+            break;
+        }
+        raycastNode(order[i], origin, dir, inverse, test, index, best);
+    }
+}
+
+/**
+ * @brief slab test of ray against loose node box
+ * @param enter distance where ray enters box (0 if origin is inside)
+ * @return true if ray hits box in front of origin
+ */
+bool CameraOctree::rayBox(int32_t node, const double * origin,
+                          const double * inverse, double & enter) const{
+    const Node & n = nodes[node];
+    double near = 0.0;
+    double far = HUGE_VAL;
+    for(int k = 0; k < 3; k++){
+        double half = n.halfSize + CAMERA_RADIUS;
+        double t0 = (n.center[k] - half - origin[k]) * inverse[k];
+        double t1 = (n.center[k] + half - origin[k]) * inverse[k];
+        if(t0 > t1){
+            swap(t0, t1);
+        }
+        near = max(near, t0);
+        far = min(far, t1);
+        if(near > far){
+            return false;
+        }
+    }
+    enter = near;
+    return true;
+}
+
+/**
+ * @brief appends empty leaf node
+ * @return node index
+ */
+int32_t CameraOctree::newNode(const double * center, double halfSize){
+    Node node;
+    for(int k = 0; k < 3; k++){
+        node.center[k] = center[k];
+    }
+    node.halfSize = halfSize;
+    for(int c = 0; c < 8; c++){
+        node.children[c] = -1;
+    }
+    node.count = 0;
+    node.sum[0] = node.sum[1] = node.sum[2] = 0;
+    // empty range until the first insert
+    node.minIndex = UINT32_MAX;
+    node.maxIndex = 0;
+    nodes.push_back(node);
+    return (int32_t)nodes.size() - 1;
+}
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
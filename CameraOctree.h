@@ -0,0 +1,205 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : CameraOctree.h
+ * @brief      : Incremental octree over camera positions and view frustum
+ *               culling
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef CAMERAOCTREE_H
+#define CAMERAOCTREE_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// radius of the sphere bounding the unit camera pyramid
+#define CAMERA_RADIUS 1.75
+
+// six world space planes (a,b,c,d), inside where a*x + b*y + c*z + d >= 0
+class Frustum
+{
+public:
+    enum Result {
+        OUTSIDE = -1,
+        INTERSECT = 0,
+        INSIDE = 1
+    };
+
+    // builds planes from gluPerspective / gluLookAt parameters
+    void set(const double * eye, const double * target, const double * up,
+             double fovy, double aspect, double zNear, double zFar);
+
+    // sphere test
+    bool contains(const double * center, double radius) const;
+
+    // box test of [lo, hi]
+    Result classify(const double * lo, const double * hi) const;
+
+    double planes[6][4];
+};
+
+// level of detail selection by projected size in pixels. a threshold of 0
+// disables that level
+struct LodParams {
+    // world camera position
+    double eye[3];
+    // pixels covered by one world unit at distance 1
+    // (viewport height / (2 tan(fovy / 2)))
+    double pixelsPerUnit;
+    // cameras at least this large are drawn as full pyramids, smaller ones
+    // as lines
+    double pyramidPixels;
+    // octree nodes smaller than this collapse into one cluster proxy
+    double clusterPixels;
+};
+
+// visible cameras split by representation
+struct CullResult {
+    vector<uint32_t> pyramids;
+    vector<uint32_t> lines;
+    // x,y,z,count per proxy
+    vector<float> clusters;
+};
+
+// exact hit test against one camera, used by CameraOctree::raycast
+class RayHitTest
+{
+public:
+    virtual ~RayHitTest() {};
+    // true if camera index is hit, with t the distance along the ray
+    virtual bool hit(uint32_t index, double & t) = 0;
+};
+
+// per cull counters
+struct CullStats {
+    size_t totalCameras;
+    size_t visibleCameras;
+    size_t totalNodes;
+    size_t visitedNodes;
+    size_t pyramidCameras;
+    size_t lineCameras;
+    size_t clusteredCameras;
+    size_t clusterProxies;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// Loose point octree keyed by camera index. Leaves split once they hold more
+// than LEAF_CAPACITY cameras; the root grows outwards when a camera lands
+// outside of it, so no bounds have to be known up front.
+class CameraOctree
+{
+public:
+    CameraOctree();
+
+    void clear();
+    size_t size() const { return count; };
+    size_t nodeCount() const { return nodes.size(); };
+
+    // adds camera index at position. false (camera not indexed) if the
+    // position is not finite or too far out to index
+    bool insert(uint32_t index, const double * position);
+    // adds n cameras indexed first, first + 1, ... at positions (n * x,y,z)
+    // in one pass. returns the number indexed
+    size_t insert(uint32_t first, const double * positions, size_t n);
+
+    // moves camera index from oldPosition to newPosition. false if
+    // newPosition is rejected as in insert
+    bool move(uint32_t index, const double * oldPosition,
+              const double * newPosition);
+
+    // collects indices of cameras whose bounding sphere touches the
+    // frustum, sorted into representations by lod. only indices in
+    // [first, last) are considered. returns true without filling result if
+    // every indexed camera of the range is inside and drawn as a pyramid
+    bool cull(const Frustum & frustum, const LodParams & lod,
+              CullResult & result, CullStats & stats, uint32_t first = 0,
+              uint32_t last = UINT32_MAX) const;
+
+    // appends indices in [first, last) of cameras within radius of center
+    void collectNear(const double * center, double radius,
+                     vector<uint32_t> & indices, uint32_t first = 0,
+                     uint32_t last = UINT32_MAX) const;
+
+    // nearest camera along ray (origin + t * dir, t >= 0). cameras whose
+    // bounding sphere the ray crosses are passed to test front to back and
+    // nodes behind the nearest hit are skipped
+    bool raycast(const double * origin, const double * dir, RayHitTest & test,
+                 uint32_t & index, double & t) const;
+
+    static const size_t LEAF_CAPACITY = 64;
+    static const int MAX_DEPTH = 24;
+private:
+    struct Entry {
+        float position[3];
+        uint32_t index;
+    };
+    struct Node {
+        double center[3];
+        double halfSize;
+        int32_t children[8];
+        // cameras in this subtree and sum of their positions
+        size_t count;
+        double sum[3];
+        // bounds of camera indices in this subtree. not shrunk on removal,
+        // so they may be wider than the cameras still below
+        uint32_t minIndex;
+        uint32_t maxIndex;
+        // leaf bucket
+        vector<Entry> entries;
+        bool isLeaf() const;
+    };
+
+    int octant(const Node & node, const float * p) const;
+    bool contains(const Node & node, const float * p) const;
+    bool growToContain(const float * p);
+    void insertEntry(int32_t node, const Entry & entry, int depth);
+    void insertEntries(int32_t node, Entry * entries, size_t n, int depth,
+                       const float * lo, const float * hi);
+    void distribute(int32_t node, Entry * entries, size_t n, int depth,
+                    const float * lo, const float * hi);
+    bool removeEntry(int32_t node, uint32_t index, const float * p);
+    void split(int32_t node, int depth);
+    void addToNode(int32_t node, const float * p, double sign);
+    void collect(int32_t node, vector<uint32_t> & visible,
+                 CullStats & stats) const;
+    size_t countInRange(int32_t node, uint32_t first, uint32_t last) const;
+    void collectNear(int32_t node, const double * center, double radius,
+                     vector<uint32_t> & indices, uint32_t first,
+                     uint32_t last) const;
+    void cullNode(int32_t node, const Frustum & frustum,
+                  const LodParams & lod, uint32_t first, uint32_t last,
+                  CullResult & result, CullStats & stats,
+                  bool fullyInside) const;
+    void raycastNode(int32_t node, const double * origin, const double * dir,
+                     const double * inverse, RayHitTest & test,
+                     uint32_t & index, double & best) const;
+    bool rayBox(int32_t node, const double * origin, const double * inverse,
+                double & enter) const;
+    int32_t newNode(const double * center, double halfSize);
+
+    vector<Node> nodes;
+    int32_t root;
+    size_t count;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
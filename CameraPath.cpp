@@ -0,0 +1,123 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : CameraPath.cpp
+ * @brief      : Definition file for keyframed world camera paths
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <algorithm>
+#include "CameraPath.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// orders keys by time
+struct KeyTimeLess {
+    bool operator()(const CameraKey & key, double time) const {
+        return key.time < time;
+    }
+};
+
+/**
+ * @brief non uniform Catmull-Rom segment between p1 and p2
+ * @param t0,t1,t2,t3 key times of p0..p3
+ * @param t time in [t1, t2]
+ * @action tangents are finite differences over the neighbouring keys, so
+ *         unevenly spaced keys do not overshoot
+ */
+static double catmullRom(double p0, double p1, double p2, double p3,
+                         double t0, double t1, double t2, double t3,
+                         double t){
+    double span = t2 - t1;
+    double m1 = (t2 > t0) ? (p2 - p0) / (t2 - t0) * span : 0.0;
+    double m2 = (t3 > t1) ? (p3 - p1) / (t3 - t1) * span : 0.0;
+    double s = (t - t1) / span;
+    double s2 = s * s;
+    double s3 = s2 * s;
+    return (2 * s3 - 3 * s2 + 1) * p1 + (s3 - 2 * s2 + s) * m1 +
+           (-2 * s3 + 3 * s2) * p2 + (s3 - s2) * m2;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief inserts key in time order
+ * @param time key time in seconds
+ * @param r,theta,distance world camera orbit at time
+ */
+void CameraPath::add(double time, double r, double theta, double distance){
+    CameraKey key = {time, r, theta, distance};
+    vector<CameraKey>::iterator it =
+        lower_bound(keys.begin(), keys.end(), time, KeyTimeLess());
+    if(it != keys.end() && it->time == time){
+        *it = key;
+    } else {
+        keys.insert(it, key);
+    }
+};
+
+/**
+ * @brief time of the first key
+ */
+double CameraPath::begin() const{
+    return keys.empty() ? 0.0 : keys.front().time;
+};
+
+/**
+ * @brief time of the last key
+ */
+double CameraPath::end() const{
+    return keys.empty() ? 0.0 : keys.back().time;
+};
+
+/**
+ * @brief interpolates orbit at time
+ * @param time seconds. clamped to the key range
+ * @param r,theta,distance interpolated orbit
+ * @return false if there are no keys
+ */
+bool CameraPath::sample(double time, double & r, double & theta,
+                        double & distance) const{
+    if(keys.empty()){
+        return false;
+    }
+    if(time <= keys.front().time || keys.size() == 1){
+        r = keys.front().r;
+        theta = keys.front().theta;
+        distance = keys.front().distance;
+        return true;
+    }
+    if(time >= keys.back().time){
+        r = keys.back().r;
+        theta = keys.back().theta;
+        distance = keys.back().distance;
+        return true;
+    }
+    // segment [i1, i2] containing time, end keys repeated
+    size_t i2 = lower_bound(keys.begin(), keys.end(), time, KeyTimeLess()) -
+                keys.begin();
+    size_t i1 = i2 - 1;
+    size_t i0 = (i1 > 0) ? i1 - 1 : i1;
+    size_t i3 = (i2 + 1 < keys.size()) ? i2 + 1 : i2;
+    const CameraKey & k0 = keys[i0];
+    const CameraKey & k1 = keys[i1];
+    const CameraKey & k2 = keys[i2];
+    const CameraKey & k3 = keys[i3];
+    r = catmullRom(k0.r, k1.r, k2.r, k3.r,
+                   k0.time, k1.time, k2.time, k3.time, time);
+    theta = catmullRom(k0.theta, k1.theta, k2.theta, k3.theta,
+                       k0.time, k1.time, k2.time, k3.time, time);
+    distance = catmullRom(k0.distance, k1.distance, k2.distance, k3.distance,
+                          k0.time, k1.time, k2.time, k3.time, time);
+    return true;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
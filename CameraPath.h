@@ -0,0 +1,67 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : CameraPath.h
+ * @brief      : Keyframed world camera orbit (r / theta / distance) over time
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <vector>
+#include <cstddef>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// world camera orbit at a point in time (seconds)
+struct CameraKey {
+    double time;
+    double r;
+    double theta;
+    double distance;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// Keys are kept sorted by time and interpolated with Catmull-Rom splines,
+// so the path passes through every key with continuous velocity. theta is
+// not wrapped: going from 0 to 2 pi turns once around the target
+class CameraPath
+{
+public:
+    void clear() { keys.clear(); };
+    size_t size() const { return keys.size(); };
+    bool empty() const { return keys.empty(); };
+    const CameraKey & key(size_t i) const { return keys[i]; };
+
+    // inserts key, replacing one at the same time
+    void add(double time, double r, double theta, double distance);
+
+    // time of the first / last key. 0 for an empty path
+    double begin() const;
+    double end() const;
+
+    // orbit at time, clamped to the first / last key. false if empty
+    bool sample(double time, double & r, double & theta,
+                double & distance) const;
+private:
+    vector<CameraKey> keys;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
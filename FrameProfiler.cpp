@@ -0,0 +1,377 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : FrameProfiler.cpp
+ * @brief      : Definition file for frame profiler
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <utility>
+#include <unistd.h>
+#include "FrameProfiler.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// pseudo phase of whole frames in traces
+static const int TRACE_FRAME = -1;
+
+/**
+ * @brief checks for GL 3.3 or ARB_timer_query on current context
+ */
+static bool hasTimerQuery(){
+    const char * version = (const char *)glGetString(GL_VERSION);
+    int major = 0;
+    int minor = 0;
+    if(version && sscanf(version, "%d.%d", &major, &minor) == 2 &&
+       (major > 3 || (major == 3 && minor >= 3))){
+        return true;
+    }
+    const char * extensions = (const char *)glGetString(GL_EXTENSIONS);
+    return extensions && strstr(extensions, "GL_ARB_timer_query");
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ * @action GPU timing stays off until initGL
+ */
+FrameProfiler::FrameProfiler(){
+    origin = 0.0;
+    origin = now();
+    frameIndex = 0;
+    inFrame = false;
+    timerQueries = false;
+    gpuPending = 0;
+    gpuOrigin = 0;
+    gpuOriginCPU = 0.0;
+    memset(queries, 0, sizeof(queries));
+    memset(issued, 0, sizeof(issued));
+    for(size_t i = 0; i < HISTORY; i++){
+        frames[i].start = 0.0;
+        frames[i].total = 0.0;
+        for(int p = 0; p < PHASE_COUNT; p++){
+            frames[i].cpu[p] = 0.0;
+            frames[i].gpu[p] = -1.0;
+        }
+    }
+    for(int p = 0; p < PHASE_COUNT; p++){
+        phaseStart[p] = 0.0;
+    }
+};
+
+/**
+ * @brief Destructor
+ * @action writes pending trace. timer queries are deleted by releaseGL,
+ *         which needs their context current
+ */
+FrameProfiler::~FrameProfiler(){
+    stopTrace();
+};
+
+/**
+ * @brief sets up GPU timer queries on the current context
+ * @action pairs a GL timestamp with the CPU clock so GPU events can be
+ *         placed on the same trace timeline
+ */
+void FrameProfiler::initGL(){
+    timerQueries = hasTimerQuery();
+    if(!timerQueries){
+        return;
+    }
+    glGenQueries(HISTORY * PHASE_COUNT * 2, &queries[0][0][0]);
+    memset(issued, 0, sizeof(issued));
+    gpuPending = frameIndex;
+    glGetInteger64v(GL_TIMESTAMP, &gpuOrigin);
+    gpuOriginCPU = now();
+};
+
+/**
+ * @brief deletes the timer queries
+ * @action GPU timing stays off until the next initGL
+ */
+void FrameProfiler::releaseGL(){
+    if(timerQueries){
+        glDeleteQueries(HISTORY * PHASE_COUNT * 2, &queries[0][0][0]);
+    }
+    timerQueries = false;
+    memset(queries, 0, sizeof(queries));
+    memset(issued, 0, sizeof(issued));
+    gpuPending = frameIndex;
+};
+
+/**
+ * @brief exchanges timer queries with obj
+ * @param obj profiler of the viewer that takes over this context
+ * @action the GL / CPU clock pairing moves with the queries, converted to
+ *         the CPU origin of the profiler that now owns them
+ */
+void FrameProfiler::swapGL(FrameProfiler & obj){
+    swap(timerQueries, obj.timerQueries);
+    swap(queries, obj.queries);
+    swap(gpuOrigin, obj.gpuOrigin);
+    double cpu = gpuOriginCPU + origin;
+    gpuOriginCPU = obj.gpuOriginCPU + obj.origin - origin;
+    obj.gpuOriginCPU = cpu - obj.origin;
+    memset(issued, 0, sizeof(issued));
+    memset(obj.issued, 0, sizeof(obj.issued));
+    gpuPending = frameIndex;
+    obj.gpuPending = obj.frameIndex;
+};
+
+/**
+ * @brief marks start of a frame
+ */
+void FrameProfiler::beginFrame(){
+    frames[frameIndex % HISTORY].start = now();
+    inFrame = true;
+};
+
+/**
+ * @brief marks end of a frame
+ * @action finishes the ring slot, picks up GPU results that are ready and
+ *         clears the next slot. input timed before the next beginFrame
+ *         counts towards the next frame
+ */
+void FrameProfiler::endFrame(){
+    FrameTiming & current = frames[frameIndex % HISTORY];
+    double end = now();
+    current.total = (end - current.start) * 1000.0;
+    inFrame = false;
+    if(tracing()){
+        addTraceEvent(TRACE_FRAME, 0, current.start, end - current.start);
+    }
+    frameIndex++;
+
+    if(timerQueries){
+        collectGPU(false);
+        // slot about to be reused still waits for its results
+        if(frameIndex - gpuPending >= HISTORY){
+            collectGPU(true);
+        }
+    }
+    size_t slot = frameIndex % HISTORY;
+    frames[slot].start = end;
+    frames[slot].total = 0.0;
+    for(int p = 0; p < PHASE_COUNT; p++){
+        frames[slot].cpu[p] = 0.0;
+        frames[slot].gpu[p] = -1.0;
+        issued[slot][p] = false;
+    }
+};
+
+/**
+ * @brief starts timing phase
+ */
+void FrameProfiler::beginPhase(ProfilePhase phase){
+    phaseStart[phase] = now();
+    size_t slot = frameIndex % HISTORY;
+    if(timerQueries && inFrame && !issued[slot][phase]){
+        glQueryCounter(queries[slot][phase][0], GL_TIMESTAMP);
+    }
+};
+
+/**
+ * @brief stops timing phase
+ * @action CPU time adds up over repeated phases within a frame
+ */
+void FrameProfiler::endPhase(ProfilePhase phase){
+    double duration = now() - phaseStart[phase];
+    size_t slot = frameIndex % HISTORY;
+    frames[slot].cpu[phase] += duration * 1000.0;
+    if(tracing()){
+        addTraceEvent(phase, 0, phaseStart[phase], duration);
+    }
+    if(timerQueries && inFrame && !issued[slot][phase]){
+        glQueryCounter(queries[slot][phase][1], GL_TIMESTAMP);
+        issued[slot][phase] = true;
+    }
+};
+
+/**
+ * @brief number of finished frames available through frame()
+ */
+size_t FrameProfiler::frameCount() const{
+    return (frameIndex < HISTORY) ? frameIndex : HISTORY;
+};
+
+/**
+ * @brief finished frame by age
+ * @param age 0 for the latest frame, up to frameCount() - 1
+ */
+const FrameTiming & FrameProfiler::frame(size_t age) const{
+    return frames[(frameIndex - 1 - age) % HISTORY];
+};
+
+/**
+ * @brief average frame rate over the frames in the ring
+ */
+double FrameProfiler::fps() const{
+    size_t n = frameCount();
+    if(n < 2){
+        return 0.0;
+    }
+    double span = frame(0).start - frame(n - 1).start;
+    return (span > 0.0) ? (n - 1) / span : 0.0;
+};
+
+/**
+ * @brief starts recording trace events
+ * @param path Chrome trace JSON written by stopTrace
+ * @return true if path can be written
+ */
+bool FrameProfiler::startTrace(const char * path){
+    stopTrace();
+    ofstream file(path);
+    if(!file){
+        cerr << "FrameProfiler: could not write " << path << endl;
+        return false;
+    }
+    tracePath = path;
+    traceEvents.clear();
+    return true;
+};
+
+/**
+ * @brief stops recording and writes the trace file
+ * @action CPU phases go to thread 1, GPU phases to thread 2 of one process
+ */
+void FrameProfiler::stopTrace(){
+    if(!tracing()){
+        return;
+    }
+    ofstream file(tracePath.c_str());
+    tracePath.clear();
+    if(!file){
+        return;
+    }
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+         << "\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+         << "\"args\":{\"name\":\"GPU\"}}";
+    char line[256];
+    for(size_t i = 0; i < traceEvents.size(); i++){
+        const TraceEvent & e = traceEvents[i];
+        snprintf(line, sizeof(line),
+                 ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                 "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                 phaseName(e.phase), e.track ? "gpu" : "cpu",
+                 e.start * 1e6, e.duration * 1e6, e.track + 1);
+        file << line;
+    }
+    file << "\n]}\n";
+    traceEvents.clear();
+};
+
+/**
+ * @brief name of phase as shown in overlay / traces
+ */
+const char * FrameProfiler::phaseName(int phase){
+    static const char * names[PHASE_COUNT] = {
+        "input", "pose update", "cull", "upload", "draw", "swap"
+    };
+    if(phase < 0 || phase >= PHASE_COUNT){
+        return "frame";
+    }
+    return names[phase];
+};
+
+/**
+ * @brief current resident memory of this process in bytes
+ */
+size_t FrameProfiler::residentBytes(){
+    size_t pages = 0;
+    size_t resident = 0;
+    FILE * statm = fopen("/proc/self/statm", "r");
+    if(!statm){
+        return 0;
+    }
+    if(fscanf(statm, "%zu %zu", &pages, &resident) != 2){
+        resident = 0;
+    }
+    fclose(statm);
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+};
+
+/**
+ * @brief seconds since construction
+ */
+double FrameProfiler::now() const{
+    return chrono::duration<double>(
+        chrono::steady_clock::now().time_since_epoch()).count() - origin;
+};
+
+/**
+ * @brief reads back finished GPU timer queries in frame order
+ * @param wait block for the oldest pending frame instead of stopping at the
+ *        first frame whose results are not ready
+ */
+void FrameProfiler::collectGPU(bool wait){
+    while(gpuPending < frameIndex){
+        size_t slot = gpuPending % HISTORY;
+        int last = -1;
+        for(int p = 0; p < PHASE_COUNT; p++){
+            if(issued[slot][p]){
+                last = p;
+            }
+        }
+        if(last >= 0 && !wait){
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot][last][1],
+                               GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available){
+                return;
+            }
+        }
+        for(int p = 0; p <= last; p++){
+            if(!issued[slot][p]){
+                continue;
+            }
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(queries[slot][p][0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(queries[slot][p][1], GL_QUERY_RESULT, &end);
+            frames[slot].gpu[p] = (end - begin) / 1000000.0;
+            if(tracing()){
+                double start = gpuOriginCPU +
+                    ((GLint64)begin - gpuOrigin) / 1000000000.0;
+                addTraceEvent(p, 1, start, (end - begin) / 1000000000.0);
+            }
+        }
+        gpuPending++;
+        // only the oldest frame has to be waited for
+        wait = false;
+    }
+};
+
+/**
+ * @brief appends trace event while below TRACE_MAX_EVENTS
+ */
+void FrameProfiler::addTraceEvent(int phase, int track, double start,
+                                  double duration){
+    if(traceEvents.size() >= TRACE_MAX_EVENTS){
+        return;
+    }
+    TraceEvent e;
+    e.phase = phase;
+    e.track = track;
+    e.start = start;
+    e.duration = duration;
+    traceEvents.push_back(e);
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
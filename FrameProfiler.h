@@ -0,0 +1,155 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : FrameProfiler.h
+ * @brief      : Per phase CPU / GPU frame timing kept in a ring buffer, with
+ *               optional Chrome trace output
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// timed parts of a frame. input is measured between frames and added to the
+// next one
+enum ProfilePhase {
+    PHASE_INPUT = 0,
+    PHASE_POSE_UPDATE,
+    PHASE_CULL,
+    PHASE_UPLOAD,
+    PHASE_DRAW,
+    PHASE_SWAP,
+    PHASE_COUNT
+};
+
+// timings of one frame in milliseconds
+struct FrameTiming {
+    // frame start, seconds since the profiler was created
+    double start;
+    // wall time from beginFrame to endFrame
+    double total;
+    double cpu[PHASE_COUNT];
+    // GPU time of phases, -1 until the timer query result arrived or when
+    // timer queries are not supported
+    double gpu[PHASE_COUNT];
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// CPU phases use a steady clock. GPU phases use GL timestamp queries, read
+// back a few frames later without stalling. only the first begin / end
+// pair of a phase within a frame is timed on the GPU
+class FrameProfiler
+{
+public:
+    FrameProfiler();
+    ~FrameProfiler();
+
+    // creates timer queries if the current context supports them
+    void initGL();
+    // deletes the timer queries, their context has to be current
+    void releaseGL();
+    // exchanges timer queries with obj when the two contexts are swapped.
+    // results still in flight are dropped
+    void swapGL(FrameProfiler & obj);
+
+    void beginFrame();
+    void endFrame();
+    void beginPhase(ProfilePhase phase);
+    void endPhase(ProfilePhase phase);
+
+    // number of finished frames in the ring (at most HISTORY)
+    size_t frameCount() const;
+    // finished frame, age 0 is the latest
+    const FrameTiming & frame(size_t age) const;
+    // frames per second over the ring
+    double fps() const;
+    bool gpuTimers() const { return timerQueries; };
+
+    // records every phase until stopTrace, which writes a Chrome trace
+    // (chrome://tracing / Perfetto) JSON file
+    bool startTrace(const char * path);
+    void stopTrace();
+    bool tracing() const { return !tracePath.empty(); };
+
+    static const char * phaseName(int phase);
+    // current resident set size of the process
+    static size_t residentBytes();
+
+    static const size_t HISTORY = 256;
+    static const size_t TRACE_MAX_EVENTS = 1 << 20;
+private:
+    FrameProfiler(const FrameProfiler & obj);
+    FrameProfiler & operator=(const FrameProfiler & obj);
+
+    struct TraceEvent {
+        int phase;
+        // 0 cpu, 1 gpu
+        int track;
+        double start;
+        double duration;
+    };
+
+    double now() const;
+    void collectGPU(bool wait);
+    void addTraceEvent(int phase, int track, double start, double duration);
+
+    // ring of frames. frames[frameIndex % HISTORY] is being recorded
+    FrameTiming frames[HISTORY];
+    size_t frameIndex;
+    bool inFrame;
+    double phaseStart[PHASE_COUNT];
+    double origin;
+
+    // 2 timestamp queries per phase per ring slot
+    bool timerQueries;
+    GLuint queries[HISTORY][PHASE_COUNT][2];
+    bool issued[HISTORY][PHASE_COUNT];
+    // oldest frame whose GPU results are not read yet
+    size_t gpuPending;
+    // GL timestamp (ns) matching CPU time gpuOriginCPU (s)
+    GLint64 gpuOrigin;
+    double gpuOriginCPU;
+
+    string tracePath;
+    vector<TraceEvent> traceEvents;
+};
+
+// times a phase for the lifetime of the scope
+class ProfileScope
+{
+public:
+    ProfileScope(FrameProfiler & profiler, ProfilePhase phase)
+        : profiler(profiler), phase(phase) { profiler.beginPhase(phase); };
+    ~ProfileScope() { profiler.endPhase(phase); };
+private:
+    FrameProfiler & profiler;
+    ProfilePhase phase;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
@@ -0,0 +1,322 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : FrameRecorder.cpp
+ * @brief      : Definition file for asynchronous frame capture
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include "FrameRecorder.h"
+#include "ImageWriter.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// longest single wait for a fence, in nanoseconds
+static const GLuint64 FENCE_WAIT_NS = 100000000;
+
+/**
+ * @brief flips RGB rows bottom up (as read back) to top down
+ */
+static void toTopDown(const unsigned char * rgb, int width, int height,
+                      unsigned char * out){
+    size_t row = (size_t)width * 3;
+    for(int y = 0; y < height; y++){
+        memcpy(out + y * row, rgb + (height - 1 - y) * row, row);
+    }
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ * @action nothing is allocated until start
+ */
+FrameRecorder::FrameRecorder(){
+    toPipe = false;
+    pipe = 0;
+    width = 0;
+    height = 0;
+    realtime = false;
+    memset(pbos, 0, sizeof(pbos));
+    memset(fences, 0, sizeof(fences));
+    head = 0;
+    tail = 0;
+    captured = 0;
+    dropped = 0;
+    buffers = 0;
+    bufferLimit = 0;
+    nextWrite = 0;
+    stopping = false;
+    error = false;
+};
+
+/**
+ * @brief Destructor
+ * @action finishes a running recording. needs the GL context it was
+ *         started on to still be current
+ */
+FrameRecorder::~FrameRecorder(){
+    stop();
+};
+
+/**
+ * @brief starts recording
+ * @param path printf pattern with exactly one %d for the frame index, or
+ *        "|command" to pipe raw RGB frames into
+ * @param w,h frame size, read from the lower left corner
+ * @param workerThreads encoder threads, 0 for one per core
+ * @param dropFrames drop frames while all buffers are taken instead of
+ *        waiting for the encoders
+ * @return false if the pattern is invalid or the pipe could not be opened
+ * @action creates the pixel buffer ring on the current context
+ */
+bool FrameRecorder::start(const char * path, int w, int h, int workerThreads,
+                          bool dropFrames){
+    stop();
+    if(w <= 0 || h <= 0){
+        return false;
+    }
+    target = path;
+    toPipe = (path[0] == '|');
+    if(toPipe){
+        // a dying encoder should fail the write, not kill the viewer
+        signal(SIGPIPE, SIG_IGN);
+        pipe = popen(path + 1, "w");
+        if(!pipe){
+            cerr << "FrameRecorder: could not run " << path + 1 << endl;
+            return false;
+        }
+    } else if(!validFramePattern(path)){
+        // frame names are printed with the target as format
+        cerr << "FrameRecorder: bad target pattern " << path
+             << " (needs exactly one %d)" << endl;
+        return false;
+    }
+    width = w;
+    height = h;
+    realtime = dropFrames;
+    if(workerThreads <= 0){
+        workerThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    workerThreads = max(workerThreads, 1);
+
+    glGenBuffers(RING, pbos);
+    for(size_t i = 0; i < RING; i++){
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 3, NULL,
+                     GL_STREAM_READ);
+        fences[i] = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    head = 0;
+    tail = 0;
+    captured = 0;
+    dropped = 0;
+    buffers = 0;
+    bufferLimit = workerThreads * FRAMES_PER_WORKER;
+    nextWrite = 0;
+    stopping = false;
+    error = false;
+    for(int i = 0; i < workerThreads; i++){
+        workers.push_back(thread(&FrameRecorder::run, this));
+    }
+    return true;
+};
+
+/**
+ * @brief queues readback of the current read buffer
+ * @action only waits for the GPU when every ring slot is still in flight
+ */
+void FrameRecorder::capture(){
+    if(!recording()){
+        return;
+    }
+    collect(false);
+    if(head - tail == RING){
+        collect(true);
+    }
+    size_t slot = head % RING;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    head++;
+};
+
+/**
+ * @brief finishes recording
+ * @return false if a frame could not be written or the encoder failed
+ * @action reads back the frames still in flight, waits for the workers and
+ *         closes the pipe
+ */
+bool FrameRecorder::stop(){
+    if(!recording()){
+        return true;
+    }
+    while(tail < head){
+        collect(true);
+    }
+    glDeleteBuffers(RING, pbos);
+    memset(pbos, 0, sizeof(pbos));
+
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    ready.notify_all();
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+    workers.clear();
+    if(pipe && pclose(pipe) != 0){
+        cerr << "FrameRecorder: " << target.c_str() + 1 << " failed" << endl;
+        error = true;
+    }
+    pipe = 0;
+    for(size_t i = 0; i < freeBuffers.size(); i++){
+        delete freeBuffers[i];
+    }
+    freeBuffers.clear();
+    buffers = 0;
+    return !error;
+};
+
+/**
+ * @brief hands finished pixel buffers to the workers, oldest first
+ * @param wait block until the oldest buffer is finished
+ * @action without a free frame buffer a realtime recording drops the
+ *         frame, otherwise it waits for a worker to finish one
+ */
+void FrameRecorder::collect(bool wait){
+    while(tail < head){
+        size_t slot = tail % RING;
+        GLenum status = glClientWaitSync(fences[slot], 0, 0);
+        while(wait && status == GL_TIMEOUT_EXPIRED){
+            status = glClientWaitSync(fences[slot],
+                                      GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      FENCE_WAIT_NS);
+        }
+        if(status == GL_TIMEOUT_EXPIRED){
+            // make sure the fence gets to the GPU, look again next frame
+            glFlush();
+            return;
+        }
+        glDeleteSync(fences[slot]);
+        fences[slot] = 0;
+        tail++;
+        wait = false;
+
+        vector<unsigned char> * pixels = 0;
+        {
+            unique_lock<mutex> guard(lock);
+            while(freeBuffers.empty() && buffers >= bufferLimit &&
+                  !realtime){
+                done.wait(guard);
+            }
+            if(!freeBuffers.empty()){
+                pixels = freeBuffers.back();
+                freeBuffers.pop_back();
+            } else if(buffers < bufferLimit){
+                pixels = new vector<unsigned char>((size_t)width * height * 3);
+                buffers++;
+            }
+        }
+        if(!pixels){
+            dropped++;
+            continue;
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+        const void * mapped = glMapBuffer(GL_PIXEL_PACK_BUFFER,
+                                          GL_READ_ONLY);
+        if(mapped){
+            memcpy(&(*pixels)[0], mapped, pixels->size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        lock_guard<mutex> guard(lock);
+        if(!mapped){
+            freeBuffers.push_back(pixels);
+            dropped++;
+            continue;
+        }
+        Frame frame = {captured++, pixels};
+        frames.push_back(frame);
+        ready.notify_one();
+    }
+};
+
+/**
+ * @brief worker thread body, encodes frames until stop
+ */
+void FrameRecorder::run(){
+    vector<unsigned char> rgb(toPipe ? (size_t)width * height * 3 : 0);
+    while(true){
+        Frame frame;
+        {
+            unique_lock<mutex> guard(lock);
+            while(frames.empty() && !stopping){
+                ready.wait(guard);
+            }
+            if(frames.empty()){
+                return;
+            }
+            frame = frames.front();
+            frames.pop_front();
+        }
+        bool ok = encode(frame, rgb);
+        {
+            lock_guard<mutex> guard(lock);
+            error = error || !ok;
+            freeBuffers.push_back(frame.pixels);
+        }
+        done.notify_all();
+    }
+};
+
+/**
+ * @brief writes one frame
+ * @param frame frame index and RGB pixels, bottom row first
+ * @param rgb scratch buffer of the worker for pipe output
+ * @return false if the frame could not be written
+ * @action image files are written in parallel. pipe writes wait for their
+ *         turn so the encoder sees frames in order
+ */
+bool FrameRecorder::encode(const Frame & frame, vector<unsigned char> & rgb){
+    const unsigned char * pixels = &(*frame.pixels)[0];
+    if(!toPipe){
+        char name[1024];
+        snprintf(name, sizeof(name), target.c_str(), (int)frame.index);
+        if(!writeImage(name, pixels, width, height, true)){
+            cerr << "FrameRecorder: could not write " << name << endl;
+            return false;
+        }
+        return true;
+    }
+    toTopDown(pixels, width, height, &rgb[0]);
+    unique_lock<mutex> guard(lock);
+    while(nextWrite != frame.index){
+        done.wait(guard);
+    }
+    bool ok = !error && fwrite(&rgb[0], rgb.size(), 1, pipe) == 1;
+    nextWrite++;
+    done.notify_all();
+    return ok;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
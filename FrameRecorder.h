@@ -0,0 +1,122 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : FrameRecorder.h
+ * @brief      : Asynchronous frame capture through a ring of pixel buffer
+ *               objects, encoded to images / an external encoder by a pool
+ *               of worker threads
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef FRAMERECORDER_H
+#define FRAMERECORDER_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// capture() queues a glReadPixels into the next pixel buffer object of a
+// ring and fences it. buffers are mapped only once their fence signalled
+// (normally a frame or two later), copied into a pooled frame and handed to
+// the workers, so the render thread never waits for the GPU or the encoder.
+// all GL calls happen on the thread owning the context.
+//
+// targets are either a printf pattern taking the frame index (*.png for
+// PNG, PPM otherwise) or "|command", which gets raw 8 bit RGB frames, top
+// row first, on its stdin (e.g. "|ffmpeg -f rawvideo -pix_fmt rgb24
+// -s 1920x1080 -r 30 -i - out.mp4")
+class FrameRecorder
+{
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+
+    // starts recording width x height frames from the lower left corner of
+    // the read buffer. workers = 0 uses one per core. realtime recordings
+    // drop frames while the encoders are behind instead of blocking
+    bool start(const char * target, int width, int height, int workers,
+               bool realtime);
+
+    // reads back the current read buffer. GL thread only
+    void capture();
+
+    // waits for every captured frame to be written. false if a write failed
+    bool stop();
+
+    bool recording() const { return pbos[0] != 0; };
+    size_t framesCaptured() const { return captured; };
+    size_t framesDropped() const { return dropped; };
+
+    // pixel buffer objects in flight
+    static const size_t RING = 3;
+    // frames waiting for / being encoded per worker
+    static const size_t FRAMES_PER_WORKER = 2;
+private:
+    FrameRecorder(const FrameRecorder & obj);
+    FrameRecorder & operator=(const FrameRecorder & obj);
+
+    struct Frame {
+        size_t index;
+        vector<unsigned char> * pixels;
+    };
+
+    // maps finished pixel buffers in capture order. wait blocks for the
+    // oldest one
+    void collect(bool wait);
+    // worker thread body
+    void run();
+    bool encode(const Frame & frame, vector<unsigned char> & rgb);
+
+    string target;
+    bool toPipe;
+    FILE * pipe;
+    int width;
+    int height;
+    bool realtime;
+
+    // ring slots, pending from tail to head
+    GLuint pbos[RING];
+    GLsync fences[RING];
+    size_t head;
+    size_t tail;
+    size_t captured;
+    size_t dropped;
+
+    // frames handed to workers, RGB bottom row first. free buffers are
+    // reused, at most bufferLimit exist
+    vector<thread> workers;
+    mutex lock;
+    condition_variable ready;
+    condition_variable done;
+    deque<Frame> frames;
+    vector<vector<unsigned char> *> freeBuffers;
+    size_t buffers;
+    size_t bufferLimit;
+    // next frame index the pipe takes, frames are written in order
+    size_t nextWrite;
+    bool stopping;
+    bool error;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
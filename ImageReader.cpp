@@ -0,0 +1,417 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : ImageReader.cpp
+ * @brief      : Definition file for PPM / PGM / PNG / JPEG readers
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <csetjmp>
+#include <zlib.h>
+#include <jpeglib.h>
+#include "ImageReader.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// largest image accepted, so corrupt headers can't ask for huge buffers
+static const size_t MAX_PIXELS = (size_t)1 << 28;
+
+static const unsigned char PNG_SIGNATURE[8] = {
+    0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+};
+// start of image marker and the first byte of the next marker
+static const unsigned char JPEG_SIGNATURE[3] = {0xff, 0xd8, 0xff};
+
+// libjpeg error manager that jumps back to readJPEG instead of exiting
+struct JPEGError {
+    jpeg_error_mgr manager;
+    jmp_buf jump;
+};
+
+static void jpegError(j_common_ptr info){
+    longjmp(((JPEGError*)info->err)->jump, 1);
+}
+
+static void jpegMessage(j_common_ptr){
+}
+
+/**
+ * @brief reads the whole file at path into data
+ */
+static bool readFile(const char * path, vector<unsigned char> & data){
+    FILE * f = fopen(path, "rb");
+    if(!f){
+        return false;
+    }
+    data.clear();
+    unsigned char buffer[1 << 16];
+    size_t n;
+    while((n = fread(buffer, 1, sizeof(buffer), f)) > 0){
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+static unsigned int getBigEndian(const unsigned char * in){
+    return ((unsigned int)in[0] << 24) | ((unsigned int)in[1] << 16) |
+           ((unsigned int)in[2] << 8) | (unsigned int)in[3];
+}
+
+/**
+ * @brief reads an unsigned decimal header field of a PNM file
+ * @param data file contents
+ * @param offset read position, moved past the field
+ * @param value output value
+ * @action skips white space and # comments before the field
+ */
+static bool readField(const vector<unsigned char> & data, size_t & offset,
+                      unsigned long & value){
+    while(offset < data.size()){
+        if(data[offset] == '#'){
+            while(offset < data.size() && data[offset] != '\n'){
+                offset++;
+            }
+        } else if(isspace(data[offset])){
+            offset++;
+        } else {
+            break;
+        }
+    }
+    if(offset >= data.size() || !isdigit(data[offset])){
+        return false;
+    }
+    value = 0;
+    while(offset < data.size() && isdigit(data[offset]) && value < 1000000){
+        value = value * 10 + (data[offset] - '0');
+        offset++;
+    }
+    return true;
+}
+
+static unsigned char paeth(int a, int b, int c){
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if(pa <= pb && pa <= pc){
+        return (unsigned char)a;
+    }
+    return (unsigned char)((pb <= pc) ? b : c);
+}
+
+/**
+ * @brief undoes the PNG filter of one scanline in place
+ * @param type filter type byte of the line
+ * @param line filtered bytes, without the type byte
+ * @param previous unfiltered line above, 0 for the first one
+ * @param length bytes per line
+ * @param bpp bytes per complete pixel, at least 1
+ * @return false for an unknown filter
+ */
+static bool unfilter(int type, unsigned char * line,
+                     const unsigned char * previous, size_t length,
+                     size_t bpp){
+    for(size_t i = 0; i < length; i++){
+        int a = (i >= bpp) ? line[i - bpp] : 0;
+        int b = previous ? previous[i] : 0;
+        int c = (previous && i >= bpp) ? previous[i - bpp] : 0;
+        switch(type){
+        case 0:
+            break;
+        case 1:
+            line[i] += a;
+            break;
+        case 2:
+            line[i] += b;
+            break;
+        case 3:
+            line[i] += (a + b) / 2;
+            break;
+        case 4:
+            line[i] += paeth(a, b, c);
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief sample of a PNG scanline as 8 bits
+ * @param line unfiltered scanline
+ * @param index sample index within the line (pixel * channels + channel)
+ * @param depth bits per sample
+ * @param scale stretch samples below 8 bits to 0..255 (not for palette
+ *        indices)
+ */
+static int sampleOf(const unsigned char * line, size_t index, int depth,
+                    bool scale){
+    if(depth == 8){
+        return line[index];
+    }
+    if(depth == 16){
+        return line[2 * index];
+    }
+    size_t bit = index * depth;
+    int mask = (1 << depth) - 1;
+    int v = (line[bit / 8] >> (8 - depth - bit % 8)) & mask;
+    return scale ? v * 255 / mask : v;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                            FUNCTION DEFINITIONS                            //
+//----------------------------------------------------------------------------//
+/**
+ * @brief reads binary PPM / PGM
+ * @param path input path
+ * @param rgb output packed rgb pixels, top row first
+ * @param width output image width
+ * @param height output image height
+ * @return true on success
+ */
+bool readPNM(const char * path, vector<unsigned char> & rgb, int & width,
+             int & height){
+    vector<unsigned char> data;
+    if(!readFile(path, data) || data.size() < 2 || data[0] != 'P' ||
+       (data[1] != '5' && data[1] != '6')){
+        return false;
+    }
+    size_t channels = (data[1] == '6') ? 3 : 1;
+    size_t offset = 2;
+    unsigned long w, h, maxval;
+    if(!readField(data, offset, w) || !readField(data, offset, h) ||
+       !readField(data, offset, maxval) || w == 0 || h == 0 ||
+       maxval == 0 || maxval > 65535 || w * h > MAX_PIXELS){
+        return false;
+    }
+    // single white space before the samples
+    offset++;
+    size_t sampleBytes = (maxval > 255) ? 2 : 1;
+    size_t pixels = w * h;
+    if(offset + pixels * channels * sampleBytes > data.size()){
+        return false;
+    }
+    rgb.resize(pixels * 3);
+    const unsigned char * in = &data[offset];
+    for(size_t i = 0; i < pixels; i++){
+        for(size_t c = 0; c < 3; c++){
+            size_t s = (channels == 3) ? c : 0;
+            unsigned long v = in[(i * channels + s) * sampleBytes];
+            if(sampleBytes == 2){
+                v = (v << 8) | in[(i * channels + s) * sampleBytes + 1];
+            }
+            rgb[i * 3 + c] = (unsigned char)(v * 255 / maxval);
+        }
+    }
+    width = (int)w;
+    height = (int)h;
+    return true;
+}
+
+/**
+ * @brief reads PNG
+ * @param path input path
+ * @param rgb output packed rgb pixels, top row first
+ * @param width output image width
+ * @param height output image height
+ * @return true on success
+ * @action IDAT chunks are inflated in one go into the filtered scanlines,
+ *         which are unfiltered in place and expanded to RGB. chunk CRCs
+ *         are not checked, zlib checks the image data
+ */
+bool readPNG(const char * path, vector<unsigned char> & rgb, int & width,
+             int & height){
+    vector<unsigned char> data;
+    if(!readFile(path, data) || data.size() < 8 ||
+       memcmp(&data[0], PNG_SIGNATURE, 8) != 0){
+        return false;
+    }
+    size_t w = 0, h = 0;
+    int depth = 0, colorType = -1, interlace = 0;
+    vector<unsigned char> palette;
+    vector<unsigned char> packed;
+    size_t offset = 8;
+    while(offset + 12 <= data.size()){
+        size_t length = getBigEndian(&data[offset]);
+        const unsigned char * type = &data[offset + 4];
+        const unsigned char * body = &data[offset + 8];
+        if(length > data.size() - offset - 12){
+            return false;
+        }
+        if(memcmp(type, "IHDR", 4) == 0 && length >= 13){
+            w = getBigEndian(body);
+            h = getBigEndian(body + 4);
+            depth = body[8];
+            colorType = body[9];
+            interlace = body[12];
+        } else if(memcmp(type, "PLTE", 4) == 0){
+            palette.assign(body, body + length);
+        } else if(memcmp(type, "IDAT", 4) == 0){
+            packed.insert(packed.end(), body, body + length);
+        } else if(memcmp(type, "IEND", 4) == 0){
+            break;
+        }
+        offset += length + 12;
+    }
+
+    int channels;
+    switch(colorType){
+    case 0: channels = 1; break;
+    case 2: channels = 3; break;
+    case 3: channels = 1; break;
+    case 4: channels = 2; break;
+    case 6: channels = 4; break;
+    default: return false;
+    }
+    bool validDepth = (depth == 8 || depth == 16) ||
+        ((colorType == 0 || colorType == 3) &&
+         (depth == 1 || depth == 2 || depth == 4));
+    if(!validDepth || (colorType == 3 && depth == 16) || interlace != 0 ||
+       w == 0 || h == 0 || w * h > MAX_PIXELS ||
+       (colorType == 3 && palette.size() < 3)){
+        return false;
+    }
+
+    size_t bits = (size_t)channels * depth;
+    size_t stride = (w * bits + 7) / 8;
+    size_t bpp = max((size_t)1, bits / 8);
+    vector<unsigned char> raw((stride + 1) * h);
+    uLongf rawSize = raw.size();
+    if(packed.empty() ||
+       uncompress(&raw[0], &rawSize, &packed[0], packed.size()) != Z_OK ||
+       rawSize != raw.size()){
+        return false;
+    }
+    packed.clear();
+
+    rgb.resize(w * h * 3);
+    size_t colors = palette.size() / 3;
+    for(size_t y = 0; y < h; y++){
+        unsigned char * line = &raw[y * (stride + 1) + 1];
+        const unsigned char * previous = y ? line - stride - 1 : 0;
+        if(!unfilter(line[-1], line, previous, stride, bpp)){
+            return false;
+        }
+        unsigned char * out = &rgb[y * w * 3];
+        for(size_t x = 0; x < w; x++, out += 3){
+            size_t s = x * channels;
+            if(colorType == 3){
+                size_t i = sampleOf(line, s, depth, false);
+                if(i >= colors){
+                    i = 0;
+                }
+                memcpy(out, &palette[i * 3], 3);
+            } else if(channels <= 2){
+                out[0] = out[1] = out[2] =
+                    (unsigned char)sampleOf(line, s, depth, true);
+            } else {
+                for(int c = 0; c < 3; c++){
+                    out[c] = (unsigned char)sampleOf(line, s + c, depth, true);
+                }
+            }
+        }
+    }
+    width = (int)w;
+    height = (int)h;
+    return true;
+}
+
+/**
+ * @brief reads JPEG through libjpeg
+ * @param path input path
+ * @param rgb output packed rgb pixels, top row first
+ * @param width output image width
+ * @param height output image height
+ * @return true on success
+ * @action gray images are expanded to RGB by libjpeg. CMYK images are
+ *         not read. libjpeg errors jump back here, warnings are dropped
+ */
+bool readJPEG(const char * path, vector<unsigned char> & rgb, int & width,
+              int & height){
+    FILE * f = fopen(path, "rb");
+    if(!f){
+        return false;
+    }
+    jpeg_decompress_struct info;
+    JPEGError error;
+    info.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = jpegError;
+    error.manager.output_message = jpegMessage;
+    if(setjmp(error.jump)){
+        jpeg_destroy_decompress(&info);
+        fclose(f);
+        return false;
+    }
+    jpeg_create_decompress(&info);
+    jpeg_stdio_src(&info, f);
+    jpeg_read_header(&info, TRUE);
+    if(info.jpeg_color_space == JCS_CMYK ||
+       info.jpeg_color_space == JCS_YCCK ||
+       (size_t)info.image_width * info.image_height > MAX_PIXELS){
+        jpeg_destroy_decompress(&info);
+        fclose(f);
+        return false;
+    }
+    info.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&info);
+    size_t w = info.output_width;
+    size_t h = info.output_height;
+    rgb.resize(w * h * 3);
+    while(info.output_scanline < h){
+        JSAMPROW row = &rgb[info.output_scanline * w * 3];
+        jpeg_read_scanlines(&info, &row, 1);
+    }
+    jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+    fclose(f);
+    width = (int)w;
+    height = (int)h;
+    return true;
+}
+
+/**
+ * @brief reads image with format chosen from its first bytes
+ * @param path input path (PNG, JPEG, else binary PPM / PGM)
+ * @return true on success
+ */
+bool readImage(const char * path, vector<unsigned char> & rgb, int & width,
+               int & height){
+    unsigned char head[8];
+    FILE * f = fopen(path, "rb");
+    if(!f){
+        return false;
+    }
+    size_t n = fread(head, 1, sizeof(head), f);
+    fclose(f);
+    if(n == 8 && memcmp(head, PNG_SIGNATURE, 8) == 0){
+        return readPNG(path, rgb, width, height);
+    }
+    if(n >= 3 && memcmp(head, JPEG_SIGNATURE, 3) == 0){
+        return readJPEG(path, rgb, width, height);
+    }
+    return readPNM(path, rgb, width, height);
+}
+//----------------------------------------------------------------------------//
+//                          END FUNCTION DEFINITIONS                          //
+//----------------------------------------------------------------------------//
@@ -0,0 +1,49 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : ImageReader.h
+ * @brief      : Minimal PPM / PGM / PNG and libjpeg JPEG readers for camera
+ *               images
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef IMAGEREADER_H
+#define IMAGEREADER_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <vector>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           FUNCTION DECLARATIONS                            //
+//----------------------------------------------------------------------------//
+// All readers return tightly packed 8 bit RGB rows, top row first. 16 bit
+// samples keep their high byte, gray / palette images are expanded and
+// alpha is dropped.
+
+// reads binary PPM / PGM (P6 / P5)
+bool readPNM(const char * path, vector<unsigned char> & rgb, int & width,
+             int & height);
+
+// reads non interlaced PNG of any color type / bit depth
+bool readPNG(const char * path, vector<unsigned char> & rgb, int & width,
+             int & height);
+
+// reads baseline / progressive JPEG (gray or color, not CMYK) with libjpeg
+bool readJPEG(const char * path, vector<unsigned char> & rgb, int & width,
+              int & height);
+
+// picks the reader from the file signature
+bool readImage(const char * path, vector<unsigned char> & rgb, int & width,
+               int & height);
+//----------------------------------------------------------------------------//
+//                         END FUNCTION DECLARATIONS                          //
+//----------------------------------------------------------------------------//
+#endif
@@ -0,0 +1,187 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : ImageWriter.cpp
+ * @brief      : Definition file for PPM / PNG writers
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+#include "ImageWriter.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+static void putBigEndian(unsigned char * out, unsigned int v){
+    out[0] = (unsigned char)(v >> 24);
+    out[1] = (unsigned char)(v >> 16);
+    out[2] = (unsigned char)(v >> 8);
+    out[3] = (unsigned char)v;
+}
+
+/**
+ * @brief writes one PNG chunk (length, type, data, crc)
+ */
+static bool writeChunk(FILE * f, const char * type, const unsigned char * data,
+                       size_t length){
+    unsigned char word[4];
+    putBigEndian(word, (unsigned int)length);
+    uLong crc = crc32(0L, (const Bytef*)type, 4);
+    if(length){
+        crc = crc32(crc, data, (uInt)length);
+    }
+    bool ok = fwrite(word, 4, 1, f) == 1 && fwrite(type, 4, 1, f) == 1;
+    if(ok && length){
+        ok = fwrite(data, length, 1, f) == 1;
+    }
+    putBigEndian(word, (unsigned int)crc);
+    return ok && fwrite(word, 4, 1, f) == 1;
+}
+
+static const unsigned char * rowOf(const unsigned char * rgb, int width,
+                                   int height, int y, bool bottomUp){
+    int row = bottomUp ? height - 1 - y : y;
+    return rgb + (size_t)row * width * 3;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                            FUNCTION DEFINITIONS                            //
+//----------------------------------------------------------------------------//
+/**
+ * @brief writes binary PPM
+ * @param path output path
+ * @param rgb packed rgb pixels
+ * @param width image width
+ * @param height image height
+ * @param bottomUp true if first row in rgb is the bottom of the image
+ * @return true on success
+ */
+bool writePPM(const char * path, const unsigned char * rgb, int width,
+              int height, bool bottomUp){
+    FILE * f = fopen(path, "wb");
+    if(!f){
+        return false;
+    }
+    bool ok = fprintf(f, "P6\n%d %d\n255\n", width, height) > 0;
+    for(int y = 0; ok && y < height; y++){
+        ok = fwrite(rowOf(rgb, width, height, y, bottomUp), width * 3, 1, f)
+             == 1;
+    }
+    return (fclose(f) == 0) && ok;
+}
+
+/**
+ * @brief writes PNG
+ * @param path output path
+ * @param rgb packed rgb pixels
+ * @param width image width
+ * @param height image height
+ * @param bottomUp true if first row in rgb is the bottom of the image
+ * @return true on success
+ */
+bool writePNG(const char * path, const unsigned char * rgb, int width,
+              int height, bool bottomUp){
+    // raw scanlines, each prefixed by filter type 0
+    size_t stride = (size_t)width * 3;
+    vector<unsigned char> raw((stride + 1) * height);
+    for(int y = 0; y < height; y++){
+        raw[y * (stride + 1)] = 0;
+        memcpy(&raw[y * (stride + 1) + 1],
+               rowOf(rgb, width, height, y, bottomUp), stride);
+    }
+    uLongf packedSize = compressBound(raw.size());
+    vector<unsigned char> packed(packedSize);
+    if(compress2(&packed[0], &packedSize, &raw[0], raw.size(),
+                 Z_BEST_SPEED) != Z_OK){
+        return false;
+    }
+
+    FILE * f = fopen(path, "wb");
+    if(!f){
+        return false;
+    }
+    static const unsigned char signature[8] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+    };
+    unsigned char header[13];
+    putBigEndian(header, width);
+    putBigEndian(header + 4, height);
+    header[8] = 8;   // bit depth
+    header[9] = 2;   // truecolor
+    header[10] = 0;  // deflate
+    header[11] = 0;  // adaptive filtering
+    header[12] = 0;  // no interlace
+    bool ok = fwrite(signature, 8, 1, f) == 1 &&
+              writeChunk(f, "IHDR", header, 13) &&
+              writeChunk(f, "IDAT", &packed[0], packedSize) &&
+              writeChunk(f, "IEND", 0, 0);
+    return (fclose(f) == 0) && ok;
+}
+
+/**
+ * @brief writes image with format chosen from extension
+ * @param path output path (*.png for PNG, PPM otherwise)
+ * @return true on success
+ */
+bool writeImage(const char * path, const unsigned char * rgb, int width,
+                int height, bool bottomUp){
+    size_t n = strlen(path);
+    if(n >= 4 && strcmp(path + n - 4, ".png") == 0){
+        return writePNG(path, rgb, width, height, bottomUp);
+    }
+    return writePPM(path, rgb, width, height, bottomUp);
+}
+
+/**
+ * @brief checks a frame name pattern before it is used as printf format
+ * @param pattern user supplied pattern, e.g. frame_%04d.png
+ * @return true if it has exactly one %d / %i and otherwise only %%
+ */
+bool validFramePattern(const char * pattern){
+    int conversions = 0;
+    for(const char * c = pattern; *c; c++){
+        if(*c != '%'){
+            continue;
+        }
+        c++;
+        if(*c == '%'){
+            continue;
+        }
+        // flags, width and precision. no '*' or length modifiers
+        while(*c && strchr("-+ #0", *c)){
+            c++;
+        }
+        while(*c >= '0' && *c <= '9'){
+            c++;
+        }
+        if(*c == '.'){
+            c++;
+            while(*c >= '0' && *c <= '9'){
+                c++;
+            }
+        }
+        if(*c != 'd' && *c != 'i'){
+            return false;
+        }
+        conversions++;
+    }
+    return conversions == 1;
+}
+//----------------------------------------------------------------------------//
+//                          END FUNCTION DEFINITIONS                          //
+//----------------------------------------------------------------------------//
@@ -0,0 +1,41 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : ImageWriter.h
+ * @brief      : Minimal PPM / PNG writers for rendered frames
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cstddef>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           FUNCTION DECLARATIONS                            //
+//----------------------------------------------------------------------------//
+// All writers take tightly packed 8 bit RGB rows. bottomUp = true for rows
+// as returned by glReadPixels.
+
+// writes binary PPM (P6)
+bool writePPM(const char * path, const unsigned char * rgb, int width,
+              int height, bool bottomUp);
+
+// writes PNG (zlib deflate, no filtering)
+bool writePNG(const char * path, const unsigned char * rgb, int width,
+              int height, bool bottomUp);
+
+// picks PNG for *.png, PPM otherwise
+bool writeImage(const char * path, const unsigned char * rgb, int width,
+                int height, bool bottomUp);
+
+// true if a printf style frame name pattern takes exactly one int (%d / %i,
+// optionally with flags, width and precision) and no other conversion than
+// %%, so it is safe to format with the frame index
+bool validFramePattern(const char * pattern);
+//----------------------------------------------------------------------------//
+//                         END FUNCTION DECLARATIONS                          //
+//----------------------------------------------------------------------------//
+#endif
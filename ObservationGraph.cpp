@@ -0,0 +1,108 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : ObservationGraph.cpp
+ * @brief      : Definition file for camera to tag observation edges
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <algorithm>
+#include "ObservationGraph.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+static bool operator<(const ObservationEdge & a, const ObservationEdge & b){
+    return a.camera < b.camera || (a.camera == b.camera && a.tag < b.tag);
+}
+
+static bool operator==(const ObservationEdge & a, const ObservationEdge & b){
+    return a.camera == b.camera && a.tag == b.tag;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+ObservationGraph::ObservationGraph(){
+};
+
+/**
+ * @brief removes all edges
+ */
+void ObservationGraph::clear(){
+    edges.clear();
+    pending.clear();
+};
+
+/**
+ * @brief queues an edge for the next compact
+ * @param camera camera index
+ * @param tag tag index
+ */
+void ObservationGraph::add(uint32_t camera, uint32_t tag){
+    ObservationEdge edge;
+    edge.camera = camera;
+    edge.tag = tag;
+    pending.push_back(edge);
+};
+
+/**
+ * @brief merges pending edges into the sorted array
+ * @return index of the first edge that changed, size() if nothing changed
+ * @action only the pending edges are sorted. edges appended for new cameras
+ *         land at the end, so the array before them stays untouched
+ */
+size_t ObservationGraph::compact(){
+    if(pending.empty()){
+        return edges.size();
+    }
+    sort(pending.begin(), pending.end());
+    pending.erase(unique(pending.begin(), pending.end()), pending.end());
+
+    size_t changed = lower_bound(edges.begin(), edges.end(), pending[0]) -
+                     edges.begin();
+    size_t middle = edges.size();
+    edges.insert(edges.end(), pending.begin(), pending.end());
+    inplace_merge(edges.begin() + changed, edges.begin() + middle,
+                  edges.end());
+    edges.erase(unique(edges.begin() + changed, edges.end()), edges.end());
+    pending.clear();
+    return changed;
+};
+
+/**
+ * @brief finds edges of a range of cameras
+ * @param first,last camera index range
+ * @param begin,end edge index range
+ */
+void ObservationGraph::cameraRange(uint32_t first, uint32_t last,
+                                   size_t & begin, size_t & end) const{
+    ObservationEdge lo = {first, 0};
+    ObservationEdge hi = {last, 0};
+    begin = lower_bound(edges.begin(), edges.end(), lo) - edges.begin();
+    end = lower_bound(edges.begin() + begin, edges.end(), hi) -
+          edges.begin();
+};
+
+/**
+ * @brief renumbers cameras after they were reordered
+ * @param moved new index of every old camera index
+ */
+void ObservationGraph::remapCameras(const vector<size_t> & moved){
+    compact();
+    for(size_t i = 0; i < edges.size(); i++){
+        edges[i].camera = (uint32_t)moved[edges[i].camera];
+    }
+    sort(edges.begin(), edges.end());
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
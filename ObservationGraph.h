@@ -0,0 +1,74 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : ObservationGraph.h
+ * @brief      : Camera to tag observation edges in one sorted edge array
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef OBSERVATIONGRAPH_H
+#define OBSERVATIONGRAPH_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// camera index observes tag index
+struct ObservationEdge {
+    uint32_t camera;
+    uint32_t tag;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// Edges sorted by camera, then tag, without duplicates: 8 bytes per edge and
+// the array goes to GL as is. the tags of a camera, or the edges of a range
+// of cameras, are found by binary search. new edges wait in a pending list
+// until compact() merges them in
+class ObservationGraph
+{
+public:
+    ObservationGraph();
+
+    void clear();
+    // merged edges (pending ones not counted)
+    size_t size() const { return edges.size(); };
+    bool empty() const { return edges.empty(); };
+    const ObservationEdge * data() const { return edges.data(); };
+
+    // queues edge camera -> tag
+    void add(uint32_t camera, uint32_t tag);
+
+    // merges pending edges. returns index of the first edge that changed,
+    // size() if none did
+    size_t compact();
+
+    // edges [begin, end) of cameras in [first, last)
+    void cameraRange(uint32_t first, uint32_t last, size_t & begin,
+                     size_t & end) const;
+
+    // renumbers cameras, moved[old index] = new index
+    void remapCameras(const vector<size_t> & moved);
+private:
+    vector<ObservationEdge> edges;
+    vector<ObservationEdge> pending;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
@@ -0,0 +1,170 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : OffscreenContext.cpp
+ * @brief      : Definition file for windowless EGL context
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <iostream>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include "OffscreenContext.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief opens an EGL display usable without X / wayland
+ * @return initialized display or EGL_NO_DISPLAY
+ * @action tries the default display first, then Mesa's surfaceless platform
+ */
+static EGLDisplay openDisplay(){
+    EGLint major, minor;
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if(display != EGL_NO_DISPLAY && eglInitialize(display, &major, &minor)){
+        return display;
+    }
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+        eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay){
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                     EGL_DEFAULT_DISPLAY, NULL);
+        if(display != EGL_NO_DISPLAY &&
+           eglInitialize(display, &major, &minor)){
+            return display;
+        }
+    }
+#endif
+    return EGL_NO_DISPLAY;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+OffscreenContext::OffscreenContext(){
+    display = EGL_NO_DISPLAY;
+    surface = EGL_NO_SURFACE;
+    context = EGL_NO_CONTEXT;
+};
+
+/**
+ * @brief Destructor
+ * @action releases context and surface
+ */
+OffscreenContext::~OffscreenContext(){
+    destroy();
+};
+
+/**
+ * @brief creates offscreen context
+ * @param width pbuffer width
+ * @param height pbuffer height
+ * @return true if context is current
+ */
+bool OffscreenContext::create(int width, int height){
+    destroy();
+    display = openDisplay();
+    if(display == EGL_NO_DISPLAY){
+        cerr << "OffscreenContext: no EGL display available" << endl;
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if(!eglChooseConfig(display, configAttribs, &config, 1, &configCount) ||
+       configCount == 0){
+        cerr << "OffscreenContext: no pbuffer config with depth" << endl;
+        destroy();
+        return false;
+    }
+
+    const EGLint surfaceAttribs[] = {
+        EGL_WIDTH, width,
+        EGL_HEIGHT, height,
+        EGL_NONE
+    };
+    surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+    if(surface == EGL_NO_SURFACE || !eglBindAPI(EGL_OPENGL_API)){
+        cerr << "OffscreenContext: could not create pbuffer" << endl;
+        destroy();
+        return false;
+    }
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if(context == EGL_NO_CONTEXT ||
+       !eglMakeCurrent(display, surface, surface, context)){
+        cerr << "OffscreenContext: could not create GL context" << endl;
+        destroy();
+        return false;
+    }
+    return true;
+};
+
+/**
+ * @brief makes context current on the calling thread
+ * @return false if there is no context
+ */
+bool OffscreenContext::makeCurrent(){
+    if(context == EGL_NO_CONTEXT){
+        return false;
+    }
+    return eglMakeCurrent(display, surface, surface, context) == EGL_TRUE;
+};
+
+/**
+ * @brief releases EGL resources
+ */
+void OffscreenContext::destroy(){
+    if(display == EGL_NO_DISPLAY){
+        return;
+    }
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(context != EGL_NO_CONTEXT){
+        eglDestroyContext(display, context);
+    }
+    if(surface != EGL_NO_SURFACE){
+        eglDestroySurface(display, surface);
+    }
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+    surface = EGL_NO_SURFACE;
+    context = EGL_NO_CONTEXT;
+};
+
+/**
+ * @brief returns GL_RENDERER of current context
+ */
+const char * OffscreenContext::renderer() const{
+    const GLubyte * name = glGetString(GL_RENDERER);
+    return name ? (const char *)name : "unknown";
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
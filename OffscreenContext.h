@@ -0,0 +1,47 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : OffscreenContext.h
+ * @brief      : Windowless OpenGL context (EGL pbuffer) for headless rendering
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef OFFSCREENCONTEXT_H
+#define OFFSCREENCONTEXT_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <EGL/egl.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// Desktop GL context rendering into an EGL pbuffer. Works without a display
+// server through Mesa's surfaceless platform (llvmpipe / softpipe).
+class OffscreenContext
+{
+public:
+    OffscreenContext();
+    ~OffscreenContext();
+
+    // creates context with a width x height color + depth pbuffer and makes
+    // it current on the calling thread
+    bool create(int width, int height);
+    void destroy();
+    // makes the context current on the calling thread again
+    bool makeCurrent();
+
+    // renderer string of the created context
+    const char * renderer() const;
+private:
+    OffscreenContext(const OffscreenContext & obj);
+    OffscreenContext & operator=(const OffscreenContext & obj);
+
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
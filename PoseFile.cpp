@@ -0,0 +1,308 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseFile.cpp
+ * @brief      : Definition file for memory mapped pose file
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "PoseFile.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+static size_t recordSizeOf(PoseEncoding encoding){
+    return (encoding == POSE_QUANTIZED16) ? sizeof(PoseRecordQ16)
+                                          : sizeof(PoseRecordF32);
+}
+
+static size_t alignUp(size_t v){
+    return (v + POSE_FILE_ALIGNMENT - 1) / POSE_FILE_ALIGNMENT *
+           POSE_FILE_ALIGNMENT;
+}
+
+/**
+ * @brief encodes one pose into record bytes
+ * @action rotation is normalized before storing
+ */
+static void encodeRecord(const double * p, const double * q,
+                         PoseEncoding encoding, const PoseFileHeader & h,
+                         unsigned char * out){
+    double n = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+    n = (n > 0) ? 1.0 / n : 0.0;
+    if(encoding == POSE_FLOAT32){
+        PoseRecordF32 r;
+        for(int k = 0; k < 3; k++){
+            r.position[k] = (float)p[k];
+        }
+        for(int k = 0; k < 4; k++){
+            r.rotation[k] = (float)(q[k] * n);
+        }
+        memcpy(out, &r, sizeof(r));
+    } else {
+        PoseRecordQ16 r;
+        for(int k = 0; k < 3; k++){
+            double extent = h.boundsMax[k] - h.boundsMin[k];
+            double t = (extent > 0) ? (p[k] - h.boundsMin[k]) / extent : 0.0;
+            t = min(max(t, 0.0), 1.0);
+            r.position[k] = (uint16_t)lround(t * 65535.0);
+        }
+        r.pad = 0;
+        for(int k = 0; k < 4; k++){
+            r.rotation[k] = (int16_t)lround(q[k] * n * 32767.0);
+        }
+        memcpy(out, &r, sizeof(r));
+    }
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+PoseFile::PoseFile(){
+    base = 0;
+    header = 0;
+    length = 0;
+};
+
+/**
+ * @brief Destructor
+ * @action unmaps file if mapped
+ */
+PoseFile::~PoseFile(){
+    close();
+};
+
+/**
+ * @brief maps pose file
+ * @param path file path
+ * @return true if file is a valid pose file
+ * @action maps whole file read only. pages are faulted in on access only
+ */
+bool PoseFile::open(const char * path){
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0){
+        cerr << "PoseFile: could not open " << path << endl;
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PoseFileHeader)){
+        cerr << "PoseFile: " << path << " is too small" << endl;
+        ::close(fd);
+        return false;
+    }
+    void * mapped = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapped == MAP_FAILED){
+        cerr << "PoseFile: could not map " << path << endl;
+        return false;
+    }
+    base = (const unsigned char *)mapped;
+    length = st.st_size;
+    header = (const PoseFileHeader *)base;
+
+    // validate layout before trusting any offset
+    const PoseFileHeader & h = *header;
+    bool valid = memcmp(h.magic, POSE_FILE_MAGIC, 4) == 0 &&
+                 h.version == POSE_FILE_VERSION &&
+                 (h.encoding == POSE_FLOAT32 ||
+                  h.encoding == POSE_QUANTIZED16) &&
+                 h.recordSize == recordSizeOf((PoseEncoding)h.encoding) &&
+                 h.recordOffset <= length &&
+                 h.count <= (length - h.recordOffset) / h.recordSize &&
+                 h.tagOffset <= length &&
+                 h.tagCount <= (length - h.tagOffset) / sizeof(PoseFileTag);
+    if(!valid){
+        cerr << "PoseFile: " << path << " is not a valid pose file" << endl;
+        close();
+        return false;
+    }
+    madvise((void*)base, length, MADV_SEQUENTIAL);
+    return true;
+};
+
+/**
+ * @brief unmaps file
+ */
+void PoseFile::close(){
+    if(base){
+        munmap((void*)base, length);
+    }
+    base = 0;
+    header = 0;
+    length = 0;
+};
+
+/**
+ * @brief checks whether path is a mapped pose file
+ * @param path file path
+ * @return true if magic matches
+ */
+bool PoseFile::probe(const char * path){
+    FILE * f = fopen(path, "rb");
+    if(!f){
+        return false;
+    }
+    char magic[4];
+    bool match = fread(magic, 4, 1, f) == 1 &&
+                 memcmp(magic, POSE_FILE_MAGIC, 4) == 0;
+    fclose(f);
+    return match;
+};
+
+/**
+ * @brief writes pose file
+ * @param path output path
+ * @param positions n * x,y,z
+ * @param rotations n * x,y,z,w
+ * @param n number of poses
+ * @param encoding record encoding
+ * @param tags optional tag table
+ * @param tagCount number of tags
+ * @return true on success
+ */
+bool PoseFile::write(const char * path, const double * positions,
+                     const double * rotations, size_t n,
+                     PoseEncoding encoding,
+                     const PoseFileTag * tags, size_t tagCount){
+    PoseFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, POSE_FILE_MAGIC, 4);
+    h.version = POSE_FILE_VERSION;
+    h.encoding = encoding;
+    h.recordSize = recordSizeOf(encoding);
+    h.count = n;
+    h.tagCount = tagCount;
+    h.tagOffset = sizeof(PoseFileHeader);
+    h.recordOffset = alignUp(h.tagOffset + tagCount * sizeof(PoseFileTag));
+
+    // position bounds
+    for(int k = 0; k < 3; k++){
+        h.boundsMin[k] = n ? (float)positions[k] : 0.0f;
+        h.boundsMax[k] = n ? (float)positions[k] : 0.0f;
+    }
+    for(size_t i = 0; i < n; i++){
+        for(int k = 0; k < 3; k++){
+            h.boundsMin[k] = min(h.boundsMin[k], (float)positions[3*i + k]);
+            h.boundsMax[k] = max(h.boundsMax[k], (float)positions[3*i + k]);
+        }
+    }
+
+    FILE * out = fopen(path, "wb");
+    if(!out){
+        cerr << "PoseFile: could not write " << path << endl;
+        return false;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, out) == 1;
+    if(ok && tagCount){
+        ok = fwrite(tags, sizeof(PoseFileTag), tagCount, out) == tagCount;
+    }
+    // pad up to record offset
+    vector<unsigned char> block(h.recordOffset - h.tagOffset -
+                                tagCount * sizeof(PoseFileTag), 0);
+    if(ok && !block.empty()){
+        ok = fwrite(&block[0], 1, block.size(), out) == block.size();
+    }
+
+    // encode records through a staging block
+    const size_t perBlock = 65536;
+    block.resize(perBlock * h.recordSize);
+    for(size_t i = 0; ok && i < n; i += perBlock){
+        size_t m = min(perBlock, n - i);
+        for(size_t j = 0; j < m; j++){
+            encodeRecord(positions + 3*(i+j), rotations + 4*(i+j), encoding,
+                         h, &block[j * h.recordSize]);
+        }
+        ok = fwrite(&block[0], h.recordSize, m, out) == m;
+    }
+    ok = (fclose(out) == 0) && ok;
+    return ok;
+};
+
+/**
+ * @brief returns tag table entry
+ * @param i tag index
+ */
+const PoseFileTag & PoseFile::tag(size_t i) const{
+    const PoseFileTag * table =
+        (const PoseFileTag *)(base + header->tagOffset);
+    return table[i];
+};
+
+/**
+ * @brief decodes pose
+ * @param i pose index
+ * @param position output x,y,z
+ * @param rotation output x,y,z,w
+ */
+void PoseFile::getPose(size_t i, double * position, double * rotation) const{
+    const unsigned char * record = records() + i * header->recordSize;
+    if(encoding() == POSE_FLOAT32){
+        PoseRecordF32 r;
+        memcpy(&r, record, sizeof(r));
+        for(int k = 0; k < 3; k++){
+            position[k] = r.position[k];
+        }
+        for(int k = 0; k < 4; k++){
+            rotation[k] = r.rotation[k];
+        }
+    } else {
+        PoseRecordQ16 r;
+        memcpy(&r, record, sizeof(r));
+        for(int k = 0; k < 3; k++){
+            double extent = header->boundsMax[k] - header->boundsMin[k];
+            position[k] = header->boundsMin[k] +
+                          extent * r.position[k] / 65535.0;
+        }
+        for(int k = 0; k < 4; k++){
+            rotation[k] = max(r.rotation[k] / 32767.0, -1.0);
+        }
+    }
+};
+
+/**
+ * @brief releases resident pages of a record range
+ * @param first first record
+ * @param n number of records
+ * @action pages are clean file pages, so they are simply dropped and read
+ *         back from disk if touched again
+ */
+void PoseFile::release(size_t first, size_t n) const{
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t begin = header->recordOffset + first * header->recordSize;
+    size_t end = begin + n * header->recordSize;
+    // only whole pages inside the range
+    begin = (begin + page - 1) / page * page;
+    end = end / page * page;
+    if(end > begin){
+        madvise((void*)(base + begin), end - begin, MADV_DONTNEED);
+    }
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
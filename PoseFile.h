@@ -0,0 +1,120 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseFile.h
+ * @brief      : Memory mapped fixed layout pose file
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef POSEFILE_H
+#define POSEFILE_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cstddef>
+#include <stdint.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+#define POSE_FILE_MAGIC "TVPM"
+#define POSE_FILE_VERSION 1
+// records start on a page boundary so they can be handed to GL as is
+#define POSE_FILE_ALIGNMENT 4096
+
+// record encodings
+enum PoseEncoding {
+    // float position[3], float rotation[4]
+    POSE_FLOAT32 = 0,
+    // uint16 position[3] within header bounds, pad, snorm16 rotation[4]
+    POSE_QUANTIZED16 = 1
+};
+
+// on-disk header. all fields little endian
+struct PoseFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t encoding;
+    uint32_t recordSize;
+    uint64_t count;
+    uint64_t recordOffset;
+    uint64_t tagOffset;
+    uint32_t tagCount;
+    uint32_t reserved;
+    // position bounds used to dequantize POSE_QUANTIZED16 records
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+struct PoseRecordF32 {
+    float position[3];
+    float rotation[4];
+};
+
+struct PoseRecordQ16 {
+    uint16_t position[3];
+    uint16_t pad;
+    int16_t rotation[4];
+};
+
+// optional tag table entry
+struct PoseFileTag {
+    uint32_t id;
+    float position[3];
+    float rotation[4];
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+class PoseFile
+{
+public:
+    PoseFile();
+    ~PoseFile();
+
+    // maps file read only. no pose data is read until it is accessed
+    bool open(const char * path);
+    void close();
+    bool isOpen() const { return base != 0; };
+
+    // true if file starts with the pose file magic
+    static bool probe(const char * path);
+
+    // writes poses (and optional tags) in the mapped file layout
+    static bool write(const char * path, const double * positions,
+                      const double * rotations, size_t n,
+                      PoseEncoding encoding,
+                      const PoseFileTag * tags = 0, size_t tagCount = 0);
+
+    size_t count() const { return header ? (size_t)header->count : 0; };
+    size_t recordSize() const { return header->recordSize; };
+    PoseEncoding encoding() const { return (PoseEncoding)header->encoding; };
+    const float * boundsMin() const { return header->boundsMin; };
+    const float * boundsMax() const { return header->boundsMax; };
+
+    // pointer to first record of the mapped range
+    const unsigned char * records() const { return base + header->recordOffset; };
+
+    size_t tagCount() const { return header ? header->tagCount : 0; };
+    const PoseFileTag & tag(size_t i) const;
+
+    // decodes single pose into doubles
+    void getPose(size_t i, double * position, double * rotation) const;
+
+    // drops resident pages of records [first, first + n) after use
+    void release(size_t first, size_t n) const;
+private:
+    PoseFile(const PoseFile & obj);
+    PoseFile & operator=(const PoseFile & obj);
+
+    const unsigned char * base;
+    const PoseFileHeader * header;
+    size_t length;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
@@ -0,0 +1,600 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseLoader.cpp
+ * @brief      : Definition file for streaming pose file loader
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <stdint.h>
+#include "PoseLoader.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// bytes read from disk per block
+static const size_t READ_BLOCK = 4 << 20;
+// maximum number of parsed chunks waiting for the consumer
+static const size_t MAX_QUEUED_CHUNKS = 8;
+
+struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+};
+
+static bool isSeparator(char c){
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+/**
+ * @brief parses a decimal number without locale / errno overhead of strtod
+ * @param p current read pointer, advanced past the number on success
+ * @param end end of line
+ * @param out parsed value
+ * @return true if a number was parsed
+ */
+static bool parseNumber(const char *& p, const char * end, double & out){
+    static const double POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char * c = p;
+    bool negative = false;
+    if(c < end && (*c == '-' || *c == '+')){
+        negative = (*c == '-');
+        c++;
+    }
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool any = false;
+    // integer part
+    while(c < end && *c >= '0' && *c <= '9'){
+        if(digits < 19){
+            mantissa = mantissa * 10 + (*c - '0');
+            if(mantissa){
+                digits++;
+            }
+        } else {
+            exponent++;
+        }
+        any = true;
+        c++;
+    }
+    // fraction part
+    if(c < end && *c == '.'){
+        c++;
+        while(c < end && *c >= '0' && *c <= '9'){
+            if(digits < 19){
+                mantissa = mantissa * 10 + (*c - '0');
+                if(mantissa){
+                    digits++;
+                }
+                exponent--;
+            }
+            any = true;
+            c++;
+        }
+    }
+    if(!any){
+        return false;
+    }
+    // exponent part
+    if(c < end && (*c == 'e' || *c == 'E')){
+        const char * e = c + 1;
+        bool eNegative = false;
+        if(e < end && (*e == '-' || *e == '+')){
+            eNegative = (*e == '-');
+            e++;
+        }
+        if(e < end && *e >= '0' && *e <= '9'){
+            int value = 0;
+            while(e < end && *e >= '0' && *e <= '9'){
+                if(value < 10000){
+                    value = value * 10 + (*e - '0');
+                }
+                e++;
+            }
+            exponent += eNegative ? -value : value;
+            c = e;
+        }
+    }
+    double v = (double)mantissa;
+    if(exponent < 0){
+        v = (exponent >= -22) ? v / POW10[-exponent] : v * pow(10.0, exponent);
+    } else if(exponent > 0){
+        v = (exponent <= 22) ? v * POW10[exponent] : v * pow(10.0, exponent);
+    }
+    out = negative ? -v : v;
+    p = c;
+    return true;
+}
+
+/**
+ * @brief parses one text line into a pose
+ * @param line start of line
+ * @param end end of line (exclusive)
+ * @param chunk destination chunk
+ * @action accepts 7 values (pose) or 8 values (timestamp + pose). poses
+ *         without timestamp get NaN. comments, blank lines and header rows
+ *         are skipped
+ */
+static void parseLine(const char * line, const char * end, PoseChunk & chunk){
+    double values[8];
+    int n = 0;
+    const char * p = line;
+    while(p < end){
+        while(p < end && isSeparator(*p)){
+            p++;
+        }
+        if(p >= end || *p == '#'){
+            break;
+        }
+        if(n == 8 || !parseNumber(p, end, values[n])){
+            // header row or malformed line
+            return;
+        }
+        n++;
+        if(p < end && !isSeparator(*p)){
+            return;
+        }
+    }
+    if(n != 7 && n != 8){
+        return;
+    }
+    const double * pose = values + (n - 7);
+    chunk.timestamps.push_back((n == 8) ? values[0] : NAN);
+    chunk.positions.insert(chunk.positions.end(), pose, pose + 3);
+    chunk.rotations.insert(chunk.rotations.end(), pose + 3, pose + 7);
+}
+
+/**
+ * @brief parses every line of [begin, end) into chunk
+ */
+static void parseLines(const char * begin, const char * end,
+                       PoseChunk * chunk){
+    const char * line = begin;
+    while(line < end){
+        const char * newline = (const char*)memchr(line, '\n', end - line);
+        if(!newline){
+            newline = end;
+        }
+        parseLine(line, newline, *chunk);
+        line = newline + 1;
+    }
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+PoseLoader::PoseLoader(){
+    file = 0;
+    format = FORMAT_AUTO;
+    expected = 0;
+    fileBytes = 0;
+    bytesRead = 0;
+    notify = 0;
+    notifyArg = 0;
+    finished = true;
+    error = false;
+    stopping = false;
+};
+
+/**
+ * @brief Destructor
+ * @action joins loader thread and closes file
+ */
+PoseLoader::~PoseLoader(){
+    close();
+};
+
+/**
+ * @brief opens pose file and starts background parsing
+ * @param path file path
+ * @param format file format. FORMAT_AUTO checks for the binary magic
+ * @return true if file could be opened
+ */
+bool PoseLoader::open(const char * path, Format fmt){
+    close();
+    file = fopen(path, "rb");
+    if(!file){
+        cerr << "PoseLoader: could not open " << path << endl;
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    fileBytes = (size_t)ftell(file);
+    rewind(file);
+    bytesRead = 0;
+
+    // detect format from header
+    BinaryHeader header;
+    bool hasHeader = fread(&header, sizeof(header), 1, file) == 1 &&
+                     memcmp(header.magic, POSE_BINARY_MAGIC, 4) == 0;
+    if(fmt == FORMAT_AUTO){
+        fmt = hasHeader ? FORMAT_BINARY : FORMAT_TEXT;
+    }
+    format = fmt;
+
+    if(format == FORMAT_BINARY){
+        if(!hasHeader || header.version != POSE_BINARY_VERSION){
+            cerr << "PoseLoader: bad binary header in " << path << endl;
+            fclose(file);
+            file = 0;
+            return false;
+        }
+        // the count is only a reservation hint once it fits the file
+        size_t records = (fileBytes - sizeof(header)) / (sizeof(double) * 7);
+        if(header.count > records){
+            cerr << "PoseLoader: " << path << " claims " << header.count
+                 << " poses but holds at most " << records << endl;
+            fclose(file);
+            file = 0;
+            return false;
+        }
+        expected = (size_t)header.count;
+    } else {
+        rewind(file);
+        expected = estimateLines();
+        rewind(file);
+    }
+
+    finished = false;
+    error = false;
+    stopping = false;
+    worker = thread(&PoseLoader::run, this);
+    return true;
+};
+
+/**
+ * @brief pops the next parsed chunk
+ * @param chunk destination, swapped with the queued chunk
+ * @return false once all chunks were consumed
+ */
+bool PoseLoader::nextChunk(PoseChunk & chunk){
+    unique_lock<mutex> guard(lock);
+    while(chunks.empty() && !finished){
+        ready.wait(guard);
+    }
+    if(chunks.empty()){
+        return false;
+    }
+    chunk.positions.swap(chunks.front().positions);
+    chunk.rotations.swap(chunks.front().rotations);
+    chunk.timestamps.swap(chunks.front().timestamps);
+    chunks.pop_front();
+    ready.notify_all();
+    return true;
+};
+
+/**
+ * @brief takes the next parsed chunk without waiting
+ * @param chunk destination, swapped with the queued chunk
+ * @return false if no chunk is ready (yet)
+ */
+bool PoseLoader::pollChunk(PoseChunk & chunk){
+    lock_guard<mutex> guard(lock);
+    if(chunks.empty()){
+        return false;
+    }
+    chunk.positions.swap(chunks.front().positions);
+    chunk.rotations.swap(chunks.front().rotations);
+    chunk.timestamps.swap(chunks.front().timestamps);
+    chunks.pop_front();
+    ready.notify_all();
+    return true;
+};
+
+/**
+ * @brief returns whether every chunk was parsed and taken
+ */
+bool PoseLoader::done(){
+    lock_guard<mutex> guard(lock);
+    return finished && chunks.empty();
+};
+
+/**
+ * @brief fraction of the file read by the loader thread
+ */
+double PoseLoader::progress() const{
+    if(fileBytes == 0){
+        return 1.0;
+    }
+    return min(1.0, (double)bytesRead.load() / fileBytes);
+};
+
+/**
+ * @brief sets callback run after each published chunk and at the end
+ * @param callback function taking arg, called on the loader thread
+ * @param arg passed to callback
+ */
+void PoseLoader::setNotify(void (*callback)(void *), void * arg){
+    lock_guard<mutex> guard(lock);
+    notify = callback;
+    notifyArg = arg;
+};
+
+/**
+ * @brief returns whether loader hit an error
+ */
+bool PoseLoader::failed(){
+    lock_guard<mutex> guard(lock);
+    return error;
+};
+
+/**
+ * @brief stops background thread and releases file
+ */
+void PoseLoader::close(){
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    ready.notify_all();
+    if(worker.joinable()){
+        worker.join();
+    }
+    if(file){
+        fclose(file);
+        file = 0;
+    }
+    chunks.clear();
+    finished = true;
+};
+
+/**
+ * @brief writes poses as binary pose file
+ * @param path output path
+ * @param positions n * x,y,z
+ * @param rotations n * x,y,z,w
+ * @param n number of poses
+ * @return true on success
+ */
+bool PoseLoader::writeBinary(const char * path, const double * positions,
+                             const double * rotations, size_t n){
+    FILE * out = fopen(path, "wb");
+    if(!out){
+        cerr << "PoseLoader: could not write " << path << endl;
+        return false;
+    }
+    BinaryHeader header;
+    memcpy(header.magic, POSE_BINARY_MAGIC, 4);
+    header.version = POSE_BINARY_VERSION;
+    header.count = n;
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    // interleave records through a small staging buffer
+    vector<double> block;
+    block.reserve(CHUNK_POSES * 7);
+    for(size_t i = 0; ok && i < n; i += CHUNK_POSES){
+        size_t m = min(CHUNK_POSES, n - i);
+        block.clear();
+        for(size_t j = i; j < i + m; j++){
+            block.insert(block.end(), positions + 3*j, positions + 3*j + 3);
+            block.insert(block.end(), rotations + 4*j, rotations + 4*j + 4);
+        }
+        ok = fwrite(&block[0], sizeof(double), block.size(), out) ==
+             block.size();
+    }
+    ok = (fclose(out) == 0) && ok;
+    return ok;
+};
+
+/**
+ * @brief loader thread entry point
+ */
+void PoseLoader::run(){
+    if(format == FORMAT_BINARY){
+        parseBinary();
+    } else {
+        parseText();
+    }
+    unique_lock<mutex> guard(lock);
+    finished = true;
+    ready.notify_all();
+    if(notify){
+        notify(notifyArg);
+    }
+};
+
+/**
+ * @brief reads binary records chunk by chunk
+ */
+void PoseLoader::parseBinary(){
+    vector<double> block(CHUNK_POSES * 7);
+    size_t remaining = expected;
+    while(remaining > 0){
+        size_t m = min(CHUNK_POSES, remaining);
+        if(fread(&block[0], sizeof(double) * 7, m, file) != m){
+            lock_guard<mutex> guard(lock);
+            error = true;
+            cerr << "PoseLoader: truncated binary pose file" << endl;
+            return;
+        }
+        PoseChunk chunk;
+        chunk.positions.resize(m * 3);
+        chunk.rotations.resize(m * 4);
+        for(size_t j = 0; j < m; j++){
+            const double * record = &block[j * 7];
+            copy(record, record + 3, &chunk.positions[j * 3]);
+            copy(record + 3, record + 7, &chunk.rotations[j * 4]);
+        }
+        remaining -= m;
+        bytesRead += m * sizeof(double) * 7;
+        publish(chunk);
+        if(stopping){
+            return;
+        }
+    }
+};
+
+/**
+ * @brief reads text in blocks and parses complete lines
+ * @action partial lines at the end of a block are carried to the next one.
+ *         with several hardware threads a block of READ_BLOCK per thread
+ *         is read and its lines are parsed in parallel slices
+ */
+void PoseLoader::parseText(){
+    size_t slices = max(1u, thread::hardware_concurrency());
+    vector<char> buffer(READ_BLOCK * slices);
+    vector<PoseChunk> parts(slices);
+    size_t carry = 0;
+    PoseChunk chunk;
+    chunk.positions.reserve(CHUNK_POSES * 3);
+    chunk.rotations.reserve(CHUNK_POSES * 4);
+    chunk.timestamps.reserve(CHUNK_POSES);
+    while(!stopping){
+        size_t n = fread(&buffer[carry], 1, buffer.size() - carry, file);
+        size_t filled = carry + n;
+        bytesRead += n;
+        bool eof = (n == 0);
+        if(filled == 0){
+            break;
+        }
+        const char * begin = &buffer[0];
+        const char * end = begin + filled;
+        const char * line = begin;
+        if(slices > 1){
+            // whole lines only, the partial last one is carried
+            line = end;
+            while(!eof && line > begin && line[-1] != '\n'){
+                line--;
+            }
+            parseSlices(begin, line, parts);
+            for(size_t s = 0; s < parts.size(); s++){
+                if(parts[s].size()){
+                    publish(parts[s]);
+                }
+            }
+        }
+        while(line < end){
+            const char * newline = (const char*)memchr(line, '\n', end - line);
+            if(!newline){
+                if(!eof){
+                    break;
+                }
+                newline = end;
+            }
+            parseLine(line, newline, chunk);
+            line = newline + 1;
+            if(chunk.size() >= CHUNK_POSES){
+                publish(chunk);
+                chunk.positions.reserve(CHUNK_POSES * 3);
+                chunk.rotations.reserve(CHUNK_POSES * 4);
+                chunk.timestamps.reserve(CHUNK_POSES);
+            }
+        }
+        if(eof){
+            break;
+        }
+        // move partial line to front of buffer
+        carry = (line < end) ? end - line : 0;
+        if(carry){
+            memmove(&buffer[0], line, carry);
+        }
+        if(carry == buffer.size()){
+            // single line larger than the block. grow buffer
+            buffer.resize(buffer.size() * 2);
+        }
+    }
+    if(chunk.size()){
+        publish(chunk);
+    }
+};
+
+/**
+ * @brief parses [begin, end) in parts.size() slices split at line ends,
+ *        one thread per slice
+ * @param parts one chunk per slice, in file order. cleared first
+ */
+void PoseLoader::parseSlices(const char * begin, const char * end,
+                             vector<PoseChunk> & parts){
+    vector<thread> workers;
+    const char * first = begin;
+    const char * slice = begin;
+    for(size_t s = 0; s < parts.size(); s++){
+        parts[s].clear();
+        const char * next = end;
+        if(s + 1 < parts.size()){
+            next = slice + (end - slice) / (parts.size() - s);
+            next = (const char*)memchr(next, '\n', end - next);
+            next = next ? next + 1 : end;
+        }
+        if(s == 0){
+            // parsed on this thread while the others run
+            first = next;
+        } else if(slice < next){
+            workers.push_back(thread(parseLines, slice, next, &parts[s]));
+        }
+        slice = next;
+    }
+    parseLines(begin, first, &parts[0]);
+    for(size_t w = 0; w < workers.size(); w++){
+        workers[w].join();
+    }
+};
+
+/**
+ * @brief estimates lines in text file from its first block
+ * @return number of newline separated lines, exact for files of one block
+ * @action only the first block is read so open does not wait for the
+ *         whole file
+ */
+size_t PoseLoader::estimateLines(){
+    vector<char> buffer(READ_BLOCK);
+    size_t n = fread(&buffer[0], 1, buffer.size(), file);
+    if(n == 0){
+        return 0;
+    }
+    size_t lines = 0;
+    const char * p = &buffer[0];
+    const char * end = p + n;
+    while((p = (const char*)memchr(p, '\n', end - p))){
+        lines++;
+        p++;
+    }
+    if(buffer[n - 1] != '\n'){
+        lines++;
+    }
+    if(n < buffer.size() || n >= fileBytes){
+        return lines;
+    }
+    return (size_t)((double)lines * fileBytes / n);
+};
+
+/**
+ * @brief hands chunk over to consumer
+ * @param chunk parsed chunk. left empty after the call
+ */
+void PoseLoader::publish(PoseChunk & chunk){
+    unique_lock<mutex> guard(lock);
+    while(chunks.size() >= MAX_QUEUED_CHUNKS && !stopping){
+        ready.wait(guard);
+    }
+    if(stopping){
+        return;
+    }
+    chunks.push_back(PoseChunk());
+    chunks.back().positions.swap(chunk.positions);
+    chunks.back().rotations.swap(chunk.rotations);
+    chunks.back().timestamps.swap(chunk.timestamps);
+    ready.notify_all();
+    if(notify){
+        notify(notifyArg);
+    }
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
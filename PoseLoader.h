@@ -0,0 +1,143 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseLoader.h
+ * @brief      : Streaming pose file loader (binary / TUM / CSV)
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef POSELOADER_H
+#define POSELOADER_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// magic / version written at the start of binary pose files
+#define POSE_BINARY_MAGIC "TVPB"
+#define POSE_BINARY_VERSION 1
+
+// block of parsed poses handed from the loader thread to the consumer
+struct PoseChunk {
+    // x,y,z per pose
+    vector<double> positions;
+    // x,y,z,w per pose
+    vector<double> rotations;
+    // one per pose (NaN where the line had none), empty for binary files
+    vector<double> timestamps;
+
+    size_t size() const { return positions.size() / 3; };
+    void clear() {
+        positions.clear();
+        rotations.clear();
+        timestamps.clear();
+    };
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+class PoseLoader
+{
+public:
+    enum Format {
+        FORMAT_AUTO,
+        // header + packed double[3] position / double[4] rotation records
+        FORMAT_BINARY,
+        // "[timestamp] tx ty tz qx qy qz qw" separated by spaces or commas
+        FORMAT_TEXT
+    };
+
+    PoseLoader();
+    ~PoseLoader();
+
+    // opens file and starts parsing on a background thread
+    bool open(const char * path, Format format = FORMAT_AUTO);
+
+    // number of poses the file is expected to hold (for reserving). exact
+    // for binary files, estimated from the first block for text
+    size_t expectedCount() const { return expected; };
+
+    // blocks until next chunk is parsed. returns false when finished
+    bool nextChunk(PoseChunk & chunk);
+
+    // takes next chunk if one is parsed already, never blocks
+    bool pollChunk(PoseChunk & chunk);
+
+    // true once parsing stopped and every chunk was taken
+    bool done();
+
+    // fraction of the file read so far, 0..1
+    double progress() const;
+
+    // callback run on the loader thread after each chunk and at the end
+    // (e.g. to wake a render loop). it runs under the loader lock, so it
+    // must not call back into the loader. 0 to remove
+    void setNotify(void (*callback)(void *), void * arg);
+
+    // true if reading / parsing stopped due to an error
+    bool failed();
+
+    // stops loader thread and closes file
+    void close();
+
+    // writes poses as a binary pose file
+    static bool writeBinary(const char * path, const double * positions,
+                            const double * rotations, size_t n);
+
+    // poses per chunk handed to the consumer
+    static const size_t CHUNK_POSES = 65536;
+private:
+    PoseLoader(const PoseLoader & obj);
+    PoseLoader & operator=(const PoseLoader & obj);
+
+    // worker thread body
+    void run();
+    void parseBinary();
+    void parseText();
+    void parseSlices(const char * begin, const char * end,
+                     vector<PoseChunk> & parts);
+    size_t estimateLines();
+
+    // hands a full chunk to the consumer queue, blocking when queue is full
+    void publish(PoseChunk & chunk);
+
+    FILE * file;
+    Format format;
+    size_t expected;
+    size_t fileBytes;
+    atomic<size_t> bytesRead;
+    void (*notify)(void *);
+    void * notifyArg;
+
+    // producer / consumer state
+    thread worker;
+    mutex lock;
+    condition_variable ready;
+    deque<PoseChunk> chunks;
+    bool finished;
+    bool error;
+    atomic<bool> stopping;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
@@ -0,0 +1,96 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseQueue.cpp
+ * @brief      : Definition file for lock-free pose update queue
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include "PoseQueue.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Constructor
+ * @param capacity minimum number of queued updates
+ * @action slot i starts with sequence i, meaning "free for enqueue index i"
+ */
+PoseQueue::PoseQueue(size_t capacity){
+    size_t size = 2;
+    while(size < capacity){
+        size *= 2;
+    }
+    cells = new Cell[size];
+    mask = size - 1;
+    for(size_t i = 0; i < size; i++){
+        cells[i].sequence.store(i, memory_order_relaxed);
+    }
+    enqueueIndex.store(0, memory_order_relaxed);
+    dequeueIndex.store(0, memory_order_relaxed);
+    droppedCount.store(0, memory_order_relaxed);
+};
+
+/**
+ * @brief Destructor
+ */
+PoseQueue::~PoseQueue(){
+    delete [] cells;
+};
+
+/**
+ * @brief enqueues update without blocking
+ * @param update pose update to copy in
+ * @return false if queue is full
+ * @action claims a slot whose sequence equals the enqueue index, copies the
+ *         update and publishes it by bumping the sequence
+ */
+bool PoseQueue::push(const PoseUpdate & update){
+    size_t index = enqueueIndex.load(memory_order_relaxed);
+    Cell * cell;
+    while(true){
+        cell = &cells[index & mask];
+        size_t sequence = cell->sequence.load(memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)index;
+        if(diff == 0){
+            if(enqueueIndex.compare_exchange_weak(index, index + 1,
+                                                  memory_order_relaxed)){
+                break;
+            }
+        } else if(diff < 0){
+            // slot still holds an update from one lap ago
+            droppedCount.fetch_add(1, memory_order_relaxed);
+            return false;
+        } else {
+            index = enqueueIndex.load(memory_order_relaxed);
+        }
+    }
+    cell->update = update;
+    cell->sequence.store(index + 1, memory_order_release);
+    return true;
+};
+
+/**
+ * @brief dequeues oldest update
+ * @param update destination
+ * @return false if queue is empty
+ */
+bool PoseQueue::pop(PoseUpdate & update){
+    size_t index = dequeueIndex.load(memory_order_relaxed);
+    Cell * cell = &cells[index & mask];
+    size_t sequence = cell->sequence.load(memory_order_acquire);
+    if(sequence != index + 1){
+        return false;
+    }
+    update = cell->update;
+    // free slot for the producer one lap ahead
+    cell->sequence.store(index + mask + 1, memory_order_release);
+    dequeueIndex.store(index + 1, memory_order_relaxed);
+    return true;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
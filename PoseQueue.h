@@ -0,0 +1,96 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseQueue.h
+ * @brief      : Lock-free bounded queue of pose updates (multi producer /
+ *               single consumer)
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef POSEQUEUE_H
+#define POSEQUEUE_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// single pose change sent from a producer thread to the render thread
+struct PoseUpdate {
+    enum Type {
+        // append camera without an id
+        CAMERA_APPEND,
+        // insert camera with id, or move it if the id already exists
+        CAMERA_UPSERT,
+        // move tag origin
+        TAG_ORIGIN,
+        // insert tag with id, or move it if the id already exists
+        TAG_UPSERT,
+        // remove all cameras
+        CAMERA_CLEAR
+    };
+    uint32_t type;
+    uint64_t id;
+    double position[3];
+    double rotation[4];
+    // timestamp of an added camera, NaN for one after the previous camera
+    double time;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// Bounded ring with a sequence number per slot. Producers claim slots with a
+// CAS on the enqueue index and never wait; a full queue rejects the update.
+// Only one thread may pop.
+class PoseQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit PoseQueue(size_t capacity);
+    ~PoseQueue();
+
+    // any thread. returns false (and counts a drop) when full
+    bool push(const PoseUpdate & update);
+
+    // consumer thread only. returns false when empty
+    bool pop(PoseUpdate & update);
+
+    size_t capacity() const { return mask + 1; };
+
+    // number of updates rejected because the queue was full
+    size_t dropped() const { return droppedCount.load(memory_order_relaxed); };
+private:
+    PoseQueue(const PoseQueue & obj);
+    PoseQueue & operator=(const PoseQueue & obj);
+
+    struct Cell {
+        atomic<size_t> sequence;
+        PoseUpdate update;
+    };
+
+    Cell * cells;
+    size_t mask;
+
+    // producer / consumer indices on separate cache lines
+    alignas(64) atomic<size_t> enqueueIndex;
+    alignas(64) atomic<size_t> dequeueIndex;
+    alignas(64) atomic<size_t> droppedCount;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
@@ -0,0 +1,144 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseSender.cpp
+ * @brief      : Test sender for the socket pose feed. Streams a synthetic
+ *               trajectory to a viewer started with -listen and prints the
+ *               ingest rate
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include "PoseServer.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <thread>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                        GLOBAL VARIABLE DEFINITIONS                         //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                      END GLOBAL VARIABLE DEFINITIONS                       //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief wall clock in seconds
+ */
+static double now(){
+    return chrono::duration<double>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief pose i of a helix around the z axis, looking at the axis
+ * @param i pose index
+ * @param position output x,y,z
+ * @param rotation output x,y,z,w
+ */
+static void helixPose(size_t i, double * position, double * rotation){
+    double t = i * 0.001;
+    position[0] = 5.0 * cos(t);
+    position[1] = 5.0 * sin(t);
+    position[2] = i * 0.0001;
+    rotation[0] = 0.0;
+    rotation[1] = 0.0;
+    rotation[2] = sin(0.5 * t);
+    rotation[3] = cos(0.5 * t);
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+/**
+ * @brief streams -n poses in batches of -batch appended cameras, each
+ *        batch followed by id updates of -moving cameras
+ */
+int main(int argc, char ** argv){
+    if(argc < 2){
+        cerr << "usage: " << argv[0] << " address [-n poses] [-batch N]"
+             << " [-moving N] [-rate poses/s] [-clear]" << endl;
+        return 1;
+    }
+    const char * address = argv[1];
+    size_t total = 10000000;
+    size_t batch = 4096;
+    size_t moving = 0;
+    double rate = 0.0;
+    bool clear = false;
+    for(int i = 2; i < argc; i++){
+        bool hasValue = (i + 1 < argc);
+        if(strcmp(argv[i], "-n") == 0 && hasValue){
+            total = strtoull(argv[++i], 0, 10);
+        } else if(strcmp(argv[i], "-batch") == 0 && hasValue){
+            batch = max(strtoull(argv[++i], 0, 10), 1ULL);
+        } else if(strcmp(argv[i], "-moving") == 0 && hasValue){
+            moving = strtoull(argv[++i], 0, 10);
+        } else if(strcmp(argv[i], "-rate") == 0 && hasValue){
+            rate = atof(argv[++i]);
+        } else if(strcmp(argv[i], "-clear") == 0){
+            clear = true;
+        }
+    }
+
+    PoseClient client;
+    if(!client.connect(address)){
+        return 1;
+    }
+    if(clear){
+        client.sendClear();
+    }
+
+    vector<double> positions(3 * batch);
+    vector<double> rotations(4 * batch);
+    vector<uint64_t> ids(moving);
+    vector<double> movedPositions(3 * moving);
+    vector<double> movedRotations(4 * moving);
+    size_t sent = 0;
+    size_t updates = 0;
+    double start = now();
+    bool ok = true;
+    while(ok && sent < total){
+        size_t n = min(batch, total - sent);
+        for(size_t i = 0; i < n; i++){
+            helixPose(sent + i, &positions[3 * i], &rotations[4 * i]);
+        }
+        ok = client.sendCameras(&positions[0], &rotations[0], n);
+        sent += n;
+        // a few cameras with ids circle the helix
+        for(size_t k = 0; ok && k < moving; k++){
+            ids[k] = k;
+            helixPose(sent + k * 997, &movedPositions[3 * k],
+                      &movedRotations[4 * k]);
+            movedPositions[3 * k] *= 1.2;
+            movedPositions[3 * k + 1] *= 1.2;
+        }
+        if(ok && moving){
+            ok = client.sendCameras(&ids[0], &movedPositions[0],
+                                    &movedRotations[0], moving);
+            updates += moving;
+        }
+        if(rate > 0.0){
+            double ahead = sent / rate - (now() - start);
+            if(ahead > 0.0){
+                client.flush();
+                this_thread::sleep_for(chrono::duration<double>(ahead));
+            }
+        }
+    }
+    ok = ok && client.flush();
+    double seconds = now() - start;
+    double bytes = sent * (sizeof(PoseRecord) + sizeof(PoseMessageHeader) /
+                           (double)batch) +
+                   updates * sizeof(PoseIdRecord);
+    cout << "sent " << sent << " poses + " << updates << " updates in "
+         << seconds << " s: " << (sent + updates) / seconds << " poses/s, "
+         << bytes / seconds / 1e6 << " MB/s" << endl;
+    return ok ? 0 : 1;
+}
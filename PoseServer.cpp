@@ -0,0 +1,557 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseServer.cpp
+ * @brief      : Definition file for the socket pose feed
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "PoseServer.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief opens a listening / connected stream socket for address
+ * @param address "unix:PATH", a path containing '/', or "[HOST:]PORT"
+ * @param listening bind and listen instead of connecting
+ * @param unixPath set to the socket path for UNIX domain sockets
+ * @return file descriptor, -1 on failure
+ * @action a stale socket file left at a UNIX path is replaced
+ */
+static int openSocket(const char * address, bool listening, string & unixPath){
+    unixPath.clear();
+    string spec = address;
+    if(spec.compare(0, 5, "unix:") == 0){
+        unixPath = spec.substr(5);
+    } else if(spec.find('/') != string::npos){
+        unixPath = spec;
+    }
+
+    if(!unixPath.empty()){
+        sockaddr_un local;
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        if(unixPath.size() >= sizeof(local.sun_path)){
+            cerr << "PoseServer: socket path too long " << unixPath << endl;
+            return -1;
+        }
+        strcpy(local.sun_path, unixPath.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd < 0){
+            return -1;
+        }
+        if(listening){
+            unlink(unixPath.c_str());
+            if(bind(fd, (sockaddr *)&local, sizeof(local)) != 0 ||
+               listen(fd, SOMAXCONN) != 0){
+                close(fd);
+                return -1;
+            }
+        } else if(connect(fd, (sockaddr *)&local, sizeof(local)) != 0){
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // [HOST:]PORT, loopback unless a host is given
+    string host = "127.0.0.1";
+    string port = spec;
+    size_t colon = spec.rfind(':');
+    if(colon != string::npos){
+        host = spec.substr(0, colon);
+        port = spec.substr(colon + 1);
+    }
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo * found = 0;
+    if(getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0){
+        cerr << "PoseServer: could not resolve " << address << endl;
+        return -1;
+    }
+    int fd = socket(found->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool ok = (fd >= 0);
+    if(ok && listening){
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        ok = bind(fd, found->ai_addr, found->ai_addrlen) == 0 &&
+             listen(fd, SOMAXCONN) == 0;
+    } else if(ok){
+        ok = connect(fd, found->ai_addr, found->ai_addrlen) == 0;
+    }
+    freeaddrinfo(found);
+    if(!ok && fd >= 0){
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief makes fd non blocking
+ */
+static void setNonBlocking(int fd){
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+PoseServer::PoseServer(){
+    listenFd = -1;
+    stopPipe[0] = stopPipe[1] = -1;
+    stopping = false;
+    notify = 0;
+    notifyArg = 0;
+    connected = 0;
+    receivedCount = 0;
+};
+
+/**
+ * @brief Destructor
+ * @action closes all connections and joins the server thread
+ */
+PoseServer::~PoseServer(){
+    stop();
+};
+
+/**
+ * @brief listens on address and starts the server thread
+ * @param address see PoseServer
+ * @return false if the socket could not be bound
+ */
+bool PoseServer::start(const char * address){
+    stop();
+    listenFd = openSocket(address, true, unixPath);
+    if(listenFd < 0){
+        cerr << "PoseServer: could not listen on " << address << endl;
+        return false;
+    }
+    if(pipe(stopPipe) != 0){
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    setNonBlocking(listenFd);
+    stopping = false;
+    worker = thread(&PoseServer::run, this);
+    return true;
+};
+
+/**
+ * @brief stops the server thread and closes all sockets
+ * @action updates not taken yet are dropped
+ */
+void PoseServer::stop(){
+    if(listenFd < 0){
+        return;
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    drained.notify_all();
+    char byte = 1;
+    ssize_t written = write(stopPipe[1], &byte, 1);
+    (void)written;
+    worker.join();
+
+    close(listenFd);
+    listenFd = -1;
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    stopPipe[0] = stopPipe[1] = -1;
+    if(!unixPath.empty()){
+        unlink(unixPath.c_str());
+    }
+    pending.clear();
+};
+
+/**
+ * @brief takes all updates received since the last call
+ * @param updates destination, swapped with the pending batch
+ * @return false if nothing arrived
+ * @action the server resumes reading if it paused on a full batch
+ */
+bool PoseServer::take(vector<PoseUpdate> & updates){
+    updates.clear();
+    {
+        lock_guard<mutex> guard(lock);
+        if(pending.empty()){
+            return false;
+        }
+        updates.swap(pending);
+    }
+    drained.notify_all();
+    return true;
+};
+
+/**
+ * @brief sets callback run when updates arrive
+ * @param callback function taking arg, 0 for none
+ * @param arg passed to callback
+ */
+void PoseServer::setNotify(void (*callback)(void *), void * arg){
+    lock_guard<mutex> guard(lock);
+    notify = callback;
+    notifyArg = arg;
+};
+
+/**
+ * @brief server thread body
+ * @action polls the listening socket and every client. each round reads
+ *         up to READ_BYTES per readable client and publishes what parsed
+ *         with one lock. waits while the render thread is MAX_PENDING
+ *         updates behind
+ */
+void PoseServer::run(){
+    vector<PoseUpdate> staged;
+    vector<pollfd> fds;
+    while(true){
+        {
+            unique_lock<mutex> guard(lock);
+            while(pending.size() >= MAX_PENDING && !stopping){
+                drained.wait(guard);
+            }
+            if(stopping){
+                break;
+            }
+        }
+
+        fds.clear();
+        pollfd stopPoll = {stopPipe[0], POLLIN, 0};
+        pollfd listenPoll = {listenFd, POLLIN, 0};
+        fds.push_back(stopPoll);
+        fds.push_back(listenPoll);
+        for(size_t i = 0; i < connections.size(); i++){
+            pollfd clientPoll = {connections[i].fd, POLLIN, 0};
+            fds.push_back(clientPoll);
+        }
+        if(poll(&fds[0], fds.size(), -1) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            cerr << "PoseServer: poll failed" << endl;
+            break;
+        }
+        if(fds[0].revents){
+            continue;
+        }
+
+        size_t polled = connections.size();
+        if(fds[1].revents & POLLIN){
+            int fd;
+            // close on exec like the listening socket, so children
+            // spawned by the viewer don't keep clients connected
+            while((fd = accept4(listenFd, 0, 0,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0){
+                Client client;
+                client.fd = fd;
+                client.used = 0;
+                connections.push_back(client);
+                connected++;
+            }
+        }
+        // back to front, so closing a client keeps the lower indices
+        for(size_t i = polled; i-- > 0;){
+            if(!fds[2 + i].revents){
+                continue;
+            }
+            if(!receive(connections[i], staged)){
+                close(connections[i].fd);
+                connections.erase(connections.begin() + i);
+                connected--;
+            }
+        }
+
+        if(!staged.empty()){
+            lock_guard<mutex> guard(lock);
+            receivedCount += staged.size();
+            if(pending.empty()){
+                pending.swap(staged);
+            } else {
+                pending.insert(pending.end(), staged.begin(), staged.end());
+            }
+            staged.clear();
+            if(notify){
+                notify(notifyArg);
+            }
+        }
+    }
+    for(size_t i = 0; i < connections.size(); i++){
+        close(connections[i].fd);
+    }
+    connections.clear();
+    connected = 0;
+};
+
+/**
+ * @brief reads from client and parses its complete messages
+ * @param client connection with its partial message
+ * @param staged parsed updates are appended here
+ * @return false if the client hung up or sent a malformed message
+ * @action an incomplete message stays at the front of the buffer until
+ *         the rest arrives
+ */
+bool PoseServer::receive(Client & client, vector<PoseUpdate> & staged){
+    if(client.buffer.size() < client.used + READ_BYTES){
+        client.buffer.resize(client.used + READ_BYTES);
+    }
+    ssize_t n = read(client.fd, &client.buffer[client.used], READ_BYTES);
+    if(n == 0){
+        return false;
+    }
+    if(n < 0){
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    client.used += n;
+
+    size_t offset = 0;
+    PoseMessageHeader header;
+    while(client.used - offset >= sizeof(header)){
+        memcpy(&header, &client.buffer[offset], sizeof(header));
+        if(header.bytes > POSE_MESSAGE_MAX_BYTES){
+            cerr << "PoseServer: message of " << header.bytes
+                 << " bytes, closing connection" << endl;
+            return false;
+        }
+        if(client.used - offset - sizeof(header) < header.bytes){
+            break;
+        }
+        if(!parse(header, &client.buffer[offset + sizeof(header)], staged)){
+            cerr << "PoseServer: bad message of type " << header.type
+                 << ", closing connection" << endl;
+            return false;
+        }
+        offset += sizeof(header) + header.bytes;
+    }
+    memmove(&client.buffer[0], &client.buffer[offset], client.used - offset);
+    client.used -= offset;
+    return true;
+};
+
+/**
+ * @brief converts one message to pose updates
+ * @param header message header
+ * @param payload header.bytes of records
+ * @param staged updates are appended here
+ * @return false if the payload is not a whole number of records. unknown
+ *         message types are skipped
+ */
+bool PoseServer::parse(const PoseMessageHeader & header, const char * payload,
+                       vector<PoseUpdate> & staged){
+    PoseUpdate update;
+    memset(&update, 0, sizeof(update));
+    update.time = NAN;
+    if(header.type == POSE_MESSAGE_CLEAR){
+        update.type = PoseUpdate::CAMERA_CLEAR;
+        staged.push_back(update);
+        return true;
+    }
+    bool withIds = (header.type == POSE_MESSAGE_CAMERA_UPDATES ||
+                    header.type == POSE_MESSAGE_TAGS);
+    if(!withIds && header.type != POSE_MESSAGE_CAMERAS){
+        return true;
+    }
+    size_t size = withIds ? sizeof(PoseIdRecord) : sizeof(PoseRecord);
+    if(header.bytes % size != 0){
+        return false;
+    }
+    update.type = (header.type == POSE_MESSAGE_CAMERAS) ?
+                  PoseUpdate::CAMERA_APPEND :
+                  (header.type == POSE_MESSAGE_TAGS) ?
+                  PoseUpdate::TAG_UPSERT : PoseUpdate::CAMERA_UPSERT;
+    size_t n = header.bytes / size;
+    size_t first = staged.size();
+    staged.resize(first + n, update);
+    for(size_t i = 0; i < n; i++){
+        PoseUpdate & out = staged[first + i];
+        const char * record = payload + i * size;
+        if(withIds){
+            memcpy(&out.id, record, sizeof(uint64_t));
+            record += sizeof(uint64_t);
+        }
+        memcpy(out.position, record, 3 * sizeof(double));
+        memcpy(out.rotation, record + 3 * sizeof(double), 4 * sizeof(double));
+    }
+    return true;
+};
+
+/**
+ * @brief Default Constructor
+ */
+PoseClient::PoseClient(){
+    fd = -1;
+};
+
+/**
+ * @brief Destructor
+ * @action sends what is still buffered
+ */
+PoseClient::~PoseClient(){
+    close();
+};
+
+/**
+ * @brief connects to a pose server
+ * @param address see PoseServer
+ * @return false if the server is not reachable
+ */
+bool PoseClient::connect(const char * address){
+    close();
+    string unixPath;
+    fd = openSocket(address, false, unixPath);
+    if(fd < 0){
+        cerr << "PoseClient: could not connect to " << address << endl;
+        return false;
+    }
+    buffer.reserve(SEND_BYTES + POSE_MESSAGE_MAX_BYTES);
+    return true;
+};
+
+/**
+ * @brief flushes and closes the connection
+ */
+void PoseClient::close(){
+    if(fd < 0){
+        return;
+    }
+    flush();
+    if(fd >= 0){
+        ::close(fd);
+        fd = -1;
+    }
+    buffer.clear();
+};
+
+/**
+ * @brief appends n cameras
+ */
+bool PoseClient::sendCameras(const double * positions,
+                             const double * rotations, size_t n){
+    return send(POSE_MESSAGE_CAMERAS, 0, positions, rotations, n);
+};
+
+/**
+ * @brief inserts / moves n cameras by id
+ */
+bool PoseClient::sendCameras(const uint64_t * ids, const double * positions,
+                             const double * rotations, size_t n){
+    return send(POSE_MESSAGE_CAMERA_UPDATES, ids, positions, rotations, n);
+};
+
+/**
+ * @brief inserts / moves n tags by id
+ */
+bool PoseClient::sendTags(const uint64_t * ids, const double * positions,
+                          const double * rotations, size_t n){
+    return send(POSE_MESSAGE_TAGS, ids, positions, rotations, n);
+};
+
+/**
+ * @brief removes all cameras
+ */
+bool PoseClient::sendClear(){
+    return send(POSE_MESSAGE_CLEAR, 0, 0, 0, 0);
+};
+
+/**
+ * @brief buffers n records as messages of type
+ * @param ids one per record, or 0 for records without id
+ * @return false once the connection failed
+ * @action batches larger than POSE_MESSAGE_MAX_BYTES are split. the buffer
+ *         is written out whenever it reaches SEND_BYTES
+ */
+bool PoseClient::send(uint32_t type, const uint64_t * ids,
+                      const double * positions, const double * rotations,
+                      size_t n){
+    if(fd < 0){
+        return false;
+    }
+    size_t size = ids ? sizeof(PoseIdRecord) : sizeof(PoseRecord);
+    size_t perMessage = POSE_MESSAGE_MAX_BYTES / size;
+    do {
+        size_t count = min(n, perMessage);
+        PoseMessageHeader header = {type, (uint32_t)(count * size)};
+        size_t at = buffer.size();
+        buffer.resize(at + sizeof(header) + count * size);
+        char * out = &buffer[at];
+        memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        for(size_t i = 0; i < count; i++){
+            if(ids){
+                memcpy(out, &ids[i], sizeof(uint64_t));
+                out += sizeof(uint64_t);
+            }
+            memcpy(out, &positions[3 * i], 3 * sizeof(double));
+            memcpy(out + 3 * sizeof(double), &rotations[4 * i],
+                   4 * sizeof(double));
+            out += 7 * sizeof(double);
+        }
+        if(ids){
+            ids += count;
+        }
+        positions += 3 * count;
+        rotations += 4 * count;
+        n -= count;
+        if(buffer.size() >= SEND_BYTES && !flush()){
+            return false;
+        }
+    } while(n > 0);
+    return true;
+};
+
+/**
+ * @brief writes all buffered messages
+ * @return false if the connection broke (it is closed then)
+ */
+bool PoseClient::flush(){
+    if(fd < 0){
+        return false;
+    }
+    size_t sent = 0;
+    while(sent < buffer.size()){
+        // no SIGPIPE if the viewer went away
+        ssize_t n = ::send(fd, &buffer[sent], buffer.size() - sent,
+                           MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n <= 0){
+            cerr << "PoseClient: connection lost" << endl;
+            ::close(fd);
+            fd = -1;
+            buffer.clear();
+            return false;
+        }
+        sent += n;
+    }
+    buffer.clear();
+    return true;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
@@ -0,0 +1,194 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseServer.h
+ * @brief      : Socket pose feed. Length prefixed binary messages received
+ *               on a UNIX domain / loopback TCP socket, and the client side
+ *               used by trackers to send them
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef POSESERVER_H
+#define POSESERVER_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <stdint.h>
+#include "PoseQueue.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// every message is a header followed by header.bytes of payload. all fields
+// are little endian, records are packed
+struct PoseMessageHeader {
+    uint32_t type;
+    uint32_t bytes;
+};
+
+enum PoseMessageType {
+    // n PoseRecords, appended as new cameras in order
+    POSE_MESSAGE_CAMERAS = 1,
+    // n PoseIdRecords, camera inserted by id or moved if the id is known
+    POSE_MESSAGE_CAMERA_UPDATES = 2,
+    // n PoseIdRecords, tag inserted by id or moved if the id is known
+    POSE_MESSAGE_TAGS = 3,
+    // no payload, removes all cameras (tags stay)
+    POSE_MESSAGE_CLEAR = 4
+};
+
+// same layout as the records of binary pose files
+struct PoseRecord {
+    double position[3];
+    double rotation[4];
+};
+
+struct PoseIdRecord {
+    uint64_t id;
+    double position[3];
+    double rotation[4];
+};
+
+// largest payload accepted. larger messages drop the connection
+#define POSE_MESSAGE_MAX_BYTES (16 << 20)
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// Addresses are "unix:PATH" (or any path containing '/') for a UNIX domain
+// socket, otherwise "[HOST:]PORT" for TCP, HOST defaulting to 127.0.0.1.
+//
+// One thread polls the listening socket and all clients, parses whole
+// messages and appends them to a pending batch. The render thread takes the
+// batch once per frame (take), so bursts coalesce into one update. While
+// MAX_PENDING updates wait the server stops reading and the senders block
+// in the kernel instead of growing the batch.
+class PoseServer
+{
+public:
+    PoseServer();
+    ~PoseServer();
+
+    // binds address and starts the server thread. false if it can't listen
+    bool start(const char * address);
+
+    // closes all connections and joins the server thread
+    void stop();
+    bool running() const { return listenFd >= 0; };
+
+    // swaps everything received since the last call into updates, in
+    // arrival order per connection. false if nothing arrived
+    bool take(vector<PoseUpdate> & updates);
+
+    // callback run on the server thread when updates arrive (e.g. to wake
+    // a render loop). runs under the server lock, must not call back into
+    // the server. 0 to remove
+    void setNotify(void (*callback)(void *), void * arg);
+
+    size_t clients() const { return connected.load(memory_order_relaxed); };
+    // updates received since start
+    size_t received() const {
+        return receivedCount.load(memory_order_relaxed);
+    };
+
+    // updates buffered for the render thread before reads pause
+    static const size_t MAX_PENDING = 1 << 17;
+    // bytes read from one client per poll round
+    static const size_t READ_BYTES = 1 << 20;
+private:
+    PoseServer(const PoseServer & obj);
+    PoseServer & operator=(const PoseServer & obj);
+
+    struct Client {
+        int fd;
+        // unparsed bytes [0, used)
+        vector<char> buffer;
+        size_t used;
+    };
+
+    // server thread body
+    void run();
+    // reads from client and parses complete messages into staged. false
+    // when the client hung up or broke the protocol
+    bool receive(Client & client, vector<PoseUpdate> & staged);
+    static bool parse(const PoseMessageHeader & header, const char * payload,
+                      vector<PoseUpdate> & staged);
+
+    int listenFd;
+    string unixPath;
+    // written by stop to end poll
+    int stopPipe[2];
+    thread worker;
+    vector<Client> connections;
+
+    mutex lock;
+    condition_variable drained;
+    vector<PoseUpdate> pending;
+    bool stopping;
+    void (*notify)(void *);
+    void * notifyArg;
+
+    atomic<size_t> connected;
+    atomic<size_t> receivedCount;
+};
+
+// Sender side of the protocol. Messages are collected in a buffer and
+// written when it fills or on flush, so many small sends cost few writes.
+// Writes block while the server is behind
+class PoseClient
+{
+public:
+    PoseClient();
+    ~PoseClient();
+
+    // connects to a PoseServer address (see PoseServer)
+    bool connect(const char * address);
+    void close();
+
+    // appends n cameras (positions: n*3, rotations: n*4)
+    bool sendCameras(const double * positions, const double * rotations,
+                     size_t n);
+    // inserts / moves n cameras by id
+    bool sendCameras(const uint64_t * ids, const double * positions,
+                     const double * rotations, size_t n);
+    // inserts / moves n tags by id
+    bool sendTags(const uint64_t * ids, const double * positions,
+                  const double * rotations, size_t n);
+    // removes all cameras
+    bool sendClear();
+
+    // writes everything buffered. false once the connection failed
+    bool flush();
+
+    // buffered bytes that trigger a write
+    static const size_t SEND_BYTES = 1 << 20;
+private:
+    PoseClient(const PoseClient & obj);
+    PoseClient & operator=(const PoseClient & obj);
+
+    // appends message header + n records of the given type
+    bool send(uint32_t type, const uint64_t * ids, const double * positions,
+              const double * rotations, size_t n);
+
+    int fd;
+    vector<char> buffer;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
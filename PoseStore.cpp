@@ -0,0 +1,336 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseStore.cpp
+ * @brief      : Definition file for structure of arrays pose storage
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <algorithm>
+#include <cmath>
+#include "PoseStore.h"
+#include "QuaternionKernel.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// orders pose indices by timestamp
+struct TimestampLess {
+    const PoseStore & store;
+    TimestampLess(const PoseStore & store) : store(store) {};
+    bool operator()(size_t a, size_t b) const {
+        return store.timestamp(a) < store.timestamp(b);
+    };
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+PoseStore::PoseStore(){
+    count = 0;
+    timeSorted = true;
+    minTimestamp = 0.0;
+    maxTimestamp = 0.0;
+};
+
+/**
+ * @brief reserves room for n poses
+ * @param n total number of poses
+ * @action only the block list is reserved. blocks are allocated full size
+ *         as they are started
+ */
+void PoseStore::reserve(size_t n){
+    blocks.reserve((n + BLOCK_SIZE - 1) / BLOCK_SIZE);
+};
+
+/**
+ * @brief removes all poses
+ * @action drops this store's references. blocks shared with other stores
+ *         stay alive for them
+ */
+void PoseStore::clear(){
+    blocks.clear();
+    count = 0;
+    timeSorted = true;
+    minTimestamp = 0.0;
+    maxTimestamp = 0.0;
+};
+
+/**
+ * @brief appends a pose
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @return index of new pose
+ */
+size_t PoseStore::add(const double * position, const double * rotation){
+    size_t index = size();
+    add(position, rotation, 1);
+    return index;
+};
+
+/**
+ * @brief appends n poses
+ * @param positions double array of size n*3
+ * @param rotations double array of size n*4
+ * @param n number of poses
+ * @param timestamps double array of size n, or NULL
+ * @action copies poses block by block and packs their GPU instances once
+ *         with the batch SIMD kernel. notes when the poses stop being
+ *         ordered by time
+ */
+void PoseStore::add(const double * positions, const double * rotations,
+                    size_t n, const double * timestamps){
+    double previous = count ? timestamp(count - 1) : -1.0;
+    size_t done = 0;
+    while(done < n){
+        Block & block = appendable();
+        size_t first = block.timestamps.size();
+        size_t m = min(n - done, BLOCK_SIZE - first);
+        if(block.timestamps.capacity() < first + m){
+            // grow geometrically, but never past one block
+            size_t capacity = min(BLOCK_SIZE, max(first + m, 2 * first));
+            block.positions.reserve(3 * capacity);
+            block.rotations.reserve(4 * capacity);
+            block.timestamps.reserve(capacity);
+            block.instances.reserve(INSTANCE_FLOATS * capacity);
+        }
+        for(size_t i = done; i < done + m; i++){
+            double t = (timestamps && !isnan(timestamps[i]))
+                       ? timestamps[i] : previous + 1.0;
+            if(count == 0 && i == 0){
+                minTimestamp = maxTimestamp = t;
+            } else if(t < previous){
+                timeSorted = false;
+            }
+            minTimestamp = min(minTimestamp, t);
+            maxTimestamp = max(maxTimestamp, t);
+            block.timestamps.push_back(t);
+            previous = t;
+        }
+        const double * p = positions + 3 * done;
+        const double * r = rotations + 4 * done;
+        block.positions.insert(block.positions.end(), p, p + 3 * m);
+        block.rotations.insert(block.rotations.end(), r, r + 4 * m);
+        block.instances.resize((first + m) * INSTANCE_FLOATS);
+        posesToInstances(p, r, m, &block.instances[INSTANCE_FLOATS * first]);
+        done += m;
+    }
+    count += n;
+};
+
+/**
+ * @brief replaces existing pose
+ * @param i pose index
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @action clones i's block first if another store shares it
+ */
+void PoseStore::set(size_t i, const double * position,
+                    const double * rotation){
+    Block & block = writable(i / BLOCK_SIZE);
+    size_t j = i % BLOCK_SIZE;
+    copy(position, position + 3, &block.positions[3 * j]);
+    copy(rotation, rotation + 4, &block.rotations[4 * j]);
+    buildInstance(position, rotation, &block.instances[INSTANCE_FLOATS * j]);
+};
+
+/**
+ * @brief applies a similarity transform to all poses
+ * @param rotation unit quaternion x,y,z,w, put in front of every rotation
+ * @param translation added after rotating and scaling
+ * @param scale scales positions, not the cameras
+ * @action block by block, each block is cloned first if shared and its
+ *         instances repacked with the batch kernel. timestamps stay
+ */
+void PoseStore::transform(const double * rotation, const double * translation,
+                          double scale){
+    const double * q = rotation;
+    for(size_t b = 0; b < blocks.size(); b++){
+        Block & block = writable(b);
+        size_t m = block.timestamps.size();
+        for(size_t j = 0; j < m; j++){
+            double * p = &block.positions[3 * j];
+            double t[3] = {2.0 * (q[1]*p[2] - q[2]*p[1]),
+                           2.0 * (q[2]*p[0] - q[0]*p[2]),
+                           2.0 * (q[0]*p[1] - q[1]*p[0])};
+            double x = p[0] + q[3]*t[0] + q[1]*t[2] - q[2]*t[1];
+            double y = p[1] + q[3]*t[1] + q[2]*t[0] - q[0]*t[2];
+            double z = p[2] + q[3]*t[2] + q[0]*t[1] - q[1]*t[0];
+            p[0] = scale * x + translation[0];
+            p[1] = scale * y + translation[1];
+            p[2] = scale * z + translation[2];
+
+            double * r = &block.rotations[4 * j];
+            double rx = q[3]*r[0] + q[0]*r[3] + q[1]*r[2] - q[2]*r[1];
+            double ry = q[3]*r[1] - q[0]*r[2] + q[1]*r[3] + q[2]*r[0];
+            double rz = q[3]*r[2] + q[0]*r[1] - q[1]*r[0] + q[2]*r[3];
+            double rw = q[3]*r[3] - q[0]*r[0] - q[1]*r[1] - q[2]*r[2];
+            r[0] = rx;
+            r[1] = ry;
+            r[2] = rz;
+            r[3] = rw;
+        }
+        if(m > 0){
+            posesToInstances(&block.positions[0], &block.rotations[0], m,
+                             &block.instances[0]);
+        }
+    }
+};
+
+/**
+ * @brief time span of all poses
+ * @param begin smallest timestamp
+ * @param end largest timestamp
+ * @return false if there are no poses
+ */
+bool PoseStore::timeRange(double & begin, double & end) const{
+    if(count == 0){
+        return false;
+    }
+    begin = minTimestamp;
+    end = maxTimestamp;
+    return true;
+};
+
+/**
+ * @brief sorts poses by timestamp
+ * @param order filled with the old index of every pose in new order
+ * @action stable, so poses with equal timestamps keep their order. every
+ *         array is permuted, instances included, into new blocks. blocks
+ *         shared with other stores are left as they were
+ */
+void PoseStore::sortByTime(vector<size_t> & order){
+    order.resize(count);
+    for(size_t i = 0; i < count; i++){
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), TimestampLess(*this));
+
+    vector<shared_ptr<Block> > sorted;
+    sorted.reserve(blocks.size());
+    for(size_t i = 0; i < count; i++){
+        if(i % BLOCK_SIZE == 0){
+            size_t m = min(count - i, BLOCK_SIZE);
+            sorted.push_back(make_shared<Block>());
+            sorted.back()->positions.reserve(3 * m);
+            sorted.back()->rotations.reserve(4 * m);
+            sorted.back()->timestamps.reserve(m);
+            sorted.back()->instances.reserve(INSTANCE_FLOATS * m);
+        }
+        Block & block = *sorted.back();
+        size_t j = order[i];
+        block.positions.insert(block.positions.end(), position(j),
+                               position(j) + 3);
+        block.rotations.insert(block.rotations.end(), rotation(j),
+                               rotation(j) + 4);
+        block.timestamps.push_back(timestamp(j));
+        block.instances.insert(block.instances.end(), instance(j),
+                               instance(j) + INSTANCE_FLOATS);
+    }
+    blocks.swap(sorted);
+    timeSorted = true;
+};
+
+/**
+ * @brief binary search for first pose at or after time t
+ */
+size_t PoseStore::lowerBound(double t) const{
+    size_t first = 0;
+    size_t n = count;
+    while(n > 0){
+        size_t half = n / 2;
+        if(timestamp(first + half) < t){
+            first += half + 1;
+            n -= half + 1;
+        } else {
+            n = half;
+        }
+    }
+    return first;
+};
+
+/**
+ * @brief binary search for first pose after time t
+ */
+size_t PoseStore::upperBound(double t) const{
+    size_t first = 0;
+    size_t n = count;
+    while(n > 0){
+        size_t half = n / 2;
+        if(!(t < timestamp(first + half))){
+            first += half + 1;
+            n -= half + 1;
+        } else {
+            n = half;
+        }
+    }
+    return first;
+};
+
+/**
+ * @brief counts blocks this store shares with other stores
+ */
+size_t PoseStore::sharedBlocks() const{
+    size_t shared = 0;
+    for(size_t i = 0; i < blocks.size(); i++){
+        if(blocks[i].use_count() > 1){
+            shared++;
+        }
+    }
+    return shared;
+};
+
+/**
+ * @brief block about to be written
+ * @param block block index
+ * @return block owned by this store only, cloned if it was shared
+ */
+PoseStore::Block & PoseStore::writable(size_t block){
+    if(blocks[block].use_count() > 1){
+        blocks[block] = make_shared<Block>(*blocks[block]);
+    }
+    return *blocks[block];
+};
+
+/**
+ * @brief block the next pose is appended to
+ * @return last block if it has room (cloned if shared), a new one otherwise
+ * @action blocks reserve BLOCK_SIZE poses up front so appends never move
+ *         them, except the first block, which grows with the store so small
+ *         stores (tags) stay small
+ */
+PoseStore::Block & PoseStore::appendable(){
+    if(blocks.empty() || blocks.back()->timestamps.size() == BLOCK_SIZE){
+        blocks.push_back(make_shared<Block>());
+        if(blocks.size() > 1){
+            Block & block = *blocks.back();
+            block.positions.reserve(3 * BLOCK_SIZE);
+            block.rotations.reserve(4 * BLOCK_SIZE);
+            block.timestamps.reserve(BLOCK_SIZE);
+            block.instances.reserve(INSTANCE_FLOATS * BLOCK_SIZE);
+        }
+    }
+    return writable(blocks.size() - 1);
+};
+
+/**
+ * @brief packs position and quaternion rotation into a GPU instance
+ * @param position double[3] array of x,y,z
+ * @param rotation double[4] array of quaternion
+ * @param instance float[INSTANCE_FLOATS] output
+ */
+void PoseStore::buildInstance(const double * position,
+                              const double * rotation, float * instance){
+    posesToInstancesScalar(position, rotation, 1, instance);
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
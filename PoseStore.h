@@ -0,0 +1,124 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseStore.h
+ * @brief      : Structure of arrays camera pose storage in shared copy on
+ *               write blocks
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef POSESTORE_H
+#define POSESTORE_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// holds camera poses as separate arrays in blocks of BLOCK_SIZE poses. GPU
+// instances (position and normalized quaternion, see posesToInstances) are
+// packed once on insert so drawing never touches per-camera math.
+// blocks are reference counted: a copied store shares all of them, and a
+// write to either copy first clones only the block it touches. copies
+// sharing blocks must be written from one thread
+class PoseStore
+{
+public:
+    PoseStore();
+
+    size_t size() const { return count; };
+    bool empty() const { return count == 0; };
+    void reserve(size_t n);
+    void clear();
+
+    // appends pose. returns its index
+    size_t add(const double * position, const double * rotation);
+
+    // appends n poses (positions: n*3, rotations: n*4, timestamps: n or
+    // NULL). a missing / NaN timestamp is one after the previous pose's
+    void add(const double * positions, const double * rotations, size_t n,
+             const double * timestamps = NULL);
+
+    // replaces pose i and repacks its instance
+    void set(size_t i, const double * position, const double * rotation);
+
+    // moves every pose by the similarity x -> scale * R(rotation) * x +
+    // translation (rotation x,y,z,w unit quaternion) and repacks the
+    // instances
+    void transform(const double * rotation, const double * translation,
+                   double scale);
+
+    // x,y,z of pose i
+    const double * position(size_t i) const {
+        return &blocks[i / BLOCK_SIZE]->positions[3 * (i % BLOCK_SIZE)];
+    };
+    // x,y,z,w of pose i
+    const double * rotation(size_t i) const {
+        return &blocks[i / BLOCK_SIZE]->rotations[4 * (i % BLOCK_SIZE)];
+    };
+    double timestamp(size_t i) const {
+        return blocks[i / BLOCK_SIZE]->timestamps[i % BLOCK_SIZE];
+    };
+    // float[INSTANCE_FLOATS] of pose i: x,y,z,1 then unit quaternion x,y,z,w
+    const float * instance(size_t i) const {
+        return &blocks[i / BLOCK_SIZE]->instances[
+            INSTANCE_FLOATS * (i % BLOCK_SIZE)];
+    };
+    // number of poses from i whose positions, rotations and instances are
+    // contiguous in memory (up to the end of i's block)
+    size_t contiguous(size_t i) const {
+        return min(count - i, BLOCK_SIZE - i % BLOCK_SIZE);
+    };
+    // number of blocks also referenced by another store
+    size_t sharedBlocks() const;
+
+    // smallest / largest timestamp. false when empty
+    bool timeRange(double & begin, double & end) const;
+    // true while timestamps never decrease with the index
+    bool sortedByTime() const { return timeSorted; };
+    // stable sort of all poses by timestamp. order[new index] = old index
+    void sortByTime(vector<size_t> & order);
+    // index of first pose with timestamp >= t / > t (needs sortedByTime)
+    size_t lowerBound(double t) const;
+    size_t upperBound(double t) const;
+
+    // packs one pose the way instance() stores it
+    static void buildInstance(const double * position,
+                              const double * rotation, float * instance);
+
+    static const size_t INSTANCE_FLOATS = 8;
+    // poses per block. one block is ~6 MB
+    static const size_t BLOCK_SIZE = 1 << 16;
+private:
+    struct Block {
+        vector<double> positions;
+        vector<double> rotations;
+        vector<double> timestamps;
+        vector<float> instances;
+    };
+
+    Block & writable(size_t block);
+    Block & appendable();
+
+    vector<shared_ptr<Block> > blocks;
+    size_t count;
+    bool timeSorted;
+    double minTimestamp;
+    double maxTimestamp;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
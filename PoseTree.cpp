@@ -0,0 +1,945 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseTree.cpp
+ * @brief      : Definition file for the out of core pose octree and its
+ *               node cache
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <iostream>
+#include <string>
+#include <queue>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "PoseTree.h"
+#include "PoseLoader.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// pose with its Morton code while packing
+struct TreeEntry {
+    uint64_t key;
+    PoseRecordF32 record;
+};
+
+struct EntryOrder {
+    bool operator()(const TreeEntry & a, const TreeEntry & b) const {
+        return a.key < b.key;
+    }
+};
+
+struct EntryBelow {
+    bool operator()(const TreeEntry & a, uint64_t key) const {
+        return a.key < key;
+    }
+};
+
+// unread part of a sorted run while merging
+struct RunCursor {
+    uint64_t next;
+    uint64_t end;
+    vector<TreeEntry> buffer;
+    size_t position;
+};
+
+// builds nodes bottom up over Morton sorted entries. nodes are appended in
+// post order, so the root comes last
+class PoseTreeBuilder
+{
+public:
+    PoseTreeBuilder(const TreeEntry * entries, FILE * out, uint64_t offset);
+
+    int32_t build(size_t begin, size_t end, uint32_t level,
+                  const double * lo, double edge, vector<TreeEntry> & sample);
+
+    vector<PoseTreeNode> nodes;
+    uint64_t offset;
+    bool ok;
+    uint32_t depth;
+private:
+    void write(PoseTreeNode & node, const TreeEntry * entries, size_t n);
+
+    const TreeEntry * entries;
+    FILE * out;
+    vector<PoseRecordQ16> block;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief spreads the low 21 bits of v to every third bit
+ */
+static uint64_t spreadBits(uint64_t v){
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+/**
+ * @brief Morton code of position within the root cube
+ * @action x is the most significant bit of each octant, matching the child
+ *         order of PoseTreeNode
+ */
+static uint64_t mortonKey(const float * position, const double * lo,
+                          double edge){
+    const double cells = (double)(1 << POSE_TREE_DEPTH);
+    uint64_t q[3];
+    for(int k = 0; k < 3; k++){
+        double t = floor((position[k] - lo[k]) / edge * cells);
+        q[k] = (uint64_t)min(max(t, 0.0), cells - 1.0);
+    }
+    return spreadBits(q[0]) << 2 | spreadBits(q[1]) << 1 | spreadBits(q[2]);
+}
+
+/**
+ * @brief keeps the first entry of every grid cell
+ * @param entries Morton sorted entries
+ * @param n number of entries
+ * @param level level of the node sampled
+ * @param sample output, one entry per occupied cell POSE_TREE_GRID_LEVELS
+ *        below level
+ * @param rest output for the entries not sampled, or 0
+ */
+static void gridSample(const TreeEntry * entries, size_t n, uint32_t level,
+                       vector<TreeEntry> & sample, vector<TreeEntry> * rest){
+    uint32_t cellLevel = min(level + POSE_TREE_GRID_LEVELS,
+                             (uint32_t)POSE_TREE_DEPTH);
+    int shift = 3 * (POSE_TREE_DEPTH - cellLevel);
+    sample.clear();
+    for(size_t i = 0; i < n; i++){
+        if(i == 0 || (entries[i].key >> shift) !=
+                     (entries[i - 1].key >> shift)){
+            sample.push_back(entries[i]);
+        } else if(rest){
+            rest->push_back(entries[i]);
+        }
+    }
+}
+
+static bool writeAll(int fd, const void * data, size_t n){
+    const char * p = (const char *)data;
+    while(n > 0){
+        ssize_t w = ::write(fd, p, n);
+        if(w <= 0){
+            return false;
+        }
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void * data, size_t n, uint64_t offset){
+    char * p = (char *)data;
+    while(n > 0){
+        ssize_t r = pread(fd, p, n, offset);
+        if(r <= 0){
+            return false;
+        }
+        p += r;
+        n -= r;
+        offset += r;
+    }
+    return true;
+}
+
+/**
+ * @brief refills cursor from the runs file
+ * @return false once the run is exhausted
+ */
+static bool refill(int fd, RunCursor & run, size_t capacity){
+    size_t n = (size_t)min((uint64_t)capacity, run.end - run.next);
+    run.buffer.resize(n);
+    run.position = 0;
+    if(n == 0 || !readAll(fd, &run.buffer[0], n * sizeof(TreeEntry),
+                          run.next * sizeof(TreeEntry))){
+        run.buffer.clear();
+        return false;
+    }
+    run.next += n;
+    return true;
+}
+
+/**
+ * @brief reads poses of input into raw float records
+ * @param input pose file
+ * @param rawPath spool file
+ * @param bounds output min x,y,z, max x,y,z
+ * @return number of poses, 0 on failure
+ */
+static size_t spoolPoses(const char * input, const string & rawPath,
+                         double * bounds){
+    PoseLoader loader;
+    if(!loader.open(input)){
+        return 0;
+    }
+    int fd = ::open(rawPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        cerr << "PoseTree: could not write " << rawPath << endl;
+        return 0;
+    }
+    size_t n = 0;
+    bool ok = true;
+    PoseChunk chunk;
+    vector<PoseRecordF32> block;
+    while(ok && loader.nextChunk(chunk)){
+        size_t m = chunk.size();
+        block.resize(m);
+        for(size_t i = 0; i < m; i++){
+            const double * p = &chunk.positions[3 * i];
+            const double * q = &chunk.rotations[4 * i];
+            double norm = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+            norm = (norm > 0) ? 1.0 / norm : 0.0;
+            for(int k = 0; k < 3; k++){
+                block[i].position[k] = (float)p[k];
+                if(n + i == 0 || block[i].position[k] < bounds[k]){
+                    bounds[k] = block[i].position[k];
+                }
+                if(n + i == 0 || block[i].position[k] > bounds[k + 3]){
+                    bounds[k + 3] = block[i].position[k];
+                }
+            }
+            for(int k = 0; k < 4; k++){
+                block[i].rotation[k] = (float)(q[k] * norm);
+            }
+        }
+        ok = (m == 0) || writeAll(fd, &block[0], m * sizeof(PoseRecordF32));
+        n += m;
+    }
+    ok = (::close(fd) == 0) && ok && !loader.failed();
+    return ok ? n : 0;
+}
+
+/**
+ * @brief sorts raw records by Morton code in runs of runPoses
+ * @param runs output run boundaries (first pose of each run, then n)
+ * @return false on I/O failure
+ */
+static bool sortRuns(const string & rawPath, const string & runsPath, size_t n,
+                     size_t runPoses, const double * lo, double edge,
+                     vector<uint64_t> & runs){
+    int in = ::open(rawPath.c_str(), O_RDONLY);
+    int out = ::open(runsPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = in >= 0 && out >= 0;
+    vector<PoseRecordF32> records(PoseLoader::CHUNK_POSES);
+    vector<TreeEntry> entries;
+    for(size_t first = 0; ok && first < n; first += runPoses){
+        size_t m = min(runPoses, n - first);
+        entries.resize(m);
+        // keyed through a small block, so the run takes all the memory
+        for(size_t i = 0; ok && i < m; i += records.size()){
+            size_t k = min(records.size(), m - i);
+            ok = readAll(in, &records[0], k * sizeof(PoseRecordF32),
+                         (first + i) * sizeof(PoseRecordF32));
+            for(size_t j = 0; ok && j < k; j++){
+                entries[i + j].key = mortonKey(records[j].position, lo, edge);
+                entries[i + j].record = records[j];
+            }
+        }
+        sort(entries.begin(), entries.end(), EntryOrder());
+        ok = ok && writeAll(out, &entries[0], m * sizeof(TreeEntry));
+        runs.push_back(first);
+    }
+    runs.push_back(n);
+    if(in >= 0){
+        ::close(in);
+    }
+    if(out >= 0){
+        ok = (::close(out) == 0) && ok;
+    }
+    return ok;
+}
+
+/**
+ * @brief merges the sorted runs into one sorted file
+ * @return false on I/O failure
+ */
+static bool mergeRuns(const string & runsPath, const string & sortedPath,
+                      const vector<uint64_t> & runs, size_t memoryBytes){
+    int in = ::open(runsPath.c_str(), O_RDONLY);
+    FILE * out = fopen(sortedPath.c_str(), "wb");
+    bool ok = in >= 0 && out != 0;
+    size_t count = runs.size() - 1;
+    size_t capacity = max(memoryBytes / (2 * count * sizeof(TreeEntry)),
+                          (size_t)4096);
+
+    // smallest key on top
+    typedef pair<uint64_t, size_t> Head;
+    priority_queue<Head, vector<Head>, greater<Head> > heads;
+    vector<RunCursor> cursors(count);
+    for(size_t r = 0; ok && r < count; r++){
+        cursors[r].next = runs[r];
+        cursors[r].end = runs[r + 1];
+        if(refill(in, cursors[r], capacity)){
+            heads.push(Head(cursors[r].buffer[0].key, r));
+        }
+    }
+    while(ok && !heads.empty()){
+        size_t r = heads.top().second;
+        heads.pop();
+        RunCursor & run = cursors[r];
+        ok = fwrite(&run.buffer[run.position], sizeof(TreeEntry), 1, out) == 1;
+        run.position++;
+        if(run.position < run.buffer.size() ||
+           refill(in, run, capacity)){
+            heads.push(Head(run.buffer[run.position].key, r));
+        }
+    }
+    if(in >= 0){
+        ::close(in);
+    }
+    if(out){
+        ok = (fclose(out) == 0) && ok;
+    }
+    return ok;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+bool PoseTreeNode::isLeaf() const{
+    for(int c = 0; c < 8; c++){
+        if(children[c] >= 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+PoseTreeBuilder::PoseTreeBuilder(const TreeEntry * entries, FILE * out,
+                                 uint64_t offset){
+    this->entries = entries;
+    this->out = out;
+    this->offset = offset;
+    ok = true;
+    depth = 0;
+}
+
+/**
+ * @brief builds the subtree over entries [begin, end)
+ * @param level level of the node, 0 for the root
+ * @param lo node cube minimum
+ * @param edge node cube edge
+ * @param sample output, grid sample of the subtree for the parent
+ * @return node index
+ * @action leaves write all their poses, grid sample first, inner nodes
+ *         the grid sample of their children's samples. pages of the
+ *         sorted file are dropped once a leaf is written, so resident
+ *         memory stays bounded
+ */
+int32_t PoseTreeBuilder::build(size_t begin, size_t end, uint32_t level,
+                               const double * lo, double edge,
+                               vector<TreeEntry> & sample){
+    PoseTreeNode node;
+    memset(&node, 0, sizeof(node));
+    for(int k = 0; k < 3; k++){
+        node.lo[k] = (float)lo[k];
+    }
+    node.edge = (float)edge;
+    node.poses = end - begin;
+    node.level = level;
+    for(int c = 0; c < 8; c++){
+        node.children[c] = -1;
+    }
+    depth = max(depth, level);
+
+    if(end - begin <= POSE_TREE_LEAF_POSES || level >= POSE_TREE_DEPTH){
+        // sample in front, so a coarse view draws a prefix of the leaf
+        vector<TreeEntry> records;
+        gridSample(entries + begin, end - begin, level, sample, &records);
+        records.insert(records.begin(), sample.begin(), sample.end());
+        write(node, &records[0], records.size());
+        node.samples = (uint32_t)sample.size();
+
+        size_t page = sysconf(_SC_PAGESIZE);
+        uintptr_t first = ((uintptr_t)(entries + begin) + page - 1) /
+                          page * page;
+        uintptr_t last = (uintptr_t)(entries + end) / page * page;
+        if(last > first){
+            madvise((void*)first, last - first, MADV_DONTNEED);
+        }
+    } else {
+        // children are consecutive ranges of the sorted entries
+        int shift = 3 * (POSE_TREE_DEPTH - 1 - level);
+        uint64_t prefix = entries[begin].key >> (shift + 3);
+        vector<TreeEntry> gathered;
+        vector<TreeEntry> childSample;
+        size_t first = begin;
+        for(int c = 0; c < 8 && first < end; c++){
+            uint64_t bound = ((prefix << 3) + c + 1) << shift;
+            size_t last = lower_bound(entries + first, entries + end, bound,
+                                      EntryBelow()) - entries;
+            if(last > first){
+                double half = 0.5 * edge;
+                double childLo[3] = {lo[0] + ((c >> 2) & 1) * half,
+                                     lo[1] + ((c >> 1) & 1) * half,
+                                     lo[2] + (c & 1) * half};
+                node.children[c] = build(first, last, level + 1, childLo,
+                                         half, childSample);
+                gathered.insert(gathered.end(), childSample.begin(),
+                                childSample.end());
+            }
+            first = last;
+        }
+        gridSample(gathered.empty() ? 0 : &gathered[0], gathered.size(),
+                   level, sample, 0);
+        write(node, sample.empty() ? 0 : &sample[0], sample.size());
+        node.samples = node.count;
+    }
+    nodes.push_back(node);
+    return (int32_t)(nodes.size() - 1);
+}
+
+/**
+ * @brief appends entries as records quantized within the node cube
+ */
+void PoseTreeBuilder::write(PoseTreeNode & node, const TreeEntry * entries,
+                            size_t n){
+    node.offset = offset;
+    node.count = (uint32_t)n;
+    block.resize(n);
+    for(size_t i = 0; i < n; i++){
+        const PoseRecordF32 & r = entries[i].record;
+        PoseRecordQ16 & q = block[i];
+        for(int k = 0; k < 3; k++){
+            double t = (node.edge > 0) ? (r.position[k] - node.lo[k]) /
+                                         node.edge : 0.0;
+            t = min(max(t, 0.0), 1.0);
+            q.position[k] = (uint16_t)lround(t * 65535.0);
+        }
+        q.pad = 0;
+        for(int k = 0; k < 4; k++){
+            q.rotation[k] = (int16_t)lround(r.rotation[k] * 32767.0);
+        }
+    }
+    if(ok && n){
+        ok = fwrite(&block[0], sizeof(PoseRecordQ16), n, out) == n;
+    }
+    offset += n * sizeof(PoseRecordQ16);
+}
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+PoseTree::PoseTree(){
+    fd = -1;
+    memset(&header, 0, sizeof(header));
+};
+
+/**
+ * @brief Destructor
+ */
+PoseTree::~PoseTree(){
+    close();
+};
+
+/**
+ * @brief opens pose tree file
+ * @param path file path
+ * @return true if file is a valid pose tree
+ * @action reads header and node table. records stay on disk until read
+ */
+bool PoseTree::open(const char * path){
+    close();
+    int file = ::open(path, O_RDONLY);
+    if(file < 0){
+        cerr << "PoseTree: could not open " << path << endl;
+        return false;
+    }
+    struct stat st;
+    PoseTreeHeader h;
+    bool valid = fstat(file, &st) == 0 &&
+                 readAll(file, &h, sizeof(h), 0) &&
+                 memcmp(h.magic, POSE_TREE_MAGIC, 4) == 0 &&
+                 h.version == POSE_TREE_VERSION &&
+                 h.nodeCount > 0 && h.root < h.nodeCount &&
+                 h.nodeOffset <= (uint64_t)st.st_size &&
+                 h.nodeCount <= ((uint64_t)st.st_size - h.nodeOffset) /
+                                sizeof(PoseTreeNode);
+    vector<PoseTreeNode> table;
+    if(valid){
+        table.resize(h.nodeCount);
+        valid = readAll(file, &table[0], h.nodeCount * sizeof(PoseTreeNode),
+                        h.nodeOffset);
+    }
+    // validate every offset before trusting it
+    for(size_t i = 0; valid && i < table.size(); i++){
+        const PoseTreeNode & n = table[i];
+        valid = n.offset <= h.nodeOffset &&
+                n.count <= (h.nodeOffset - n.offset) / sizeof(PoseRecordQ16) &&
+                n.samples <= n.count;
+        // pack writes children before their parent, which also rules
+        // out cycles
+        for(int c = 0; valid && c < 8; c++){
+            valid = n.children[c] == -1 ||
+                    (n.children[c] >= 0 && (size_t)n.children[c] < i);
+        }
+    }
+    if(!valid){
+        cerr << "PoseTree: " << path << " is not a valid pose tree" << endl;
+        ::close(file);
+        return false;
+    }
+    fd = file;
+    header = h;
+    nodes.swap(table);
+    return true;
+};
+
+/**
+ * @brief closes file
+ */
+void PoseTree::close(){
+    if(fd >= 0){
+        ::close(fd);
+    }
+    fd = -1;
+    memset(&header, 0, sizeof(header));
+    nodes.clear();
+};
+
+/**
+ * @brief checks whether path is a pose tree file
+ * @param path file path
+ * @return true if magic matches
+ */
+bool PoseTree::probe(const char * path){
+    FILE * f = fopen(path, "rb");
+    if(!f){
+        return false;
+    }
+    char magic[4];
+    bool match = fread(magic, 4, 1, f) == 1 &&
+                 memcmp(magic, POSE_TREE_MAGIC, 4) == 0;
+    fclose(f);
+    return match;
+};
+
+/**
+ * @brief packs a pose file into a pose tree
+ * @param input binary / TUM / CSV pose file
+ * @param output pose tree path
+ * @param memoryBytes RAM used for sorting
+ * @param stats poses, sorted runs, nodes and levels of the tree
+ * @return true on success
+ * @action poses are spooled as float records while the bounds are found,
+ *         sorted by Morton code in runs that fit memoryBytes, merged into
+ *         one sorted file and the tree is built over its mapping. the
+ *         temporary files next to output are removed at the end
+ */
+bool PoseTree::pack(const char * input, const char * output,
+                    size_t memoryBytes, PoseTreePackStats & stats){
+    string rawPath = string(output) + ".raw";
+    string runsPath = string(output) + ".runs";
+    string sortedPath = string(output) + ".sorted";
+
+    double bounds[6] = {0, 0, 0, 0, 0, 0};
+    size_t n = spoolPoses(input, rawPath, bounds);
+    if(n == 0){
+        unlink(rawPath.c_str());
+        return false;
+    }
+
+    // root cube, slightly larger so the maximum falls inside
+    double lo[3] = {bounds[0], bounds[1], bounds[2]};
+    double edge = max(max(bounds[3] - bounds[0], bounds[4] - bounds[1]),
+                      bounds[5] - bounds[2]);
+    edge = (edge > 0) ? edge * (1.0 + 1e-6) : 1.0;
+
+    size_t runPoses = max(memoryBytes / sizeof(TreeEntry), (size_t)65536);
+    vector<uint64_t> runs;
+    bool ok = sortRuns(rawPath, runsPath, n, runPoses, lo, edge, runs);
+    unlink(rawPath.c_str());
+    if(ok && runs.size() > 2){
+        ok = mergeRuns(runsPath, sortedPath, runs, memoryBytes);
+        unlink(runsPath.c_str());
+    } else if(ok){
+        ok = rename(runsPath.c_str(), sortedPath.c_str()) == 0;
+    }
+    if(!ok){
+        cerr << "PoseTree: could not sort " << input << endl;
+        unlink(runsPath.c_str());
+        unlink(sortedPath.c_str());
+        return false;
+    }
+
+    int sortedFd = ::open(sortedPath.c_str(), O_RDONLY);
+    size_t length = n * sizeof(TreeEntry);
+    void * mapped = (sortedFd >= 0) ?
+        mmap(0, length, PROT_READ, MAP_PRIVATE, sortedFd, 0) : MAP_FAILED;
+    if(sortedFd >= 0){
+        ::close(sortedFd);
+    }
+    FILE * out = fopen(output, "wb");
+    if(mapped == MAP_FAILED || !out){
+        cerr << "PoseTree: could not write " << output << endl;
+        if(mapped != MAP_FAILED){
+            munmap(mapped, length);
+        }
+        if(out){
+            fclose(out);
+        }
+        unlink(sortedPath.c_str());
+        return false;
+    }
+    madvise(mapped, length, MADV_SEQUENTIAL);
+
+    PoseTreeHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, POSE_TREE_MAGIC, 4);
+    h.version = POSE_TREE_VERSION;
+    h.poses = n;
+    for(int k = 0; k < 3; k++){
+        h.boundsMin[k] = (float)bounds[k];
+        h.boundsMax[k] = (float)bounds[k + 3];
+    }
+    ok = fwrite(&h, sizeof(h), 1, out) == 1;
+
+    PoseTreeBuilder builder((const TreeEntry *)mapped, out, sizeof(h));
+    vector<TreeEntry> sample;
+    h.root = builder.build(0, n, 0, lo, edge, sample);
+    munmap(mapped, length);
+    unlink(sortedPath.c_str());
+
+    // node table after the records, 8 byte aligned
+    uint64_t padding = (8 - builder.offset % 8) % 8;
+    const char zeros[8] = {0};
+    h.nodeOffset = builder.offset + padding;
+    h.nodeCount = (uint32_t)builder.nodes.size();
+    ok = ok && builder.ok &&
+         fwrite(zeros, 1, padding, out) == padding &&
+         fwrite(&builder.nodes[0], sizeof(PoseTreeNode), h.nodeCount, out) ==
+         h.nodeCount &&
+         fseek(out, 0, SEEK_SET) == 0 &&
+         fwrite(&h, sizeof(h), 1, out) == 1;
+    ok = (fclose(out) == 0) && ok;
+    if(!ok){
+        cerr << "PoseTree: could not write " << output << endl;
+        return false;
+    }
+    stats.poses = n;
+    stats.runs = runs.size() - 1;
+    stats.nodes = h.nodeCount;
+    stats.levels = builder.depth + 1;
+    return true;
+};
+
+/**
+ * @brief reads records of a node
+ * @param i node index
+ * @param records output, count PoseRecordQ16 records
+ * @return false on read error
+ */
+bool PoseTree::read(size_t i, vector<unsigned char> & records) const{
+    const PoseTreeNode & n = nodes[i];
+    records.resize(n.count * sizeof(PoseRecordQ16));
+    return records.empty() ||
+           readAll(fd, &records[0], records.size(), n.offset);
+};
+
+/**
+ * @brief Default Constructor
+ */
+PoseTreeCache::PoseTreeCache(){
+    capacity = 0;
+    frame = 1;
+    bytes = 0;
+    reading = 0;
+    stopping = false;
+    notify = 0;
+    notifyArg = 0;
+};
+
+/**
+ * @brief Destructor
+ * @action joins the I/O threads
+ */
+PoseTreeCache::~PoseTreeCache(){
+    stop();
+};
+
+/**
+ * @brief starts paging nodes of tree
+ * @param tree open pose tree, shared with the caller
+ * @param capacity resident bytes before nodes are evicted
+ * @param threads number of I/O threads
+ * @return false if tree is not open
+ */
+bool PoseTreeCache::start(const shared_ptr<PoseTree> & tree, size_t capacity,
+                          int threads){
+    stop();
+    if(!tree || !tree->isOpen()){
+        return false;
+    }
+    this->tree = tree;
+    this->capacity = capacity;
+    size_t n = tree->nodeCount();
+    isResident.assign(n, 0);
+    requestedFrame.assign(n, 0);
+    usedFrame.assign(n, 0);
+    nodeBytes.assign(n, 0);
+    lruPosition.assign(n, lru.end());
+    state.assign(n, ABSENT);
+    frame = 1;
+    bytes = 0;
+    stopping = false;
+    for(int i = 0; i < max(threads, 1); i++){
+        workers.push_back(thread(&PoseTreeCache::run, this));
+    }
+    return true;
+};
+
+/**
+ * @brief stops I/O threads and forgets all nodes
+ * @action the owner frees what it uploaded for resident nodes
+ */
+void PoseTreeCache::stop(){
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    queued.notify_all();
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+    workers.clear();
+    queue.clear();
+    loaded.clear();
+    reading = 0;
+    lru.clear();
+    isResident.clear();
+    requestedFrame.clear();
+    usedFrame.clear();
+    nodeBytes.clear();
+    lruPosition.clear();
+    state.clear();
+    wanted.clear();
+    bytes = 0;
+    tree.reset();
+};
+
+/**
+ * @brief asks for a node that is not resident
+ * @param node node index
+ * @param error screen space error that made the node needed
+ */
+void PoseTreeCache::request(uint32_t node, double error){
+    if(isResident[node] || requestedFrame[node] == frame){
+        return;
+    }
+    requestedFrame[node] = frame;
+    Request r;
+    r.node = node;
+    r.level = tree->node(node).level;
+    r.error = error;
+    wanted.push_back(r);
+};
+
+/**
+ * @brief marks resident node as used in this frame
+ */
+void PoseTreeCache::touch(uint32_t node){
+    usedFrame[node] = frame;
+    lru.splice(lru.begin(), lru, lruPosition[node]);
+};
+
+/**
+ * @brief hands this frame's requests to the I/O threads
+ * @return number of nodes requested in this frame
+ * @action reads not started yet are dropped, nodes the view moved away
+ *         from are not read at all
+ */
+size_t PoseTreeCache::submit(){
+    size_t requested = wanted.size();
+    sort(wanted.begin(), wanted.end(), RequestOrder());
+    bool hasWork;
+    {
+        unique_lock<mutex> guard(lock);
+        for(size_t i = 0; i < queue.size(); i++){
+            if(state[queue[i].node] == QUEUED){
+                state[queue[i].node] = ABSENT;
+            }
+        }
+        queue.clear();
+        for(size_t i = 0; i < wanted.size(); i++){
+            if(state[wanted[i].node] == ABSENT){
+                state[wanted[i].node] = QUEUED;
+                queue.push_back(wanted[i]);
+            }
+        }
+        hasWork = !queue.empty();
+    }
+    if(hasWork){
+        queued.notify_all();
+    }
+    wanted.clear();
+    frame++;
+    return requested;
+};
+
+/**
+ * @brief takes a node read by an I/O thread
+ * @param node output node index
+ * @param records output records
+ * @return false if no read finished since the last call
+ */
+bool PoseTreeCache::take(uint32_t & node, vector<unsigned char> & records){
+    unique_lock<mutex> guard(lock);
+    if(loaded.empty()){
+        return false;
+    }
+    node = loaded.back().node;
+    records.swap(loaded.back().records);
+    loaded.pop_back();
+    return true;
+};
+
+/**
+ * @brief adds uploaded node to the cache
+ * @param node node index
+ * @param size bytes the node occupies
+ */
+void PoseTreeCache::setResident(uint32_t node, size_t size){
+    if(isResident[node]){
+        return;
+    }
+    isResident[node] = 1;
+    nodeBytes[node] = size;
+    bytes += size;
+    lru.push_front(node);
+    lruPosition[node] = lru.begin();
+    unique_lock<mutex> guard(lock);
+    state[node] = RESIDENT;
+};
+
+/**
+ * @brief removes the least recently used node while over the cap
+ * @param node output node index, the owner frees its upload
+ * @return false if nothing has to / can be evicted
+ */
+bool PoseTreeCache::evict(uint32_t & node){
+    if(bytes <= capacity || lru.empty() || usedFrame[lru.back()] == frame){
+        return false;
+    }
+    node = lru.back();
+    lru.pop_back();
+    lruPosition[node] = lru.end();
+    isResident[node] = 0;
+    bytes -= nodeBytes[node];
+    unique_lock<mutex> guard(lock);
+    state[node] = ABSENT;
+    return true;
+};
+
+/**
+ * @brief waits for the I/O threads
+ * @action returns once a read is waiting to be taken, or right away when
+ *         nothing is queued or in flight
+ */
+void PoseTreeCache::wait(){
+    unique_lock<mutex> guard(lock);
+    while(loaded.empty() && (!queue.empty() || reading > 0)){
+        finished.wait(guard);
+    }
+};
+
+/**
+ * @brief sets callback run after each read
+ */
+void PoseTreeCache::setNotify(void (*callback)(void *), void * arg){
+    unique_lock<mutex> guard(lock);
+    notify = callback;
+    notifyArg = arg;
+};
+
+/**
+ * @brief reads queued, in flight or waiting to be taken
+ */
+size_t PoseTreeCache::pending(){
+    unique_lock<mutex> guard(lock);
+    return queue.size() + reading + loaded.size();
+};
+
+bool PoseTreeCache::RequestOrder::operator()(const Request & a,
+                                             const Request & b) const{
+    if(a.level != b.level){
+        return a.level > b.level;
+    }
+    return a.error < b.error;
+};
+
+/**
+ * @brief I/O thread body. reads the most urgent queued node
+ * @action a node that fails to read is marked failed and never asked for
+ *         again
+ */
+void PoseTreeCache::run(){
+    unique_lock<mutex> guard(lock);
+    while(true){
+        while(!stopping && queue.empty()){
+            queued.wait(guard);
+        }
+        if(stopping){
+            return;
+        }
+        uint32_t node = queue.back().node;
+        queue.pop_back();
+        state[node] = READING;
+        reading++;
+        guard.unlock();
+
+        vector<unsigned char> records;
+        bool ok = tree->read(node, records);
+
+        guard.lock();
+        reading--;
+        if(ok){
+            loaded.push_back(Loaded());
+            loaded.back().node = node;
+            loaded.back().records.swap(records);
+        } else {
+            cerr << "PoseTree: could not read node " << node << endl;
+            state[node] = FAILED;
+        }
+        finished.notify_all();
+        if(notify){
+            notify(notifyArg);
+        }
+    }
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
@@ -0,0 +1,250 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseTree.h
+ * @brief      : Out of core multi resolution pose octree. Packed offline
+ *               from Morton sorted poses, paged in node by node at runtime
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef POSETREE_H
+#define POSETREE_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <vector>
+#include <list>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include "PoseFile.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// magic / version at the start of pose tree files
+#define POSE_TREE_MAGIC "TVPT"
+#define POSE_TREE_VERSION 1
+
+// nodes with at most this many poses are leaves holding all of them
+#define POSE_TREE_LEAF_POSES 8192
+// levels of the Morton code (21 bits per axis). nodes at the last level are
+// leaves whatever their size
+#define POSE_TREE_DEPTH 21
+// inner nodes keep one pose per occupied cell of a grid this many levels
+// below them (16^3 cells), so their geometric error is edge / 16
+#define POSE_TREE_GRID_LEVELS 4
+#define POSE_TREE_GRID (1 << POSE_TREE_GRID_LEVELS)
+
+// on-disk header. all fields little endian
+struct PoseTreeHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t poses;
+    uint64_t nodeOffset;
+    uint32_t nodeCount;
+    uint32_t root;
+    // bounds of all positions
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// node of the octree table at nodeOffset. count PoseRecordQ16 records at
+// offset, positions quantized within the node cube [lo, lo + edge]. the
+// first samples records are the grid subsample of the subtree. inner nodes
+// hold only those, leaves all their poses with the sample in front
+struct PoseTreeNode {
+    float lo[3];
+    float edge;
+    uint64_t offset;
+    // poses in the subtree
+    uint64_t poses;
+    uint32_t count;
+    uint32_t samples;
+    uint32_t level;
+    uint32_t reserved;
+    // -1 where the octant is empty
+    int32_t children[8];
+
+    bool isLeaf() const;
+};
+
+// what PoseTree::pack did, for the caller to report
+struct PoseTreePackStats {
+    size_t poses;
+    // sorted runs merged into one
+    size_t runs;
+    size_t nodes;
+    size_t levels;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// Read side keeps the node table in memory and reads node records with
+// pread, so any number of threads may read at once. pack builds a file from
+// binary / TUM / CSV poses using memoryBytes of RAM however large the input:
+// poses are spooled to disk, sorted in runs, merged and the tree is built
+// bottom up over the sorted poses. temporary files take about 3x the input
+// as float records next to output
+class PoseTree
+{
+public:
+    PoseTree();
+    ~PoseTree();
+
+    bool open(const char * path);
+    void close();
+    bool isOpen() const { return fd >= 0; };
+
+    // true if file starts with the pose tree magic
+    static bool probe(const char * path);
+
+    // packs input into a pose tree file at output
+    static bool pack(const char * input, const char * output,
+                     size_t memoryBytes, PoseTreePackStats & stats);
+
+    size_t poses() const { return (size_t)header.poses; };
+    size_t nodeCount() const { return nodes.size(); };
+    uint32_t root() const { return header.root; };
+    const PoseTreeNode & node(size_t i) const { return nodes[i]; };
+    const float * boundsMin() const { return header.boundsMin; };
+    const float * boundsMax() const { return header.boundsMax; };
+
+    // reads the records of node i into records. thread safe
+    bool read(size_t i, vector<unsigned char> & records) const;
+private:
+    PoseTree(const PoseTree & obj);
+    PoseTree & operator=(const PoseTree & obj);
+
+    int fd;
+    PoseTreeHeader header;
+    vector<PoseTreeNode> nodes;
+};
+
+// Keeps the nodes a view needs within a memory cap. Each frame the render
+// thread requests the nodes it is missing and touches the ones it uses;
+// submit replaces the reads still waiting from the last frame with the new
+// requests, coarse levels first. I/O threads read them and the owner takes
+// the records to upload, then marks them resident. Nodes not touched for
+// the longest are evicted first once resident bytes pass the cap. Nodes
+// touched in the current frame are never evicted, so a view needing more
+// than the cap exceeds it instead of thrashing
+class PoseTreeCache
+{
+public:
+    PoseTreeCache();
+    ~PoseTreeCache();
+
+    // starts reading from tree with threads I/O threads
+    bool start(const shared_ptr<PoseTree> & tree, size_t capacity,
+               int threads = IO_THREADS);
+    void stop();
+
+    void setCapacity(size_t bytes) { capacity = bytes; };
+    size_t capacityBytes() const { return capacity; };
+
+    // render thread side
+    bool resident(uint32_t node) const { return isResident[node] != 0; };
+    // asks for node, more urgent with larger screen space error
+    void request(uint32_t node, double error);
+    // marks resident node as used in this frame
+    void touch(uint32_t node);
+    // queues this frame's requests and starts the next frame. returns the
+    // number of nodes requested
+    size_t submit();
+    // takes a node whose records were read. false if none is waiting
+    bool take(uint32_t & node, vector<unsigned char> & records);
+    // records of node are uploaded (bytes of them)
+    void setResident(uint32_t node, size_t bytes);
+    // picks the least recently used node to free while over the cap.
+    // false when under the cap or only nodes of this frame are left
+    bool evict(uint32_t & node);
+    // blocks until a read finished or none is queued / in flight
+    void wait();
+
+    // callback run on an I/O thread after each read (e.g. to wake a render
+    // loop). runs under the cache lock, must not call back into the cache.
+    // 0 to remove
+    void setNotify(void (*callback)(void *), void * arg);
+
+    size_t residentBytes() const { return bytes; };
+    size_t residentNodes() const { return lru.size(); };
+    // reads queued or in flight
+    size_t pending();
+
+    static const int IO_THREADS = 2;
+private:
+    PoseTreeCache(const PoseTreeCache & obj);
+    PoseTreeCache & operator=(const PoseTreeCache & obj);
+
+    enum State {
+        ABSENT,
+        QUEUED,
+        READING,
+        RESIDENT,
+        FAILED
+    };
+
+    struct Request {
+        uint32_t node;
+        uint32_t level;
+        double error;
+    };
+
+    // orders requests least urgent first, so the most urgent is popped
+    // from the back
+    struct RequestOrder {
+        bool operator()(const Request & a, const Request & b) const;
+    };
+
+    struct Loaded {
+        uint32_t node;
+        vector<unsigned char> records;
+    };
+
+    // I/O thread body
+    void run();
+
+    shared_ptr<PoseTree> tree;
+    size_t capacity;
+    vector<thread> workers;
+
+    // render thread only
+    vector<unsigned char> isResident;
+    vector<uint32_t> requestedFrame;
+    vector<uint32_t> usedFrame;
+    vector<size_t> nodeBytes;
+    list<uint32_t> lru;
+    vector<list<uint32_t>::iterator> lruPosition;
+    vector<Request> wanted;
+    uint32_t frame;
+    size_t bytes;
+
+    // shared with I/O threads
+    mutex lock;
+    condition_variable queued;
+    condition_variable finished;
+    vector<unsigned char> state;
+    vector<Request> queue;
+    vector<Loaded> loaded;
+    size_t reading;
+    bool stopping;
+    void (*notify)(void *);
+    void * notifyArg;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
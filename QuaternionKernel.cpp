@@ -0,0 +1,260 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : QuaternionKernel.cpp
+ * @brief      : Definition file for batch pose to GPU instance packing
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cmath>
+#include <cstring>
+#include "QuaternionKernel.h"
+#if defined(__SSE2__) && defined(__GNUC__)
+#define QUATERNION_KERNEL_X86
+#include <immintrin.h>
+#endif
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// squared norms below this are treated as zero (identity rotation)
+static const float MIN_NORM2 = 1e-30f;
+
+/*
+ * Every path writes one 8 float instance per pose: x, y, z, 1 followed by
+ * the normalized quaternion x, y, z, w. A zero quaternion becomes the
+ * identity rotation (0, 0, 0, 1).
+ */
+
+#ifdef QUATERNION_KERNEL_X86
+/**
+ * @brief loads quaternion x,y,z,w doubles as floats
+ */
+static inline __m128 loadQuaternion(const double * q){
+    __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(q));
+    __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(q + 2));
+    return _mm_movelh_ps(lo, hi);
+}
+
+/**
+ * @brief writes 4 instances from normalized quaternion lanes of 4 poses
+ * @param x,y,z,w quaternion components, each lane one pose
+ * @param positions positions of the 4 poses
+ * @param out first of 4 output instances
+ */
+static inline void storeInstances4(__m128 x, __m128 y, __m128 z, __m128 w,
+                                   const double * positions, float * out){
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    __m128 q[4] = {x, y, z, w};
+    for(int p = 0; p < 4; p++){
+        const double * t = positions + 3*p;
+        _mm_storeu_ps(out + 8*p,
+                      _mm_setr_ps((float)t[0], (float)t[1], (float)t[2], 1.0f));
+        _mm_storeu_ps(out + 8*p + 4, q[p]);
+    }
+}
+
+/**
+ * @brief SSE path, 4 poses per iteration
+ * @return number of poses converted
+ */
+static size_t convertSSE(const double * positions, const double * rotations,
+                         size_t n, float * instances){
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minNorm = _mm_set1_ps(MIN_NORM2);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        // gather 4 quaternions and transpose into x,y,z,w lanes
+        __m128 x = loadQuaternion(rotations + 4*i);
+        __m128 y = loadQuaternion(rotations + 4*i + 4);
+        __m128 z = loadQuaternion(rotations + 4*i + 8);
+        __m128 w = loadQuaternion(rotations + 4*i + 12);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        __m128 n2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                               _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+        __m128 valid = _mm_cmpgt_ps(n2, minNorm);
+        __m128 s = _mm_and_ps(valid,
+                              _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(n2,
+                                                                     minNorm))));
+        x = _mm_mul_ps(x, s);
+        y = _mm_mul_ps(y, s);
+        z = _mm_mul_ps(z, s);
+        // w * 0 keeps the sign of w, so mask it before or-ing in the 1
+        w = _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(w, s)),
+                      _mm_andnot_ps(valid, one));
+        storeInstances4(x, y, z, w, positions + 3*i, instances + 8*i);
+    }
+    return i;
+}
+
+/**
+ * @brief AVX2 path, 8 poses per iteration
+ * @return number of poses converted
+ */
+__attribute__((target("avx2")))
+static size_t convertAVX2(const double * positions, const double * rotations,
+                          size_t n, float * instances){
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 minNorm = _mm256_set1_ps(MIN_NORM2);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        // each 256 bit double load is one quaternion
+        __m128 q[8];
+        for(int p = 0; p < 8; p++){
+            q[p] = _mm256_cvtpd_ps(_mm256_loadu_pd(rotations + 4*(i + p)));
+        }
+        _MM_TRANSPOSE4_PS(q[0], q[1], q[2], q[3]);
+        _MM_TRANSPOSE4_PS(q[4], q[5], q[6], q[7]);
+        __m256 x = _mm256_set_m128(q[4], q[0]);
+        __m256 y = _mm256_set_m128(q[5], q[1]);
+        __m256 z = _mm256_set_m128(q[6], q[2]);
+        __m256 w = _mm256_set_m128(q[7], q[3]);
+
+        __m256 n2 = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)),
+            _mm256_add_ps(_mm256_mul_ps(z, z), _mm256_mul_ps(w, w)));
+        __m256 valid = _mm256_cmp_ps(n2, minNorm, _CMP_GT_OQ);
+        __m256 s = _mm256_and_ps(valid, _mm256_div_ps(
+            one, _mm256_sqrt_ps(_mm256_max_ps(n2, minNorm))));
+        x = _mm256_mul_ps(x, s);
+        y = _mm256_mul_ps(y, s);
+        z = _mm256_mul_ps(z, s);
+        w = _mm256_or_ps(_mm256_and_ps(valid, _mm256_mul_ps(w, s)),
+                         _mm256_andnot_ps(valid, one));
+
+        // write lower / upper 4 poses
+        storeInstances4(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y),
+                        _mm256_castps256_ps128(z), _mm256_castps256_ps128(w),
+                        positions + 3*i, instances + 8*i);
+        storeInstances4(_mm256_extractf128_ps(x, 1),
+                        _mm256_extractf128_ps(y, 1),
+                        _mm256_extractf128_ps(z, 1),
+                        _mm256_extractf128_ps(w, 1),
+                        positions + 3*(i + 4), instances + 8*(i + 4));
+    }
+    return i;
+}
+#endif
+
+typedef size_t (*ConvertFunction)(const double *, const double *, size_t,
+                                  float *);
+
+/**
+ * @brief picks the widest SIMD path the CPU supports
+ */
+static ConvertFunction selectKernel(const char ** name){
+#ifdef QUATERNION_KERNEL_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        *name = "avx2";
+        return convertAVX2;
+    }
+    *name = "sse";
+    return convertSSE;
+#else
+    *name = "scalar";
+    return 0;
+#endif
+}
+
+static const char * kernelName = 0;
+static ConvertFunction kernel = selectKernel(&kernelName);
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                            FUNCTION DEFINITIONS                            //
+//----------------------------------------------------------------------------//
+/**
+ * @brief packs poses into GPU instances using the selected SIMD path
+ * @param positions n * x,y,z
+ * @param rotations n * x,y,z,w
+ * @param n number of poses
+ * @param instances n * 8 output floats
+ */
+void posesToInstances(const double * positions, const double * rotations,
+                      size_t n, float * instances){
+    size_t done = kernel ? kernel(positions, rotations, n, instances) : 0;
+    posesToInstancesScalar(positions + 3*done, rotations + 4*done,
+                           n - done, instances + 8*done);
+}
+
+/**
+ * @brief portable packing, one pose at a time
+ * @param positions n * x,y,z
+ * @param rotations n * x,y,z,w
+ * @param n number of poses
+ * @param instances n * 8 output floats
+ */
+void posesToInstancesScalar(const double * positions,
+                            const double * rotations,
+                            size_t n, float * instances){
+    for(size_t i = 0; i < n; i++){
+        const double * q = rotations + 4*i;
+        const double * t = positions + 3*i;
+        float * out = instances + 8*i;
+        float x = (float)q[0];
+        float y = (float)q[1];
+        float z = (float)q[2];
+        float w = (float)q[3];
+        float n2 = x*x + y*y + z*z + w*w;
+
+        out[0] = (float)t[0];
+        out[1] = (float)t[1];
+        out[2] = (float)t[2];
+        out[3] = 1.0f;
+        if(n2 > MIN_NORM2){
+            float s = 1.0f / sqrtf(n2);
+            out[4] = x * s;
+            out[5] = y * s;
+            out[6] = z * s;
+            out[7] = w * s;
+        } else {
+            out[4] = 0.0f;
+            out[5] = 0.0f;
+            out[6] = 0.0f;
+            out[7] = 1.0f;
+        }
+    }
+}
+
+/**
+ * @brief returns name of the dispatched path ("avx2", "sse", "scalar")
+ */
+const char * quaternionKernelName(){
+    return kernelName;
+}
+
+/**
+ * @brief packs poses with the named path instead of the dispatched one
+ * @param path "avx2", "sse" or "scalar"
+ * @return false if the path is not available
+ */
+bool posesToInstancesPath(const char * path, const double * positions,
+                          const double * rotations, size_t n,
+                          float * instances){
+    ConvertFunction convert = 0;
+    if(strcmp(path, "scalar") == 0){
+        convert = 0;
+#ifdef QUATERNION_KERNEL_X86
+    } else if(strcmp(path, "sse") == 0){
+        convert = convertSSE;
+    } else if(strcmp(path, "avx2") == 0 &&
+              __builtin_cpu_supports("avx2")){
+        convert = convertAVX2;
+#endif
+    } else {
+        return false;
+    }
+    size_t done = convert ? convert(positions, rotations, n, instances) : 0;
+    posesToInstancesScalar(positions + 3*done, rotations + 4*done,
+                           n - done, instances + 8*done);
+    return true;
+}
+//----------------------------------------------------------------------------//
+//                          END FUNCTION DEFINITIONS                          //
+//----------------------------------------------------------------------------//
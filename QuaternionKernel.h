@@ -0,0 +1,46 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : QuaternionKernel.h
+ * @brief      : Batch packing of poses into GPU instances (SIMD)
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef QUATERNIONKERNEL_H
+#define QUATERNIONKERNEL_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cstddef>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           FUNCTION DECLARATIONS                            //
+//----------------------------------------------------------------------------//
+// Packs n poses into 8 float GPU instances: x,y,z,1 then the normalized
+// quaternion x,y,z,w (identity for a zero quaternion). The vertex shaders
+// rotate by the quaternion, so no matrices are built on the CPU.
+//   positions : n * x,y,z
+//   rotations : n * x,y,z,w
+//   instances : n * 8 floats
+// Picks the AVX2 or SSE path at runtime, scalar code elsewhere.
+void posesToInstances(const double * positions, const double * rotations,
+                      size_t n, float * instances);
+
+// portable implementation, also used for the tails of the SIMD paths
+void posesToInstancesScalar(const double * positions,
+                            const double * rotations,
+                            size_t n, float * instances);
+
+// name of the path posesToInstances dispatches to
+const char * quaternionKernelName();
+
+// runs one path by name ("avx2", "sse" or "scalar") with the scalar tail,
+// e.g. to test every path on one machine. false if the path is not built
+// in or the CPU lacks it, instances are untouched then
+bool posesToInstancesPath(const char * path, const double * positions,
+                          const double * rotations, size_t n,
+                          float * instances);
+//----------------------------------------------------------------------------//
+//                         END FUNCTION DECLARATIONS                          //
+//----------------------------------------------------------------------------//
+#endif
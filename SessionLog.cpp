@@ -0,0 +1,755 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : SessionLog.cpp
+ * @brief      : Definition file for session logs
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <zlib.h>
+#include "SessionLog.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+#define SESSION_BLOCK_MAGIC "TVSB"
+#define SESSION_INDEX_MAGIC "TVSI"
+
+struct SessionFileHeader {
+    char magic[4];
+    uint32_t version;
+};
+
+// last bytes of a closed log
+struct SessionTrailer {
+    uint64_t indexOffset;
+    uint32_t blocks;
+    char magic[4];
+};
+
+// orders blocks by their last event time
+struct BlockEndsBefore {
+    bool operator()(const SessionIndexEntry & entry, uint64_t micros) const {
+        return entry.lastMicros < micros;
+    }
+};
+
+/**
+ * @brief seconds on a monotonic clock
+ */
+static double clockSeconds(){
+    return chrono::duration<double>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief true for update types that carry an id
+ */
+static bool hasId(uint32_t type){
+    return type == PoseUpdate::CAMERA_UPSERT || type == PoseUpdate::TAG_UPSERT;
+}
+
+/**
+ * @brief true for update types that add / move a camera and carry its
+ *        timestamp
+ */
+static bool hasTime(uint32_t type){
+    return type == PoseUpdate::CAMERA_APPEND ||
+           type == PoseUpdate::CAMERA_UPSERT;
+}
+
+/**
+ * @brief bit pattern of a timestamp. consecutive timestamps differ in the
+ *        low bits, so the difference of two patterns is a short varint
+ */
+static uint64_t timeBits(double t){
+    uint64_t bits;
+    memcpy(&bits, &t, sizeof(bits));
+    return bits;
+}
+static double bitsTime(uint64_t bits){
+    double t;
+    memcpy(&t, &bits, sizeof(t));
+    return t;
+}
+
+/**
+ * @brief appends v as LEB128 varint
+ */
+static void putVarint(vector<unsigned char> & out, uint64_t v){
+    while(v >= 0x80){
+        out.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((unsigned char)v);
+}
+
+/**
+ * @brief reads LEB128 varint at offset
+ * @return false if the data ends inside the varint
+ */
+static bool getVarint(const vector<unsigned char> & in, size_t & offset,
+                      uint64_t & v){
+    v = 0;
+    for(int shift = 0; shift < 64 && offset < in.size(); shift += 7){
+        unsigned char byte = in[offset++];
+        v |= (uint64_t)(byte & 0x7f) << shift;
+        if(!(byte & 0x80)){
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief maps signed deltas to small unsigned values (0,-1,1,-2 -> 0,1,2,3)
+ */
+static uint64_t zigzag(int64_t v){
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+static int64_t unzigzag(uint64_t v){
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/**
+ * @brief rounds v to an integer within +-SESSION_MAX_QUANTUM, NaN to 0
+ */
+static int64_t quantizeValue(double v){
+    if(!(v == v)){
+        return 0;
+    }
+    return llround(max(min(v, SESSION_MAX_QUANTUM), -SESSION_MAX_QUANTUM));
+}
+
+/**
+ * @brief quantizes position / rotation to 7 integers
+ */
+static void quantize(const PoseUpdate & update, int64_t * q){
+    for(int k = 0; k < 3; k++){
+        q[k] = quantizeValue(update.position[k] / SESSION_POSITION_QUANTUM);
+    }
+    for(int k = 0; k < 4; k++){
+        q[3 + k] = quantizeValue(update.rotation[k] * SESSION_ROTATION_STEPS);
+    }
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+SessionWriter::SessionWriter(){
+    file = 0;
+    startTime = 0.0;
+    error = false;
+    eventCount = 0;
+    fileBytes = 0;
+    lastMicros = 0;
+    memset(&block, 0, sizeof(block));
+    memset(previous, 0, sizeof(previous));
+    previousTime = 0;
+    keyframe = false;
+    keyframeMicros = 0;
+    keyframeEvents = 0;
+    sinceKeyframe = 0;
+};
+
+/**
+ * @brief Destructor
+ * @action closes the log, writing its index
+ */
+SessionWriter::~SessionWriter(){
+    close();
+};
+
+/**
+ * @brief creates session log
+ * @param path file to write, replaced if it exists
+ * @return false if the file could not be created
+ */
+bool SessionWriter::open(const char * path){
+    close();
+    file = fopen(path, "wb");
+    if(!file){
+        cerr << "SessionWriter: could not create " << path << endl;
+        return false;
+    }
+    SessionFileHeader header;
+    memcpy(header.magic, SESSION_LOG_MAGIC, 4);
+    header.version = SESSION_LOG_VERSION;
+    error = fwrite(&header, sizeof(header), 1, file) != 1;
+    fileBytes = sizeof(header);
+    startTime = clockSeconds();
+    eventCount = 0;
+    lastMicros = 0;
+    index.clear();
+    raw.clear();
+    block.events = 0;
+    keyframe = false;
+    keyframeEvents = 0;
+    sinceKeyframe = 0;
+    return !error;
+};
+
+/**
+ * @brief writes the last block, the index and the trailer
+ * @return false if any write failed
+ */
+bool SessionWriter::close(){
+    if(!file){
+        return true;
+    }
+    endKeyframe();
+    flushBlock();
+    SessionTrailer trailer;
+    trailer.indexOffset = fileBytes;
+    trailer.blocks = (uint32_t)index.size();
+    memcpy(trailer.magic, SESSION_INDEX_MAGIC, 4);
+    if(!index.empty() &&
+       fwrite(&index[0], sizeof(SessionIndexEntry), index.size(),
+              file) != index.size()){
+        error = true;
+    }
+    if(fwrite(&trailer, sizeof(trailer), 1, file) != 1){
+        error = true;
+    }
+    if(fclose(file) != 0){
+        error = true;
+    }
+    file = 0;
+    if(error){
+        cerr << "SessionWriter: write failed" << endl;
+    }
+    return !error;
+};
+
+/**
+ * @brief appends update stamped with the session clock, or with the time
+ *        of the keyframe being written
+ */
+void SessionWriter::write(const PoseUpdate & update){
+    if(keyframe){
+        write(update, keyframeMicros);
+        return;
+    }
+    double seconds = clockSeconds() - startTime;
+    write(update, (uint64_t)(max(seconds, 0.0) * 1e6));
+};
+
+/**
+ * @brief appends update
+ * @param update camera / tag update
+ * @param micros session time, clamped to not go back
+ * @action the open block is written out first once it is full or spans
+ *         SESSION_BLOCK_MICROS
+ */
+void SessionWriter::write(const PoseUpdate & update, uint64_t micros){
+    if(!file){
+        return;
+    }
+    micros = max(micros, lastMicros);
+    if(block.events >= SESSION_BLOCK_EVENTS ||
+       (block.events && micros - block.firstMicros >= SESSION_BLOCK_MICROS)){
+        flushBlock(keyframe ? SESSION_BLOCK_KEYFRAME : 0);
+    }
+    if(block.events == 0){
+        block.firstMicros = micros;
+        lastMicros = micros;
+        memset(previous, 0, sizeof(previous));
+        previousTime = 0;
+    }
+    raw.push_back((unsigned char)update.type);
+    putVarint(raw, micros - lastMicros);
+    if(hasId(update.type)){
+        putVarint(raw, update.id);
+    }
+    if(update.type < PoseUpdate::CAMERA_CLEAR){
+        int64_t q[7];
+        quantize(update, q);
+        int64_t * last = previous[update.type];
+        for(int k = 0; k < 7; k++){
+            putVarint(raw, zigzag(q[k] - last[k]));
+            last[k] = q[k];
+        }
+    }
+    if(hasTime(update.type)){
+        bool timed = !isnan(update.time);
+        raw.push_back(timed ? 1 : 0);
+        if(timed){
+            uint64_t bits = timeBits(update.time);
+            putVarint(raw, zigzag((int64_t)(bits - previousTime)));
+            previousTime = bits;
+        }
+    }
+    lastMicros = micros;
+    block.lastMicros = micros;
+    block.events++;
+    if(keyframe){
+        keyframeEvents++;
+    } else {
+        eventCount++;
+        sinceKeyframe++;
+    }
+};
+
+/**
+ * @brief true once the events since the last keyframe outnumber both
+ *        SESSION_KEYFRAME_EVENTS and that keyframe
+ */
+bool SessionWriter::keyframeDue() const{
+    return file && !keyframe &&
+           sinceKeyframe >= max((size_t)SESSION_KEYFRAME_EVENTS,
+                                keyframeEvents);
+};
+
+/**
+ * @brief starts a scene keyframe at the current session time
+ * @action the open block is written out first, keyframe updates go into
+ *         blocks of their own
+ */
+void SessionWriter::beginKeyframe(){
+    if(!file || keyframe){
+        return;
+    }
+    flushBlock();
+    double seconds = clockSeconds() - startTime;
+    keyframeMicros = max((uint64_t)(max(seconds, 0.0) * 1e6), lastMicros);
+    keyframe = true;
+    keyframeEvents = 0;
+};
+
+/**
+ * @brief finishes the keyframe
+ * @action its last block is marked, so seeking knows it is complete
+ */
+void SessionWriter::endKeyframe(){
+    if(!keyframe){
+        return;
+    }
+    flushBlock(SESSION_BLOCK_KEYFRAME | SESSION_BLOCK_KEYFRAME_END);
+    keyframe = false;
+    sinceKeyframe = 0;
+};
+
+/**
+ * @brief deflates the open block and appends it to the file
+ * @param flags SESSION_BLOCK_KEYFRAME / _END
+ * @action the block is flushed to disk, its index entry kept for close
+ */
+void SessionWriter::flushBlock(uint32_t flags){
+    if(block.events == 0){
+        return;
+    }
+    uLongf packedSize = compressBound(raw.size());
+    packed.resize(packedSize);
+    if(compress2(&packed[0], &packedSize, &raw[0], raw.size(),
+                 Z_BEST_SPEED) != Z_OK){
+        error = true;
+    }
+    SessionBlockHeader header;
+    memcpy(header.magic, SESSION_BLOCK_MAGIC, 4);
+    header.events = block.events;
+    header.firstMicros = block.firstMicros;
+    header.lastMicros = block.lastMicros;
+    header.rawBytes = (uint32_t)raw.size();
+    header.packedBytes = (uint32_t)packedSize;
+    header.flags = flags;
+    header.reserved = 0;
+    block.offset = fileBytes;
+    block.flags = flags;
+    if(fwrite(&header, sizeof(header), 1, file) != 1 ||
+       fwrite(&packed[0], 1, packedSize, file) != packedSize){
+        error = true;
+    }
+    fflush(file);
+    fileBytes += sizeof(header) + packedSize;
+    index.push_back(block);
+    raw.clear();
+    block.events = 0;
+};
+
+/**
+ * @brief Default Constructor
+ */
+SessionReader::SessionReader(){
+    file = 0;
+    fileBytes = 0;
+    eventCount = 0;
+    block = 0;
+    rawOffset = 0;
+    hasNext = false;
+    nextMicros = 0;
+    memset(&nextUpdate, 0, sizeof(nextUpdate));
+    memset(previous, 0, sizeof(previous));
+    previousTime = 0;
+    inKeyframe = false;
+};
+
+/**
+ * @brief Destructor
+ */
+SessionReader::~SessionReader(){
+    close();
+};
+
+/**
+ * @brief opens session log and moves to its first event
+ * @param path log written by SessionWriter
+ * @return false if it is not a session log
+ */
+bool SessionReader::open(const char * path){
+    close();
+    file = fopen(path, "rb");
+    if(!file){
+        cerr << "SessionReader: could not open " << path << endl;
+        return false;
+    }
+    SessionFileHeader header;
+    if(fread(&header, sizeof(header), 1, file) != 1 ||
+       memcmp(header.magic, SESSION_LOG_MAGIC, 4) != 0){
+        cerr << "SessionReader: " << path << " is not a session log" << endl;
+        close();
+        return false;
+    }
+    if(header.version != SESSION_LOG_VERSION){
+        cerr << "SessionReader: " << path << " is a version "
+             << header.version << " session log, only version "
+             << SESSION_LOG_VERSION << " is read" << endl;
+        close();
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    fileBytes = (uint64_t)ftell(file);
+    if(!readIndex()){
+        scanBlocks();
+    }
+    // session events and the keyframes that end with a marked block
+    eventCount = 0;
+    bool inside = false;
+    size_t start = 0;
+    for(size_t b = 0; b < index.size(); b++){
+        if(!(index[b].flags & SESSION_BLOCK_KEYFRAME)){
+            eventCount += index[b].events;
+            inside = false;
+            continue;
+        }
+        if(!inside){
+            start = b;
+            inside = true;
+        }
+        if(index[b].flags & SESSION_BLOCK_KEYFRAME_END){
+            keyframes.push_back(start);
+            inside = false;
+        }
+    }
+    return seek(0);
+};
+
+/**
+ * @brief closes the log
+ */
+void SessionReader::close(){
+    if(file){
+        fclose(file);
+        file = 0;
+    }
+    index.clear();
+    keyframes.clear();
+    eventCount = 0;
+    hasNext = false;
+    inKeyframe = false;
+};
+
+/**
+ * @brief time of the last event in microseconds, 0 for an empty log
+ */
+uint64_t SessionReader::duration() const{
+    return index.empty() ? 0 : index.back().lastMicros;
+};
+
+/**
+ * @brief reads the block index written on close
+ * @return false if the log has no (valid) trailer
+ */
+bool SessionReader::readIndex(){
+    SessionTrailer trailer;
+    if(fseek(file, -(long)sizeof(trailer), SEEK_END) != 0 ||
+       fread(&trailer, sizeof(trailer), 1, file) != 1 ||
+       memcmp(trailer.magic, SESSION_INDEX_MAGIC, 4) != 0){
+        return false;
+    }
+    // the index sits right before the trailer
+    if(trailer.indexOffset < sizeof(SessionFileHeader) ||
+       trailer.indexOffset + (uint64_t)trailer.blocks *
+       sizeof(SessionIndexEntry) + sizeof(trailer) != fileBytes){
+        return false;
+    }
+    index.resize(trailer.blocks);
+    if(trailer.blocks &&
+       (fseek(file, (long)trailer.indexOffset, SEEK_SET) != 0 ||
+        fread(&index[0], sizeof(SessionIndexEntry), trailer.blocks,
+              file) != trailer.blocks)){
+        index.clear();
+        return false;
+    }
+    return true;
+};
+
+/**
+ * @brief rebuilds the index of a log that was not closed
+ * @action walks block headers from the start, stopping at the first
+ *         truncated / damaged block
+ */
+void SessionReader::scanBlocks(){
+    index.clear();
+    uint64_t offset = sizeof(SessionFileHeader);
+    SessionBlockHeader header;
+    while(fseek(file, (long)offset, SEEK_SET) == 0 &&
+          fread(&header, sizeof(header), 1, file) == 1 &&
+          memcmp(header.magic, SESSION_BLOCK_MAGIC, 4) == 0){
+        uint64_t end = offset + sizeof(header) + header.packedBytes;
+        // the last block may have been cut off mid write
+        if(fseek(file, (long)end - 1, SEEK_SET) != 0 || fgetc(file) == EOF){
+            break;
+        }
+        SessionIndexEntry entry = {offset, header.firstMicros,
+                                   header.lastMicros, header.events,
+                                   header.flags};
+        index.push_back(entry);
+        offset = end;
+    }
+    cerr << "SessionReader: log was not closed, recovered " << index.size()
+         << " blocks" << endl;
+};
+
+/**
+ * @brief moves to the first event at or after micros
+ * @param micros session time
+ * @return false if no event is left at or after micros
+ * @action binary search over the block index, then decodes events of
+ *         that block up to micros
+ */
+bool SessionReader::seek(uint64_t micros){
+    hasNext = false;
+    inKeyframe = false;
+    size_t b = lower_bound(index.begin(), index.end(), micros,
+                           BlockEndsBefore()) - index.begin();
+    b = skipKeyframes(b);
+    if(b >= index.size() || !loadBlock(b)){
+        block = index.size();
+        return false;
+    }
+    while(hasNext && nextMicros < micros){
+        PoseUpdate update;
+        uint64_t t;
+        next(update, t);
+    }
+    return hasNext;
+};
+
+/**
+ * @brief session time of the last complete keyframe at or before micros
+ * @return false if there is none
+ */
+bool SessionReader::keyframeTime(uint64_t micros, uint64_t & keyframe) const{
+    size_t k = findKeyframe(micros);
+    if(k >= keyframes.size()){
+        return false;
+    }
+    keyframe = index[keyframes[k]].firstMicros;
+    return true;
+};
+
+/**
+ * @brief moves to the last complete keyframe at or before micros
+ * @return false if there is none (or it is damaged)
+ * @action events of the keyframe come first, then the session events
+ *         logged after it
+ */
+bool SessionReader::seekKeyframe(uint64_t micros){
+    hasNext = false;
+    size_t k = findKeyframe(micros);
+    if(k >= keyframes.size()){
+        return false;
+    }
+    inKeyframe = true;
+    if(!loadBlock(keyframes[k])){
+        inKeyframe = false;
+        block = index.size();
+        return false;
+    }
+    return hasNext;
+};
+
+/**
+ * @brief binary search over the keyframe start times
+ */
+size_t SessionReader::findKeyframe(uint64_t micros) const{
+    size_t lo = 0;
+    size_t hi = keyframes.size();
+    while(lo < hi){
+        size_t mid = (lo + hi) / 2;
+        if(index[keyframes[mid]].firstMicros <= micros){
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo ? lo - 1 : keyframes.size();
+};
+
+/**
+ * @brief skips keyframe blocks
+ */
+size_t SessionReader::skipKeyframes(size_t b) const{
+    while(b < index.size() && (index[b].flags & SESSION_BLOCK_KEYFRAME)){
+        b++;
+    }
+    return b;
+};
+
+/**
+ * @brief time of the next event
+ * @return false at the end of the log
+ */
+bool SessionReader::peek(uint64_t & micros){
+    micros = nextMicros;
+    return hasNext;
+};
+
+/**
+ * @brief takes the next event
+ * @param update decoded update (poses dequantized)
+ * @param micros session time of the update
+ * @return false at the end of the log
+ */
+bool SessionReader::next(PoseUpdate & update, uint64_t & micros){
+    if(!hasNext){
+        return false;
+    }
+    update = nextUpdate;
+    micros = nextMicros;
+    if(rawOffset < raw.size()){
+        hasNext = decode();
+        return true;
+    }
+    // a keyframe goes on until its last block, the session skips them
+    size_t b = block + 1;
+    if(inKeyframe && (index[block].flags & SESSION_BLOCK_KEYFRAME_END)){
+        inKeyframe = false;
+    }
+    if(!inKeyframe){
+        b = skipKeyframes(b);
+    }
+    hasNext = b < index.size() && loadBlock(b);
+    return true;
+};
+
+/**
+ * @brief reads and inflates block b
+ * @return false if the block is damaged
+ * @action decodes its first event
+ */
+bool SessionReader::loadBlock(size_t b){
+    block = b;
+    hasNext = false;
+    SessionBlockHeader header;
+    if(fseek(file, (long)index[b].offset, SEEK_SET) != 0 ||
+       fread(&header, sizeof(header), 1, file) != 1 ||
+       memcmp(header.magic, SESSION_BLOCK_MAGIC, 4) != 0){
+        return false;
+    }
+    // sizes a writer can produce, and data that fits the file
+    uint64_t rest = fileBytes - min(fileBytes, index[b].offset +
+                                               sizeof(header));
+    if(header.events > SESSION_BLOCK_EVENTS ||
+       header.rawBytes > header.events * SESSION_MAX_EVENT_BYTES ||
+       header.packedBytes > compressBound(header.rawBytes) ||
+       header.packedBytes > rest){
+        cerr << "SessionReader: damaged block " << b << endl;
+        return false;
+    }
+    packed.resize(header.packedBytes);
+    raw.resize(header.rawBytes);
+    uLongf rawSize = header.rawBytes;
+    if(fread(&packed[0], 1, packed.size(), file) != packed.size() ||
+       uncompress(&raw[0], &rawSize, &packed[0], packed.size()) != Z_OK){
+        cerr << "SessionReader: damaged block " << b << endl;
+        return false;
+    }
+    raw.resize(rawSize);
+    rawOffset = 0;
+    nextMicros = header.firstMicros;
+    memset(previous, 0, sizeof(previous));
+    previousTime = 0;
+    hasNext = decode();
+    return hasNext;
+};
+
+/**
+ * @brief decodes the event at rawOffset
+ * @return false if the block data ends early / is damaged
+ */
+bool SessionReader::decode(){
+    if(rawOffset >= raw.size()){
+        return false;
+    }
+    uint32_t type = raw[rawOffset++];
+    uint64_t delta;
+    if(type > PoseUpdate::CAMERA_CLEAR || !getVarint(raw, rawOffset, delta)){
+        return false;
+    }
+    memset(&nextUpdate, 0, sizeof(nextUpdate));
+    nextUpdate.type = type;
+    nextUpdate.time = NAN;
+    nextMicros += delta;
+    if(hasId(type) && !getVarint(raw, rawOffset, nextUpdate.id)){
+        return false;
+    }
+    if(type < PoseUpdate::CAMERA_CLEAR){
+        int64_t * last = previous[type];
+        for(int k = 0; k < 7; k++){
+            uint64_t v;
+            if(!getVarint(raw, rawOffset, v)){
+                return false;
+            }
+            // wraps instead of overflowing on damaged data
+            last[k] = (int64_t)((uint64_t)last[k] + (uint64_t)unzigzag(v));
+        }
+        for(int k = 0; k < 3; k++){
+            nextUpdate.position[k] = last[k] * SESSION_POSITION_QUANTUM;
+        }
+        for(int k = 0; k < 4; k++){
+            nextUpdate.rotation[k] = (double)last[3 + k] /
+                                     SESSION_ROTATION_STEPS;
+        }
+    }
+    if(hasTime(type)){
+        if(rawOffset >= raw.size()){
+            return false;
+        }
+        if(raw[rawOffset++]){
+            uint64_t v;
+            if(!getVarint(raw, rawOffset, v)){
+                return false;
+            }
+            previousTime += (uint64_t)unzigzag(v);
+            nextUpdate.time = bitsTime(previousTime);
+        }
+    }
+    return true;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
@@ -0,0 +1,226 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : SessionLog.h
+ * @brief      : Append only log of timestamped pose updates. Poses are
+ *               quantized and delta encoded, blocks of events are deflated
+ *               and indexed by time for seeking
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cstdio>
+#include <vector>
+#include <stdint.h>
+#include "PoseQueue.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// magic / version at the start of session logs
+#define SESSION_LOG_MAGIC "TVSL"
+#define SESSION_LOG_VERSION 2
+
+// pose quantization: positions in steps of 10 um (scene units taken as
+// meters), quaternion components in steps of 2^-20
+#define SESSION_POSITION_QUANTUM 1e-5
+#define SESSION_ROTATION_STEPS (1 << 20)
+// quantized values are clamped to +-2^61 so the difference of two fits
+// int64. positions beyond about 2.3e13 are logged at that bound
+#define SESSION_MAX_QUANTUM ((double)(1LL << 61))
+
+// a block is closed after this many events or this much session time, so
+// a crash loses at most a few seconds of the session
+#define SESSION_BLOCK_EVENTS 8192
+#define SESSION_BLOCK_MICROS 5000000
+// longest encoded event: type, time delta, id, 7 pose deltas, timestamp
+// flag and delta. bounds the size of a block read from a log
+#define SESSION_MAX_EVENT_BYTES (1 + 10 + 10 + 7 * 10 + 1 + 10)
+
+// a scene keyframe is due once this many events, and at least as many as
+// the last keyframe held, were logged after it. seeking applies one
+// keyframe and the events after it, so it costs about twice the scene
+// size however long the session is, and keyframes take at most about as
+// much space as the events
+#define SESSION_KEYFRAME_EVENTS 65536
+
+// block flags. keyframe blocks hold the whole scene at one time and are
+// skipped by normal playback. the last block of a keyframe is marked, so
+// keyframes cut short by a crash are ignored
+#define SESSION_BLOCK_KEYFRAME 1
+#define SESSION_BLOCK_KEYFRAME_END 2
+
+// block of events, followed by packedBytes of deflated event data. times
+// are microseconds since the log was opened
+struct SessionBlockHeader {
+    char magic[4];
+    uint32_t events;
+    uint64_t firstMicros;
+    uint64_t lastMicros;
+    uint32_t rawBytes;
+    uint32_t packedBytes;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+// index entry per block, written at the end of the file on close
+struct SessionIndexEntry {
+    uint64_t offset;
+    uint64_t firstMicros;
+    uint64_t lastMicros;
+    uint64_t events;
+    uint64_t flags;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// Events are encoded as type byte, varint time delta, varint id (id
+// updates only) and seven zigzag varints of quantized pose deltas against
+// the previous event of the same type. Camera events add a byte telling
+// whether they carry a timestamp, then the zigzag varint difference of its
+// bits to the previous one. Delta state restarts with every block, so
+// blocks decode on their own. Consecutive poses of a trajectory take a few
+// bytes each before deflate.
+class SessionWriter
+{
+public:
+    SessionWriter();
+    ~SessionWriter();
+
+    // creates log at path. the session clock starts here
+    bool open(const char * path);
+
+    // closes the open block and writes the index. false if a write failed
+    bool close();
+    bool isOpen() const { return file != 0; };
+
+    // appends update at the current session time
+    void write(const PoseUpdate & update);
+    // appends update at micros since open. times must not decrease
+    void write(const PoseUpdate & update, uint64_t micros);
+
+    // true once a scene keyframe should be written
+    bool keyframeDue() const;
+    // updates written between begin and end are a snapshot of the whole
+    // scene at the current session time (e.g. camera / tag upserts), used
+    // to seek without replaying the session before it
+    void beginKeyframe();
+    void endKeyframe();
+
+    size_t events() const { return eventCount; };
+    // bytes written to disk so far
+    size_t bytes() const { return fileBytes; };
+private:
+    SessionWriter(const SessionWriter & obj);
+    SessionWriter & operator=(const SessionWriter & obj);
+
+    // deflates and appends the open block with flags
+    void flushBlock(uint32_t flags = 0);
+
+    FILE * file;
+    double startTime;
+    bool error;
+    size_t eventCount;
+    size_t fileBytes;
+    vector<SessionIndexEntry> index;
+
+    // open block
+    vector<unsigned char> raw;
+    vector<unsigned char> packed;
+    SessionIndexEntry block;
+    uint64_t lastMicros;
+    int64_t previous[PoseUpdate::CAMERA_CLEAR][7];
+    uint64_t previousTime;
+
+    // keyframe being written and its session time
+    bool keyframe;
+    uint64_t keyframeMicros;
+    size_t keyframeEvents;
+    size_t sinceKeyframe;
+};
+
+// Reads a session log in time order, skipping keyframes. Without an index
+// (the writer did not get to close) the blocks are found by scanning, up
+// to the first damaged one
+class SessionReader
+{
+public:
+    SessionReader();
+    ~SessionReader();
+
+    bool open(const char * path);
+    void close();
+
+    // events of the session, without keyframes
+    size_t events() const { return eventCount; };
+    // time of the last event in microseconds
+    uint64_t duration() const;
+
+    // moves to the first event at or after micros
+    bool seek(uint64_t micros);
+
+    // time of the last complete keyframe at or before micros. false if
+    // there is none
+    bool keyframeTime(uint64_t micros, uint64_t & keyframe) const;
+    // moves to the last complete keyframe at or before micros. next then
+    // returns the scene of the keyframe followed by the events after it
+    bool seekKeyframe(uint64_t micros);
+
+    // time of the next event. false at the end of the log
+    bool peek(uint64_t & micros);
+    // takes the next event. false at the end of the log
+    bool next(PoseUpdate & update, uint64_t & micros);
+private:
+    SessionReader(const SessionReader & obj);
+    SessionReader & operator=(const SessionReader & obj);
+
+    bool readIndex();
+    void scanBlocks();
+    // inflates block b and resets the delta state
+    bool loadBlock(size_t b);
+    // first block at or after b that normal playback reads
+    size_t skipKeyframes(size_t b) const;
+    // last complete keyframe starting at or before micros, keyframes.size()
+    // if none
+    size_t findKeyframe(uint64_t micros) const;
+    // decodes the event at rawOffset into nextUpdate / nextMicros
+    bool decode();
+
+    FILE * file;
+    uint64_t fileBytes;
+    vector<SessionIndexEntry> index;
+    size_t eventCount;
+    // first block of every complete keyframe
+    vector<size_t> keyframes;
+
+    // current block and decoded event waiting to be taken
+    size_t block;
+    vector<unsigned char> raw;
+    vector<unsigned char> packed;
+    size_t rawOffset;
+    bool hasNext;
+    PoseUpdate nextUpdate;
+    uint64_t nextMicros;
+    int64_t previous[PoseUpdate::CAMERA_CLEAR][7];
+    uint64_t previousTime;
+    // reading the blocks of a keyframe
+    bool inKeyframe;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
@@ -8,39 +8,308 @@
 //                                  INCLUDES                                  //
 //----------------------------------------------------------------------------//
 #include <iostream>
+#include <chrono>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <thread>
 #include "TagViewer.h"
+#include <GL/glx.h>
+#include "PoseLoader.h"
+#include "PoseFile.h"
+#include "PoseTree.h"
+#include "ThumbnailCache.h"
+#include "OffscreenContext.h"
+#include "FrameRecorder.h"
+#include "PoseServer.h"
+#include "SessionLog.h"
+#include "ImageWriter.h"
 //----------------------------------------------------------------------------//
 //                                END INCLUDES                                //
 //----------------------------------------------------------------------------//
 //----------------------------------------------------------------------------//
+//                        GLOBAL VARIABLE DEFINITIONS                         //
+//----------------------------------------------------------------------------//
+// camera pyramid, interleaved x,y,z,r,g,b. 4 triangles
+static const GLfloat pyramidVertices[] = {
+    0.0f, 1.0f, 0.0f,    0.0f, 1.0f, 1.0f,
+    -1.0f, -1.0f, 1.0f,  0.0f, 1.0f, 0.0f,
+    1.0f, -1.0f, 1.0f,   0.0f, 0.0f, 1.0f,
+
+    0.0f, 1.0f, 0.0f,    0.0f, 1.0f, 1.0f,
+    -1.0f, -1.0f, 1.0f,  0.0f, 1.0f, 0.0f,
+    0.0f, -1.0f, -1.0f,  0.0f, 0.0f, 1.0f,
+
+    0.0f, 1.0f, 0.0f,    0.0f, 1.0f, 1.0f,
+    0.0f, -1.0f, -1.0f,  0.0f, 1.0f, 0.0f,
+    1.0f, -1.0f, 1.0f,   0.0f, 0.0f, 1.0f,
+
+    -1.0f, -1.0f, 1.0f,  0.0f, 1.0f, 1.0f,
+    0.0f, -1.0f, -1.0f,  0.0f, 1.0f, 0.0f,
+    1.0f, -1.0f, 1.0f,   0.0f, 0.0f, 1.0f
+};
+//----------------------------------------------------------------------------//
+//                      END GLOBAL VARIABLE DEFINITIONS                       //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// exact ray test against the pyramid triangles of one camera. the ray is
+// moved into camera space with the inverse of its rigid pose (translation
+// removed, then rotated by the conjugate quaternion). cameras outside
+// [first, last) are not drawn and never hit
+class PyramidHitTest : public RayHitTest
+{
+public:
+    PyramidHitTest(const PoseStore & cameras, const double * origin,
+                   const double * dir, size_t first, size_t last)
+        : cameras(cameras), origin(origin), dir(dir), first(first),
+          last(last) {};
+
+    bool hit(uint32_t index, double & t){
+        if(index < first || index >= last){
+            return false;
+        }
+        const GLfloat * pose = cameras.instance(index);
+        double o[3] = {origin[0] - pose[0], origin[1] - pose[1],
+                       origin[2] - pose[2]};
+        double d[3] = {dir[0], dir[1], dir[2]};
+        rotateInverse(pose + 4, o);
+        rotateInverse(pose + 4, d);
+        bool found = false;
+        for(int i = 0; i < 4; i++){
+            double tri;
+            if(hitTriangle(o, d, pyramidVertices + 18 * i, tri) &&
+               (!found || tri < t)){
+                t = tri;
+                found = true;
+            }
+        }
+        return found;
+    };
+private:
+    // rotates v by the conjugate of unit quaternion q (x,y,z,w), same
+    // formula as the vertex shaders with the axis negated
+    static void rotateInverse(const GLfloat * q, double * v){
+        double t[3] = {2.0 * (q[2] * v[1] - q[1] * v[2]),
+                       2.0 * (q[0] * v[2] - q[2] * v[0]),
+                       2.0 * (q[1] * v[0] - q[0] * v[1])};
+        v[0] += q[3] * t[0] - (q[1] * t[2] - q[2] * t[1]);
+        v[1] += q[3] * t[1] - (q[2] * t[0] - q[0] * t[2]);
+        v[2] += q[3] * t[2] - (q[0] * t[1] - q[1] * t[0]);
+    };
+
+    // Moller-Trumbore on triangle with interleaved vertex stride 6
+    static bool hitTriangle(const double * o, const double * d,
+                            const GLfloat * v, double & t){
+        double e1[3], e2[3], p[3], q[3], s[3];
+        for(int k = 0; k < 3; k++){
+            e1[k] = v[6 + k] - v[k];
+            e2[k] = v[12 + k] - v[k];
+            s[k] = o[k] - v[k];
+        }
+        p[0] = d[1] * e2[2] - d[2] * e2[1];
+        p[1] = d[2] * e2[0] - d[0] * e2[2];
+        p[2] = d[0] * e2[1] - d[1] * e2[0];
+        double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if(fabs(det) < 1e-12){
+            return false;
+        }
+        double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / det;
+        if(u < 0.0 || u > 1.0){
+            return false;
+        }
+        q[0] = s[1] * e1[2] - s[2] * e1[1];
+        q[1] = s[2] * e1[0] - s[0] * e1[2];
+        q[2] = s[0] * e1[1] - s[1] * e1[0];
+        double v2 = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) / det;
+        if(v2 < 0.0 || u + v2 > 1.0){
+            return false;
+        }
+        t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / det;
+        return t >= 0.0;
+    };
+
+    const PoseStore & cameras;
+    const double * origin;
+    const double * dir;
+    size_t first;
+    size_t last;
+};
+
+// camera with an image, large enough on screen for its thumbnail
+struct ThumbnailCandidate {
+    double pixels;
+    uint32_t camera;
+    uint32_t view;
+};
+
+// orders thumbnail candidates largest first
+struct LargerOnScreen {
+    bool operator()(const ThumbnailCandidate & a,
+                    const ThumbnailCandidate & b) const {
+        return a.pixels > b.pixels;
+    };
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
 //                              CLASS DEFINITION                              //
 //----------------------------------------------------------------------------//
 /**
- * @brief Default Constructor. Initializes all private variables
- * @action initializes all private variables
+ * @brief Viewport Constructor
+ * @param x,y lower left corner as fractions of the window
+ * @param width,height size as fractions of the window
+ * @param mode camera placement
+ * @action GL buffers are created with the first cull result
  */
-TagViewer::TagViewer(){
-    // initialize OpenGL running Environment
-    mouseId = -1;
-    mouseDown = false;
-    mouse_x = -1;
-    mouse_y = -1;
+Viewport::Viewport(double x, double y, double width, double height,
+                   ViewMode mode)
+    : x(x), y(y), width(width), height(height), mode(mode){
+    for(int k = 0; k < 3; k++){
+        eye[k] = target[k] = up[k] = 0.0;
+    }
+    for(int k = 0; k < 4; k++){
+        pixels[k] = 0;
+    }
+    memset(frustum.planes, 0, sizeof(frustum.planes));
+    culledVersion = (size_t)-1;
+    culledFirst = 0;
+    culledLast = 0;
+    allVisible = true;
+    memset(&stats, 0, sizeof(stats));
+    visibleVBO = 0;
+    visibleCapacity = 0;
+    lineIndexVBO = 0;
+    lineIndexCapacity = 0;
+    clusterVBO = 0;
+    clusterCapacity = 0;
+    thumbnailVBO = 0;
+    thumbnailCapacity = 0;
+};
 
-    width = 1;
-    height = 1;
+/**
+ * @brief Default Constructor. Initializes all private variables
+ * @action initializes all private variables for a 1 x 1 window
+ */
+TagViewer::TagViewer()
+    : TagViewer(1, 1){
 };
 /**
  * @brief Constructor with window sizes
  * @param w width
  * @param h height
- * @action same as constructor
+ * @action initializes all private variables
  */
-TagViewer::TagViewer(int w, int h){
+TagViewer::TagViewer(int w, int h)
+    : poseUpdates(POSE_QUEUE_CAPACITY){
     // initialize OpenGL running Environment
     mouseId = -1;
     mouseDown = false;
     mouse_x = -1;
     mouse_y = -1;
+    press_x = -1;
+    press_y = -1;
+    hovered = NO_CAMERA;
+    selected = NO_CAMERA;
+
+    frustumProgram = 0;
+    pyramidVBO = 0;
+    lineVBO = 0;
+    squareVBO = 0;
+    instanceVBO = 0;
+    instanceCapacity = 0;
+    uploadedInstances = 0;
+    drawCalls = 0;
+    updatedBegin = 0;
+    updatedEnd = 0;
+    sceneVersion = 0;
+
+    poseTexture = 0;
+    poseProgram = 0;
+    tagVBO = 0;
+    tagCapacity = 0;
+    tagTexture = 0;
+    edgeProgram = 0;
+    edgeVBO = 0;
+    edgeCapacity = 0;
+    tagsUploaded = 0;
+    tagsChanged = 0;
+    orbitTag = false;
+    orbitTagId = 0;
+    edgesUploaded = 0;
+    showObservations = true;
+    viewports.push_back(Viewport(0.0, 0.0, 1.0, 1.0, VIEW_ORBIT));
+    activeViewport = 0;
+    pyramidPixels = LOD_PYRAMID_PIXELS;
+    clusterPixels = LOD_CLUSTER_PIXELS;
+
+    window = 0;
+    offscreen = 0;
+    running = false;
+    dirty = true;
+    redisplayPosted = false;
+    vsync = true;
+    minFrameInterval = 0.0;
+    lastFrameTime = 0.0;
+    initWakePipe();
+
+    showStats = false;
+
+    playback = false;
+    playing = false;
+    playTime = NAN;
+    playWindow = 0.0;
+    playSpeed = 1.0;
+    lastTick = 0.0;
+    loader = 0;
+    server = 0;
+    serverOffset = 0;
+    loadOffset = 0;
+    loadedPoses = 0;
+    for(int k = 0; k < 6; k++){
+        loadBounds[k] = 0.0;
+    }
+    autoFrame = false;
+    sessionLog = 0;
+    logMuted = false;
+    replay = 0;
+    replaySpeed = 1.0;
+    replayClock = 0.0;
+    replayTick = 0.0;
+    replayWait = -1.0;
+    recorder = 0;
+    pathPlaying = false;
+    pathTime = 0.0;
+    pathTick = 0.0;
+    showTrajectory = true;
+    windowFirst = 0;
+    windowLast = 0;
+
+    octree = make_shared<CameraOctree>();
+    mappedVBO = 0;
+    mappedUploaded = 0;
+    treeCache = 0;
+    treeMemory = TREE_MEMORY_BYTES;
+    treeErrorPixels = TREE_ERROR_PIXELS;
+    imageCount = 0;
+    thumbnailCache = 0;
+    thumbnailTexture = 0;
+    thumbnailProgram = 0;
+    atlasColumns = 0;
+    thumbnailMemory = THUMBNAIL_MEMORY_BYTES;
+    thumbnailPixels = THUMBNAIL_PIXELS;
+    showThumbnails = true;
+    referenceVBO = 0;
+    referenceUploaded = false;
+    errorVBO = 0;
+    errorTexture = 0;
+    errorsUploaded = false;
+    errorRange = 0.0;
+    errorRmse = 0.0;
+    showErrors = true;
 
     width = w;
     height = h;
@@ -49,215 +318,3918 @@ TagViewer::TagViewer(int w, int h){
 
 /**
  * @brief Destructor. 
- * @action Deletes all memory allocated if exists
+ * @action Deletes all memory allocated if exists. shared pose blocks and
+ *         the mapped pose file go with their last viewer. GL objects are
+ *         deleted with the window / offscreen context current, then the
+ *         window / context itself
  */
 TagViewer::~TagViewer(){
-    // currently nothing really
+    bool current = makeCurrent();
+    // recorder still needs the context to read back its last frames
+    delete recorder;
+    delete loader;
+    delete server;
+    delete sessionLog;
+    delete replay;
+    // without a context (window closed) its objects are gone already
+    releaseGL(current);
+    if(window){
+        // GLUT destroys it on its next event pass, without calling back
+        glutCloseFunc(0);
+        glutDestroyWindow(window);
+    }
+    delete offscreen;
+    close(wakePipe[0]);
+    close(wakePipe[1]);
 };
 
 /**
  * @brief Copy constructor
- * @action Defines new Tagviewer using other Tagviewr instance
+ * @action Defines new Tagviewer using other Tagviewr instance. the new
+ *         viewer shares the scene with obj (see copyScene). like any new
+ *         viewer it has no window / context until initWindow /
+ *         initOffscreen, which upload the scene again
  */
-TagViewer::TagViewer(const TagViewer & obj){
-    mouseId = -1;
-    mouseDown = false;
-    mouse_x = -1;
-    mouse_y = -1;
+TagViewer::TagViewer(const TagViewer & obj)
+    : TagViewer(obj.width, obj.height){
+    copyScene(obj);
+};
 
-    width = obj.width;
-    height = obj.height;
-    // needs to update worldcamera using its own copy constructor..
-    /* worldCamera = worldCamera; */
-    /* worldCamera.setAspect((double)w / h); */
-    
+/**
+ * @brief Move constructor
+ * @action takes over scene, GL objects, window / context and pending live
+ *         updates of obj, which is left as a new empty viewer
+ */
+TagViewer::TagViewer(TagViewer && obj)
+    : TagViewer(obj.width, obj.height){
+    swapState(obj);
+};
+
+/**
+ * @brief assignment operator
+ * @action shares the scene of tv. window, context and GL objects of this
+ *         viewer are kept and everything is uploaded again
+ */
+TagViewer & TagViewer::operator=(const TagViewer & tv){
+    if(this != &tv){
+        copyScene(tv);
+    }
+    return *this;
+};
+
+/**
+ * @brief move assignment operator
+ * @action exchanges everything with tv, so the old window / context and GL
+ *         objects of this viewer are deleted by tv's destructor
+ */
+TagViewer & TagViewer::operator=(TagViewer && tv){
+    if(this != &tv){
+        swapState(tv);
+    }
+    return *this;
+};
+
+/**
+ * @brief shares scene of obj
+ * @param obj viewer to copy from
+ * @action camera / tag stores, octree and mapped pose file are reference
+ *         counted, so this costs one pointer per BLOCK_SIZE cameras. the
+ *         first write to either viewer clones only the block it touches.
+ *         view settings come along, GL uploads start over. objects this
+ *         viewer drops are deleted with its own context current
+ */
+void TagViewer::copyScene(const TagViewer & obj){
+    if(!makeCurrent()){
+        // no window / context (yet or any more), so only names to forget
+        releaseGL(false);
+    }
+    cameras = obj.cameras;
+    cameraIds = obj.cameraIds;
+    octree = obj.octree;
+    tags = obj.tags;
+    tagIds = obj.tagIds;
+    orbitTag = obj.orbitTag;
+    orbitTagId = obj.orbitTagId;
+    observations = obj.observations;
+    poseFile = obj.poseFile;
+    releaseTree();
+    poseTree = obj.poseTree;
+    treeMemory = obj.treeMemory;
+    treeErrorPixels = obj.treeErrorPixels;
+    releaseThumbnails();
+    cameraImages = obj.cameraImages;
+    imageCount = obj.imageCount;
+    thumbnailMemory = obj.thumbnailMemory;
+    thumbnailPixels = obj.thumbnailPixels;
+    showThumbnails = obj.showThumbnails;
+    reference = obj.reference;
+    referenceUploaded = false;
+    cameraErrors = obj.cameraErrors;
+    errorsUploaded = false;
+    errorRange = obj.errorRange;
+    errorRmse = obj.errorRmse;
+    showErrors = obj.showErrors;
+
+    double aspect = worldCamera.getAspect();
+    worldCamera = obj.worldCamera;
+    worldCamera.setAspect(aspect);
+    // layout and cameras of obj, cull buffers of this context
+    for(size_t v = obj.viewports.size(); v < viewports.size(); v++){
+        releaseViewport(viewports[v]);
+    }
+    viewports.resize(obj.viewports.size(),
+                     Viewport(0.0, 0.0, 1.0, 1.0, VIEW_ORBIT));
+    for(size_t v = 0; v < viewports.size(); v++){
+        const Viewport & from = obj.viewports[v];
+        viewports[v].x = from.x;
+        viewports[v].y = from.y;
+        viewports[v].width = from.width;
+        viewports[v].height = from.height;
+        viewports[v].mode = from.mode;
+        viewports[v].camera = from.camera;
+        viewports[v].culledVersion = (size_t)-1;
+    }
+    activeViewport = 0;
+    hovered = NO_CAMERA;
+    selected = obj.selected;
+    pyramidPixels = obj.pyramidPixels;
+    clusterPixels = obj.clusterPixels;
+    playback = obj.playback;
+    playing = false;
+    playTime = obj.playTime;
+    playWindow = obj.playWindow;
+    playSpeed = obj.playSpeed;
+    showTrajectory = obj.showTrajectory;
+    showObservations = obj.showObservations;
+    cameraPath = obj.cameraPath;
+    pathPlaying = false;
+    autoFrame = false;
+    pathTime = 0.0;
+    windowFirst = 0;
+    windowLast = cameras.size();
+
+    uploadedInstances = 0;
+    updatedBegin = updatedEnd = 0;
+    tagsUploaded = 0;
+    tagsChanged = 0;
+    edgesUploaded = 0;
+    mappedUploaded = 0;
+    sceneVersion++;
+    reshapeCB(width, height);
+};
+
+/**
+ * @brief exchanges all state with obj
+ * @param obj viewer to swap with
+ * @action GL objects belong to the context they were made in, so they
+ *         move together with the window / offscreen context. live updates
+ *         still queued in obj are moved over and applied here. the frame
+ *         profiler stays, only its timer queries move with the context
+ */
+void TagViewer::swapState(TagViewer & obj){
+    swap(worldCamera, obj.worldCamera);
+    swap(cameras, obj.cameras);
+    swap(cameraIds, obj.cameraIds);
+    swap(updatedBegin, obj.updatedBegin);
+    swap(updatedEnd, obj.updatedEnd);
+    swap(octree, obj.octree);
+    swap(sceneVersion, obj.sceneVersion);
+    PoseUpdate update;
+    while(obj.poseUpdates.pop(update)){
+        poseUpdates.push(update);
+    }
+
+    swap(width, obj.width);
+    swap(height, obj.height);
+    swap(mouseDown, obj.mouseDown);
+    swap(mouseId, obj.mouseId);
+    swap(mouse_x, obj.mouse_x);
+    swap(mouse_y, obj.mouse_y);
+    swap(press_x, obj.press_x);
+    swap(press_y, obj.press_y);
+    swap(hovered, obj.hovered);
+    swap(selected, obj.selected);
+
+    swap(tags, obj.tags);
+    swap(tagIds, obj.tagIds);
+    swap(tagsUploaded, obj.tagsUploaded);
+    swap(tagsChanged, obj.tagsChanged);
+    swap(orbitTag, obj.orbitTag);
+    swap(orbitTagId, obj.orbitTagId);
+    swap(observations, obj.observations);
+    swap(edgesUploaded, obj.edgesUploaded);
+    swap(showObservations, obj.showObservations);
+
+    swap(frustumProgram, obj.frustumProgram);
+    swap(pyramidVBO, obj.pyramidVBO);
+    swap(lineVBO, obj.lineVBO);
+    swap(squareVBO, obj.squareVBO);
+    swap(instanceVBO, obj.instanceVBO);
+    swap(instanceCapacity, obj.instanceCapacity);
+    swap(uploadedInstances, obj.uploadedInstances);
+    swap(drawCalls, obj.drawCalls);
+    swap(poseTexture, obj.poseTexture);
+    swap(poseProgram, obj.poseProgram);
+    swap(tagVBO, obj.tagVBO);
+    swap(tagCapacity, obj.tagCapacity);
+    swap(tagTexture, obj.tagTexture);
+    swap(edgeProgram, obj.edgeProgram);
+    swap(edgeVBO, obj.edgeVBO);
+    swap(edgeCapacity, obj.edgeCapacity);
+
+    swap(viewports, obj.viewports);
+    swap(activeViewport, obj.activeViewport);
+    swap(pyramidPixels, obj.pyramidPixels);
+    swap(clusterPixels, obj.clusterPixels);
+
+    swap(window, obj.window);
+    swap(offscreen, obj.offscreen);
+    profiler.swapGL(obj.profiler);
+    // close events find the viewer through its window
+    int current = window || obj.window ? glutGetWindow() : 0;
+    if(window){
+        glutSetWindow(window);
+        glutSetWindowData(this);
+    }
+    if(obj.window){
+        glutSetWindow(obj.window);
+        glutSetWindowData(&obj);
+    }
+    if(current){
+        glutSetWindow(current);
+    }
+    running = obj.running.exchange(running);
+    dirty = obj.dirty.exchange(dirty);
+    swap(redisplayPosted, obj.redisplayPosted);
+    swap(vsync, obj.vsync);
+    swap(minFrameInterval, obj.minFrameInterval);
+    swap(lastFrameTime, obj.lastFrameTime);
+    swap(wakePipe, obj.wakePipe);
+    swap(showStats, obj.showStats);
+
+    swap(playback, obj.playback);
+    swap(playing, obj.playing);
+    swap(playTime, obj.playTime);
+    swap(playWindow, obj.playWindow);
+    swap(playSpeed, obj.playSpeed);
+    swap(lastTick, obj.lastTick);
+    swap(loader, obj.loader);
+    swap(loadChunk, obj.loadChunk);
+    swap(loadOffset, obj.loadOffset);
+    swap(loadedPoses, obj.loadedPoses);
+    swap(loadBounds, obj.loadBounds);
+    swap(autoFrame, obj.autoFrame);
+    // loader / server threads wake whichever viewer owns them now
+    if(loader){
+        loader->setNotify(notifyDirty, this);
+    }
+    if(obj.loader){
+        obj.loader->setNotify(notifyDirty, &obj);
+    }
+    swap(server, obj.server);
+    swap(serverUpdates, obj.serverUpdates);
+    swap(serverOffset, obj.serverOffset);
+    if(server){
+        server->setNotify(notifyDirty, this);
+    }
+    if(obj.server){
+        obj.server->setNotify(notifyDirty, &obj);
+    }
+    swap(sessionLog, obj.sessionLog);
+    swap(logMuted, obj.logMuted);
+    swap(replay, obj.replay);
+    swap(replaySpeed, obj.replaySpeed);
+    swap(replayClock, obj.replayClock);
+    swap(replayTick, obj.replayTick);
+    swap(replayWait, obj.replayWait);
+    swap(replayBatch, obj.replayBatch);
+    swap(recorder, obj.recorder);
+    swap(cameraPath, obj.cameraPath);
+    swap(pathPlaying, obj.pathPlaying);
+    swap(pathTime, obj.pathTime);
+    swap(pathTick, obj.pathTick);
+    swap(showTrajectory, obj.showTrajectory);
+    swap(windowFirst, obj.windowFirst);
+    swap(windowLast, obj.windowLast);
+
+    swap(poseFile, obj.poseFile);
+    swap(mappedVBO, obj.mappedVBO);
+    swap(mappedUploaded, obj.mappedUploaded);
+    swap(poseTree, obj.poseTree);
+    swap(treeCache, obj.treeCache);
+    swap(treeVBOs, obj.treeVBOs);
+    swap(treeMemory, obj.treeMemory);
+    swap(treeErrorPixels, obj.treeErrorPixels);
+    if(treeCache){
+        treeCache->setNotify(notifyDirty, this);
+    }
+    if(obj.treeCache){
+        obj.treeCache->setNotify(notifyDirty, &obj);
+    }
+    swap(cameraImages, obj.cameraImages);
+    swap(imageCount, obj.imageCount);
+    swap(thumbnailCache, obj.thumbnailCache);
+    swap(thumbnailTexture, obj.thumbnailTexture);
+    swap(thumbnailProgram, obj.thumbnailProgram);
+    swap(atlasColumns, obj.atlasColumns);
+    swap(thumbnailMemory, obj.thumbnailMemory);
+    swap(thumbnailPixels, obj.thumbnailPixels);
+    swap(showThumbnails, obj.showThumbnails);
+    if(thumbnailCache){
+        thumbnailCache->setNotify(notifyDirty, this);
+    }
+    if(obj.thumbnailCache){
+        obj.thumbnailCache->setNotify(notifyDirty, &obj);
+    }
+    swap(reference, obj.reference);
+    swap(referenceVBO, obj.referenceVBO);
+    swap(referenceUploaded, obj.referenceUploaded);
+    swap(cameraErrors, obj.cameraErrors);
+    swap(errorVBO, obj.errorVBO);
+    swap(errorTexture, obj.errorTexture);
+    swap(errorsUploaded, obj.errorsUploaded);
+    swap(errorRange, obj.errorRange);
+    swap(errorRmse, obj.errorRmse);
+    swap(showErrors, obj.showErrors);
+};
+
+/**
+ * @brief copy on write access to the octree
+ * @return octree owned by this viewer only, cloned if it was shared
+ */
+CameraOctree & TagViewer::writableOctree(){
+    if(octree.use_count() > 1){
+        octree = make_shared<CameraOctree>(*octree);
+    }
+    return *octree;
+};
+
+/**
+ * @brief adds camera node to scene.
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @action adds camera to pose store used for drawing camera frustum in
+ *         scene
+ */
+void TagViewer::addCamera(double * position, double * rotation){
+    logUpdate(PoseUpdate::CAMERA_APPEND, 0, position, rotation);
+    // GPU instance is packed here once. uploaded on next draw
+    size_t index = cameras.add(position, rotation);
+    writableOctree().insert((uint32_t)index, position);
+    sceneVersion++;
+    markDirty();
+};
+
+/**
+ * @brief adds batch of camera nodes to scene.
+ * @param positions double array of size n*3 representing x,y,z
+ * @param rotations double array of size n*4 representing x,y,z,w
+ * @param n number of cameras
+ * @param timestamps double array of size n, or NULL
+ * @action appends all cameras to the pose store in one pass and indexes
+ *         them in the octree
+ */
+void TagViewer::addCameras(const double * positions, const double * rotations,
+                           size_t n, const double * timestamps){
+    if(sessionLog && !logMuted){
+        for(size_t i = 0; i < n; i++){
+            logUpdate(PoseUpdate::CAMERA_APPEND, 0, positions + 3 * i,
+                      rotations + 4 * i, timestamps ? timestamps[i] : NAN);
+        }
+    }
+    size_t first = cameras.size();
+    cameras.add(positions, rotations, n, timestamps);
+    writableOctree().insert((uint32_t)first, positions, n);
+    sceneVersion++;
+    markDirty();
+};
+
+/**
+ * @brief loads cameras from pose file
+ * @param path binary pose file or TUM / CSV text file
+ * @return number of cameras added
+ * @action parses on loader thread while chunks are added here. storage is
+ *         reserved from the expected count so cameras is not reallocated
+ */
+size_t TagViewer::loadPoses(const char * path){
+    PoseLoader loader;
+    if(!loader.open(path)){
+        return 0;
+    }
+    cameras.reserve(cameras.size() + loader.expectedCount());
+
+    size_t loaded = 0;
+    PoseChunk chunk;
+    while(loader.nextChunk(chunk)){
+        addCameras(&chunk.positions[0], &chunk.rotations[0], chunk.size(),
+                   chunk.timestamps.empty() ? NULL : &chunk.timestamps[0]);
+        loaded += chunk.size();
+    }
+    if(loader.failed()){
+        cerr << "TagViewer: error while loading " << path << endl;
+    }
+    return loaded;
+};
+
+/**
+ * @brief starts loading pose file in the background
+ * @param path binary pose file or TUM / CSV text file
+ * @return false if the file cannot be opened
+ * @action chunks parsed by the loader thread are added by drawScene, at
+ *         most LOAD_FRAME_SECONDS per frame, and the world camera frames
+ *         them until the user moves it. a running load is stopped first
+ */
+bool TagViewer::streamPoses(const char * path){
+    delete loader;
+    loader = new PoseLoader();
+    loadChunk.clear();
+    loadOffset = 0;
+    loadedPoses = 0;
+    if(!loader->open(path)){
+        delete loader;
+        loader = 0;
+        return false;
+    }
+    cameras.reserve(cameras.size() + loader->expectedCount());
+    loader->setNotify(notifyDirty, this);
+    autoFrame = true;
+    markDirty();
+    return true;
+};
+
+/**
+ * @brief fraction of the streamed pose file read so far
+ */
+double TagViewer::loadProgress() const{
+    return loader ? loader->progress() : 1.0;
+};
+
+/**
+ * @brief wakes the render loop when the loader / pose server has new poses
+ * @param viewer TagViewer owning the loader / server
+ */
+void TagViewer::notifyDirty(void * viewer){
+    ((TagViewer *)viewer)->markDirty();
+};
+
+/**
+ * @brief adds parsed chunks of the streamed pose file
+ * @param wait add the whole file, blocking for the loader (snapshots)
+ * @action without wait, batches of LOAD_BATCH poses are added until
+ *         LOAD_FRAME_SECONDS are used up, so input stays responsive. what
+ *         is left of a chunk is added next frame
+ */
+void TagViewer::applyLoadedPoses(bool wait){
+    if(!loader){
+        return;
+    }
+    double start = now();
+    bool added = false;
+    while(wait || now() - start < LOAD_FRAME_SECONDS){
+        if(loadOffset >= loadChunk.size()){
+            loadChunk.clear();
+            loadOffset = 0;
+            if(!(wait ? loader->nextChunk(loadChunk)
+                      : loader->pollChunk(loadChunk))){
+                break;
+            }
+        }
+        size_t n = min((size_t)LOAD_BATCH, loadChunk.size() - loadOffset);
+        const double * positions = &loadChunk.positions[3 * loadOffset];
+        addCameras(positions, &loadChunk.rotations[4 * loadOffset], n,
+                   loadChunk.timestamps.empty() ? NULL :
+                   &loadChunk.timestamps[loadOffset]);
+        for(size_t i = 0; i < n; i++){
+            for(int k = 0; k < 3; k++){
+                double v = positions[3 * i + k];
+                if(loadedPoses + i == 0 || v < loadBounds[k]){
+                    loadBounds[k] = v;
+                }
+                if(loadedPoses + i == 0 || v > loadBounds[k + 3]){
+                    loadBounds[k + 3] = v;
+                }
+            }
+        }
+        loadOffset += n;
+        loadedPoses += n;
+        added = true;
+    }
+    if(added && autoFrame){
+        frameLoadedPoses();
+    }
+    if(loadOffset < loadChunk.size()){
+        // budget used up, rest of the chunk next frame
+        markDirty();
+    } else if(loader->done()){
+        if(loader->failed()){
+            cerr << "TagViewer: error while loading poses" << endl;
+        }
+        cout << "loaded " << loadedPoses << " poses" << endl;
+        delete loader;
+        loader = 0;
+        loadChunk.clear();
+        loadOffset = 0;
+    }
+};
+
+/**
+ * @brief points every viewport camera at the streamed cameras
+ * @action targets the center of their bounds at a distance where the
+ *         bounding sphere fits the narrower field of view
+ */
+void TagViewer::frameLoadedPoses(){
+    double center[3];
+    double diagonal = 0.0;
+    for(int k = 0; k < 3; k++){
+        center[k] = 0.5 * (loadBounds[k] + loadBounds[k + 3]);
+        double extent = loadBounds[k + 3] - loadBounds[k];
+        diagonal += extent * extent;
+    }
+    double radius = 0.5 * sqrt(diagonal) + CAMERA_RADIUS;
+    // the orbit tag would pull the target back on its next move
+    orbitTag = false;
+    for(size_t v = 0; v < viewports.size(); v++){
+        WorldCamera & camera = viewportCamera(v);
+        double halfY = camera.getFOVY() * 0.5 * PI / 180.0;
+        double halfX = atan(tan(halfY) * camera.getAspect());
+        copy(center, center+3, camera.target);
+        camera.distance = radius / sin(min(halfX, halfY));
+        // large scenes would end at the default far plane
+        camera.setFar(max(camera.getFar(), camera.distance + 2.0 * radius));
+    }
+    markDirty();
+};
+
+/**
+ * @brief queues camera append from any thread
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @return false if the feed queue is full (update dropped)
+ */
+bool TagViewer::pushCamera(const double * position, const double * rotation){
+    PoseUpdate update;
+    update.type = PoseUpdate::CAMERA_APPEND;
+    update.id = 0;
+    copy(position, position+3, update.position);
+    copy(rotation, rotation+4, update.rotation);
+    update.time = NAN;
+    if(!poseUpdates.push(update)){
+        return false;
+    }
+    markDirty();
+    return true;
+};
+
+/**
+ * @brief queues camera insert / update by id from any thread
+ * @param id caller chosen camera id. a known id moves that camera
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @return false if the feed queue is full (update dropped)
+ */
+bool TagViewer::pushCamera(uint64_t id, const double * position,
+                           const double * rotation){
+    PoseUpdate update;
+    update.type = PoseUpdate::CAMERA_UPSERT;
+    update.id = id;
+    copy(position, position+3, update.position);
+    copy(rotation, rotation+4, update.rotation);
+    update.time = NAN;
+    if(!poseUpdates.push(update)){
+        return false;
+    }
+    markDirty();
+    return true;
+};
+
+/**
+ * @brief queues tag origin change from any thread
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @return false if the feed queue is full (update dropped)
+ */
+bool TagViewer::pushTagOrigin(const double * position,
+                              const double * rotation){
+    PoseUpdate update;
+    update.type = PoseUpdate::TAG_ORIGIN;
+    update.id = 0;
+    copy(position, position+3, update.position);
+    copy(rotation, rotation+4, update.rotation);
+    update.time = NAN;
+    if(!poseUpdates.push(update)){
+        return false;
+    }
+    markDirty();
+    return true;
+};
+
+/**
+ * @brief queues tag insert / update by id from any thread
+ * @param id tag id. a known id moves that tag
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @return false if the feed queue is full (update dropped)
+ */
+bool TagViewer::pushTag(uint64_t id, const double * position,
+                        const double * rotation){
+    PoseUpdate update;
+    update.type = PoseUpdate::TAG_UPSERT;
+    update.id = id;
+    copy(position, position+3, update.position);
+    copy(rotation, rotation+4, update.rotation);
+    update.time = NAN;
+    if(!poseUpdates.push(update)){
+        return false;
+    }
+    markDirty();
+    return true;
+};
+
+/**
+ * @brief accepts the live feed on a socket
+ * @param address "unix:PATH" or "[HOST:]PORT" (see PoseServer.h)
+ * @return false if address could not be listened on
+ * @action replaces a running server. the server thread wakes the render
+ *         loop whenever a batch arrives
+ */
+bool TagViewer::startServer(const char * address){
+    stopServer();
+    server = new PoseServer();
+    if(!server->start(address)){
+        delete server;
+        server = 0;
+        return false;
+    }
+    server->setNotify(notifyDirty, this);
+    return true;
+};
+
+/**
+ * @brief closes the feed socket and all its connections
+ * @action updates received but not applied yet are dropped
+ */
+void TagViewer::stopServer(){
+    delete server;
+    server = 0;
+    serverUpdates.clear();
+    serverOffset = 0;
+};
+
+/**
+ * @brief removes all cameras
+ * @action tags stay. the octree starts over, so a copy sharing the old one
+ *         keeps it untouched. camera images and errors go with their
+ *         cameras, the reference stays
+ */
+void TagViewer::clearCameras(){
+    logUpdate(PoseUpdate::CAMERA_CLEAR, 0, 0, 0);
+    cameras.clear();
+    cameraIds.clear();
+    octree = make_shared<CameraOctree>();
+    observations.clear();
+    edgesUploaded = 0;
+    clearCameraImages();
+    cameraErrors.clear();
+    errorsUploaded = false;
+    hovered = NO_CAMERA;
+    selected = NO_CAMERA;
+    playTime = NAN;
+    windowFirst = 0;
+    windowLast = 0;
+    uploadedInstances = 0;
+    updatedBegin = updatedEnd = 0;
+    sceneVersion++;
+    markDirty();
+};
+
+/**
+ * @brief applies live feed updates on the render thread
+ * @action socket batches are applied LOAD_BATCH updates at a time until
+ *         LOAD_FRAME_SECONDS are used up, the rest waits for the next
+ *         frame while the server holds back further reads. in process
+ *         updates are applied up to one queue worth per frame, so a busy
+ *         producer cannot stall rendering
+ */
+void TagViewer::applyPoseUpdates(){
+    double start = now();
+    while(server){
+        if(serverOffset == serverUpdates.size()){
+            serverOffset = 0;
+            if(!server->take(serverUpdates)){
+                break;
+            }
+        }
+        size_t n = min((size_t)LOAD_BATCH, serverUpdates.size() - serverOffset);
+        applyUpdates(&serverUpdates[serverOffset], n);
+        serverOffset += n;
+        if(now() - start > LOAD_FRAME_SECONDS){
+            if(serverOffset < serverUpdates.size()){
+                markDirty();
+            }
+            break;
+        }
+    }
+
+    vector<PoseUpdate> queued;
+    PoseUpdate update;
+    for(size_t n = 0; n < poseUpdates.capacity() && poseUpdates.pop(update);
+        n++){
+        queued.push_back(update);
+    }
+    if(!queued.empty()){
+        applyUpdates(&queued[0], queued.size());
+    }
+};
+
+/**
+ * @brief applies live feed updates in order
+ * @param updates camera / tag updates
+ * @param n number of updates
+ * @action appends are collected and added as one batch. updates of known
+ *         ids rewrite the pose in place and widen the range re-uploaded
+ *         next frame. a clear drops the appends collected before it.
+ *         poses with NaN / infinite components are dropped before they are
+ *         logged
+ */
+void TagViewer::applyUpdates(const PoseUpdate * updates, size_t n){
+    vector<double> positions;
+    vector<double> rotations;
+    vector<double> times;
+    // logged here as sent, not as the calls they turn into
+    bool muted = logMuted;
+    logMuted = true;
+    size_t dropped = 0;
+    for(size_t u = 0; u < n; u++){
+        const PoseUpdate & update = updates[u];
+        bool finite = true;
+        for(int k = 0; k < 3; k++){
+            finite = finite && isfinite(update.position[k]);
+        }
+        for(int k = 0; k < 4; k++){
+            finite = finite && isfinite(update.rotation[k]);
+        }
+        if(!finite){
+            dropped++;
+            continue;
+        }
+        if(sessionLog && !muted){
+            sessionLog->write(update);
+        }
+        if(update.type == PoseUpdate::CAMERA_CLEAR){
+            positions.clear();
+            rotations.clear();
+            times.clear();
+            clearCameras();
+            continue;
+        }
+        if(update.type == PoseUpdate::TAG_ORIGIN){
+            double position[3], rotation[4];
+            copy(update.position, update.position+3, position);
+            copy(update.rotation, update.rotation+4, rotation);
+            setTagOrigin(position, rotation);
+            continue;
+        }
+        if(update.type == PoseUpdate::TAG_UPSERT){
+            setTag(update.id, update.position, update.rotation);
+            continue;
+        }
+        if(update.type == PoseUpdate::CAMERA_UPSERT){
+            unordered_map<uint64_t, size_t>::iterator it =
+                cameraIds.find(update.id);
+            if(it != cameraIds.end()){
+                size_t index = it->second;
+                if(index < cameras.size()){
+                    writableOctree().move((uint32_t)index,
+                                          cameras.position(index),
+                                          update.position);
+                    sceneVersion++;
+                    cameras.set(index, update.position, update.rotation);
+                    if(updatedBegin == updatedEnd){
+                        updatedBegin = index;
+                        updatedEnd = index + 1;
+                    } else {
+                        updatedBegin = min(updatedBegin, index);
+                        updatedEnd = max(updatedEnd, index + 1);
+                    }
+                } else {
+                    // appended earlier in this batch, not in the store yet
+                    size_t pending = index - cameras.size();
+                    copy(update.position, update.position+3,
+                         &positions[3 * pending]);
+                    copy(update.rotation, update.rotation+4,
+                         &rotations[4 * pending]);
+                }
+                continue;
+            }
+            cameraIds[update.id] = cameras.size() + positions.size() / 3;
+        }
+        positions.insert(positions.end(), update.position,
+                         update.position + 3);
+        rotations.insert(rotations.end(), update.rotation,
+                         update.rotation + 4);
+        times.push_back(update.time);
+    }
+    if(!positions.empty()){
+        addCameras(&positions[0], &rotations[0], positions.size() / 3,
+                   &times[0]);
+    }
+    logMuted = muted;
+    if(dropped){
+        cerr << "TagViewer: dropped " << dropped
+             << " updates with non-finite poses" << endl;
+    }
+};
+
+/**
+ * @brief writes one update to the session log
+ * @param type PoseUpdate type
+ * @param id camera / tag id for id updates
+ * @param position x,y,z or 0 for a clear
+ * @param rotation x,y,z,w or 0 for a clear
+ * @param time timestamp of an added camera, NaN for none
+ * @action nothing while not logging or muted
+ */
+void TagViewer::logUpdate(uint32_t type, uint64_t id, const double * position,
+                          const double * rotation, double time){
+    if(!sessionLog || logMuted){
+        return;
+    }
+    PoseUpdate update;
+    memset(&update, 0, sizeof(update));
+    update.type = type;
+    update.id = id;
+    update.time = time;
+    if(position){
+        copy(position, position+3, update.position);
+        copy(rotation, rotation+4, update.rotation);
+    }
+    sessionLog->write(update);
+};
+
+/**
+ * @brief writes the whole scene to the session log as a keyframe
+ * @action tags in index order, then cameras in store order with their ids
+ *         and timestamps. seekReplay starts from the last keyframe instead
+ *         of the start of the log
+ */
+void TagViewer::logKeyframe(){
+    sessionLog->beginKeyframe();
+    PoseUpdate update;
+    memset(&update, 0, sizeof(update));
+
+    vector<uint64_t> ids(tags.size());
+    for(unordered_map<uint64_t, size_t>::const_iterator it = tagIds.begin();
+        it != tagIds.end(); ++it){
+        ids[it->second] = it->first;
+    }
+    update.time = NAN;
+    for(size_t i = 0; i < tags.size(); i++){
+        update.type = (ids[i] == TAG_ORIGIN_ID) ? PoseUpdate::TAG_ORIGIN
+                                                : PoseUpdate::TAG_UPSERT;
+        update.id = ids[i];
+        copy(tags.position(i), tags.position(i)+3, update.position);
+        copy(tags.rotation(i), tags.rotation(i)+4, update.rotation);
+        sessionLog->write(update);
+    }
+
+    // cameras without id were appended
+    ids.assign(cameras.size(), 0);
+    vector<bool> hasId(cameras.size(), false);
+    for(unordered_map<uint64_t, size_t>::const_iterator it = cameraIds.begin();
+        it != cameraIds.end(); ++it){
+        if(it->second < cameras.size()){
+            ids[it->second] = it->first;
+            hasId[it->second] = true;
+        }
+    }
+    for(size_t i = 0; i < cameras.size(); i++){
+        update.type = hasId[i] ? PoseUpdate::CAMERA_UPSERT
+                               : PoseUpdate::CAMERA_APPEND;
+        update.id = ids[i];
+        copy(cameras.position(i), cameras.position(i)+3, update.position);
+        copy(cameras.rotation(i), cameras.rotation(i)+4, update.rotation);
+        update.time = cameras.timestamp(i);
+        sessionLog->write(update);
+    }
+    sessionLog->endKeyframe();
+};
+
+/**
+ * @brief starts logging camera / tag updates
+ * @param path session log to create (see SessionLog.h)
+ * @return false if the log could not be created
+ * @action the scene so far is not logged, start before loading it
+ */
+bool TagViewer::startSessionLog(const char * path){
+    stopSessionLog();
+    sessionLog = new SessionWriter();
+    if(!sessionLog->open(path)){
+        delete sessionLog;
+        sessionLog = 0;
+        return false;
+    }
+    return true;
 };
 
 /**
- * @brief assignment operator
- * @action Copy constructor using assignment = operator
+ * @brief closes the session log
+ * @return false if a write failed
+ */
+bool TagViewer::stopSessionLog(){
+    if(!sessionLog){
+        return true;
+    }
+    bool ok = sessionLog->close();
+    cout << "logged " << sessionLog->events() << " updates ("
+         << sessionLog->bytes() << " bytes)" << endl;
+    delete sessionLog;
+    sessionLog = 0;
+    return ok;
+};
+
+/**
+ * @brief replays a session log
+ * @param path log written by startSessionLog
+ * @param speed session seconds per second, 0 for as fast as possible
+ * @return false if path is not a session log
+ * @action clears cameras and tags, events are then applied per frame as
+ *         their session time comes up (see applyReplay)
+ */
+bool TagViewer::replaySession(const char * path, double speed){
+    SessionReader * log = new SessionReader();
+    if(!log->open(path)){
+        delete log;
+        return false;
+    }
+    delete replay;
+    replay = log;
+    replaySpeed = max(speed, 0.0);
+    bool muted = logMuted;
+    logMuted = true;
+    clearCameras();
+    clearTags();
+    logMuted = muted;
+    replayClock = 0.0;
+    replayTick = now();
+    markDirty();
+    return true;
+};
+
+/**
+ * @brief length of the replayed session in ms, 0 when not replaying
+ */
+double TagViewer::replayDuration() const{
+    return replay ? replay->duration() / 1000.0 : 0.0;
+};
+
+/**
+ * @brief jumps to a point of the replayed session
+ * @param ms session time, clamped to the log
+ * @action events up to ms are applied right away. going back, or forward
+ *         past a keyframe, clears the scene and applies the last keyframe
+ *         before ms and the events after it (the log from its start if
+ *         there is none). otherwise only the events in between are applied
+ */
+void TagViewer::seekReplay(double ms){
+    if(!replay){
+        return;
+    }
+    double micros = max(0.0, min(ms, replayDuration())) * 1000.0;
+    uint64_t keyframe;
+    bool haveKeyframe = replay->keyframeTime((uint64_t)micros, keyframe);
+    if(micros < replayClock || (haveKeyframe && keyframe > replayClock)){
+        bool muted = logMuted;
+        logMuted = true;
+        clearCameras();
+        clearTags();
+        logMuted = muted;
+        if(!haveKeyframe || !replay->seekKeyframe((uint64_t)micros)){
+            replay->seek(0);
+        }
+    }
+    applyReplay(micros, false);
+    replayClock = micros;
+    replayTick = now();
+    markDirty();
+};
+
+/**
+ * @brief applies replayed events up to a session time
+ * @param until session time in microseconds, INFINITY for the whole log
+ * @param budgeted stop after LOAD_FRAME_SECONDS and continue next frame
+ * @action events go through the live feed path in LOAD_BATCH batches. a
+ *         replay as fast as possible moves replayClock along with them
+ */
+void TagViewer::applyReplay(double until, bool budgeted){
+    double start = now();
+    uint64_t micros;
+    while(replay->peek(micros) && micros <= until){
+        replayBatch.clear();
+        PoseUpdate update;
+        while(replayBatch.size() < LOAD_BATCH && replay->peek(micros) &&
+              micros <= until){
+            replay->next(update, micros);
+            replayBatch.push_back(update);
+        }
+        applyUpdates(&replayBatch[0], replayBatch.size());
+        if(replaySpeed <= 0.0){
+            replayClock = max(replayClock, (double)micros);
+        }
+        if(budgeted && now() - start > LOAD_FRAME_SECONDS){
+            markDirty();
+            break;
+        }
+    }
+};
+
+/**
+ * @brief removes all tags
+ * @action observation edges point at tag indices, so they go too
+ */
+void TagViewer::clearTags(){
+    tags.clear();
+    tagIds.clear();
+    tagsUploaded = 0;
+    tagsChanged = 0;
+    orbitTag = false;
+    observations.clear();
+    edgesUploaded = 0;
+    markDirty();
+};
+
+/**
+ * @brief finds the cameras of the current time window
+ * @action two binary searches over the time sorted store. cameras are
+ *         sorted first if they arrived out of order
+ */
+void TagViewer::updateTimeWindow(){
+    double begin, end;
+    if(!playback || !timeRange(begin, end)){
+        windowFirst = 0;
+        windowLast = cameras.size();
+        return;
+    }
+    if(!cameras.sortedByTime()){
+        sortCamerasByTime();
+    }
+    if(isnan(playTime)){
+        playTime = begin;
+    }
+    windowLast = cameras.upperBound(playTime);
+    windowFirst = (playWindow > 0.0) ? cameras.lowerBound(playTime - playWindow)
+                                     : 0;
+    windowFirst = min(windowFirst, windowLast);
+};
+
+/**
+ * @brief reorders cameras by timestamp
+ * @action indices change, so live feed ids, hovered / selected cameras,
+ *         camera images / errors and the octree follow and all instances are
+ *         uploaded again. thumbnails are decoded again under the new
+ *         indices
+ */
+void TagViewer::sortCamerasByTime(){
+    vector<size_t> order;
+    cameras.sortByTime(order);
+    vector<size_t> moved(order.size());
+    for(size_t i = 0; i < order.size(); i++){
+        moved[order[i]] = i;
+    }
+    for(unordered_map<uint64_t, size_t>::iterator it = cameraIds.begin();
+        it != cameraIds.end(); ++it){
+        it->second = moved[it->second];
+    }
+    if(hovered < moved.size()){
+        hovered = moved[hovered];
+    }
+    if(selected < moved.size()){
+        selected = moved[selected];
+    }
+    observations.remapCameras(moved);
+    edgesUploaded = 0;
+    if(imageCount > 0){
+        // images of cameras still to come keep their index
+        cameraImages.resize(max(cameraImages.size(), order.size()));
+        vector<string> images(order.size());
+        for(size_t i = 0; i < order.size(); i++){
+            images[i].swap(cameraImages[order[i]]);
+        }
+        for(size_t i = 0; i < order.size(); i++){
+            cameraImages[i].swap(images[i]);
+        }
+        releaseThumbnails();
+    }
+    if(!cameraErrors.empty()){
+        // cameras added after the comparison have no error
+        cameraErrors.resize(order.size(), -1.0f);
+        vector<float> errors(order.size());
+        for(size_t i = 0; i < order.size(); i++){
+            errors[i] = cameraErrors[order[i]];
+        }
+        cameraErrors.swap(errors);
+        errorsUploaded = false;
+    }
+    // fresh tree, so one shared with a copied viewer is not cloned first
+    octree = make_shared<CameraOctree>();
+    for(size_t i = 0; i < cameras.size(); i += cameras.contiguous(i)){
+        octree->insert((uint32_t)i, cameras.position(i),
+                       cameras.contiguous(i));
+    }
+    uploadedInstances = 0;
+    updatedBegin = updatedEnd = 0;
+    sceneVersion++;
+};
+
+/**
+ * @brief maps pose file and renders it without copying into cameras
+ * @param path pose file written by PoseFile::write
+ * @return true if file was mapped
+ * @action replaces any previously mapped file. tags of the tag table are
+ *         added by id and the first one becomes the orbit target
+ */
+bool TagViewer::openPoseFile(const char * path){
+    PoseFile * file = new PoseFile();
+    if(!file->open(path)){
+        delete file;
+        return false;
+    }
+    poseFile.reset(file);
+    mappedUploaded = 0;
+    markDirty();
+
+    for(size_t i = 0; i < poseFile->tagCount(); i++){
+        const PoseFileTag & tag = poseFile->tag(i);
+        double position[3] = {tag.position[0], tag.position[1],
+                              tag.position[2]};
+        double rotation[4] = {tag.rotation[0], tag.rotation[1],
+                              tag.rotation[2], tag.rotation[3]};
+        setTag(tag.id, position, rotation);
+    }
+    if(poseFile->tagCount()){
+        setOrbitTarget(poseFile->tag(0).id);
+    }
+    return true;
+};
+
+/**
+ * @brief opens pose tree and pages it in as the views need it
+ * @param path pose tree written by PoseTree::pack
+ * @return true if file was opened
+ * @action replaces any previously opened tree and frames its bounds like
+ *         a streamed file. paging starts with the first frame, so forked
+ *         headless workers each run their own I/O threads
+ */
+bool TagViewer::openPoseTree(const char * path){
+    PoseTree * tree = new PoseTree();
+    if(!tree->open(path)){
+        delete tree;
+        return false;
+    }
+    releaseTree();
+    poseTree.reset(tree);
+    markDirty();
+    for(int k = 0; k < 3; k++){
+        loadBounds[k] = tree->boundsMin()[k];
+        loadBounds[k + 3] = tree->boundsMax()[k];
+    }
+    frameLoadedPoses();
+    return true;
+};
+
+/**
+ * @brief sets pose tree paging budget
+ * @param memoryBytes bytes of node records kept resident
+ * @param errorPixels nodes are refined while the spacing of their samples
+ *        projects to more than this many pixels
+ */
+void TagViewer::setTreeBudget(size_t memoryBytes, double errorPixels){
+    treeMemory = memoryBytes;
+    treeErrorPixels = errorPixels;
+    if(treeCache){
+        treeCache->setCapacity(memoryBytes);
+    }
+    markDirty();
+};
+
+/**
+ * @brief starts paging poseTree with the current budget
+ */
+void TagViewer::startTreeCache(){
+    treeCache = new PoseTreeCache();
+    treeCache->start(poseTree, treeMemory);
+    treeCache->setNotify(notifyDirty, this);
+    treeVBOs.assign(poseTree->nodeCount(), 0);
+};
+
+/**
+ * @brief stops paging and frees the buffers of resident nodes
+ */
+void TagViewer::releaseTree(){
+    delete treeCache;
+    treeCache = 0;
+    for(size_t i = 0; i < treeVBOs.size(); i++){
+        if(treeVBOs[i]){
+            glDeleteBuffers(1, &treeVBOs[i]);
+        }
+    }
+    treeVBOs.clear();
+    for(size_t v = 0; v < viewports.size(); v++){
+        viewports[v].treeNodes.clear();
+        viewports[v].treePoints.clear();
+    }
+    poseTree.reset();
+};
+
+/**
+ * @brief sets the image of a camera
+ * @param camera camera index, may be one still to be added
+ * @param path image file, "" to remove
+ * @action replacing an image that may already be in the atlas drops all
+ *         thumbnails, setting new ones keeps them
+ */
+void TagViewer::setCameraImage(size_t camera, const string & path){
+    if(camera >= cameraImages.size()){
+        if(path.empty()){
+            return;
+        }
+        cameraImages.resize(camera + 1);
+    }
+    string & image = cameraImages[camera];
+    if(!image.empty()){
+        imageCount--;
+        releaseThumbnails();
+    }
+    image = path;
+    if(!image.empty()){
+        imageCount++;
+    }
+    markDirty();
+};
+
+/**
+ * @brief removes all camera images and their thumbnails
+ */
+void TagViewer::clearCameraImages(){
+    cameraImages.clear();
+    imageCount = 0;
+    releaseThumbnails();
+    markDirty();
+};
+
+/**
+ * @brief sets thumbnail atlas size and the pyramid size that shows one
+ * @param memoryBytes atlas bytes, 0 disables thumbnails
+ * @param pixels pyramids projected smaller than this stay untextured
+ * @action a new size takes effect with a new atlas, so the current one
+ *         is dropped
+ */
+void TagViewer::setThumbnailBudget(size_t memoryBytes, double pixels){
+    if(memoryBytes != thumbnailMemory){
+        releaseThumbnails();
+    }
+    thumbnailMemory = memoryBytes;
+    thumbnailPixels = pixels;
+    markDirty();
+};
+
+/**
+ * @brief creates the thumbnail atlas and starts decoding
+ * @return false if the budget doesn't fit a single tile
+ * @action the atlas is as square as GL_MAX_TEXTURE_SIZE allows and never
+ *         larger than thumbnailMemory
+ */
+bool TagViewer::startThumbnailCache(){
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    size_t maxTiles = (size_t)max(maxSize, 0) / THUMBNAIL_SIZE;
+    size_t tiles = thumbnailMemory / THUMBNAIL_TILE_BYTES;
+    size_t columns = min((size_t)ceil(sqrt((double)tiles)), maxTiles);
+    size_t rows = columns ? min(tiles / columns, maxTiles) : 0;
+    if(rows == 0){
+        return false;
+    }
+    glGenTextures(1, &thumbnailTexture);
+    glBindTexture(GL_TEXTURE_2D, thumbnailTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
+                 (GLsizei)(columns * THUMBNAIL_SIZE),
+                 (GLsizei)(rows * THUMBNAIL_SIZE), 0, GL_RGB,
+                 GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    atlasColumns = columns;
+    thumbnailCache = new ThumbnailCache();
+    thumbnailCache->start(columns * rows);
+    thumbnailCache->setNotify(notifyDirty, this);
+    return true;
+};
+
+/**
+ * @brief stops decoding and frees the atlas
+ */
+void TagViewer::releaseThumbnails(){
+    delete thumbnailCache;
+    thumbnailCache = 0;
+    if(thumbnailTexture){
+        glDeleteTextures(1, &thumbnailTexture);
+        thumbnailTexture = 0;
+    }
+    atlasColumns = 0;
+    for(size_t v = 0; v < viewports.size(); v++){
+        viewports[v].thumbnails.clear();
+    }
+};
+
+/**
+ * @brief loads the reference trajectory cameras are compared against
+ * @param path binary pose file or TUM / CSV text file
+ * @return number of poses loaded, 0 if the file can't be read
+ * @action replaces the previous reference. errors against it are dropped
+ */
+size_t TagViewer::loadReference(const char * path){
+    clearReference();
+    PoseLoader loader;
+    if(!loader.open(path)){
+        return 0;
+    }
+    reference.reserve(loader.expectedCount());
+    PoseChunk chunk;
+    while(loader.nextChunk(chunk)){
+        reference.add(&chunk.positions[0], &chunk.rotations[0], chunk.size(),
+                      chunk.timestamps.empty() ? NULL : &chunk.timestamps[0]);
+    }
+    if(loader.failed()){
+        cerr << "TagViewer: error while loading " << path << endl;
+    }
+    return reference.size();
+};
+
+/**
+ * @brief removes the reference trajectory and the camera errors
+ */
+void TagViewer::clearReference(){
+    reference.clear();
+    referenceUploaded = false;
+    cameraErrors.clear();
+    errorsUploaded = false;
+    markDirty();
+};
+
+/**
+ * @brief aligns the cameras to the reference and colors them by error
+ * @param mode fit applied to the cameras before comparing
+ * @param maxTimeDifference largest time difference of the pose pairs the
+ *        fit is made from
+ * @param alignment output transform the cameras were moved by
+ * @param errors output per camera errors and ATE / RPE statistics
+ * @return false without reference / cameras or if the fit fails, cameras
+ *         stay where they are then
+ * @action association and errors run on one thread per core. fitted
+ *         cameras get a fresh octree and are uploaded again, their errors
+ *         go to the frustum shader through a texture buffer. cameras moved
+ *         or added later keep their error until the next comparison
+ */
+bool TagViewer::compareToReference(AlignMode mode, double maxTimeDifference,
+                                   Alignment & alignment,
+                                   TrajectoryErrors & errors){
+    if(cameras.empty() || reference.empty()){
+        return false;
+    }
+    int threads = max(1, (int)thread::hardware_concurrency());
+    vector<uint32_t> pairs;
+    associateByTime(cameras, reference, maxTimeDifference, pairs, threads);
+    if(!fitAlignment(cameras, reference, pairs, mode, alignment)){
+        return false;
+    }
+    if(mode != ALIGN_NONE){
+        cameras.transform(alignment.rotation, alignment.translation,
+                          alignment.scale);
+        octree = make_shared<CameraOctree>();
+        for(size_t i = 0; i < cameras.size(); i += cameras.contiguous(i)){
+            octree->insert((uint32_t)i, cameras.position(i),
+                           cameras.contiguous(i));
+        }
+        uploadedInstances = 0;
+        updatedBegin = updatedEnd = 0;
+        sceneVersion++;
+    }
+
+    PointKdTree tree;
+    tree.build(reference, threads);
+    compareTrajectories(cameras, reference, tree, errors, threads);
+    cameraErrors = errors.translation;
+    errorsUploaded = false;
+    errorRmse = errors.ate.rmse;
+    markDirty();
+    return true;
+};
+
+/**
+ * @brief sets the error shown in full red
+ * @param range translation error, 0 for 3x the ATE rmse of the last
+ *        comparison
+ */
+void TagViewer::setErrorRange(double range){
+    errorRange = range;
+    markDirty();
+};
+
+/**
+ * @brief Sets Tag origin
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @action sets tag TAG_ORIGIN_ID and makes it the camera orbit origin
+ */
+void TagViewer::setTagOrigin(double * position, double * rotation){
+    logUpdate(PoseUpdate::TAG_ORIGIN, 0, position, rotation);
+    bool muted = logMuted;
+    logMuted = true;
+    setTag(TAG_ORIGIN_ID, position, rotation);
+    logMuted = muted;
+    setOrbitTarget(TAG_ORIGIN_ID);
+};
+
+/**
+ * @brief inserts or moves tag by id
+ * @param id tag id
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @action one hash lookup. a moved tag is re-uploaded from its index on,
+ *         and the orbit target follows it
+ */
+void TagViewer::setTag(uint64_t id, const double * position,
+                       const double * rotation){
+    logUpdate(PoseUpdate::TAG_UPSERT, id, position, rotation);
+    unordered_map<uint64_t, size_t>::iterator it = tagIds.find(id);
+    if(it == tagIds.end()){
+        tagIds[id] = tags.add(position, rotation);
+    } else {
+        tags.set(it->second, position, rotation);
+        tagsChanged = min(tagsChanged, it->second);
+    }
+    if(orbitTag && orbitTagId == id){
+        for(size_t v = 0; v < viewports.size(); v++){
+            copy(position, position+3, viewportCamera(v).target);
+        }
+    }
+    markDirty();
+};
+
+/**
+ * @brief gets pose of tag id
+ * @param id tag id
+ * @param position output x,y,z
+ * @param rotation output x,y,z,w
+ * @return false if tag id is unknown
+ */
+bool TagViewer::getTagPose(uint64_t id, double * position,
+                           double * rotation) const{
+    unordered_map<uint64_t, size_t>::const_iterator it = tagIds.find(id);
+    if(it == tagIds.end()){
+        return false;
+    }
+    copy(tags.position(it->second), tags.position(it->second) + 3, position);
+    copy(tags.rotation(it->second), tags.rotation(it->second) + 4, rotation);
+    return true;
+};
+
+/**
+ * @brief makes the cameras of all viewports orbit tag id
+ * @param id tag id
+ * @return false if tag id is unknown (target unchanged)
+ */
+bool TagViewer::setOrbitTarget(uint64_t id){
+    unordered_map<uint64_t, size_t>::iterator it = tagIds.find(id);
+    if(it == tagIds.end()){
+        return false;
+    }
+    orbitTag = true;
+    orbitTagId = id;
+    autoFrame = false;
+    const double * position = tags.position(it->second);
+    for(size_t v = 0; v < viewports.size(); v++){
+        copy(position, position+3, viewportCamera(v).target);
+    }
+    markDirty();
+    return true;
+};
+
+/**
+ * @brief adds observation edge from camera to tag
+ * @param camera camera index
+ * @param tagId tag id
+ * @return false if tag id is unknown
+ * @action edges are merged into the graph on the next upload, so adding a
+ *         large batch costs one sort
+ */
+bool TagViewer::addObservation(size_t camera, uint64_t tagId){
+    unordered_map<uint64_t, size_t>::iterator it = tagIds.find(tagId);
+    if(it == tagIds.end()){
+        return false;
+    }
+    observations.add((uint32_t)camera, (uint32_t)it->second);
+    markDirty();
+    return true;
+};
+
+/**
+ * @brief removes all observation edges
+ */
+void TagViewer::clearObservations(){
+    observations.clear();
+    edgesUploaded = 0;
+    markDirty();
+};
+
+/**
+ * @brief number of distinct observation edges
+ * @action merges edges added since the last frame
+ */
+size_t TagViewer::observationCount(){
+    edgesUploaded = min(edgesUploaded, observations.compact());
+    return observations.size();
+};
+
+
+/**
+ * @brief updates world camera position using r, theta, distance
+ * @action sets camera position
+ */
+void TagViewer::updateWorldCameraPosition(){
+    double x = worldCamera.target[0];
+    double y = worldCamera.target[1];
+    double z = worldCamera.target[2];
+    double d = worldCamera.distance;
+    double r = worldCamera.r;
+    double t = worldCamera.theta;
+    
+    worldCamera.position[0] = x + d * cos(r) * cos(t);
+    worldCamera.position[1] = y + d * sin(r);
+    worldCamera.position[2] = z + d * cos(r) * sin(t);
+};
+    
+/**
+ * @brief initializes opengl window
+ * @param argv,argc for glutinit
+ * @action sets up window
+ */
+void TagViewer::initWindow(int & argv, char** argc){
+    // GLUT Window Initialization:
+    glutInit (&argv,argc);
+    glutInitWindowSize (width, height);
+    glutInitDisplayMode ( GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+    window = glutCreateWindow ("Tag Viewer");
+
+    // return from the render loop instead of exiting on window close. the
+    // window is forgotten even if the application sets no close callback
+    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_CONTINUE_EXECUTION);
+    glutSetWindowData(this);
+    glutCloseFunc(windowClosed);
+
+    initGLState();
+    applySwapInterval();
+    markDirty();
+};
+
+/**
+ * @brief initializes windowless GL context for headless rendering
+ * @return true if offscreen context could be created
+ * @action renders into a width x height EGL pbuffer instead of a GLUT
+ *         window. GLUT is never initialized in this mode
+ */
+bool TagViewer::initOffscreen(){
+    OffscreenContext * context = new OffscreenContext();
+    if(!context->create(width, height)){
+        delete context;
+        return false;
+    }
+    delete offscreen;
+    offscreen = context;
+
+    initGLState();
+    reshapeCB(width, height);
+    return true;
+};
+
+/**
+ * @brief makes the window / offscreen context of this viewer current
+ * @return false if there is none
+ */
+bool TagViewer::makeCurrent(){
+    if(window){
+        glutSetWindow(window);
+        return true;
+    }
+    return offscreen && offscreen->makeCurrent();
+};
+
+/**
+ * @brief GLUT close callback of windows made by initWindow
+ * @action the viewer is found through the window data
+ */
+void TagViewer::windowClosed(){
+    TagViewer * viewer = (TagViewer *)glutGetWindowData();
+    if(viewer){
+        viewer->closeCB();
+    }
+};
+
+/**
+ * @brief deletes every GL object of this viewer
+ * @param deleteObjects false if the context is gone, only the names are
+ *        forgotten then
+ * @action streaming caches stop too, as they fill GL objects
+ */
+void TagViewer::releaseGL(bool deleteObjects){
+    if(!deleteObjects){
+        treeVBOs.clear();
+        thumbnailTexture = 0;
+        for(size_t v = 0; v < viewports.size(); v++){
+            viewports[v].visibleVBO = viewports[v].lineIndexVBO = 0;
+            viewports[v].clusterVBO = viewports[v].thumbnailVBO = 0;
+        }
+    }
+    releaseTree();
+    releaseThumbnails();
+    if(deleteObjects){
+        for(size_t v = 0; v < viewports.size(); v++){
+            releaseViewport(viewports[v]);
+        }
+        GLuint buffers[] = {pyramidVBO, lineVBO, squareVBO, instanceVBO,
+                            tagVBO, edgeVBO, mappedVBO, referenceVBO,
+                            errorVBO};
+        glDeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers);
+        GLuint textures[] = {poseTexture, tagTexture, errorTexture};
+        glDeleteTextures(sizeof(textures) / sizeof(textures[0]), textures);
+        glDeleteProgram(frustumProgram);
+        glDeleteProgram(poseProgram);
+        glDeleteProgram(edgeProgram);
+        glDeleteProgram(thumbnailProgram);
+        profiler.releaseGL();
+    }
+    pyramidVBO = lineVBO = squareVBO = instanceVBO = 0;
+    tagVBO = edgeVBO = mappedVBO = referenceVBO = errorVBO = 0;
+    poseTexture = tagTexture = errorTexture = 0;
+    frustumProgram = poseProgram = edgeProgram = thumbnailProgram = 0;
+    instanceCapacity = tagCapacity = edgeCapacity = 0;
+};
+
+/**
+ * @brief renders scene with current world camera and waits for GL
+ * @action all pending pose uploads are finished before drawing so the
+ *         frame is complete. used for headless snapshots / benchmarks
+ */
+void TagViewer::drawFrame(){
+    profiler.beginFrame();
+    finishUploads();
+    drawScene();
+    glFinish();
+    profiler.endFrame();
+};
+
+/**
+ * @brief adds / uploads pending poses, the rest of a streamed pose file and
+ *        all of the mapped pose file
+ * @action offline frames have to be complete, so file poses are not
+ *         spread over several frames
+ */
+void TagViewer::finishUploads(){
+    applyLoadedPoses(true);
+    applyPoseUpdates();
+    uploadInstances();
+    while(poseFile && mappedUploaded < poseFile->count()){
+        uploadMapped();
+    }
+    // page in every pose tree node the views need
+    if(poseTree){
+        cullViewports();
+        uploadTree();
+        while(selectTree() > 0 && treeCache->pending() > 0){
+            treeCache->wait();
+            uploadTree();
+        }
+    }
+    // decode every thumbnail the views show
+    if(imageCount > 0 && showThumbnails){
+        cullViewports();
+        uploadThumbnails();
+        while(selectThumbnails() > 0 && thumbnailCache &&
+              thumbnailCache->pending() > 0){
+            thumbnailCache->wait();
+            uploadThumbnails();
+        }
+    }
+};
+
+/**
+ * @brief renders scene with current world camera and saves it as image
+ * @param path output path (*.png for PNG, PPM otherwise)
+ * @return true if frame was written
+ */
+bool TagViewer::saveFrame(const char * path){
+    drawFrame();
+
+    vector<unsigned char> pixels((size_t)width * height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+    if(!writeImage(path, &pixels[0], width, height, true)){
+        cerr << "TagViewer: could not write " << path << endl;
+        return false;
+    }
+    return true;
+};
+
+/**
+ * @brief sets up GL state shared by window / offscreen rendering
+ */
+void TagViewer::initGLState(){
+    // Initialize OpenGL graphics state
+    glClearColor(1.0,1.0,1.0,1.0);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_MULTISAMPLE);
+
+    // upload static geometry / shaders
+    initBuffers();
+    profiler.initGL();
+};
+
+/**
+ * @brief marks scene as changed so the scheduler draws a new frame
+ * @action safe to call from any thread. wakes the render loop if it is
+ *         blocked waiting for input. only the first call after a frame
+ *         pays for the wakeup
+ */
+void TagViewer::markDirty(){
+    if(!dirty.exchange(true)){
+        wakeup();
+    }
+};
+
+/**
+ * @brief wakes render loop blocked in waitForEvents
+ * @action safe to call from any thread
+ */
+void TagViewer::wakeup(){
+    if(wakePipe[1] >= 0){
+        char byte = 1;
+        // pipe is non blocking. a full pipe already means a pending wakeup
+        ssize_t written = write(wakePipe[1], &byte, 1);
+        (void)written;
+    }
+};
+
+/**
+ * @brief limits redraw rate
+ * @param fps maximum frames per second. 0 for no limit
+ */
+void TagViewer::setFrameRateLimit(double fps){
+    minFrameInterval = (fps > 0) ? 1.0 / fps : 0.0;
+    wakeup();
+};
+
+/**
+ * @brief enables / disables waiting for vertical sync on swap
+ * @param enabled true to sync swaps to display refresh
+ * @action applied right away if the window exists, else on initWindow
+ */
+void TagViewer::setVSync(bool enabled){
+    vsync = enabled;
+    if(window){
+        applySwapInterval();
+    }
+};
+
+/**
+ * @brief sets level of detail thresholds
+ * @param pyramidPixels cameras projected smaller than this are drawn as a
+ *        single line along their viewing axis. 0 always draws pyramids
+ * @param clusterPixels groups of such cameras covering less than this are
+ *        drawn as one point at their mean position. 0 disables clusters
+ */
+void TagViewer::setLodThresholds(double pyramidPixels, double clusterPixels){
+    this->pyramidPixels = pyramidPixels;
+    this->clusterPixels = clusterPixels;
+    sceneVersion++;
+    markDirty();
+};
+
+/**
+ * @brief adds a viewport on top of the existing ones
+ * @param x,y lower left corner as fractions of the window
+ * @param w,h size as fractions of the window
+ * @param mode camera placement
+ * @return viewport index
+ * @action its camera starts as a copy of worldCamera
+ */
+size_t TagViewer::addViewport(double x, double y, double w, double h,
+                              ViewMode mode){
+    viewports.push_back(Viewport(x, y, w, h, mode));
+    viewports.back().camera = worldCamera;
+    updateView(viewports.size() - 1);
+    markDirty();
+    return viewports.size() - 1;
+};
+
+/**
+ * @brief moves / resizes viewport
+ * @param index viewport index, ignored if out of range
+ * @param x,y lower left corner as fractions of the window
+ * @param w,h size as fractions of the window
+ */
+void TagViewer::setViewport(size_t index, double x, double y, double w,
+                            double h){
+    if(index >= viewports.size()){
+        return;
+    }
+    viewports[index].x = x;
+    viewports[index].y = y;
+    viewports[index].width = w;
+    viewports[index].height = h;
+    updateView(index);
+    markDirty();
+};
+
+/**
+ * @brief changes camera placement of viewport
+ * @param index viewport index, ignored if out of range
+ * @param mode camera placement
+ */
+void TagViewer::setViewMode(size_t index, ViewMode mode){
+    if(index >= viewports.size()){
+        return;
+    }
+    viewports[index].mode = mode;
+    markDirty();
+};
+
+/**
+ * @brief camera of viewport
+ * @param index viewport index. 0 and out of range give worldCamera
+ */
+WorldCamera & TagViewer::viewportCamera(size_t index){
+    if(index == 0 || index >= viewports.size()){
+        return worldCamera;
+    }
+    return viewports[index].camera;
+};
+
+/**
+ * @brief replaces viewports with a grid, one cell per mode
+ * @param modes camera placement per viewport, first one top left
+ * @action up to 3 viewports sit side by side, more fill a near square
+ *         grid row by row. viewport 0 keeps worldCamera, others start from
+ *         a copy of it
+ */
+void TagViewer::setViewportLayout(const vector<ViewMode> & modes){
+    if(modes.empty()){
+        return;
+    }
+    for(size_t v = modes.size(); v < viewports.size(); v++){
+        releaseViewport(viewports[v]);
+    }
+    viewports.resize(min(viewports.size(), modes.size()),
+                     Viewport(0.0, 0.0, 1.0, 1.0, VIEW_ORBIT));
+    size_t n = modes.size();
+    size_t columns = (n <= 3) ? n : (size_t)ceil(sqrt((double)n));
+    size_t rows = (n + columns - 1) / columns;
+    for(size_t v = 0; v < n; v++){
+        double x = (double)(v % columns) / columns;
+        double y = 1.0 - (double)(v / columns + 1) / rows;
+        if(v < viewports.size()){
+            setViewport(v, x, y, 1.0 / columns, 1.0 / rows);
+            setViewMode(v, modes[v]);
+        } else {
+            addViewport(x, y, 1.0 / columns, 1.0 / rows, modes[v]);
+        }
+    }
+    activeViewport = 0;
+};
+
+/**
+ * @brief deletes cull result buffers of a viewport being removed
+ */
+void TagViewer::releaseViewport(Viewport & view){
+    GLuint buffers[4] = {view.visibleVBO, view.lineIndexVBO,
+                         view.clusterVBO, view.thumbnailVBO};
+    if(buffers[0] || buffers[1] || buffers[2] || buffers[3]){
+        glDeleteBuffers(4, buffers);
+    }
+    view.visibleVBO = view.lineIndexVBO = view.clusterVBO = 0;
+    view.thumbnailVBO = 0;
+};
+
+/**
+ * @brief viewport under window pixel x,y (GLUT coordinates)
+ * @return topmost viewport containing the pixel, 0 if none does
+ */
+size_t TagViewer::viewportAt(int x, int y) const{
+    int py = height - 1 - y;
+    for(size_t v = viewports.size(); v-- > 0;){
+        const int * p = viewports[v].pixels;
+        if(x >= p[0] && x < p[0] + p[2] && py >= p[1] && py < p[1] + p[3]){
+            return v;
+        }
+    }
+    return 0;
+};
+
+/**
+ * @brief starts recording frame phases for a Chrome trace
+ * @param path JSON file written when stopTrace is called or the viewer is
+ *        destroyed
+ * @return false if path cannot be written
+ */
+bool TagViewer::startTrace(const char * path){
+    return profiler.startTrace(path);
+};
+
+/**
+ * @brief writes recorded Chrome trace
+ */
+void TagViewer::stopTrace(){
+    profiler.stopTrace();
+};
+
+/**
+ * @brief starts recording displayed frames
+ * @param target image file pattern taking the frame index, or "|command"
+ *        reading raw RGB frames from stdin
+ * @param workers encoder threads, 0 for one per core
+ * @return false without a GL context or if target cannot be opened
+ * @action frames keep the window size recording started with
+ */
+bool TagViewer::startRecording(const char * target, int workers){
+    stopRecording();
+    if(!window && !offscreen){
+        return false;
+    }
+    recorder = new FrameRecorder();
+    if(!recorder->start(target, width, height, workers, true)){
+        delete recorder;
+        recorder = 0;
+        return false;
+    }
+    return true;
+};
+
+/**
+ * @brief stops recording and waits for the encoders
+ * @return false if a frame could not be written
+ */
+bool TagViewer::stopRecording(){
+    if(!recorder){
+        return true;
+    }
+    bool ok = recorder->stop();
+    cout << "recorded " << recorder->framesCaptured() << " frames ("
+         << recorder->framesDropped() << " dropped)" << endl;
+    delete recorder;
+    recorder = 0;
+    return ok;
+};
+
+/**
+ * @brief true while displayed frames are recorded
+ */
+bool TagViewer::isRecording() const{
+    return recorder != 0;
+};
+
+/**
+ * @brief replaces camera path
+ * @action stops a playing path
+ */
+void TagViewer::setCameraPath(const CameraPath & path){
+    cameraPath = path;
+    pathPlaying = false;
+};
+
+/**
+ * @brief plays camera path from its first key in real time
+ * @action idleCB moves the world camera along the path until its last key
+ */
+void TagViewer::playCameraPath(){
+    if(cameraPath.empty()){
+        return;
+    }
+    pathPlaying = true;
+    pathTime = 0.0;
+    pathTick = now();
+    applyCameraPath(cameraPath.begin());
+};
+
+/**
+ * @brief moves world camera to the camera path orbit at time
+ * @param time path time in seconds
+ */
+void TagViewer::applyCameraPath(double time){
+    double r, theta, distance;
+    if(!cameraPath.sample(time, r, theta, distance)){
+        return;
+    }
+    worldCamera.r = r;
+    worldCamera.theta = theta;
+    // splines may overshoot between close keys
+    worldCamera.distance = max(distance, 0.1);
+    markDirty();
+};
+
+/**
+ * @brief renders camera path offline
+ * @param target image file pattern taking the frame index, or "|command"
+ *        reading raw RGB frames from stdin
+ * @param fps frames per second of path time
+ * @param workers encoder threads, 0 for one per core
+ * @return false if the path is empty or a frame could not be written
+ * @action frames are read back asynchronously and encoded while the next
+ *         ones render, without glFinish between them. needs initOffscreen
+ *         or initWindow
+ */
+bool TagViewer::exportCameraPath(const char * target, double fps,
+                                 int workers){
+    if(cameraPath.empty() || fps <= 0.0 || (!window && !offscreen)){
+        return false;
+    }
+    FrameRecorder exporter;
+    if(!exporter.start(target, width, height, workers, false)){
+        return false;
+    }
+    double begin = cameraPath.begin();
+    size_t frames = (size_t)((cameraPath.end() - begin) * fps + 1e-6) + 1;
+    for(size_t i = 0; i < frames; i++){
+        applyCameraPath(begin + i / fps);
+        profiler.beginFrame();
+        finishUploads();
+        drawScene();
+        {
+            ProfileScope scope(profiler, PHASE_SWAP);
+            exporter.capture();
+        }
+        profiler.endFrame();
+    }
+    return exporter.stop();
+};
+
+/**
+ * @brief turns time line playback on / off
+ * @param enabled true to draw only the cameras of the time window
+ * @action the time starts at the first timestamp unless set before
+ */
+void TagViewer::setPlayback(bool enabled){
+    playback = enabled;
+    if(!enabled){
+        playing = false;
+    }
+    sceneVersion++;
+    markDirty();
+};
+
+/**
+ * @brief moves playback time
+ * @param time timestamp at the end of the window
+ */
+void TagViewer::setPlaybackTime(double time){
+    playTime = time;
+    markDirty();
+};
+
+/**
+ * @brief sets length of the sliding time window
+ * @param window timestamp units before the playback time that are drawn.
+ *        0 draws everything up to the playback time
+ */
+void TagViewer::setPlaybackWindow(double window){
+    playWindow = max(window, 0.0);
+    markDirty();
+};
+
+/**
+ * @brief sets playback speed
+ * @param speed timestamp units per second. negative plays backwards
+ */
+void TagViewer::setPlaybackSpeed(double speed){
+    playSpeed = speed;
+};
+
+/**
+ * @brief starts / pauses playback
+ * @action enables playback if needed. starting at the end of the time range
+ *         rewinds to its beginning first
+ */
+void TagViewer::setPlaying(bool playing){
+    double begin, end;
+    if(playing && timeRange(begin, end)){
+        if(!playback){
+            setPlayback(true);
+        }
+        if(isnan(playTime) || (playSpeed >= 0 && playTime >= end)){
+            playTime = begin;
+        } else if(playSpeed < 0 && playTime <= begin){
+            playTime = end;
+        }
+        lastTick = now();
+    }
+    this->playing = playing && playback;
+    markDirty();
+};
+
+/**
+ * @brief time span of the cameras
+ * @param begin first timestamp
+ * @param end last timestamp
+ * @return false if there are no cameras
+ */
+bool TagViewer::timeRange(double & begin, double & end) const{
+    return cameras.timeRange(begin, end);
+};
+
+/**
+ * @brief finds camera under window pixel
+ * @param x,y window coordinates, origin at the top left (as GLUT reports)
+ * @param index picked camera index
+ * @return true if a camera pyramid is under the pixel
+ * @action casts the pixel ray through the camera octree, testing only
+ *         cameras whose bounding spheres the ray crosses, nearest first
+ */
+bool TagViewer::pickCamera(int x, int y, size_t & index){
+    double origin[3];
+    double dir[3];
+    pickRay(x, y, origin, dir);
+    PyramidHitTest test(cameras, origin, dir, windowFirst, windowLast);
+    WorldCamera & camera = viewportCamera(viewportAt(x, y));
+    uint32_t hit;
+    double t;
+    if(!octree->raycast(origin, dir, test, hit, t) ||
+       t < camera.getNear() || t > camera.getFar()){
+        return false;
+    }
+    index = hit;
+    return true;
+};
+
+/**
+ * @brief copies pose of camera
+ * @param index camera index
+ * @param position double array of size 3 representing x,y,z
+ * @param rotation double array of size 4 representing x,y,z,w
+ * @return false if index is out of range
+ */
+bool TagViewer::getCameraPose(size_t index, double * position,
+                              double * rotation) const{
+    if(index >= cameras.size()){
+        return false;
+    }
+    copy(cameras.position(index), cameras.position(index)+3, position);
+    copy(cameras.rotation(index), cameras.rotation(index)+4, rotation);
+    return true;
+};
+
+/**
+ * @brief highlights camera as selected
+ * @param index camera index or NO_CAMERA to clear
+ */
+void TagViewer::selectCamera(size_t index){
+    if(selected != index){
+        selected = index;
+        markDirty();
+    }
+};
+
+/**
+ * @brief world space ray through the center of a window pixel
+ * @param x,y window coordinates, origin at the top left
+ * @param origin ray origin (eye of the viewport under x,y)
+ * @param dir normalized ray direction
+ * @action built from the same parameters as gluPerspective / gluLookAt so
+ *         no GL state has to be read back
+ */
+void TagViewer::pickRay(int x, int y, double * origin, double * dir){
+    size_t index = viewportAt(x, y);
+    updateView(index);
+    const Viewport & view = viewports[index];
+    WorldCamera & camera = viewportCamera(index);
+    const double * eye = view.eye;
+    const double * target = view.target;
+    double f[3] = {target[0]-eye[0], target[1]-eye[1], target[2]-eye[2]};
+    double length = sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]);
+    for(int k = 0; k < 3; k++){
+        f[k] /= length;
+    }
+    // side = f x up
+    double side[3] = {f[1]*view.up[2] - f[2]*view.up[1],
+                      f[2]*view.up[0] - f[0]*view.up[2],
+                      f[0]*view.up[1] - f[1]*view.up[0]};
+    length = sqrt(side[0]*side[0] + side[1]*side[1] + side[2]*side[2]);
+    for(int k = 0; k < 3; k++){
+        side[k] /= length;
+    }
+    double up[3] = {side[1]*f[2] - side[2]*f[1],
+                    side[2]*f[0] - side[0]*f[2],
+                    side[0]*f[1] - side[1]*f[0]};
+
+    // GLUT y grows downwards, viewport rectangles upwards
+    const int * p = view.pixels;
+    double tanY = tan(camera.getFOVY() * 0.5 * PI / 180.0);
+    double tanX = tanY * camera.getAspect();
+    double ndcX = 2.0 * (x + 0.5 - p[0]) / p[2] - 1.0;
+    double ndcY = 1.0 - 2.0 * (y + 0.5 - (height - p[1] - p[3])) / p[3];
+    for(int k = 0; k < 3; k++){
+        origin[k] = eye[k];
+        dir[k] = f[k] + side[k] * ndcX * tanX + up[k] * ndcY * tanY;
+    }
+    length = sqrt(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+    for(int k = 0; k < 3; k++){
+        dir[k] /= length;
+    }
+};
+
+/**
+ * @brief runs event driven render loop until stop() or window close
+ * @action dispatches GLUT events, redraws only when something is dirty
+ *         (respecting the frame rate limit) and otherwise blocks until
+ *         input or a wakeup arrives
+ */
+void TagViewer::run(){
+    running = true;
+    while(running){
+        // dispatch input / window events. may call displayCB
+        glutMainLoopEvent();
+        if(!running){
+            break;
+        }
+        idleCB();
+
+        // -1 waits for input / wakeup without timeout, a replay until its
+        // next event
+        double timeout = replayWait;
+        if(dirty){
+            double remaining = lastFrameTime + minFrameInterval - now();
+            if(redisplayPosted){
+                // window not drawable right now (e.g. iconified)
+                timeout = 0.1;
+            } else if(remaining <= 0){
+                redisplayPosted = true;
+                glutPostRedisplay();
+                continue;
+            } else {
+                timeout = remaining;
+            }
+        }
+        waitForEvents(timeout);
+    }
+    running = false;
+};
+
+/**
+ * @brief requests render loop to return
+ * @action safe to call from any thread
+ */
+void TagViewer::stop(){
+    running = false;
+    wakeup();
+};
+
+/**
+ * @brief blocks until window system input, a wakeup or timeout
+ * @param timeout seconds to wait at most. negative waits forever
+ */
+void TagViewer::waitForEvents(double timeout){
+    struct pollfd fds[2];
+    int count = 0;
+    Display * display = glXGetCurrentDisplay();
+    if(display){
+        // events already read into Xlib's queue will not show up on the fd
+        if(XPending(display)){
+            return;
+        }
+        fds[count].fd = ConnectionNumber(display);
+        fds[count].events = POLLIN;
+        count++;
+    } else if(timeout < 0){
+        // no connection to watch. fall back to polling
+        timeout = 0.01;
+    }
+    fds[count].fd = wakePipe[0];
+    fds[count].events = POLLIN;
+    count++;
+
+    int ms = (timeout < 0) ? -1 : (int)ceil(timeout * 1000.0);
+    if(poll(fds, count, ms) > 0 && (fds[count - 1].revents & POLLIN)){
+        // drain wakeups
+        char buffer[64];
+        while(read(wakePipe[0], buffer, sizeof(buffer)) > 0){
+        }
+    }
+};
+
+/**
+ * @brief creates non blocking self pipe used to wake the render loop
+ */
+void TagViewer::initWakePipe(){
+    if(pipe(wakePipe) != 0){
+        wakePipe[0] = -1;
+        wakePipe[1] = -1;
+        return;
+    }
+    for(int i = 0; i < 2; i++){
+        fcntl(wakePipe[i], F_SETFL, fcntl(wakePipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(wakePipe[i], F_SETFD, FD_CLOEXEC);
+    }
+};
+
+/**
+ * @brief applies vsync setting to current GLX drawable
+ * @action tries GLX_EXT_swap_control, then MESA / SGI variants
+ */
+void TagViewer::applySwapInterval(){
+    int interval = vsync ? 1 : 0;
+    typedef void (*SwapIntervalEXT)(Display *, GLXDrawable, int);
+    typedef int (*SwapInterval)(int);
+    SwapIntervalEXT swapEXT = (SwapIntervalEXT)
+        glXGetProcAddress((const GLubyte *)"glXSwapIntervalEXT");
+    SwapInterval swapMESA = (SwapInterval)
+        glXGetProcAddress((const GLubyte *)"glXSwapIntervalMESA");
+    SwapInterval swapSGI = (SwapInterval)
+        glXGetProcAddress((const GLubyte *)"glXSwapIntervalSGI");
+    Display * display = glXGetCurrentDisplay();
+    if(swapEXT && display){
+        swapEXT(display, glXGetCurrentDrawable(), interval);
+    } else if(swapMESA){
+        swapMESA(interval);
+    } else if(swapSGI && interval > 0){
+        swapSGI(interval);
+    }
+};
+
+/**
+ * @brief monotonic time in seconds
+ */
+double TagViewer::now(){
+    return chrono::duration<double>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+};
+    
+/**
+ * @brief processes pending events once. run() should be preferred
+ */
+void TagViewer::renderFrame(){
+    glutMainLoopEvent();
+};
+
+
+/**
+ * @brief draws visible cameras, one instanced draw call per level of detail
+ * @action near cameras are pyramids, far ones lines and dense far groups
+ *         single points. with everything in view at full detail the index
+ *         list is skipped and the instance id is used directly
+ */
+void TagViewer::drawFrustums(const Viewport & view){
+    if(!frustumProgram || uploadedInstances == 0){
+        return;
+    }
+    if(view.allVisible){
+        // time window is a contiguous range of instances
+        size_t last = min(windowLast, uploadedInstances);
+        drawPoseInstances(poseTexture, pyramidVBO, GL_TRIANGLES, 12, 0,
+                          windowFirst,
+                          (last > windowFirst) ? last - windowFirst : 0);
+    } else {
+        drawPoseInstances(poseTexture, pyramidVBO, GL_TRIANGLES, 12,
+                          view.visibleVBO, 0, view.culled.pyramids.size());
+        drawPoseInstances(poseTexture, lineVBO, GL_LINES, 2,
+                          view.lineIndexVBO, 0, view.culled.lines.size());
+    }
+    drawClusters(view);
+};
+
+/**
+ * @brief draws geometry once per pose
+ * @param poses texture buffer of pose instances (poseTexture / tagTexture)
+ * @param geometry interleaved x,y,z,r,g,b vertex buffer in model space
+ * @param mode primitive type
+ * @param vertices vertex count of geometry
+ * @param indices per-instance pose indices. 0 draws poses
+ *        first..first+count-1
+ * @param first first pose drawn without indices
+ * @param count number of instances
+ * @action poses are fetched by index from the pose texture and rotated in
+ *         the vertex shader. only triangles are lit
+ */
+void TagViewer::drawPoseInstances(GLuint poses, GLuint geometry, GLenum mode,
+                                  GLsizei vertices, GLuint indices,
+                                  size_t first, size_t count){
+    if(count == 0){
+        return;
+    }
+    glUseProgram(frustumProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, poses);
+    glUniform1i(glGetUniformLocation(frustumProgram, "poses"), 0);
+    glUniform1i(glGetUniformLocation(frustumProgram, "indexed"),
+                indices ? 1 : 0);
+    glUniform1i(glGetUniformLocation(frustumProgram, "firstInstance"),
+                (GLint)first);
+    glUniform1i(glGetUniformLocation(frustumProgram, "lit"),
+                mode == GL_TRIANGLES ? 1 : 0);
+    // error colors for compared cameras only
+    size_t errorCount = 0;
+    if(poses == poseTexture && showErrors && errorsUploaded){
+        errorCount = cameraErrors.size();
+        double range = (errorRange > 0.0) ? errorRange : 3.0 * errorRmse;
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_BUFFER, errorTexture);
+        glActiveTexture(GL_TEXTURE0);
+        glUniform1i(glGetUniformLocation(frustumProgram, "errors"), 1);
+        glUniform1f(glGetUniformLocation(frustumProgram, "errorRange"),
+                    (GLfloat)max(range, 1e-9));
+    }
+    glUniform1i(glGetUniformLocation(frustumProgram, "errorCount"),
+                (GLint)errorCount);
+
+    // per-vertex camera geometry
+    glBindBuffer(GL_ARRAY_BUFFER, geometry);
+    glEnableVertexAttribArray(ATTRIB_VERTEX);
+    glEnableVertexAttribArray(ATTRIB_COLOR);
+    glVertexAttribPointer(ATTRIB_VERTEX, 3, GL_FLOAT, GL_FALSE,
+                          6 * sizeof(GLfloat), (void*)0);
+    glVertexAttribPointer(ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE,
+                          6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+
+    // per-instance camera index
+    if(indices){
+        glBindBuffer(GL_ARRAY_BUFFER, indices);
+        glEnableVertexAttribArray(ATTRIB_INDEX);
+        glVertexAttribIPointer(ATTRIB_INDEX, 1, GL_UNSIGNED_INT,
+                               sizeof(GLuint), (void*)0);
+        glVertexAttribDivisor(ATTRIB_INDEX, 1);
+    }
+
+    glDrawArraysInstanced(mode, 0, vertices, (GLsizei)count);
+    drawCalls++;
+
+    if(indices){
+        glVertexAttribDivisor(ATTRIB_INDEX, 0);
+        glDisableVertexAttribArray(ATTRIB_INDEX);
+    }
+    glDisableVertexAttribArray(ATTRIB_VERTEX);
+    glDisableVertexAttribArray(ATTRIB_COLOR);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if(errorCount){
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glUseProgram(0);
+};
+
+/**
+ * @brief binds pose program for single poses in world units
+ * @param lit shade faces (triangles only)
+ */
+void TagViewer::usePoseProgram(bool lit){
+    glUseProgram(poseProgram);
+    glUniform3f(glGetUniformLocation(poseProgram, "positionOffset"),
+                0.0f, 0.0f, 0.0f);
+    glUniform3f(glGetUniformLocation(poseProgram, "positionScale"),
+                1.0f, 1.0f, 1.0f);
+    glUniform1i(glGetUniformLocation(poseProgram, "lit"), lit ? 1 : 0);
+};
+
+/**
+ * @brief draws the time window as a polyline through camera positions
+ * @action reads positions straight from the instance buffer, which is in
+ *         time order during playback, so nothing is uploaded
+ */
+void TagViewer::drawTrajectory(){
+    size_t last = min(windowLast, uploadedInstances);
+    if(!playback || !showTrajectory || !poseProgram ||
+       last < windowFirst + 2){
+        return;
+    }
+    usePoseProgram(false);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glEnableVertexAttribArray(ATTRIB_VERTEX);
+    glVertexAttribPointer(ATTRIB_VERTEX, 3, GL_FLOAT, GL_FALSE,
+                          PoseStore::INSTANCE_FLOATS * sizeof(GLfloat),
+                          (void*)0);
+    glVertexAttrib3f(ATTRIB_COLOR, 1.0f, 0.5f, 0.0f);
+    glVertexAttrib3f(ATTRIB_POSITION, 0.0f, 0.0f, 0.0f);
+    glVertexAttrib4f(ATTRIB_ROTATION, 0.0f, 0.0f, 0.0f, 1.0f);
+
+    glDrawArrays(GL_LINE_STRIP, (GLint)windowFirst,
+                 (GLsizei)(last - windowFirst));
+    drawCalls++;
+
+    glDisableVertexAttribArray(ATTRIB_VERTEX);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+};
+
+/**
+ * @brief draws the reference trajectory as a polyline through its
+ *        positions
+ * @action reads positions straight from the reference instances like
+ *         drawTrajectory does
+ */
+void TagViewer::drawReference(){
+    if(!showErrors || !poseProgram || !referenceUploaded ||
+       reference.size() < 2){
+        return;
+    }
+    usePoseProgram(false);
+    glBindBuffer(GL_ARRAY_BUFFER, referenceVBO);
+    glEnableVertexAttribArray(ATTRIB_VERTEX);
+    glVertexAttribPointer(ATTRIB_VERTEX, 3, GL_FLOAT, GL_FALSE,
+                          PoseStore::INSTANCE_FLOATS * sizeof(GLfloat),
+                          (void*)0);
+    glVertexAttrib3f(ATTRIB_COLOR, 0.3f, 0.3f, 0.3f);
+    glVertexAttrib3f(ATTRIB_POSITION, 0.0f, 0.0f, 0.0f);
+    glVertexAttrib4f(ATTRIB_ROTATION, 0.0f, 0.0f, 0.0f, 1.0f);
+
+    glDrawArrays(GL_LINE_STRIP, 0, (GLsizei)reference.size());
+    drawCalls++;
+
+    glDisableVertexAttribArray(ATTRIB_VERTEX);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+};
+
+/**
+ * @brief draws one point per cluster proxy of the last cull
+ * @action proxy positions are world space, so the pose is identity
+ */
+void TagViewer::drawClusters(const Viewport & view){
+    size_t count = view.culled.clusters.size() / 4;
+    if(!poseProgram || view.allVisible || count == 0){
+        return;
+    }
+    usePoseProgram(false);
+    glBindBuffer(GL_ARRAY_BUFFER, view.clusterVBO);
+    glEnableVertexAttribArray(ATTRIB_VERTEX);
+    glVertexAttribPointer(ATTRIB_VERTEX, 3, GL_FLOAT, GL_FALSE,
+                          4 * sizeof(GLfloat), (void*)0);
+    glVertexAttrib3f(ATTRIB_COLOR, 0.0f, 0.5f, 0.8f);
+    glVertexAttrib3f(ATTRIB_POSITION, 0.0f, 0.0f, 0.0f);
+    glVertexAttrib4f(ATTRIB_ROTATION, 0.0f, 0.0f, 0.0f, 1.0f);
+    glPointSize(CLUSTER_POINT_SIZE);
+
+    glDrawArrays(GL_POINTS, 0, (GLsizei)count);
+    drawCalls++;
+
+    glPointSize(1.0f);
+    glDisableVertexAttribArray(ATTRIB_VERTEX);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+};
+
+/**
+ * @brief binds pose program for drawing pose records (see
+ *        bindMappedRecords)
+ * @param points one point per pose in the cluster color instead of the
+ *        unit pyramid
+ */
+void TagViewer::beginMappedDraw(bool points){
+    if(points){
+        usePoseProgram(false);
+        glVertexAttrib3f(ATTRIB_VERTEX, 0.0f, 0.0f, 0.0f);
+        glVertexAttrib3f(ATTRIB_COLOR, 0.0f, 0.5f, 0.8f);
+        glPointSize(CLUSTER_POINT_SIZE);
+    } else {
+        usePoseProgram(true);
+        glBindBuffer(GL_ARRAY_BUFFER, pyramidVBO);
+        glEnableVertexAttribArray(ATTRIB_VERTEX);
+        glEnableVertexAttribArray(ATTRIB_COLOR);
+        glVertexAttribPointer(ATTRIB_VERTEX, 3, GL_FLOAT, GL_FALSE,
+                              6 * sizeof(GLfloat), (void*)0);
+        glVertexAttribPointer(ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE,
+                              6 * sizeof(GLfloat),
+                              (void*)(3 * sizeof(GLfloat)));
+    }
+    glEnableVertexAttribArray(ATTRIB_POSITION);
+    glEnableVertexAttribArray(ATTRIB_ROTATION);
+    glVertexAttribDivisor(ATTRIB_POSITION, 1);
+    glVertexAttribDivisor(ATTRIB_ROTATION, 1);
+};
+
+/**
+ * @brief points the instance attributes at pose records
+ * @param vbo buffer of PoseRecordF32 / PoseRecordQ16 records
+ * @param quantized true for PoseRecordQ16
+ * @param offset position of quantized 0
+ * @param scale extent of quantized positions per axis
+ */
+void TagViewer::bindMappedRecords(GLuint vbo, bool quantized,
+                                  const float * offset, const float * scale){
+    GLint offsetLocation = glGetUniformLocation(poseProgram, "positionOffset");
+    GLint scaleLocation = glGetUniformLocation(poseProgram, "positionScale");
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if(!quantized){
+        GLsizei stride = sizeof(PoseRecordF32);
+        glUniform3f(offsetLocation, 0.0f, 0.0f, 0.0f);
+        glUniform3f(scaleLocation, 1.0f, 1.0f, 1.0f);
+        glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, stride,
+                              (void*)offsetof(PoseRecordF32, position));
+        glVertexAttribPointer(ATTRIB_ROTATION, 4, GL_FLOAT, GL_FALSE, stride,
+                              (void*)offsetof(PoseRecordF32, rotation));
+    } else {
+        GLsizei stride = sizeof(PoseRecordQ16);
+        glUniform3f(offsetLocation, offset[0], offset[1], offset[2]);
+        glUniform3f(scaleLocation, scale[0], scale[1], scale[2]);
+        glVertexAttribPointer(ATTRIB_POSITION, 3, GL_UNSIGNED_SHORT, GL_TRUE,
+                              stride, (void*)offsetof(PoseRecordQ16, position));
+        glVertexAttribPointer(ATTRIB_ROTATION, 4, GL_SHORT, GL_TRUE,
+                              stride, (void*)offsetof(PoseRecordQ16, rotation));
+    }
+};
+
+/**
+ * @brief restores attribute state after drawing pose records
+ */
+void TagViewer::endMappedDraw(){
+    glVertexAttribDivisor(ATTRIB_POSITION, 0);
+    glVertexAttribDivisor(ATTRIB_ROTATION, 0);
+    glDisableVertexAttribArray(ATTRIB_POSITION);
+    glDisableVertexAttribArray(ATTRIB_ROTATION);
+    glDisableVertexAttribArray(ATTRIB_VERTEX);
+    glDisableVertexAttribArray(ATTRIB_COLOR);
+    glPointSize(1.0f);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+};
+
+/**
+ * @brief draws uploaded part of mapped pose file in one instanced call
+ * @action record fields are bound directly as per-instance attributes
+ */
+void TagViewer::drawMapped(){
+    if(!poseFile || !poseProgram || mappedUploaded == 0){
+        return;
+    }
+    beginMappedDraw(false);
+    const float * lo = poseFile->boundsMin();
+    const float * hi = poseFile->boundsMax();
+    float extent[3] = {hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]};
+    bindMappedRecords(mappedVBO, poseFile->encoding() == POSE_QUANTIZED16,
+                      lo, extent);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 12, (GLsizei)mappedUploaded);
+    drawCalls++;
+    endMappedDraw();
+};
+
+/**
+ * @brief draws the pose tree nodes picked for view
+ * @param view viewport being drawn
+ * @action one instanced draw per node, positions dequantized within the
+ *         node cube. nodes whose poses are below pyramidPixels are drawn
+ *         as points
+ */
+void TagViewer::drawTree(const Viewport & view){
+    if(!treeCache || !poseProgram){
+        return;
+    }
+    const vector<TreeDraw> * lists[2] = {&view.treeNodes, &view.treePoints};
+    for(int points = 0; points < 2; points++){
+        const vector<TreeDraw> & draws = *lists[points];
+        if(draws.empty()){
+            continue;
+        }
+        beginMappedDraw(points != 0);
+        for(size_t i = 0; i < draws.size(); i++){
+            const PoseTreeNode & node = poseTree->node(draws[i].node);
+            float extent[3] = {node.edge, node.edge, node.edge};
+            bindMappedRecords(treeVBOs[draws[i].node], true, node.lo, extent);
+            if(points){
+                glDrawArraysInstanced(GL_POINTS, 0, 1,
+                                      (GLsizei)draws[i].count);
+            } else {
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 12,
+                                      (GLsizei)draws[i].count);
+            }
+            drawCalls++;
+        }
+        endMappedDraw();
+    }
+};
+
+/**
+ * @brief draws the thumbnails picked for view in one instanced call
+ * @param view viewport being drawn
+ * @action poses come from the camera pose texture like the pyramids. the
+ *         quads are pulled towards the eye so they win over the base
+ *         faces they lie on
+ */
+void TagViewer::drawThumbnails(const Viewport & view){
+    if(!thumbnailProgram || !thumbnailCache || view.thumbnails.empty()){
+        return;
+    }
+    size_t slots = thumbnailCache->slotCount();
+    glUseProgram(thumbnailProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, poseTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, thumbnailTexture);
+    glUniform1i(glGetUniformLocation(thumbnailProgram, "poses"), 0);
+    glUniform1i(glGetUniformLocation(thumbnailProgram, "atlas"), 1);
+    glUniform2f(glGetUniformLocation(thumbnailProgram, "atlasSize"),
+                (float)(atlasColumns * THUMBNAIL_SIZE),
+                (float)((slots / atlasColumns) * THUMBNAIL_SIZE));
+
+    glBindBuffer(GL_ARRAY_BUFFER, squareVBO);
+    glEnableVertexAttribArray(ATTRIB_VERTEX);
+    glVertexAttribPointer(ATTRIB_VERTEX, 3, GL_FLOAT, GL_FALSE,
+                          6 * sizeof(GLfloat), (void*)0);
+
+    // per-instance camera index and atlas tile
+    glBindBuffer(GL_ARRAY_BUFFER, view.thumbnailVBO);
+    glEnableVertexAttribArray(ATTRIB_INDEX);
+    glEnableVertexAttribArray(ATTRIB_TILE);
+    glVertexAttribIPointer(ATTRIB_INDEX, 1, GL_UNSIGNED_INT,
+                           sizeof(ThumbnailDraw),
+                           (void*)offsetof(ThumbnailDraw, camera));
+    glVertexAttribPointer(ATTRIB_TILE, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(ThumbnailDraw),
+                          (void*)offsetof(ThumbnailDraw, tile));
+    glVertexAttribDivisor(ATTRIB_INDEX, 1);
+    glVertexAttribDivisor(ATTRIB_TILE, 1);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(-1.0f, -1.0f);
+
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6,
+                          (GLsizei)view.thumbnails.size());
+    drawCalls++;
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glVertexAttribDivisor(ATTRIB_INDEX, 0);
+    glVertexAttribDivisor(ATTRIB_TILE, 0);
+    glDisableVertexAttribArray(ATTRIB_INDEX);
+    glDisableVertexAttribArray(ATTRIB_TILE);
+    glDisableVertexAttribArray(ATTRIB_VERTEX);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glUseProgram(0);
+};
+
+/**
+ * @brief draws every tag as a square in one instanced draw call
+ */
+void TagViewer::drawTags(){
+    if(!frustumProgram){
+        return;
+    }
+    drawPoseInstances(tagTexture, squareVBO, GL_TRIANGLES, 6, 0, 0,
+                      tagsUploaded);
+};
+
+/**
+ * @brief draws observation edges of the cameras in the time window
+ * @action edges are sorted by camera, so the window is one contiguous range
+ *         of edgeVBO. each edge is an instance of a 2 vertex line whose ends
+ *         are looked up in the camera and tag pose textures, so moving a
+ *         camera or tag moves its edges without touching edgeVBO. ranges
+ *         over EDGE_DRAW_BUDGET are thinned to every k-th edge by the
+ *         attribute stride alone
+ */
+void TagViewer::drawObservations(){
+    size_t last = min(windowLast, uploadedInstances);
+    if(!edgeProgram || !showObservations || edgesUploaded == 0 ||
+       tagsUploaded == 0 || last <= windowFirst){
+        return;
+    }
+    size_t begin, end;
+    observations.cameraRange((uint32_t)windowFirst, (uint32_t)last, begin,
+                             end);
+    end = min(end, edgesUploaded);
+    if(begin >= end){
+        return;
+    }
+    size_t step = (end - begin + EDGE_DRAW_BUDGET - 1) / EDGE_DRAW_BUDGET;
+    glUseProgram(edgeProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, poseTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, tagTexture);
+    glUniform1i(glGetUniformLocation(edgeProgram, "poses"), 0);
+    glUniform1i(glGetUniformLocation(edgeProgram, "tagPoses"), 1);
+    glUniform1i(glGetUniformLocation(edgeProgram, "lit"), 0);
+
+    // line end points tell the camera end from the tag end
+    glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
+    glEnableVertexAttribArray(ATTRIB_VERTEX);
+    glVertexAttribPointer(ATTRIB_VERTEX, 3, GL_FLOAT, GL_FALSE,
+                          6 * sizeof(GLfloat), (void*)0);
+    glVertexAttrib3f(ATTRIB_COLOR, 0.2f, 0.7f, 1.0f);
+
+    // per-instance camera / tag index pair
+    glBindBuffer(GL_ARRAY_BUFFER, edgeVBO);
+    glEnableVertexAttribArray(ATTRIB_EDGE);
+    glVertexAttribIPointer(ATTRIB_EDGE, 2, GL_UNSIGNED_INT,
+                           (GLsizei)(step * sizeof(ObservationEdge)),
+                           (void*)(begin * sizeof(ObservationEdge)));
+    glVertexAttribDivisor(ATTRIB_EDGE, 1);
+
+    glDrawArraysInstanced(GL_LINES, 0, 2,
+                          (GLsizei)((end - begin + step - 1) / step));
+    drawCalls++;
+
+    glVertexAttribDivisor(ATTRIB_EDGE, 0);
+    glDisableVertexAttribArray(ATTRIB_EDGE);
+    glDisableVertexAttribArray(ATTRIB_VERTEX);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glUseProgram(0);
+};
+
+/**
+ * @brief outlines hovered / selected cameras
+ */
+void TagViewer::drawHighlights(){
+    if(hovered != NO_CAMERA && hovered != selected){
+        drawHighlight(hovered, 1.0f, 0.8f, 0.0f);
+    }
+    if(selected != NO_CAMERA){
+        drawHighlight(selected, 1.0f, 0.0f, 0.0f);
+    }
+};
+
+/**
+ * @brief draws camera pyramid as wireframe on top of the scene
+ * @param index camera index
+ * @param r,g,b outline color
+ */
+void TagViewer::drawHighlight(size_t index, float r, float g, float b){
+    if(!poseProgram || index < windowFirst || index >= windowLast){
+        return;
+    }
+    usePoseProgram(false);
+    glBindBuffer(GL_ARRAY_BUFFER, pyramidVBO);
+    glEnableVertexAttribArray(ATTRIB_VERTEX);
+    glVertexAttribPointer(ATTRIB_VERTEX, 3, GL_FLOAT, GL_FALSE,
+                          6 * sizeof(GLfloat), (void*)0);
+    glVertexAttrib3f(ATTRIB_COLOR, r, g, b);
+    const GLfloat * pose = cameras.instance(index);
+    glVertexAttrib3fv(ATTRIB_POSITION, pose);
+    glVertexAttrib4fv(ATTRIB_ROTATION, pose + 4);
+    glPushAttrib(GL_ENABLE_BIT | GL_POLYGON_BIT | GL_LINE_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    glLineWidth(2.0f);
+
+    glDrawArrays(GL_TRIANGLES, 0, 12);
+    drawCalls++;
+
+    glPopAttrib();
+    glDisableVertexAttribArray(ATTRIB_VERTEX);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+};
+
+/**
+ * @brief draws frame statistics over the scene when enabled with 'p'
+ * @action frame time graph of the profiler ring (the line marks 60 fps)
+ *         plus fps, visible / total cameras, phase times and resident
+ *         memory. text needs GLUT, so headless frames only get the graph
+ */
+void TagViewer::drawStatsOverlay(){
+    if(!showStats){
+        return;
+    }
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_COLOR_BUFFER_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, width, 0, height, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    const float left = 10.0f;
+    const float graphWidth = (float)FrameProfiler::HISTORY;
+    const float graphHeight = 60.0f;
+    const float lineHeight = 15.0f;
+    const int lines = playback ? 6 : 5;
+    float top = height - 10.0f;
+    float graphBottom = top - graphHeight;
+    float bottom = graphBottom - lines * lineHeight - 5.0f;
+
+    // background panel
+    glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+    glBegin(GL_QUADS);
+    glVertex2f(left - 5.0f, bottom);
+    glVertex2f(left + graphWidth + 5.0f, bottom);
+    glVertex2f(left + graphWidth + 5.0f, top + 5.0f);
+    glVertex2f(left - 5.0f, top + 5.0f);
+    glEnd();
+
+    // frame times, oldest on the left. full height is 33 ms
+    const float fullScale = 1000.0f / 30.0f;
+    glColor4f(0.5f, 0.5f, 0.5f, 1.0f);
+    glBegin(GL_LINES);
+    glVertex2f(left, graphBottom + graphHeight * 0.5f);
+    glVertex2f(left + graphWidth, graphBottom + graphHeight * 0.5f);
+    glEnd();
+    size_t frames = profiler.frameCount();
+    glColor4f(0.2f, 1.0f, 0.2f, 1.0f);
+    glBegin(GL_LINE_STRIP);
+    for(size_t i = 0; i < frames; i++){
+        const FrameTiming & timing = profiler.frame(frames - 1 - i);
+        float y = min((float)timing.total / fullScale, 1.0f);
+        glVertex2f(left + graphWidth - frames + i, graphBottom + y * graphHeight);
+    }
+    glEnd();
+
+    if(window && frames > 0){
+        const FrameTiming & last = profiler.frame(0);
+        // newest frame whose GPU timers have been read back
+        const FrameTiming * gpu = 0;
+        for(size_t i = 0; i < frames && !gpu; i++){
+            if(profiler.frame(i).gpu[PHASE_DRAW] >= 0.0){
+                gpu = &profiler.frame(i);
+            }
+        }
+        char text[6][192];
+        snprintf(text[0], sizeof(text[0]), "%.1f fps  %.2f ms / frame",
+                 profiler.fps(), last.total);
+        snprintf(text[1], sizeof(text[1]),
+                 "cameras %zu / %zu visible  %zu draw calls",
+                 viewports[0].stats.visibleCameras,
+                 viewports[0].stats.totalCameras, drawCalls);
+        snprintf(text[2], sizeof(text[2]),
+                 "cpu ms  pose %.2f cull %.2f upload %.2f draw %.2f swap %.2f",
+                 last.cpu[PHASE_POSE_UPDATE], last.cpu[PHASE_CULL],
+                 last.cpu[PHASE_UPLOAD], last.cpu[PHASE_DRAW],
+                 last.cpu[PHASE_SWAP]);
+        if(gpu){
+            snprintf(text[3], sizeof(text[3]),
+                     "gpu ms  upload %.2f cull %.2f draw %.2f",
+                     gpu->gpu[PHASE_UPLOAD], gpu->gpu[PHASE_CULL],
+                     gpu->gpu[PHASE_DRAW]);
+        } else {
+            snprintf(text[3], sizeof(text[3]), "gpu ms  %s",
+                     profiler.gpuTimers() ? "pending" : "n/a");
+        }
+        int used = snprintf(text[4], sizeof(text[4]),
+                            "memory %.1f MB resident",
+                            FrameProfiler::residentBytes() / (1024.0 * 1024.0));
+        if(treeCache){
+            used += snprintf(text[4] + used, sizeof(text[4]) - used,
+                             "  tree %.1f MB in %zu nodes",
+                             treeCache->residentBytes() / (1024.0 * 1024.0),
+                             treeCache->residentNodes());
+        }
+        if(thumbnailCache){
+            used += snprintf(text[4] + used, sizeof(text[4]) - used,
+                             "  thumbnails %zu / %zu",
+                             thumbnailCache->residentCount(),
+                             thumbnailCache->slotCount());
+        }
+        if(replay){
+            snprintf(text[4] + used, sizeof(text[4]) - used,
+                     "  replay %.1f / %.1f s", replayTime() / 1000.0,
+                     replayDuration() / 1000.0);
+        }
+        int length = snprintf(text[5], sizeof(text[5]),
+                              "time %.3f  window %.3f  speed %.2fx  %s",
+                              playTime, playWindow, playSpeed,
+                              playing ? "playing" : "paused");
+        if(recorder){
+            snprintf(text[5] + length, sizeof(text[5]) - length,
+                     "  rec %zu (%zu dropped)", recorder->framesCaptured(),
+                     recorder->framesDropped());
+        }
+        glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+        for(int i = 0; i < lines; i++){
+            glRasterPos2f(left, graphBottom - (i + 1) * lineHeight);
+            glutBitmapString(GLUT_BITMAP_8_BY_13,
+                             (const unsigned char *)text[i]);
+        }
+    }
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+};
+
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief compiles a single shader stage
+ * @param type GL_VERTEX_SHADER / GL_FRAGMENT_SHADER
+ * @param source GLSL source
+ * @return shader handle, 0 on failure
+ */
+static GLuint compileShader(GLenum type, const char * source){
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if(status != GL_TRUE){
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        cerr << "TagViewer: shader compile failed: " << log << endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/**
+ * @brief compiles and links program with the shared attribute slots
+ * @param vertexSource vertex shader GLSL source
+ * @param fragmentSource fragment shader GLSL source
+ * @return program handle, 0 on failure
+ */
+static GLuint buildProgram(const char * vertexSource,
+                           const char * fragmentSource){
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if(!vs || !fs){
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        return 0;
+    }
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glBindAttribLocation(program, ATTRIB_VERTEX, "vertex");
+    glBindAttribLocation(program, ATTRIB_COLOR, "color");
+    glBindAttribLocation(program, ATTRIB_POSITION, "position");
+    glBindAttribLocation(program, ATTRIB_ROTATION, "rotation");
+    glBindAttribLocation(program, ATTRIB_INDEX, "instanceIndex");
+    glBindAttribLocation(program, ATTRIB_EDGE, "edge");
+    glBindAttribLocation(program, ATTRIB_TILE, "tile");
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if(status != GL_TRUE){
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        cerr << "TagViewer: program link failed: " << log << endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+/**
+ * @brief sets up shaders and uploads pyramid / square geometry once
+ * @action creates frustum program, static vertex buffers and an empty
+ *         instance buffer that addCamera appends to
+ */
+void TagViewer::initBuffers(){
+    // viewing axis of the pyramid (apex to base center)
+    static const GLfloat lineVertices[] = {
+        0.0f, 1.0f, 0.0f,    0.0f, 1.0f, 1.0f,
+        0.0f, -1.0f, 0.0f,   0.0f, 0.0f, 1.0f
+    };
+    static const GLfloat squareVertices[] = {
+        1.0f, 0.0f, 1.0f,    1.0f, 0.0f, 0.0f,
+        1.0f, 0.0f, -1.0f,   1.0f, 0.0f, 0.0f,
+        -1.0f, 0.0f, 1.0f,   1.0f, 0.0f, 0.0f,
+
+        -1.0f, 0.0f, 1.0f,   1.0f, 0.0f, 0.0f,
+        1.0f, 0.0f, -1.0f,   1.0f, 0.0f, 0.0f,
+        -1.0f, 0.0f, -1.0f,  1.0f, 0.0f, 0.0f
+    };
+    // camera poses fetched from a texture buffer, position then unit
+    // quaternion (2 texels per camera), by culled index or by instance id
+    // from firstInstance when all are visible. the vertex is rotated by the quaternion here,
+    // so no matrix is ever built per camera. cameras with a known error
+    // (the first errorCount, negative for none) are colored green to red
+    // up to errorRange
+    static const char * frustumVertexSource =
+        "#version 150 compatibility\n"
+        "in vec3 vertex;\n"
+        "in vec3 color;\n"
+        "in uint instanceIndex;\n"
+        "uniform samplerBuffer poses;\n"
+        "uniform samplerBuffer errors;\n"
+        "uniform bool indexed;\n"
+        "uniform int firstInstance;\n"
+        "uniform int errorCount;\n"
+        "uniform float errorRange;\n"
+        "out vec3 vColor;\n"
+        "out vec3 vEye;\n"
+        "void main(){\n"
+        "    int index = indexed ? int(instanceIndex)\n"
+        "                        : firstInstance + gl_InstanceID;\n"
+        "    int base = 2 * index;\n"
+        "    vec3 p = texelFetch(poses, base).xyz;\n"
+        "    vec4 q = texelFetch(poses, base + 1);\n"
+        "    vec3 t = 2.0 * cross(q.xyz, vertex);\n"
+        "    vec4 world = vec4(vertex + q.w * t + cross(q.xyz, t) + p, 1.0);\n"
+        "    vColor = color;\n"
+        "    float e = (index < errorCount) ? texelFetch(errors, index).r\n"
+        "                                   : -1.0;\n"
+        "    if(e >= 0.0){\n"
+        "        float x = clamp(e / errorRange, 0.0, 1.0);\n"
+        "        vColor = vec3(min(1.0, 2.0 * x), min(1.0, 2.0 - 2.0 * x), 0.0);\n"
+        "    }\n"
+        "    vEye = (gl_ModelViewMatrix * world).xyz;\n"
+        "    gl_Position = gl_ModelViewProjectionMatrix * world;\n"
+        "}\n";
+    // position / quaternion as attributes: per-instance for mapped records,
+    // constant for single poses. positions are dequantized with
+    // positionOffset + positionScale * position
+    static const char * poseVertexSource =
+        "#version 150 compatibility\n"
+        "in vec3 vertex;\n"
+        "in vec3 color;\n"
+        "in vec3 position;\n"
+        "in vec4 rotation;\n"
+        "uniform vec3 positionOffset;\n"
+        "uniform vec3 positionScale;\n"
+        "out vec3 vColor;\n"
+        "out vec3 vEye;\n"
+        "void main(){\n"
+        "    float n2 = dot(rotation, rotation);\n"
+        "    vec4 q = (n2 > 0.0) ? rotation * inversesqrt(n2)\n"
+        "                        : vec4(0.0, 0.0, 0.0, 1.0);\n"
+        "    vec3 t = 2.0 * cross(q.xyz, vertex);\n"
+        "    vec3 p = positionOffset + positionScale * position;\n"
+        "    vec4 world = vec4(vertex + q.w * t + cross(q.xyz, t) + p, 1.0);\n"
+        "    vColor = color;\n"
+        "    vEye = (gl_ModelViewMatrix * world).xyz;\n"
+        "    gl_Position = gl_ModelViewProjectionMatrix * world;\n"
+        "}\n";
+    // camera -> tag line. the camera end (vertex.y > 0 on the line
+    // geometry) is fetched from the camera poses, the other from the tags
+    static const char * edgeVertexSource =
+        "#version 150 compatibility\n"
+        "in vec3 vertex;\n"
+        "in vec3 color;\n"
+        "in uvec2 edge;\n"
+        "uniform samplerBuffer poses;\n"
+        "uniform samplerBuffer tagPoses;\n"
+        "out vec3 vColor;\n"
+        "out vec3 vEye;\n"
+        "void main(){\n"
+        "    vec4 world = vec4((vertex.y > 0.0)\n"
+        "        ? texelFetch(poses, 2 * int(edge.x)).xyz\n"
+        "        : texelFetch(tagPoses, 2 * int(edge.y)).xyz, 1.0);\n"
+        "    vColor = color;\n"
+        "    vEye = (gl_ModelViewMatrix * world).xyz;\n"
+        "    gl_Position = gl_ModelViewProjectionMatrix * world;\n"
+        "}\n";
+    // camera image on the pyramid base (y = -1), looking down -y with +z
+    // up like the camera view, so image right is -x. the unit square is
+    // shrunk to the aspect of the thumbnail's atlas tile
+    static const char * thumbnailVertexSource =
+        "#version 150 compatibility\n"
+        "in vec3 vertex;\n"
+        "in uint instanceIndex;\n"
+        "in vec4 tile;\n"
+        "uniform samplerBuffer poses;\n"
+        "uniform vec2 atlasSize;\n"
+        "out vec2 vTexCoord;\n"
+        "void main(){\n"
+        "    int base = 2 * int(instanceIndex);\n"
+        "    vec3 p = texelFetch(poses, base).xyz;\n"
+        "    vec4 q = texelFetch(poses, base + 1);\n"
+        "    vec2 size = (tile.zw - tile.xy) * atlasSize;\n"
+        "    vec2 extent = size / max(size.x, size.y);\n"
+        "    vec3 v = vec3(vertex.x * extent.x, -1.0, vertex.z * extent.y);\n"
+        "    vec3 t = 2.0 * cross(q.xyz, v);\n"
+        "    vec4 world = vec4(v + q.w * t + cross(q.xyz, t) + p, 1.0);\n"
+        "    vTexCoord = mix(tile.xy, tile.zw,\n"
+        "                    0.5 - 0.5 * vec2(vertex.x, vertex.z));\n"
+        "    gl_Position = gl_ModelViewProjectionMatrix * world;\n"
+        "}\n";
+    static const char * thumbnailFragmentSource =
+        "#version 150 compatibility\n"
+        "in vec2 vTexCoord;\n"
+        "uniform sampler2D atlas;\n"
+        "void main(){\n"
+        "    gl_FragColor = vec4(texture(atlas, vTexCoord).rgb, 1.0);\n"
+        "}\n";
+    // flat shading from screen space derivatives, lit by a head light at
+    // the eye. both sides of a face are lit the same
+    static const char * fragmentSource =
+        "#version 150 compatibility\n"
+        "in vec3 vColor;\n"
+        "in vec3 vEye;\n"
+        "uniform bool lit;\n"
+        "void main(){\n"
+        "    vec3 c = vColor;\n"
+        "    if(lit){\n"
+        "        vec3 n = normalize(cross(dFdx(vEye), dFdy(vEye)));\n"
+        "        float diffuse = abs(dot(n, normalize(-vEye)));\n"
+        "        c *= 0.35 + 0.65 * diffuse;\n"
+        "    }\n"
+        "    gl_FragColor = vec4(c, 1.0);\n"
+        "}\n";
+
+    frustumProgram = buildProgram(frustumVertexSource, fragmentSource);
+    poseProgram = buildProgram(poseVertexSource, fragmentSource);
+    edgeProgram = buildProgram(edgeVertexSource, fragmentSource);
+    thumbnailProgram = buildProgram(thumbnailVertexSource,
+                                    thumbnailFragmentSource);
+    if(!frustumProgram || !poseProgram || !edgeProgram ||
+       !thumbnailProgram){
+        return;
+    }
+
+    // static geometry
+    glGenBuffers(1, &pyramidVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, pyramidVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(pyramidVertices), pyramidVertices,
+                 GL_STATIC_DRAW);
+
+    glGenBuffers(1, &lineVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(lineVertices), lineVertices,
+                 GL_STATIC_DRAW);
+
+    glGenBuffers(1, &squareVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, squareVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(squareVertices), squareVertices,
+                 GL_STATIC_DRAW);
+
+    // instance buffer, filled lazily by uploadInstances and read by the
+    // frustum shader through a texture buffer
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instanceCapacity = 0;
+    uploadedInstances = 0;
+    glGenTextures(1, &poseTexture);
+
+    // tag instances / observation edges, filled by uploadTags and
+    // uploadObservations
+    glGenBuffers(1, &tagVBO);
+    glGenTextures(1, &tagTexture);
+    tagCapacity = 0;
+    tagsUploaded = 0;
+    glGenBuffers(1, &edgeVBO);
+    edgeCapacity = 0;
+    edgesUploaded = 0;
+
+    // visible camera indices / cluster proxies are per viewport, created
+    // with their first cull result
+    for(size_t v = 0; v < viewports.size(); v++){
+        viewports[v].culledVersion = (size_t)-1;
+    }
+
+    // mapped pose file records, filled lazily by uploadMapped
+    glGenBuffers(1, &mappedVBO);
+    mappedUploaded = 0;
+
+    // reference trajectory / camera errors, filled by uploadReference and
+    // uploadErrors
+    glGenBuffers(1, &referenceVBO);
+    referenceUploaded = false;
+    glGenBuffers(1, &errorVBO);
+    glGenTextures(1, &errorTexture);
+    errorsUploaded = false;
+}
+
+/**
+ * @brief copies instances of poses [first, first + n) into the bound
+ *        GL_ARRAY_BUFFER at the same index
+ * @param store pose store
+ * @param first first pose
+ * @param n number of poses
+ * @action one glBufferSubData per store block touched
+ */
+static void uploadPoses(const PoseStore & store, size_t first, size_t n){
+    const size_t stride = PoseStore::INSTANCE_FLOATS * sizeof(GLfloat);
+    while(n > 0){
+        size_t m = min(n, store.contiguous(first));
+        glBufferSubData(GL_ARRAY_BUFFER, first * stride, m * stride,
+                        store.instance(first));
+        first += m;
+        n -= m;
+    }
+}
+
+/**
+ * @brief uploads camera instances added or changed since the last frame
+ * @action only the newly appended tail and the range touched by live
+ *         updates are sent to the GPU. buffer storage grows geometrically
+ *         so reallocation is rare
+ */
+void TagViewer::uploadInstances(){
+    size_t count = cameras.size();
+    // updates past the uploaded part go out with the tail
+    updatedEnd = min(updatedEnd, uploadedInstances);
+    bool updated = updatedBegin < updatedEnd;
+    if(!instanceVBO || (count == uploadedInstances && !updated)){
+        updatedBegin = updatedEnd = 0;
+        return;
+    }
+    const size_t stride = PoseStore::INSTANCE_FLOATS * sizeof(GLfloat);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if(count > instanceCapacity){
+        // grow storage and re-upload everything
+        size_t capacity = instanceCapacity ? instanceCapacity : 1024;
+        while(capacity < count){
+            capacity *= 2;
+        }
+        glBufferData(GL_ARRAY_BUFFER, capacity * stride, NULL, GL_DYNAMIC_DRAW);
+        uploadPoses(cameras, 0, count);
+        instanceCapacity = capacity;
+        // new data store has to be attached to the texture again
+        glBindTexture(GL_TEXTURE_BUFFER, poseTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceVBO);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    } else {
+        // changed cameras, then the new tail
+        if(updated){
+            uploadPoses(cameras, updatedBegin, updatedEnd - updatedBegin);
+        }
+        if(count > uploadedInstances){
+            uploadPoses(cameras, uploadedInstances,
+                        count - uploadedInstances);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    uploadedInstances = count;
+    updatedBegin = updatedEnd = 0;
+}
+
+/**
+ * @brief uploads the reference trajectory once it changed
+ * @action the instances are sent as they are and drawn as a line through
+ *         their positions
  */
-TagViewer & TagViewer::operator=(const TagViewer & tv){
-    //!! needs to write it (Not implemented yet)
-    TagViewer * t = new TagViewer();
-    return *t;
-};
-
-    
+void TagViewer::uploadReference(){
+    if(!referenceVBO || referenceUploaded){
+        return;
+    }
+    const size_t stride = PoseStore::INSTANCE_FLOATS * sizeof(GLfloat);
+    glBindBuffer(GL_ARRAY_BUFFER, referenceVBO);
+    glBufferData(GL_ARRAY_BUFFER, reference.size() * stride, NULL,
+                 GL_STATIC_DRAW);
+    uploadPoses(reference, 0, reference.size());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    referenceUploaded = true;
+}
 
 /**
- * @brief adds camera node to scene.
- * @param position double array of size 3 representing x,y,z
- * @param rotation double array of size 4 representing x,y,z,w
- * @action adds camera to vector of object nodes used for drawing camera 
- *         frustum in scene
+ * @brief uploads the camera errors once they changed
  */
-void TagViewer::addCamera(double * position, double * rotation){
-    ObjectNode o;
-    copy(position, position+3, o.position);
-    copy(rotation, rotation+4, o.rotation);
-    cameras.push_back(o);
-};
+void TagViewer::uploadErrors(){
+    if(!errorVBO || errorsUploaded || cameraErrors.empty()){
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, errorVBO);
+    glBufferData(GL_ARRAY_BUFFER, cameraErrors.size() * sizeof(GLfloat),
+                 &cameraErrors[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // new data store has to be attached to the texture again
+    glBindTexture(GL_TEXTURE_BUFFER, errorTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, errorVBO);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    errorsUploaded = true;
+}
 
 /**
- * @brief Sets Tag origin
- * @param position double array of size 3 representing x,y,z
- * @param rotation double array of size 4 representing x,y,z,w
- * @action sets camera orbit origin as this position
+ * @brief uploads tags added or moved since the last frame
+ * @action tags from the first changed one on are sent. the registry holds
+ *         hundreds of tags, so that is at most a few KB
  */
-void TagViewer::setTagOrigin(double * position, double * rotation){
-    copy(position, position+3, Tag.position);
-    copy(position, position+3, worldCamera.target);
-    copy(rotation, rotation+4, Tag.rotation);
-};
-
+void TagViewer::uploadTags(){
+    size_t count = tags.size();
+    if(!tagVBO || (count == tagsUploaded && tagsChanged >= count)){
+        tagsChanged = count;
+        return;
+    }
+    const size_t stride = PoseStore::INSTANCE_FLOATS * sizeof(GLfloat);
+    size_t first = min(tagsChanged, tagsUploaded);
+    glBindBuffer(GL_ARRAY_BUFFER, tagVBO);
+    if(count > tagCapacity){
+        size_t capacity = tagCapacity ? tagCapacity : 64;
+        while(capacity < count){
+            capacity *= 2;
+        }
+        glBufferData(GL_ARRAY_BUFFER, capacity * stride, NULL, GL_DYNAMIC_DRAW);
+        tagCapacity = capacity;
+        first = 0;
+        glBindTexture(GL_TEXTURE_BUFFER, tagTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, tagVBO);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    uploadPoses(tags, first, count - first);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    tagsUploaded = count;
+    tagsChanged = count;
+}
 
 /**
- * @brief updates world camera position using r, theta, distance
- * @action sets camera position
+ * @brief merges new observation edges and uploads the changed part
+ * @action edges of newly added cameras sort to the end, so a growing graph
+ *         only sends its tail. edgeVBO holds 8 bytes per edge and grows
+ *         geometrically
  */
-void TagViewer::updateWorldCameraPosition(){
-    double x = worldCamera.target[0];
-    double y = worldCamera.target[1];
-    double z = worldCamera.target[2];
-    double d = worldCamera.distance;
-    double r = worldCamera.r;
-    double t = worldCamera.theta;
-    
-    worldCamera.position[0] = x + d * cos(r) * cos(t);
-    worldCamera.position[1] = y + d * sin(r);
-    worldCamera.position[2] = z + d * cos(r) * sin(t);
-};
-    
+void TagViewer::uploadObservations(){
+    edgesUploaded = min(edgesUploaded, observations.compact());
+    size_t count = observations.size();
+    if(!edgeVBO || edgesUploaded == count){
+        return;
+    }
+    const size_t stride = sizeof(ObservationEdge);
+    glBindBuffer(GL_ARRAY_BUFFER, edgeVBO);
+    if(count > edgeCapacity){
+        size_t capacity = edgeCapacity ? edgeCapacity : 1024;
+        while(capacity < count){
+            capacity *= 2;
+        }
+        glBufferData(GL_ARRAY_BUFFER, capacity * stride, NULL, GL_DYNAMIC_DRAW);
+        edgeCapacity = capacity;
+        edgesUploaded = 0;
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, edgesUploaded * stride,
+                    (count - edgesUploaded) * stride,
+                    observations.data() + edgesUploaded);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    edgesUploaded = count;
+}
+
 /**
- * @brief initializes opengl window
- * @param argv,argc for glutinit
- * @action sets up window
+ * @brief rotates v by unit quaternion q (x,y,z,w), same formula as the
+ *        vertex shaders
  */
-void TagViewer::initWindow(int & argv, char** argc){
-    // GLUT Window Initialization:
-    glutInit (&argv,argc);
-    glutInitWindowSize (width, height);
-    glutInitDisplayMode ( GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-    glutCreateWindow ("Tag Viewer");
-
-    // Initialize OpenGL graphics state
-    glClearColor(1.0,1.0,1.0,1.0);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHT0);
-    glEnable(GL_LIGHT1);
-    glEnable(GL_LIGHTING);
-    glEnable(GL_COLOR_MATERIAL);
-    glEnable(GL_MULTISAMPLE);
+static void rotateVector(const GLfloat * q, const double * v, double * out){
+    double t[3] = {2.0 * (q[1] * v[2] - q[2] * v[1]),
+                   2.0 * (q[2] * v[0] - q[0] * v[2]),
+                   2.0 * (q[0] * v[1] - q[1] * v[0])};
+    out[0] = v[0] + q[3] * t[0] + (q[1] * t[2] - q[2] * t[1]);
+    out[1] = v[1] + q[3] * t[1] + (q[2] * t[0] - q[0] * t[2]);
+    out[2] = v[2] + q[3] * t[2] + (q[0] * t[1] - q[1] * t[0]);
+}
 
-};
-    
 /**
- * @brief renders one frame(should be called in loop)
+ * @brief culls one viewport, run on a worker thread
+ * @param octree shared camera octree, only read
+ * @param view viewport whose frustum is set. only its cull result and
+ *        stats are written
+ * @param lod level of detail parameters of the viewport
+ * @param first,last time window
  */
-void TagViewer::renderFrame(){
-    glutMainLoopEvent();
-};
-
+static void cullView(const CameraOctree * octree, Viewport * view,
+                     LodParams lod, uint32_t first, uint32_t last){
+    view->allVisible = octree->cull(view->frustum, lod, view->culled,
+                                    view->stats, first, last);
+}
 
 /**
- * @brief draws frustum using obj's pos / rot and pyramid helper function
- * @param obj object node with position and rotation
+ * @brief places the camera of a viewport for this frame
+ * @param index viewport index
+ * @action sets the pixel rectangle, the camera aspect and eye / target /
+ *         up. orbit views use the same formula as updateWorldCameraPosition,
+ *         the top down view keeps the up vector an orbit would have at the
+ *         top. the camera view sits just in front of the followed
+ *         pyramid's base so its own pyramid stays behind the eye
  */
-void TagViewer::drawFrustum(ObjectNode & obj){
-    glTranslated(obj.position[0],obj.position[1],obj.position[2]);
-    // multiply rotation matrix using quaternion
-    applyQuaternion(obj.rotation);
+void TagViewer::updateView(size_t index){
+    Viewport & view = viewports[index];
+    WorldCamera & camera = viewportCamera(index);
+    view.pixels[0] = (int)(view.x * width + 0.5);
+    view.pixels[1] = (int)(view.y * height + 0.5);
+    view.pixels[2] = max(1, (int)((view.x + view.width) * width + 0.5) -
+                            view.pixels[0]);
+    view.pixels[3] = max(1, (int)((view.y + view.height) * height + 0.5) -
+                            view.pixels[1]);
+    camera.setAspect((double)view.pixels[2] / view.pixels[3]);
 
-    // draw frustum
-    pyramid();
-};
+    double d = camera.distance;
+    double r = camera.r;
+    double t = camera.theta;
+    copy(camera.target, camera.target+3, view.target);
+    // camera view follows the selected camera, else the newest one drawn
+    size_t last = min(windowLast, cameras.size());
+    size_t follow = (selected >= windowFirst && selected < last) ? selected :
+                    last - 1;
+    if(view.mode == VIEW_CAMERA && last > windowFirst){
+        const GLfloat * pose = cameras.instance(follow);
+        const double eye[3] = {0.0, -1.05, 0.0};
+        const double ahead[3] = {0.0, -2.0, 0.0};
+        const double up[3] = {0.0, 0.0, 1.0};
+        rotateVector(pose + 4, eye, view.eye);
+        rotateVector(pose + 4, ahead, view.target);
+        rotateVector(pose + 4, up, view.up);
+        for(int k = 0; k < 3; k++){
+            view.eye[k] += pose[k];
+            view.target[k] += pose[k];
+        }
+    } else if(view.mode == VIEW_TOP_DOWN){
+        view.eye[0] = camera.target[0];
+        view.eye[1] = camera.target[1] + d;
+        view.eye[2] = camera.target[2];
+        view.up[0] = -cos(t);
+        view.up[1] = 0.0;
+        view.up[2] = -sin(t);
+    } else {
+        view.eye[0] = camera.target[0] + d * cos(r) * cos(t);
+        view.eye[1] = camera.target[1] + d * sin(r);
+        view.eye[2] = camera.target[2] + d * cos(r) * sin(t);
+        view.up[0] = 0.0;
+        view.up[1] = 1.0;
+        view.up[2] = 0.0;
+    }
+    copy(view.eye, view.eye+3, camera.position);
+}
 
 /**
- * @brief draws tag using obj's pos / rot and pyramid helper function
- * @param obj object node with position and rotation
+ * @brief culls cameras against the frustum of every viewport
+ * @action a viewport is only culled again when its frustum, the time
+ *         window or the cameras changed. stale viewports are culled in
+ *         parallel against the shared octree, one thread each (the first on
+ *         this thread), then their visible lists are uploaded for
+ *         drawFrustums. all viewports draw from the same instance buffer
  */
-void TagViewer::drawTag(ObjectNode & obj){
-    glTranslated(obj.position[0],obj.position[1],obj.position[2]);
-    // multiply rotation matrix using quaternion
-    applyQuaternion(obj.rotation);
+void TagViewer::cullViewports(){
+    vector<size_t> stale;
+    vector<LodParams> lods;
+    for(size_t v = 0; v < viewports.size(); v++){
+        updateView(v);
+        Viewport & view = viewports[v];
+        WorldCamera & camera = viewportCamera(v);
+        Frustum frustum;
+        frustum.set(view.eye, view.target, view.up, camera.getFOVY(),
+                    camera.getAspect(), camera.getNear(), camera.getFar());
+        if(view.culledVersion == sceneVersion &&
+           view.culledFirst == windowFirst && view.culledLast == windowLast &&
+           memcmp(frustum.planes, view.frustum.planes,
+                  sizeof(frustum.planes)) == 0){
+            continue;
+        }
+        view.frustum = frustum;
+        view.culledVersion = sceneVersion;
+        view.culledFirst = windowFirst;
+        view.culledLast = windowLast;
+
+        LodParams lod;
+        copy(view.eye, view.eye+3, lod.eye);
+        lod.pixelsPerUnit = view.pixels[3] /
+            (2.0 * tan(camera.getFOVY() * 0.5 * PI / 180.0));
+        lod.pyramidPixels = pyramidPixels;
+        lod.clusterPixels = clusterPixels;
+        stale.push_back(v);
+        lods.push_back(lod);
+    }
+    if(stale.empty()){
+        return;
+    }
 
-    // draw tag
-    square();
+    vector<thread> workers;
+    for(size_t i = 1; i < stale.size(); i++){
+        workers.push_back(thread(cullView, octree.get(), &viewports[stale[i]],
+                                 lods[i], (uint32_t)windowFirst,
+                                 (uint32_t)windowLast));
+    }
+    cullView(octree.get(), &viewports[stale[0]], lods[0],
+             (uint32_t)windowFirst, (uint32_t)windowLast);
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
 
-};
+    for(size_t i = 0; i < stale.size(); i++){
+        Viewport & view = viewports[stale[i]];
+        if(view.allVisible){
+            continue;
+        }
+        uploadCulled(view.visibleVBO, view.visibleCapacity,
+                     view.culled.pyramids.data(),
+                     view.culled.pyramids.size() * sizeof(GLuint));
+        uploadCulled(view.lineIndexVBO, view.lineIndexCapacity,
+                     view.culled.lines.data(),
+                     view.culled.lines.size() * sizeof(GLuint));
+        uploadCulled(view.clusterVBO, view.clusterCapacity,
+                     view.culled.clusters.data(),
+                     view.culled.clusters.size() * sizeof(GLfloat));
+    }
+}
 
 /**
- * @brief applies quaternion rotation to OpenGL matrix
- * @param quat double[4] array of quaternion
- * @action applies rotation using glMultMat
+ * @brief picks the pose tree nodes every viewport draws
+ * @return number of nodes the views are missing
+ * @action nodes not used by any view are evicted over the memory cap,
+ *         missing ones are queued for the I/O threads
  */
-void TagViewer::applyQuaternion(double * quat){
-    // normalize quaternion
-    double x = quat[0];
-    double y = quat[1]; 
-    double z = quat[2]; 
-    double w = quat[3]; 
-    double n = 1.0 / sqrt(x*x+y*y + z*z + w*w);
-
-    x *= n;
-    y *= n;
-    z *= n;
-    w *= n;
-    double m[] = {
-        1 - 2*y*y - 2*z*z,   2*x*y - 2*w*z  , 2*x*y + 2*w*y    , 0.0, 
-        2*x*y + 2*w*z    , 1 - 2*x*x - 2*z*z, 2*y*z - 2*w*x    , 0.0, 
-        2*x*z - 2*w*y    , 2*y*z + 2*w*x    , 1 - 2*x*x - 2*y*y, 0.0, 
-        0.0              , 0.0              , 0.0              , 1.0
-    };
-    // apply quaternion rotation
-    glMultMatrixd(m);
-};
+size_t TagViewer::selectTree(){
+    if(!treeCache){
+        return 0;
+    }
+    for(size_t v = 0; v < viewports.size(); v++){
+        Viewport & view = viewports[v];
+        WorldCamera & camera = viewportCamera(v);
+        double pixelsPerUnit = view.pixels[3] /
+            (2.0 * tan(camera.getFOVY() * 0.5 * PI / 180.0));
+        view.treeNodes.clear();
+        view.treePoints.clear();
+        selectTreeNode(view, poseTree->root(), pixelsPerUnit,
+                       camera.getNear());
+    }
+    uint32_t node;
+    while(treeCache->evict(node)){
+        glDeleteBuffers(1, &treeVBOs[node]);
+        treeVBOs[node] = 0;
+    }
+    return treeCache->submit();
+}
 
-//----------------------------------------------------------------------------//
-//                            END CLASS DEFINITION                            //
-//----------------------------------------------------------------------------//
-//----------------------------------------------------------------------------//
-//                              HELPER FUNCTIONS                              //
-//----------------------------------------------------------------------------//
-void TagViewer::pyramid()
-{
-    glBegin( GL_TRIANGLES );
+/**
+ * @brief picks nodes of the subtree at index for view
+ * @param view viewport with the frustum of this frame
+ * @param index node index
+ * @param pixelsPerUnit pixels covered by one world unit at distance 1
+ * @param zNear near plane distance
+ * @action a node is refined while its geometric error (sample spacing)
+ *         projects to more than treeErrorPixels. its children replace it
+ *         only once all visible ones are resident, until then the node
+ *         stays and the children are requested. leaves draw their sample
+ *         within the budget and all their poses beyond it
+ */
+void TagViewer::selectTreeNode(Viewport & view, uint32_t index,
+                               double pixelsPerUnit, double zNear){
+    const PoseTreeNode & node = poseTree->node(index);
+    // poses are drawn as pyramids around their position
+    double lo[3];
+    double hi[3];
+    for(int k = 0; k < 3; k++){
+        lo[k] = node.lo[k] - CAMERA_RADIUS;
+        hi[k] = node.lo[k] + node.edge + CAMERA_RADIUS;
+    }
+    if(view.frustum.classify(lo, hi) == Frustum::OUTSIDE){
+        return;
+    }
 
-    glColor3f( 0.0f, 1.0f, 1.0f ); glVertex3f( 0.0f, 1.f, 0.0f );
-    glColor3f( 0.0f, 1.0f, 0.0f ); glVertex3f( -1.0f, -1.0f, 1.0f );
-    glColor3f( 0.0f, 0.0f, 1.0f ); glVertex3f( 1.0f, -1.0f, 1.0f);
+    double distance = 0.0;
+    for(int k = 0; k < 3; k++){
+        double d = max(max(lo[k] - view.eye[k], view.eye[k] - hi[k]), 0.0);
+        distance += d * d;
+    }
+    distance = max(sqrt(distance), zNear);
+    double error = node.edge / POSE_TREE_GRID * pixelsPerUnit / distance;
+    bool leaf = node.isLeaf();
+    if(error > treeErrorPixels && !leaf){
+        bool ready = true;
+        for(int c = 0; c < 8; c++){
+            int32_t child = node.children[c];
+            if(child < 0){
+                continue;
+            }
+            if(treeCache->resident(child)){
+                treeCache->touch(child);
+            } else {
+                treeCache->request(child, error);
+                ready = false;
+            }
+        }
+        if(ready){
+            for(int c = 0; c < 8; c++){
+                if(node.children[c] >= 0){
+                    selectTreeNode(view, node.children[c], pixelsPerUnit,
+                                   zNear);
+                }
+            }
+            return;
+        }
+    }
+    if(treeCache->resident(index)){
+        treeCache->touch(index);
+        TreeDraw draw;
+        draw.node = index;
+        draw.count = (leaf && error > treeErrorPixels) ? node.count
+                                                       : node.samples;
+        bool small = 2 * CAMERA_RADIUS * pixelsPerUnit / distance <
+                     pyramidPixels;
+        (small ? view.treePoints : view.treeNodes).push_back(draw);
+    } else {
+        treeCache->request(index, error);
+    }
+}
 
-    glColor3f( 0.0f, 1.0f, 1.0f ); glVertex3f( 0.0f, 1.0f, 0.0f);
-    glColor3f( 0.0f, 1.0f, 0.0f ); glVertex3f( -1.0f, -1.0f, 1.0f);
-    glColor3f( 0.0f, 0.0f, 1.0f ); glVertex3f( 0.0f, -1.0f, -1.0f);
+/**
+ * @brief picks the cameras every viewport draws with thumbnails
+ * @return number of thumbnails the views are missing
+ * @action visible pyramids with an image and at least thumbnailPixels of
+ *         projected size are candidates. when there are more than atlas
+ *         tiles only the largest are kept, so what the views want always
+ *         fits. resident ones are drawn, missing ones are queued for
+ *         decoding largest first
+ */
+size_t TagViewer::selectThumbnails(){
+    for(size_t v = 0; v < viewports.size(); v++){
+        viewports[v].thumbnails.clear();
+    }
+    if(!thumbnailCache || !showThumbnails){
+        return 0;
+    }
+    vector<ThumbnailCandidate> candidates;
+    vector<uint32_t> nearby;
+    size_t last = min(windowLast, uploadedInstances);
+    for(size_t v = 0; v < viewports.size(); v++){
+        Viewport & view = viewports[v];
+        WorldCamera & camera = viewportCamera(v);
+        double pixelsPerUnit = view.pixels[3] /
+            (2.0 * tan(camera.getFOVY() * 0.5 * PI / 180.0));
+        const vector<uint32_t> * visible = &view.culled.pyramids;
+        if(view.allVisible){
+            // everything is in view, only cameras close enough to reach
+            // thumbnailPixels are candidates
+            double radius = (thumbnailPixels > 0)
+                ? 2 * CAMERA_RADIUS * pixelsPerUnit / thumbnailPixels
+                : HUGE_VAL;
+            nearby.clear();
+            octree->collectNear(view.eye, radius, nearby,
+                                (uint32_t)windowFirst, (uint32_t)last);
+            // in index order like a culled list, so requests are stable
+            sort(nearby.begin(), nearby.end());
+            visible = &nearby;
+        }
+        for(size_t i = 0; i < visible->size(); i++){
+            size_t index = (*visible)[i];
+            if(index >= cameraImages.size() || index >= last ||
+               cameraImages[index].empty()){
+                continue;
+            }
+            const double * p = cameras.position(index);
+            double d[3] = {p[0] - view.eye[0], p[1] - view.eye[1],
+                           p[2] - view.eye[2]};
+            double distance = max(sqrt(d[0] * d[0] + d[1] * d[1] +
+                                       d[2] * d[2]), camera.getNear());
+            double pixels = 2 * CAMERA_RADIUS * pixelsPerUnit / distance;
+            if(pixels >= thumbnailPixels){
+                ThumbnailCandidate c = {pixels, (uint32_t)index, (uint32_t)v};
+                candidates.push_back(c);
+            }
+        }
+    }
+    size_t slots = thumbnailCache->slotCount();
+    if(candidates.size() > slots){
+        nth_element(candidates.begin(), candidates.begin() + slots,
+                    candidates.end(), LargerOnScreen());
+        candidates.resize(slots);
+    }
 
-    glColor3f( 0.0f, 1.0f, 1.0f ); glVertex3f( 0.0f, 1.0f, 0.0f);
-    glColor3f( 0.0f, 1.0f, 0.0f ); glVertex3f( 0.0f, -1.0f, -1.0f);
-    glColor3f( 0.0f, 0.0f, 1.0f ); glVertex3f( 1.0f, -1.0f, 1.0f);
+    float columns = (float)(atlasColumns * THUMBNAIL_SIZE);
+    float rows = (float)((slots / atlasColumns) * THUMBNAIL_SIZE);
+    for(size_t i = 0; i < candidates.size(); i++){
+        const ThumbnailCandidate & c = candidates[i];
+        int s = thumbnailCache->slot(c.camera);
+        if(s < 0){
+            thumbnailCache->request(c.camera, cameraImages[c.camera],
+                                    c.pixels);
+            continue;
+        }
+        thumbnailCache->touch(c.camera);
+        // texel centers at the tile edges, so filtering stays in the tile
+        float x = (float)((s % atlasColumns) * THUMBNAIL_SIZE);
+        float y = (float)((s / atlasColumns) * THUMBNAIL_SIZE);
+        ThumbnailDraw draw;
+        draw.camera = c.camera;
+        draw.tile[0] = (x + 0.5f) / columns;
+        draw.tile[1] = (y + 0.5f) / rows;
+        draw.tile[2] = (x + thumbnailCache->slotWidth(s) - 0.5f) / columns;
+        draw.tile[3] = (y + thumbnailCache->slotHeight(s) - 0.5f) / rows;
+        viewports[c.view].thumbnails.push_back(draw);
+    }
+    for(size_t v = 0; v < viewports.size(); v++){
+        Viewport & view = viewports[v];
+        uploadCulled(view.thumbnailVBO, view.thumbnailCapacity,
+                     view.thumbnails.data(),
+                     view.thumbnails.size() * sizeof(ThumbnailDraw));
+    }
+    return thumbnailCache->submit();
+}
 
+/**
+ * @brief replaces contents of a cull result buffer
+ * @param vbo buffer to fill, created if 0
+ * @param capacity current buffer size in bytes, grown geometrically
+ * @param data source
+ * @param bytes size of data
+ */
+void TagViewer::uploadCulled(GLuint & vbo, size_t & capacity,
+                             const void * data, size_t bytes){
+    if(bytes == 0){
+        return;
+    }
+    if(!vbo){
+        glGenBuffers(1, &vbo);
+        capacity = 0;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if(bytes > capacity){
+        size_t size = capacity ? capacity : 4096;
+        while(size < bytes){
+            size *= 2;
+        }
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+        capacity = size;
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    glColor3f( 0.0f, 1.0f, 1.0f ); glVertex3f( -1.0f, -1.0f, 1.0f);
-    glColor3f( 0.0f, 1.0f, 0.0f ); glVertex3f( 0.0f, -1.0f, -1.0f);
-    glColor3f( 0.0f, 0.0f, 1.0f ); glVertex3f( 1.0f, -1.0f, 1.0f);
+/**
+ * @brief streams records of the mapped pose file into its GL buffer
+ * @action records go straight from the mapping to GL, a bounded slice per
+ *         frame. uploaded pages are dropped so resident memory stays small
+ */
+void TagViewer::uploadMapped(){
+    if(!poseFile || !mappedVBO || mappedUploaded == poseFile->count()){
+        return;
+    }
+    size_t total = poseFile->count();
+    size_t stride = poseFile->recordSize();
+    glBindBuffer(GL_ARRAY_BUFFER, mappedVBO);
+    if(mappedUploaded == 0){
+        glBufferData(GL_ARRAY_BUFFER, total * stride, NULL, GL_STATIC_DRAW);
+    }
+    size_t n = min(total - mappedUploaded, MAPPED_UPLOAD_BYTES / stride);
+    glBufferSubData(GL_ARRAY_BUFFER, mappedUploaded * stride, n * stride,
+                    poseFile->records() + mappedUploaded * stride);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    poseFile->release(mappedUploaded, n);
+    mappedUploaded += n;
 
-    glEnd();
+    // keep streaming on following frames
+    if(mappedUploaded < total){
+        markDirty();
+    }
+}
 
+/**
+ * @brief uploads pose tree nodes read since the last frame
+ * @action starts paging on first use. every node gets a buffer of its
+ *         own, so evicting it frees exactly its records
+ */
+void TagViewer::uploadTree(){
+    if(!poseTree){
+        return;
+    }
+    if(!treeCache){
+        startTreeCache();
+    }
+    uint32_t node;
+    vector<unsigned char> records;
+    while(treeCache->take(node, records)){
+        if(!treeVBOs[node]){
+            glGenBuffers(1, &treeVBOs[node]);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, treeVBOs[node]);
+        glBufferData(GL_ARRAY_BUFFER, records.size(),
+                     records.empty() ? NULL : &records[0], GL_STATIC_DRAW);
+        treeCache->setResident(node, records.size());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
-void TagViewer::square(){
-    glBegin(GL_TRIANGLES);
-    // set color
-    glColor3f( 1.0f, 0.0f, 0.0f );
-
-    // set vertices
-    glVertex3f( 1.0f, 0.0f, 1.0f);
-    glVertex3f( 1.0f, 0.0f, -1.0f);
-    glVertex3f( -1.0f, 0.0f, 1.0f);
-
-    glVertex3f( -1.0f, 0.0f, 1.0f);
-    glVertex3f( 1.0f, 0.0f, -1.0f);
-    glVertex3f( -1.0f, 0.0f, -1.0f);
-    glEnd();
+
+/**
+ * @brief copies thumbnails decoded since the last frame into the atlas
+ * @action starts decoding on first use. at most THUMBNAIL_UPLOADS tiles
+ *         are written per frame, the rest waits for the next one
+ */
+void TagViewer::uploadThumbnails(){
+    if(imageCount == 0 || !showThumbnails || !thumbnailProgram){
+        return;
+    }
+    if(!thumbnailCache && !startThumbnailCache()){
+        return;
+    }
+    Thumbnail thumbnail;
+    size_t uploaded = 0;
+    glBindTexture(GL_TEXTURE_2D, thumbnailTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    while(uploaded < THUMBNAIL_UPLOADS && thumbnailCache->take(thumbnail)){
+        int s = thumbnailCache->place(thumbnail);
+        if(s < 0){
+            continue;
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0,
+                        (GLint)((s % atlasColumns) * THUMBNAIL_SIZE),
+                        (GLint)((s / atlasColumns) * THUMBNAIL_SIZE),
+                        thumbnail.width, thumbnail.height, GL_RGB,
+                        GL_UNSIGNED_BYTE, &thumbnail.rgb[0]);
+        uploaded++;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if(uploaded == THUMBNAIL_UPLOADS){
+        markDirty();
+    }
 }
 //----------------------------------------------------------------------------//
 //                            END HELPER FUNCTIONS                            //
@@ -266,33 +4238,208 @@ void TagViewer::square(){
 //                             CALLBACK FUNCTIONS                             //
 //----------------------------------------------------------------------------//
 /**
- * @brief displays callback function for drawing scene
- * @action Clears scnee and draws all objects
+ * @brief draws all objects using current world camera
+ * @action Clears scene, uploads new poses and draws cameras / tag
  */
-void TagViewer::displayCB(void){
+void TagViewer::drawScene(){
     // clear color for drawing
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    drawCalls = 0;
+
+    // apply live feed, push new / changed cameras then draw the visible ones
+    // of the time window
+    {
+        ProfileScope scope(profiler, PHASE_POSE_UPDATE);
+        applyLoadedPoses(false);
+        applyPoseUpdates();
+        if(replay){
+            applyReplay(replaySpeed > 0.0 ? replayClock : INFINITY, true);
+        }
+        if(sessionLog && sessionLog->keyframeDue()){
+            logKeyframe();
+        }
+        updateTimeWindow();
+    }
+    {
+        ProfileScope scope(profiler, PHASE_UPLOAD);
+        uploadInstances();
+        uploadTags();
+        uploadObservations();
+        uploadMapped();
+        uploadTree();
+        uploadThumbnails();
+        uploadReference();
+        uploadErrors();
+    }
+    {
+        ProfileScope scope(profiler, PHASE_CULL);
+        cullViewports();
+        selectTree();
+        selectThumbnails();
+    }
+    {
+        ProfileScope scope(profiler, PHASE_DRAW);
+        for(size_t v = 0; v < viewports.size(); v++){
+            drawView(v);
+        }
+        glViewport(0, 0, width, height);
+        drawViewportBorders();
+        drawStatsOverlay();
+        drawLoadProgress();
+    }
+};
+
+/**
+ * @brief progress bar along the bottom of the window while a pose file
+ *        streams in
+ */
+void TagViewer::drawLoadProgress(){
+    if(!loader){
+        return;
+    }
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, width, 0, height, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    float left = 10.0f;
+    float right = width - 10.0f;
+    float bottom = 10.0f;
+    float top = 16.0f;
+    float filled = left + (right - left) * (float)loader->progress();
+    glBegin(GL_QUADS);
+    glColor4f(0.0f, 0.0f, 0.0f, 0.3f);
+    glVertex2f(left, bottom);
+    glVertex2f(right, bottom);
+    glVertex2f(right, top);
+    glVertex2f(left, top);
+    glColor4f(0.1f, 0.4f, 1.0f, 1.0f);
+    glVertex2f(left, bottom);
+    glVertex2f(filled, bottom);
+    glVertex2f(filled, top);
+    glVertex2f(left, top);
+    glEnd();
+
+    // bitmap fonts need GLUT
+    if(window){
+        char text[128];
+        snprintf(text, sizeof(text), "loading  %zu poses  %.0f%%",
+                 loadedPoses, loader->progress() * 100.0);
+        glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
+        glRasterPos2f(left, top + 5.0f);
+        glutBitmapString(GLUT_BITMAP_8_BY_13, (const unsigned char *)text);
+    }
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+};
+
+/**
+ * @brief draws the scene into one viewport
+ * @param index viewport index
+ * @action later viewports clear depth in their rectangle first, so they
+ *         may overlap earlier ones
+ */
+void TagViewer::drawView(size_t index){
+    const Viewport & view = viewports[index];
+    WorldCamera & camera = viewportCamera(index);
+    glViewport(view.pixels[0], view.pixels[1], view.pixels[2],
+               view.pixels[3]);
+    if(index > 0){
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(view.pixels[0], view.pixels[1], view.pixels[2],
+                  view.pixels[3]);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(camera.getFOVY(), camera.getAspect(), camera.getNear(),
+                   camera.getFar());
+    glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
+    gluLookAt(view.eye[0], view.eye[1], view.eye[2],
+              view.target[0], view.target[1], view.target[2],
+              view.up[0], view.up[1], view.up[2]);
 
-    updateWorldCameraPosition();
-    gluLookAt(
-        worldCamera.position[0], worldCamera.position[1], worldCamera.position[2],
-        worldCamera.target[0], worldCamera.target[1], worldCamera.target[2],
-        0.0, 1.0, 0.0);
+    drawFrustums(view);
+    drawThumbnails(view);
+    drawTrajectory();
+    drawReference();
+    drawObservations();
+    drawMapped();
+    drawTree(view);
+    drawTags();
+    drawHighlights();
+    glDisable(GL_SCISSOR_TEST);
+};
 
-    // setup camera
-    vector<ObjectNode>::iterator it;
-    for(it = cameras.begin(); it != cameras.end(); it++){
-        glPushMatrix();
-        drawFrustum(*it);
-        glPopMatrix();
+/**
+ * @brief outlines viewports when there is more than one
+ */
+void TagViewer::drawViewportBorders(){
+    if(viewports.size() < 2){
+        return;
     }
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, width, 0, height, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
     glPushMatrix();
-    drawTag(Tag);
+    glLoadIdentity();
+
+    glColor3f(0.5f, 0.5f, 0.5f);
+    for(size_t v = 0; v < viewports.size(); v++){
+        const int * p = viewports[v].pixels;
+        glBegin(GL_LINE_LOOP);
+        glVertex2f(p[0] + 0.5f, p[1] + 0.5f);
+        glVertex2f(p[0] + p[2] - 0.5f, p[1] + 0.5f);
+        glVertex2f(p[0] + p[2] - 0.5f, p[1] + p[3] - 0.5f);
+        glVertex2f(p[0] + 0.5f, p[1] + p[3] - 0.5f);
+        glEnd();
+    }
+
     glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+};
+
+/**
+ * @brief displays callback function for drawing scene
+ * @action draws scene and swaps buffers
+ */
+void TagViewer::displayCB(void){
+    // clear before drawing so changes made while drawing get a new frame
+    dirty = false;
+    redisplayPosted = false;
+    lastFrameTime = now();
+    profiler.beginFrame();
+    drawScene();
 
-    // swap buffers to redraw scene
-    glutSwapBuffers();
+    // swap buffers to redraw scene. recording reads the back buffer first
+    {
+        ProfileScope scope(profiler, PHASE_SWAP);
+        if(recorder){
+            recorder->capture();
+        }
+        glutSwapBuffers();
+    }
+    profiler.endFrame();
 };
 
 
@@ -300,51 +4447,147 @@ void TagViewer::displayCB(void){
  * @brief callback function for reshaping window
  * @param  w width of new window
  * @param  h height of new window
- * @action updates camera aspect, resets perspective matrix / viewport
+ * @action updates viewport rectangles and camera aspects
  */
 void TagViewer::reshapeCB(GLint w, GLint h){
+    ProfileScope scope(profiler, PHASE_INPUT);
     // reset width / height
     width = w;
     height = h;
-    worldCamera.setAspect((double)width / height);
-    // setup viewport for world camera 
-    glViewport(0, 0, width, height);
-
-    // reset perspective projection matrix
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(
-        worldCamera.getFOVY(),
-        worldCamera.getAspect(),
-        worldCamera.getNear(),
-        worldCamera.getFar());
-
-    // return to model view matrix
-    glMatrixMode(GL_MODELVIEW);
+    // viewport rectangles, aspects and projections follow in updateView /
+    // drawView
+    for(size_t v = 0; v < viewports.size(); v++){
+        updateView(v);
+    }
+    // projected camera sizes depend on the viewport height
+    sceneVersion++;
+    markDirty();
 };
 /**
  * @brief Handles keyboard event callback
  */
 void TagViewer::keyboardCB(unsigned char key, int x, int y){
-    // not implemented yet
+    ProfileScope scope(profiler, PHASE_INPUT);
+    // q / escape quits
+    if(key == 'q' || key == 27){
+        stop();
+    } else if(key == 'p'){
+        // stats overlay
+        showStats = !showStats;
+        markDirty();
+    } else if(key == ' '){
+        // playback
+        setPlaying(!playing);
+    } else if(key == ',' || key == '.' || key == '[' || key == ']'){
+        // step time / resize window by a fraction of the time range
+        double begin, end;
+        if(!timeRange(begin, end)){
+            return;
+        }
+        double step = (end - begin) * PLAYBACK_STEP;
+        if(!playback){
+            setPlayback(true);
+        }
+        if(isnan(playTime)){
+            playTime = begin;
+        }
+        if(key == ','){
+            setPlaybackTime(max(playTime - step, begin));
+        } else if(key == '.'){
+            setPlaybackTime(min(playTime + step, end));
+        } else if(key == '['){
+            setPlaybackWindow(playWindow * 0.5);
+        } else {
+            setPlaybackWindow(playWindow > 0.0 ? playWindow * 2.0 : step);
+        }
+    } else if(key == 't'){
+        // trajectory polyline
+        showTrajectory = !showTrajectory;
+        markDirty();
+    } else if(key == 'o'){
+        // observation edges
+        showObservations = !showObservations;
+        markDirty();
+    } else if(key == 'i'){
+        // camera image thumbnails
+        showThumbnails = !showThumbnails;
+        markDirty();
+    } else if(key == 'e'){
+        // reference trajectory and camera errors
+        showErrors = !showErrors;
+        markDirty();
+    } else if(key == 'c'){
+        // camera path from the start
+        playCameraPath();
+    } else if((key == '<' || key == '>') && replay){
+        seekReplay(replayTime() + (key == '<' ? -1 : 1) * REPLAY_SEEK_MS);
+    } else if(key == 'v'){
+        // next camera placement for the viewport under the cursor
+        size_t index = viewportAt(x, y);
+        setViewMode(index, (ViewMode)((viewports[index].mode + 1) % 3));
+    } else if(key == 'g' && !tags.empty()){
+        // orbit next tag in the order tags were added
+        size_t next = 0;
+        if(orbitTag){
+            next = (tagIds[orbitTagId] + 1) % tags.size();
+        }
+        for(unordered_map<uint64_t, size_t>::iterator it = tagIds.begin();
+            it != tagIds.end(); ++it){
+            if(it->second == next){
+                setOrbitTarget(it->first);
+                break;
+            }
+        }
+    }
     return;
 };
 
+/**
+ * @brief Handles window close
+ * @action leaves render loop so the caller can clean up
+ */
+void TagViewer::closeCB(void){
+    window = 0;
+    stop();
+};
+
 /**
  * @brief mouse down/up event
  */
 void TagViewer::mouseDownCB(int button, int state, int x, int y){
+    ProfileScope scope(profiler, PHASE_INPUT);
+    // the user takes over from auto framing of a streamed file
+    if(state == GLUT_DOWN){
+        autoFrame = false;
+    }
     // left button
     if (button == GLUT_LEFT_BUTTON)
     {
         mouseDown = (state == GLUT_DOWN);
         if(mouseDown){
-            // down
+            // down. drags go to the viewport pressed in
+            activeViewport = viewportAt(x, y);
             mouseId = 0;
             mouse_x = x;
             mouse_y = y;
+            press_x = x;
+            press_y = y;
         } else {
-            // up
+            // up. release where it was pressed is a click: select camera
+            if(abs(x - press_x) <= 2 && abs(y - press_y) <= 2){
+                size_t index = NO_CAMERA;
+                double position[3];
+                double rotation[4];
+                if(pickCamera(x, y, index) &&
+                   getCameraPose(index, position, rotation)){
+                    cout << "camera " << index << ": position "
+                         << position[0] << " " << position[1] << " "
+                         << position[2] << " rotation " << rotation[0] << " "
+                         << rotation[1] << " " << rotation[2] << " "
+                         << rotation[3] << endl;
+                }
+                selectCamera(index);
+            }
             mouseId = -1;
             mouse_x = -1;
             mouse_y = -1;
@@ -354,6 +4597,7 @@ void TagViewer::mouseDownCB(int button, int state, int x, int y){
         mouseDown = (state == GLUT_DOWN);
         if(mouseDown){
             // down
+            activeViewport = viewportAt(x, y);
             mouseId = 1;
             mouse_x = x;
             mouse_y = y;
@@ -364,17 +4608,19 @@ void TagViewer::mouseDownCB(int button, int state, int x, int y){
             mouse_y = -1;
         }
     } else {
+        // wheel zooms the viewport under the cursor
+        WorldCamera & camera = viewportCamera(viewportAt(x, y));
         if(button == 3){
             // wheel up
-            worldCamera.distance += 0.3;
-            glutPostRedisplay();
+            camera.distance += 0.3;
+            markDirty();
         } else if(button == 4) {
             // wheel down
-            worldCamera.distance -= 0.3;
-            if(worldCamera.distance < 0.1){
-                worldCamera.distance = 0.1;
+            camera.distance -= 0.3;
+            if(camera.distance < 0.1){
+                camera.distance = 0.1;
             }
-            glutPostRedisplay();
+            markDirty();
         }
     }
     return;
@@ -384,40 +4630,94 @@ void TagViewer::mouseDownCB(int button, int state, int x, int y){
  * @brief mouse move event handler
  */
 void TagViewer::mouseMoveCB(int x, int y){
+    ProfileScope scope(profiler, PHASE_INPUT);
     if(!mouseDown){
         return; 
     }
     double dx = (double)(x - mouse_x)/width;
     double dy = (double)(y - mouse_y)/height;
+    WorldCamera & camera = viewportCamera(activeViewport);
     
     // add dy to r
-    worldCamera.r += dy;
-    if(worldCamera.r > PI/2){
-        worldCamera.r = PI/2;
-    } else if (worldCamera.r < -PI/2){
-        worldCamera.r = -PI/2;
+    camera.r += dy;
+    if(camera.r > PI/2){
+        camera.r = PI/2;
+    } else if (camera.r < -PI/2){
+        camera.r = -PI/2;
     }
     
     // add dx to theta;
-    worldCamera.theta += dx;
-    if(worldCamera.theta > 2*PI){
-        worldCamera.theta  -= 2*PI;
-    } else if (worldCamera.theta < 0){
-        worldCamera.theta  += 2*PI;
+    camera.theta += dx;
+    if(camera.theta > 2*PI){
+        camera.theta  -= 2*PI;
+    } else if (camera.theta < 0){
+        camera.theta  += 2*PI;
     }
 
-    glutPostRedisplay();
+    markDirty();
     mouse_x = x;
     mouse_y = y;
     return;
 };
 
+/**
+ * @brief mouse move without button, highlights camera under cursor
+ * @action redraws only when the hovered camera changes
+ */
+void TagViewer::passiveMouseMoveCB(int x, int y){
+    ProfileScope scope(profiler, PHASE_INPUT);
+    size_t index = NO_CAMERA;
+    pickCamera(x, y, index);
+    if(index != hovered){
+        hovered = index;
+        markDirty();
+    }
+};
+
 /**
  * @brief called every time when nothing is happening
+ * @action advances camera path and playback time by the wall time since
+ *         the last call and requests a frame. stops at the last key / either
+ *         end of the time range. a replay requests a frame when its next
+ *         event is due and sets replayWait to the time until then
  */
 void TagViewer::idleCB(void){
-    // not implemented yet
-    return;
+    uint64_t nextEvent;
+    replayWait = -1.0;
+    if(replay && replay->peek(nextEvent)){
+        double tick = now();
+        if(replaySpeed > 0.0){
+            replayClock += (tick - replayTick) * replaySpeed * 1e6;
+        }
+        replayTick = tick;
+        // redraw once the next event is due, sleep until then
+        if(replaySpeed <= 0.0 || nextEvent <= replayClock){
+            markDirty();
+        } else {
+            replayWait = (nextEvent - replayClock) / (replaySpeed * 1e6);
+        }
+    }
+    if(pathPlaying){
+        double tick = now();
+        pathTime += tick - pathTick;
+        pathTick = tick;
+        applyCameraPath(cameraPath.begin() + pathTime);
+        if(cameraPath.begin() + pathTime >= cameraPath.end()){
+            pathPlaying = false;
+        }
+    }
+    double begin, end;
+    if(!playing || !timeRange(begin, end)){
+        return;
+    }
+    double tick = now();
+    playTime += (tick - lastTick) * playSpeed;
+    lastTick = tick;
+    if(playSpeed >= 0 ? playTime >= end : playTime <= begin){
+        playTime = max(begin, min(playTime, end));
+        playing = false;
+    }
+    markDirty();
 };
 //----------------------------------------------------------------------------//
 //                           END CALLBACK FUNCTIONS                           //
@@ -7,10 +7,23 @@
 //----------------------------------------------------------------------------//
 //                                  INCLUDES                                  //
 //----------------------------------------------------------------------------//
+#define GL_GLEXT_PROTOTYPES
 #include <GL/freeglut.h>
 #include <vector>
 #include <iterator>
 #include <cmath>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <string>
+#include "PoseStore.h"
+#include "PoseLoader.h"
+#include "PoseQueue.h"
+#include "CameraOctree.h"
+#include "FrameProfiler.h"
+#include "ObservationGraph.h"
+#include "CameraPath.h"
+#include "TrajectoryCompare.h"
 #define PI 3.1415926535
 //----------------------------------------------------------------------------//
 //                                END INCLUDES                                //
@@ -63,10 +76,138 @@ private:
  	GLdouble zFar;
 };
 
-struct ObjectNode {
-    double position[3];
-    double rotation[4];
+// how a viewport places its camera
+enum ViewMode {
+    // orbit around the target (drag turns, wheel zooms)
+    VIEW_ORBIT = 0,
+    // straight down onto the target (drag turns, wheel zooms)
+    VIEW_TOP_DOWN,
+    // through the selected capture camera, else the newest one drawn
+    VIEW_CAMERA
+};
+
+// pose tree node drawn by a viewport: its first count records
+struct TreeDraw {
+    uint32_t node;
+    uint32_t count;
+};
+
+// camera drawn with its image thumbnail: camera index and the corners
+// (u0, v0, u1, v1) of its thumbnail in the atlas
+struct ThumbnailDraw {
+    uint32_t camera;
+    float tile[4];
 };
+
+// one view into the window with its own camera and cull result. viewports
+// cull in parallel but draw from the same instance buffers
+struct Viewport {
+    // rectangle in fractions of the window, origin bottom left
+    double x;
+    double y;
+    double width;
+    double height;
+    ViewMode mode;
+    // camera of this view. viewport 0 uses TagViewer::worldCamera
+    WorldCamera camera;
+
+    // eye / target / up of the current frame and the rectangle in pixels
+    double eye[3];
+    double target[3];
+    double up[3];
+    int pixels[4];
+
+    // visible camera indices by level of detail, redone when the view, the
+    // time window or the scene changes
+    Frustum frustum;
+    size_t culledVersion;
+    size_t culledFirst;
+    size_t culledLast;
+    bool allVisible;
+    CullResult culled;
+    CullStats stats;
+    GLuint visibleVBO;
+    size_t visibleCapacity;
+    GLuint lineIndexVBO;
+    size_t lineIndexCapacity;
+    GLuint clusterVBO;
+    size_t clusterCapacity;
+    // pose tree nodes drawn as pyramids / points, picked every frame
+    vector<TreeDraw> treeNodes;
+    vector<TreeDraw> treePoints;
+    // cameras drawn with thumbnails, picked every frame
+    vector<ThumbnailDraw> thumbnails;
+    GLuint thumbnailVBO;
+    size_t thumbnailCapacity;
+
+    Viewport(double x, double y, double width, double height, ViewMode mode);
+};
+
+// vertex attribute slots used by the retained mode shaders
+enum VertexAttrib {
+    ATTRIB_VERTEX = 0,
+    ATTRIB_COLOR = 1,
+    ATTRIB_POSITION = 2,
+    ATTRIB_ROTATION = 3,
+    ATTRIB_INDEX = 4,
+    ATTRIB_EDGE = 5,
+    ATTRIB_TILE = 6
+};
+
+// capacity of the live pose feed queue
+#define POSE_QUEUE_CAPACITY (1 << 16)
+
+// bytes of mapped pose records streamed to GL per frame
+#define MAPPED_UPLOAD_BYTES (64 << 20)
+
+// default pose tree budget (see setTreeBudget)
+#define TREE_MEMORY_BYTES ((size_t)1 << 30)
+#define TREE_ERROR_PIXELS 4.0
+
+// default thumbnail atlas size / smallest pyramid in pixels textured with
+// its image (see setThumbnailBudget)
+#define THUMBNAIL_MEMORY_BYTES ((size_t)64 << 20)
+#define THUMBNAIL_PIXELS 64.0
+// thumbnails uploaded into the atlas per frame at most
+#define THUMBNAIL_UPLOADS 16
+
+// seconds per frame spent adding poses of a streamed file / the socket
+// feed, in batches of LOAD_BATCH poses
+#define LOAD_FRAME_SECONDS 0.008
+#define LOAD_BATCH 8192
+
+// default level of detail thresholds in pixels (see setLodThresholds)
+#define LOD_PYRAMID_PIXELS 6.0
+#define LOD_CLUSTER_PIXELS 8.0
+// size of a cluster proxy point in pixels
+#define CLUSTER_POINT_SIZE 3.0f
+
+// fraction of the time range covered by one playback step ('.' / ',') and
+// by the first window opened with ']'
+#define PLAYBACK_STEP 0.01
+
+// observation edges drawn per frame at most. denser graphs are drawn
+// every k-th edge
+#define EDGE_DRAW_BUDGET (1 << 16)
+
+// session time skipped by '<' / '>' while replaying, in ms
+#define REPLAY_SEEK_MS 10000.0
+
+// camera index meaning none (picking / selection)
+#define NO_CAMERA ((size_t)-1)
+
+// id of the tag set by setTagOrigin
+#define TAG_ORIGIN_ID 0
+
+class PoseFile;
+class PoseTree;
+class PoseTreeCache;
+class ThumbnailCache;
+class OffscreenContext;
+class FrameRecorder;
+class PoseServer;
+class SessionWriter;
+class SessionReader;
 //----------------------------------------------------------------------------//
 //                        END HELPER CLASS DEFINITION                         //
 //----------------------------------------------------------------------------//
@@ -77,27 +218,218 @@ class TagViewer
 {
 public:
     // define constructor / destructor / copy constructor / assignment operator
+    // copies share the scene (copy on write), moves take over the window /
+    // context and GL objects too
     TagViewer();
     TagViewer(int width, int height);
     TagViewer(const TagViewer & obj);
+    TagViewer(TagViewer && obj);
     ~TagViewer();
     TagViewer & operator=(const TagViewer& tv);
+    TagViewer & operator=(TagViewer && tv);
     
     // adds camera to display
     void addCamera(double * position, double * rotation);
 
+    // adds n cameras at once (positions: n*3, rotations: n*4, timestamps: n
+    // or NULL, see PoseStore::add)
+    void addCameras(const double * positions, const double * rotations,
+                    size_t n, const double * timestamps = NULL);
+
+    // loads cameras from binary / TUM / CSV pose file. returns poses loaded
+    size_t loadPoses(const char * path);
+
+    // loads pose file on a background thread and adds its chunks between
+    // frames, so frames keep coming while the file fills in. until the
+    // user moves the camera it frames the cameras loaded so far
+    bool streamPoses(const char * path);
+    bool isLoading() const { return loader != 0; };
+    // fraction of the streamed file read, 1 when not loading
+    double loadProgress() const;
+
+    // thread safe live feed. updates are queued without blocking and
+    // applied by the render thread once per frame. false if queue is full
+    bool pushCamera(const double * position, const double * rotation);
+    bool pushCamera(uint64_t id, const double * position,
+                    const double * rotation);
+    bool pushTagOrigin(const double * position, const double * rotation);
+    bool pushTag(uint64_t id, const double * position,
+                 const double * rotation);
+
+    // accepts the live feed from other processes on a UNIX domain / TCP
+    // socket (see PoseServer.h). everything received between two frames is
+    // applied as one batch. false if address can't be listened on
+    bool startServer(const char * address);
+    void stopServer();
+    bool isServing() const { return server != 0; };
+
+    // removes all cameras, their feed ids and observation edges
+    void clearCameras();
+
+    // session log. every camera / tag update from here on (direct calls,
+    // loaded text / binary files and the live feed) is written with its
+    // arrival time. stop closes the log, false if a write failed
+    bool startSessionLog(const char * path);
+    bool stopSessionLog();
+    // replays a session log into the scene at speed times real time, 0 as
+    // fast as frames allow. seeking back rebuilds the scene from the start
+    bool replaySession(const char * path, double speed = 1.0);
+    void seekReplay(double ms);
+    bool isReplaying() const { return replay != 0; };
+    // session time of the replay / length of the replayed log in ms
+    double replayTime() const { return replayClock / 1000.0; };
+    double replayDuration() const;
+
+    // maps pose file and renders straight from it (see PoseFile.h)
+    bool openPoseFile(const char * path);
+
+    // opens a pose tree (see PoseTree.h) of any size. only the nodes the
+    // views need for errorPixels of screen space error are paged in, at
+    // most memoryBytes of them stay resident
+    bool openPoseTree(const char * path);
+    void setTreeBudget(size_t memoryBytes, double errorPixels);
+
+    // image of camera index (PNG / PPM / JPEG, see ImageReader.h). pyramids
+    // at least thumbnailPixels large show it on their base once it has
+    // been decoded in the background. "" removes it
+    void setCameraImage(size_t camera, const string & path);
+    void clearCameraImages();
+    size_t cameraImageCount() const { return imageCount; };
+    // thumbnails are kept in an atlas of memoryBytes, the largest ones on
+    // screen win when more are visible than fit. 0 disables them
+    void setThumbnailBudget(size_t memoryBytes, double pixels);
+
+    // reference trajectory (e.g. ground truth) the cameras are compared
+    // against, drawn as a line through its poses. returns poses loaded
+    size_t loadReference(const char * path);
+    void clearReference();
+    size_t referenceCount() const { return reference.size(); };
+    // fits the cameras onto the reference (mode, from poses at most
+    // maxTimeDifference apart in time), moves them there and colors every
+    // camera by its distance to the nearest reference pose. 'e' toggles
+    // the coloring. false without reference / cameras or if too few poses
+    // pair up for the fit
+    bool compareToReference(AlignMode mode, double maxTimeDifference,
+                            Alignment & alignment, TrajectoryErrors & errors);
+    // error colored red and above, 0 for 3x the ATE rmse
+    void setErrorRange(double range);
+
     // adds Tag position / rotation used as origin
     void setTagOrigin(double * position, double * rotation);
 
+    // tag registry. inserts tag id, or moves it if the id already exists
+    void setTag(uint64_t id, const double * position,
+                const double * rotation);
+    // pose of tag id. false if unknown
+    bool getTagPose(uint64_t id, double * position, double * rotation) const;
+    size_t tagCount() const { return tags.size(); };
+    // world camera orbits tag id and follows it when it moves. false if
+    // unknown
+    bool setOrbitTarget(uint64_t id);
+
+    // camera index observes tag id, drawn as a line between the two. false
+    // if the tag is unknown
+    bool addObservation(size_t camera, uint64_t tagId);
+    void clearObservations();
+    size_t observationCount();
+
     // sets world camera position based on target
     void updateWorldCameraPosition();
     
     // sets up window and GL drawing environments
     void initWindow(int & argv, char** argc);
+
+    // sets up windowless (EGL) GL drawing environment instead of a window
+    bool initOffscreen();
+
+    // renders current view and waits until it is finished
+    void drawFrame();
+
+    // renders current view and writes it to path (PNG / PPM)
+    bool saveFrame(const char * path);
     
-    // draws scene
+    // processes pending events once (see run)
     void renderFrame();
 
+    // event driven render loop. returns after stop() or window close
+    void run();
+    void stop();
+
+    // marks scene changed so a new frame is drawn. thread safe
+    void markDirty();
+
+    // frame rate cap (0 = unlimited) / vsync on swap
+    void setFrameRateLimit(double fps);
+    void setVSync(bool enabled);
+
+    // cameras projected smaller than pyramidPixels are drawn as lines,
+    // groups smaller than clusterPixels as one point. 0 disables a level
+    void setLodThresholds(double pyramidPixels, double clusterPixels);
+
+    // visible / total counters of the last frustum cull of viewport 0
+    const CullStats & cullStats() const { return viewports[0].stats; };
+
+    // split screen. viewport 0 (the whole window by default) shows
+    // worldCamera, added viewports start from a copy of it. rectangles are
+    // fractions of the window, origin bottom left
+    size_t addViewport(double x, double y, double w, double h,
+                       ViewMode mode = VIEW_ORBIT);
+    void setViewport(size_t index, double x, double y, double w, double h);
+    void setViewMode(size_t index, ViewMode mode);
+    size_t viewportCount() const { return viewports.size(); };
+    WorldCamera & viewportCamera(size_t index);
+    // replaces all viewports with one per mode, side by side (2x2 for 4)
+    void setViewportLayout(const vector<ViewMode> & modes);
+
+    // GL draw calls issued by the last frame
+    size_t frameDrawCalls() const { return drawCalls; };
+
+    // camera under window pixel x,y (GLUT coordinates). O(log n) ray cast
+    // through the camera octree
+    bool pickCamera(int x, int y, size_t & index);
+    // pose of camera index. false if out of range
+    bool getCameraPose(size_t index, double * position,
+                       double * rotation) const;
+    // highlighted camera, set by clicking a camera. NO_CAMERA for none
+    void selectCamera(size_t index);
+    size_t selectedCamera() const { return selected; };
+
+    // time line playback. while enabled only cameras with timestamps in
+    // [time - window, time] are drawn (window 0: everything up to time),
+    // joined by their trajectory. idleCB advances time while playing
+    void setPlayback(bool enabled);
+    bool playbackEnabled() const { return playback; };
+    void setPlaybackTime(double time);
+    double playbackTime() const { return playTime; };
+    void setPlaybackWindow(double window);
+    double playbackWindow() const { return playWindow; };
+    // timestamp units advanced per second while playing
+    void setPlaybackSpeed(double speed);
+    void setPlaying(bool playing);
+    bool isPlaying() const { return playing; };
+    // first / last camera timestamp. false without cameras
+    bool timeRange(double & begin, double & end) const;
+
+    // records every displayed frame to target (image pattern or "|command",
+    // see FrameRecorder.h) until stopRecording. frames are dropped rather
+    // than slowing down the window when the encoders fall behind
+    bool startRecording(const char * target, int workers = 0);
+    bool stopRecording();
+    bool isRecording() const;
+
+    // keyframed world camera orbit. playCameraPath runs it once in the
+    // window ('c' restarts it), exportCameraPath renders every frame of it
+    // at a fixed rate without dropping any
+    void setCameraPath(const CameraPath & path);
+    const CameraPath & getCameraPath() const { return cameraPath; };
+    void playCameraPath();
+    bool exportCameraPath(const char * target, double fps, int workers = 0);
+
+    // per phase frame timings. 'p' toggles the on screen stats overlay
+    const FrameProfiler & frameProfiler() const { return profiler; };
+    // records frame phases into a Chrome trace JSON until stopTrace
+    bool startTrace(const char * path);
+    void stopTrace();
 
     // define GLUT callback functions
     void displayCB(void);
@@ -105,14 +437,36 @@ public:
     void keyboardCB(unsigned char key, int x, int y);
     void mouseDownCB(int button, int state, int x, int y);
     void mouseMoveCB(int x, int y);
+    void passiveMouseMoveCB(int x, int y);
     void idleCB(void);
+    void closeCB(void);
     
 
     // World Camera
     WorldCamera worldCamera;
 private:
-    // holds camera vector
-    vector<ObjectNode> cameras;
+    // holds camera poses and their packed GPU instances, shared block wise
+    // with copies of this viewer
+    PoseStore cameras;
+
+    // live feed from producer threads, drained in applyPoseUpdates
+    PoseQueue poseUpdates;
+    // socket feed, 0 when not listening. the batch taken from it last is
+    // applied from serverOffset on
+    PoseServer * server;
+    vector<PoseUpdate> serverUpdates;
+    size_t serverOffset;
+    // live feed camera id -> index in cameras
+    unordered_map<uint64_t, size_t> cameraIds;
+    // range of already uploaded cameras changed since last upload
+    size_t updatedBegin;
+    size_t updatedEnd;
+
+    // spatial index over camera positions, updated as cameras are added /
+    // moved. bumped sceneVersion invalidates the cached cull. shared with
+    // copies of this viewer until one of them changes it
+    shared_ptr<CameraOctree> octree;
+    size_t sceneVersion;
 
     // window with / height
     int width;
@@ -123,17 +477,241 @@ private:
     int mouseId;
     int mouse_x;
     int mouse_y;
+    // left button press position, to tell clicks from drags
+    int press_x;
+    int press_y;
 
-    // holds pos/rot for tag
-    ObjectNode Tag;
+    // picked cameras
+    size_t hovered;
+    size_t selected;
+
+    // tag poses, tag id -> index in tags. tags [tagsUploaded, size) and
+    // from tagsChanged on are sent to GL next frame
+    PoseStore tags;
+    unordered_map<uint64_t, size_t> tagIds;
+    size_t tagsUploaded;
+    size_t tagsChanged;
+    // tag the world camera orbits
+    bool orbitTag;
+    uint64_t orbitTagId;
+
+    // camera -> tag edges. edges before edgesUploaded are in edgeVBO
+    ObservationGraph observations;
+    size_t edgesUploaded;
+    bool showObservations;
+
+    // retained mode GL objects
+    GLuint frustumProgram;
+    GLuint pyramidVBO;
+    GLuint lineVBO;
+    GLuint squareVBO;
+    GLuint instanceVBO;
+    size_t instanceCapacity;
+    size_t uploadedInstances;
+    size_t drawCalls;
+    // camera instances (see PoseStore::instance) read by index from
+    // instanceVBO, 2 texels per camera
+    GLuint poseTexture;
+    // single poses given as constant attributes, or mapped records as
+    // instanced attributes
+    GLuint poseProgram;
+    // tag instances, read like camera instances through tagTexture
+    GLuint tagVBO;
+    size_t tagCapacity;
+    GLuint tagTexture;
+    // observation edges, both ends fetched from the pose textures
+    GLuint edgeProgram;
+    GLuint edgeVBO;
+    size_t edgeCapacity;
+
+    // split screen views, never empty. mouse drags go to the viewport
+    // pressed in
+    vector<Viewport> viewports;
+    size_t activeViewport;
+    double pyramidPixels;
+    double clusterPixels;
+
+    // GLUT window id, 0 before initWindow / after close
+    int window;
+    // windowless context when rendering headless, 0 with a GLUT window
+    OffscreenContext * offscreen;
+
+    // frame scheduler state
+    atomic<bool> running;
+    atomic<bool> dirty;
+    bool redisplayPosted;
+    bool vsync;
+    double minFrameInterval;
+    double lastFrameTime;
+    // self pipe written by wakeup() to unblock waitForEvents
+    int wakePipe[2];
+
+    // frame phase timings / stats overlay
+    FrameProfiler profiler;
+    bool showStats;
+
+    // time line playback. cameras [windowFirst, windowLast) are in the
+    // current time window (all of them with playback off)
+    bool playback;
+    bool playing;
+    double playTime;
+    double playWindow;
+    double playSpeed;
+    double lastTick;
+    bool showTrajectory;
+    size_t windowFirst;
+    size_t windowLast;
+
+    // pose file streamed by streamPoses, 0 when done. loadChunk is being
+    // added from loadOffset on
+    PoseLoader * loader;
+    PoseChunk loadChunk;
+    size_t loadOffset;
+    size_t loadedPoses;
+    // bounds (min x,y,z, max x,y,z) of the streamed cameras, framed while
+    // autoFrame is set
+    double loadBounds[6];
+    bool autoFrame;
+
+    // session log written, 0 when not logging. logMuted while an update
+    // already logged as a whole is applied
+    SessionWriter * sessionLog;
+    bool logMuted;
+    // session log replayed, 0 when not replaying. replayClock microseconds
+    // of the session have been replayed, replayWait seconds until the next
+    // event is due (-1 for none)
+    SessionReader * replay;
+    double replaySpeed;
+    double replayClock;
+    double replayTick;
+    double replayWait;
+    vector<PoseUpdate> replayBatch;
+
+    // frame capture, 0 while not recording
+    FrameRecorder * recorder;
+    // camera path played by idleCB, pathTime seconds into the path
+    CameraPath cameraPath;
+    bool pathPlaying;
+    double pathTime;
+    double pathTick;
+
+    // memory mapped pose file, drawn without copying into cameras. shared
+    // with copies of this viewer
+    shared_ptr<PoseFile> poseFile;
+    GLuint mappedVBO;
+    size_t mappedUploaded;
+
+    // out of core pose tree. the file is shared with copies of this viewer,
+    // paging and one buffer per resident node are per viewer
+    shared_ptr<PoseTree> poseTree;
+    PoseTreeCache * treeCache;
+    vector<GLuint> treeVBOs;
+    size_t treeMemory;
+    double treeErrorPixels;
+
+    // camera index -> image path ("" for none) and thumbnails of them. the
+    // atlas has atlasColumns tiles per row, as many as the cache has slots
+    vector<string> cameraImages;
+    size_t imageCount;
+    ThumbnailCache * thumbnailCache;
+    GLuint thumbnailTexture;
+    GLuint thumbnailProgram;
+    size_t atlasColumns;
+    size_t thumbnailMemory;
+    double thumbnailPixels;
+    bool showThumbnails;
+
+    // reference trajectory, drawn from its instances in referenceVBO.
+    // cameraErrors holds the translation error of every compared camera,
+    // read by the frustum shader through errorTexture
+    PoseStore reference;
+    GLuint referenceVBO;
+    bool referenceUploaded;
+    vector<float> cameraErrors;
+    GLuint errorVBO;
+    GLuint errorTexture;
+    bool errorsUploaded;
+    double errorRange;
+    double errorRmse;
+    bool showErrors;
+
+    void finishUploads();
+    void applyLoadedPoses(bool wait);
+    static void notifyDirty(void * viewer);
+    void frameLoadedPoses();
+    void drawLoadProgress();
+    void applyCameraPath(double time);
+    void copyScene(const TagViewer & obj);
+    void swapState(TagViewer & obj);
+    CameraOctree & writableOctree();
 
     // OpenGL Drawing Functions
-    void drawFrustum(ObjectNode& obj);
-    void drawTag(ObjectNode & obj);
-    void pyramid();
-    void square();
-    void applyQuaternion(double *  quat);
-    
+    void initGLState();
+    void initBuffers();
+    bool makeCurrent();
+    void releaseGL(bool deleteObjects);
+    static void windowClosed();
+    void drawScene();
+    void wakeup();
+    void waitForEvents(double timeout);
+    void initWakePipe();
+    void applySwapInterval();
+    static double now();
+    void applyPoseUpdates();
+    void applyUpdates(const PoseUpdate * updates, size_t n);
+    void logUpdate(uint32_t type, uint64_t id, const double * position,
+                   const double * rotation, double time = NAN);
+    void logKeyframe();
+    void applyReplay(double until, bool budgeted);
+    void clearTags();
+    void updateTimeWindow();
+    void sortCamerasByTime();
+    void uploadInstances();
+    void uploadMapped();
+    void uploadTree();
+    void startTreeCache();
+    void releaseTree();
+    bool startThumbnailCache();
+    void releaseThumbnails();
+    void uploadThumbnails();
+    void uploadReference();
+    void uploadErrors();
+    void updateView(size_t index);
+    void cullViewports();
+    size_t selectTree();
+    void selectTreeNode(Viewport & view, uint32_t index,
+                        double pixelsPerUnit, double zNear);
+    size_t selectThumbnails();
+    void uploadCulled(GLuint & vbo, size_t & capacity, const void * data,
+                      size_t bytes);
+    void releaseViewport(Viewport & view);
+    size_t viewportAt(int x, int y) const;
+    void drawView(size_t index);
+    void drawViewportBorders();
+    void drawFrustums(const Viewport & view);
+    void drawPoseInstances(GLuint poses, GLuint geometry, GLenum mode,
+                           GLsizei vertices, GLuint indices, size_t first,
+                           size_t count);
+    void drawTrajectory();
+    void usePoseProgram(bool lit);
+    void drawClusters(const Viewport & view);
+    void beginMappedDraw(bool points);
+    void bindMappedRecords(GLuint vbo, bool quantized, const float * offset,
+                           const float * scale);
+    void endMappedDraw();
+    void drawMapped();
+    void drawTree(const Viewport & view);
+    void drawThumbnails(const Viewport & view);
+    void drawReference();
+    void uploadTags();
+    void uploadObservations();
+    void drawTags();
+    void drawObservations();
+    void drawStatsOverlay();
+    void drawHighlights();
+    void drawHighlight(size_t index, float r, float g, float b);
+    void pickRay(int x, int y, double * origin, double * dir);
+
 };
 //----------------------------------------------------------------------------//
 //                            END CLASS DEFINITION                            //
@@ -0,0 +1,371 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : ThumbnailCache.cpp
+ * @brief      : Definition file for the camera thumbnail cache
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <iostream>
+#include <algorithm>
+#include "ThumbnailCache.h"
+#include "ImageReader.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+ThumbnailCache::ThumbnailCache(){
+    frame = 1;
+    decoding = 0;
+    stopping = false;
+    notify = 0;
+    notifyArg = 0;
+};
+
+/**
+ * @brief Destructor
+ * @action joins the worker threads
+ */
+ThumbnailCache::~ThumbnailCache(){
+    stop();
+};
+
+/**
+ * @brief starts decoding
+ * @param slots number of atlas tiles
+ * @param threads number of worker threads
+ */
+void ThumbnailCache::start(size_t slots, int threads){
+    stop();
+    slotCamera.assign(slots, -1);
+    slotSize.assign(2 * slots, 0);
+    slotFrame.assign(slots, 0);
+    lruPosition.assign(slots, lru.end());
+    freeSlots.clear();
+    for(size_t s = slots; s > 0; s--){
+        freeSlots.push_back((int)s - 1);
+    }
+    frame = 1;
+    stopping = false;
+    for(int i = 0; i < max(threads, 1); i++){
+        workers.push_back(thread(&ThumbnailCache::run, this));
+    }
+};
+
+/**
+ * @brief stops worker threads and forgets all cameras
+ */
+void ThumbnailCache::stop(){
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    queued.notify_all();
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+    workers.clear();
+    queue.clear();
+    decoded.clear();
+    decoding = 0;
+    state.clear();
+    slots.clear();
+    slotCamera.clear();
+    slotSize.clear();
+    slotFrame.clear();
+    lru.clear();
+    lruPosition.clear();
+    freeSlots.clear();
+    wanted.clear();
+};
+
+/**
+ * @brief atlas tile holding the thumbnail of camera
+ * @return tile index, -1 if the camera is not resident
+ */
+int ThumbnailCache::slot(uint32_t camera) const{
+    unordered_map<uint32_t, int>::const_iterator it = slots.find(camera);
+    return (it == slots.end()) ? -1 : it->second;
+};
+
+/**
+ * @brief asks for the thumbnail of a camera that is not resident
+ * @param camera camera index
+ * @param path image file of the camera
+ * @param pixels projected size of the camera
+ */
+void ThumbnailCache::request(uint32_t camera, const string & path,
+                             double pixels){
+    Request r;
+    r.camera = camera;
+    r.pixels = pixels;
+    r.path = path;
+    wanted.push_back(r);
+};
+
+/**
+ * @brief marks resident camera as drawn in this frame
+ */
+void ThumbnailCache::touch(uint32_t camera){
+    int s = slot(camera);
+    if(s < 0){
+        return;
+    }
+    slotFrame[s] = frame;
+    lru.splice(lru.begin(), lru, lruPosition[s]);
+};
+
+/**
+ * @brief hands this frame's requests to the workers
+ * @return number of cameras requested in this frame
+ * @action decodes not started yet are dropped, cameras the view moved away
+ *         from are not decoded at all. failed images are not asked for
+ *         again
+ */
+size_t ThumbnailCache::submit(){
+    size_t requested = wanted.size();
+    sort(wanted.begin(), wanted.end(), RequestOrder());
+    bool hasWork;
+    {
+        unique_lock<mutex> guard(lock);
+        for(size_t i = 0; i < queue.size(); i++){
+            unordered_map<uint32_t, unsigned char>::iterator it =
+                state.find(queue[i].camera);
+            if(it != state.end() && it->second == QUEUED){
+                state.erase(it);
+            }
+        }
+        queue.clear();
+        // most urgent first, so a camera wanted by several views keeps its
+        // largest size
+        for(size_t i = wanted.size(); i > 0; i--){
+            Request & r = wanted[i - 1];
+            if(state.insert(make_pair(r.camera, (unsigned char)QUEUED))
+               .second){
+                queue.push_back(Request());
+                queue.back().camera = r.camera;
+                queue.back().pixels = r.pixels;
+                queue.back().path.swap(r.path);
+            }
+        }
+        reverse(queue.begin(), queue.end());
+        hasWork = !queue.empty();
+    }
+    if(hasWork){
+        queued.notify_all();
+    }
+    wanted.clear();
+    frame++;
+    return requested;
+};
+
+/**
+ * @brief takes a thumbnail decoded by a worker
+ * @param thumbnail output thumbnail
+ * @return false if no decode finished since the last call
+ */
+bool ThumbnailCache::take(Thumbnail & thumbnail){
+    unique_lock<mutex> guard(lock);
+    if(decoded.empty()){
+        return false;
+    }
+    thumbnail.camera = decoded.back().camera;
+    thumbnail.width = decoded.back().width;
+    thumbnail.height = decoded.back().height;
+    thumbnail.rgb.swap(decoded.back().rgb);
+    decoded.pop_back();
+    // workers hold back while MAX_DECODED wait
+    queued.notify_all();
+    return true;
+};
+
+/**
+ * @brief assigns a tile to a taken thumbnail
+ * @param thumbnail thumbnail taken from the cache
+ * @return tile the owner uploads the thumbnail to, -1 if none can be freed
+ * @action a free tile is used first, else the least recently drawn one is
+ *         taken from its camera. the new tile counts as drawn in this
+ *         frame, so thumbnails uploaded together don't evict each other
+ */
+int ThumbnailCache::place(const Thumbnail & thumbnail){
+    int s = slot(thumbnail.camera);
+    if(s >= 0){
+        return s;
+    }
+    if(!freeSlots.empty()){
+        s = freeSlots.back();
+        freeSlots.pop_back();
+    } else if(!lru.empty() && slotFrame[lru.back()] != frame){
+        s = lru.back();
+        lru.pop_back();
+        uint32_t evicted = (uint32_t)slotCamera[s];
+        slots.erase(evicted);
+        unique_lock<mutex> guard(lock);
+        state.erase(evicted);
+    } else {
+        unique_lock<mutex> guard(lock);
+        state.erase(thumbnail.camera);
+        return -1;
+    }
+    slots[thumbnail.camera] = s;
+    slotCamera[s] = thumbnail.camera;
+    slotSize[2 * s] = thumbnail.width;
+    slotSize[2 * s + 1] = thumbnail.height;
+    slotFrame[s] = frame;
+    lru.push_front(s);
+    lruPosition[s] = lru.begin();
+    unique_lock<mutex> guard(lock);
+    state[thumbnail.camera] = RESIDENT;
+    return s;
+};
+
+/**
+ * @brief waits for the workers
+ * @action returns once a thumbnail is waiting to be taken, or right away
+ *         when nothing is queued or in flight
+ */
+void ThumbnailCache::wait(){
+    unique_lock<mutex> guard(lock);
+    while(decoded.empty() && (!queue.empty() || decoding > 0)){
+        finished.wait(guard);
+    }
+};
+
+/**
+ * @brief sets callback run after each decode
+ */
+void ThumbnailCache::setNotify(void (*callback)(void *), void * arg){
+    unique_lock<mutex> guard(lock);
+    notify = callback;
+    notifyArg = arg;
+};
+
+/**
+ * @brief decodes queued, in flight or waiting to be taken
+ */
+size_t ThumbnailCache::pending(){
+    unique_lock<mutex> guard(lock);
+    return queue.size() + decoding + decoded.size();
+};
+
+/**
+ * @brief shrinks an image into a thumbnail
+ * @param rgb packed rgb pixels
+ * @param width,height image size
+ * @param thumbnail output size and pixels. images smaller than a tile keep
+ *        their size
+ * @action every thumbnail pixel averages the image pixels it covers
+ */
+void ThumbnailCache::shrink(const vector<unsigned char> & rgb, int width,
+                            int height, Thumbnail & thumbnail){
+    int w = min(width, THUMBNAIL_SIZE);
+    int h = min(height, THUMBNAIL_SIZE);
+    if(width >= height){
+        h = max(1, (int)((double)height * w / width + 0.5));
+    } else {
+        w = max(1, (int)((double)width * h / height + 0.5));
+    }
+    thumbnail.width = w;
+    thumbnail.height = h;
+    thumbnail.rgb.resize((size_t)w * h * 3);
+    vector<uint32_t> sums((size_t)w * 3);
+    for(int y = 0; y < h; y++){
+        int y0 = (int)((int64_t)y * height / h);
+        int y1 = max(y0 + 1, (int)((int64_t)(y + 1) * height / h));
+        fill(sums.begin(), sums.end(), 0);
+        for(int sy = y0; sy < y1; sy++){
+            const unsigned char * row = &rgb[(size_t)sy * width * 3];
+            for(int x = 0; x < w; x++){
+                int x0 = (int)((int64_t)x * width / w);
+                int x1 = max(x0 + 1, (int)((int64_t)(x + 1) * width / w));
+                for(int sx = x0; sx < x1; sx++){
+                    sums[3 * x] += row[3 * sx];
+                    sums[3 * x + 1] += row[3 * sx + 1];
+                    sums[3 * x + 2] += row[3 * sx + 2];
+                }
+            }
+        }
+        unsigned char * out = &thumbnail.rgb[(size_t)y * w * 3];
+        for(int x = 0; x < w; x++){
+            int x0 = (int)((int64_t)x * width / w);
+            int x1 = max(x0 + 1, (int)((int64_t)(x + 1) * width / w));
+            uint32_t area = (uint32_t)((x1 - x0) * (y1 - y0));
+            for(int c = 0; c < 3; c++){
+                out[3 * x + c] = (unsigned char)(sums[3 * x + c] / area);
+            }
+        }
+    }
+};
+
+bool ThumbnailCache::RequestOrder::operator()(const Request & a,
+                                              const Request & b) const{
+    return a.pixels < b.pixels;
+};
+
+/**
+ * @brief worker thread body. decodes the most urgent queued image
+ * @action an image that fails to decode is marked failed and never asked
+ *         for again
+ */
+void ThumbnailCache::run(){
+    unique_lock<mutex> guard(lock);
+    while(true){
+        while(!stopping &&
+              (queue.empty() || decoded.size() + decoding >= MAX_DECODED)){
+            queued.wait(guard);
+        }
+        if(stopping){
+            return;
+        }
+        Request request;
+        request.camera = queue.back().camera;
+        request.path.swap(queue.back().path);
+        queue.pop_back();
+        state[request.camera] = DECODING;
+        decoding++;
+        guard.unlock();
+
+        Thumbnail thumbnail;
+        thumbnail.camera = request.camera;
+        vector<unsigned char> rgb;
+        int width, height;
+        bool ok = readImage(request.path.c_str(), rgb, width, height);
+        if(ok){
+            shrink(rgb, width, height, thumbnail);
+        }
+
+        guard.lock();
+        decoding--;
+        if(ok){
+            decoded.push_back(Thumbnail());
+            decoded.back().camera = thumbnail.camera;
+            decoded.back().width = thumbnail.width;
+            decoded.back().height = thumbnail.height;
+            decoded.back().rgb.swap(thumbnail.rgb);
+        } else {
+            cerr << "ThumbnailCache: could not read image " << request.path
+                 << endl;
+            state[request.camera] = FAILED;
+        }
+        finished.notify_all();
+        if(notify){
+            notify(notifyArg);
+        }
+    }
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
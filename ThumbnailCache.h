@@ -0,0 +1,165 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : ThumbnailCache.h
+ * @brief      : Camera image thumbnails decoded on worker threads and kept
+ *               in the tiles of a fixed size texture atlas
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <vector>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// edge of an atlas tile in texels. thumbnails are scaled to fit one,
+// keeping their aspect ratio
+#define THUMBNAIL_SIZE 128
+// bytes of atlas per tile (RGBA8)
+#define THUMBNAIL_TILE_BYTES (THUMBNAIL_SIZE * THUMBNAIL_SIZE * 4)
+
+// decoded thumbnail, packed 8 bit RGB rows, top row first
+struct Thumbnail {
+    uint32_t camera;
+    int width;
+    int height;
+    vector<unsigned char> rgb;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+// Assigns camera images to a fixed number of atlas tiles. Each frame the
+// render thread touches the cameras it draws and requests the ones it is
+// missing; submit replaces the decodes still waiting from the last frame
+// with the new requests, largest on screen first. Worker threads decode
+// and shrink the images, at most MAX_DECODED of them wait for the owner
+// to take and upload, so a backlog of requests never piles up decoded
+// images. place puts a thumbnail into a free tile or the least recently
+// used one not drawn this frame. The owner's atlas has exactly slotCount
+// tiles, so the cache never grows past it
+class ThumbnailCache
+{
+public:
+    ThumbnailCache();
+    ~ThumbnailCache();
+
+    // starts decoding for an atlas of slots tiles with threads workers
+    void start(size_t slots, int threads = DECODE_THREADS);
+    void stop();
+    size_t slotCount() const { return slotCamera.size(); };
+
+    // render thread side
+    // atlas tile of camera, -1 if not resident
+    int slot(uint32_t camera) const;
+    // width / height of the thumbnail in tile s
+    int slotWidth(int s) const { return slotSize[2 * s]; };
+    int slotHeight(int s) const { return slotSize[2 * s + 1]; };
+    // asks for the image at path, more urgent with larger pixels on screen
+    void request(uint32_t camera, const string & path, double pixels);
+    // marks resident camera as drawn in this frame
+    void touch(uint32_t camera);
+    // queues this frame's requests and starts the next frame. returns the
+    // number of cameras requested
+    size_t submit();
+    // takes a decoded thumbnail. false if none is waiting
+    bool take(Thumbnail & thumbnail);
+    // assigns a tile to the taken thumbnail. returns the tile to upload it
+    // to, -1 if every tile is drawn in this frame (the thumbnail is
+    // dropped and asked for again later)
+    int place(const Thumbnail & thumbnail);
+    // blocks until a decode finished or none is queued / in flight
+    void wait();
+
+    // callback run on a worker thread after each decode (e.g. to wake a
+    // render loop). runs under the cache lock, must not call back into the
+    // cache. 0 to remove
+    void setNotify(void (*callback)(void *), void * arg);
+
+    size_t residentCount() const { return slots.size(); };
+    // decodes queued, in flight or waiting to be taken
+    size_t pending();
+
+    // scales rgb (width x height) to fit a THUMBNAIL_SIZE square with a box
+    // filter
+    static void shrink(const vector<unsigned char> & rgb, int width,
+                       int height, Thumbnail & thumbnail);
+
+    static const int DECODE_THREADS = 2;
+    static const size_t MAX_DECODED = 64;
+private:
+    ThumbnailCache(const ThumbnailCache & obj);
+    ThumbnailCache & operator=(const ThumbnailCache & obj);
+
+    enum State {
+        QUEUED,
+        DECODING,
+        RESIDENT,
+        FAILED
+    };
+
+    struct Request {
+        uint32_t camera;
+        double pixels;
+        string path;
+    };
+
+    // orders requests least urgent first, so the most urgent is popped
+    // from the back
+    struct RequestOrder {
+        bool operator()(const Request & a, const Request & b) const;
+    };
+
+    // worker thread body
+    void run();
+
+    // render thread only. camera -> tile, tile -> camera (-1 if free),
+    // tiles by last use, most recent first
+    unordered_map<uint32_t, int> slots;
+    vector<int64_t> slotCamera;
+    vector<int> slotSize;
+    vector<uint32_t> slotFrame;
+    list<int> lru;
+    vector<list<int>::iterator> lruPosition;
+    vector<int> freeSlots;
+    vector<Request> wanted;
+    uint32_t frame;
+    vector<thread> workers;
+
+    // shared with worker threads. cameras without a state are absent
+    mutex lock;
+    condition_variable queued;
+    condition_variable finished;
+    unordered_map<uint32_t, unsigned char> state;
+    vector<Request> queue;
+    vector<Thumbnail> decoded;
+    size_t decoding;
+    bool stopping;
+    void (*notify)(void *);
+    void * notifyArg;
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+#endif
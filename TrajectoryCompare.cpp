@@ -0,0 +1,723 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : TrajectoryCompare.cpp
+ * @brief      : Definition file for trajectory alignment and errors
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <algorithm>
+#include "TrajectoryCompare.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// estimate pose without a reference pose close enough in time
+static const uint32_t NO_MATCH = 0xffffffffu;
+
+// reference timestamp and the pose it belongs to
+struct TimeIndex {
+    double time;
+    uint32_t index;
+    bool operator<(const TimeIndex & b) const { return time < b.time; };
+};
+
+// everything the worker threads of one pass read / write. each worker
+// handles one range of estimate poses
+struct CompareJob {
+    const PoseStore * estimate;
+    const PoseStore * reference;
+    const PointKdTree * tree;
+    // associateByTime: reference by time, matches per estimate pose
+    const vector<TimeIndex> * times;
+    double maxDifference;
+    vector<uint32_t> * match;
+    // compareTrajectories: per pose errors, relative errors per step
+    TrajectoryErrors * errors;
+    vector<float> * rpe;
+    vector<float> * rpeRotation;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief unit quaternion of q, identity for a zero quaternion (like the
+ *        instance kernel)
+ */
+static void normalized(const double * q, double * out){
+    double n2 = q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3];
+    if(n2 <= 0.0){
+        out[0] = out[1] = out[2] = 0.0;
+        out[3] = 1.0;
+        return;
+    }
+    double s = 1.0 / sqrt(n2);
+    for(int k = 0; k < 4; k++){
+        out[k] = q[k] * s;
+    }
+}
+
+/**
+ * @brief quaternion product a * b (x,y,z,w)
+ */
+static void multiply(const double * a, const double * b, double * out){
+    double x = a[3]*b[0] + a[0]*b[3] + a[1]*b[2] - a[2]*b[1];
+    double y = a[3]*b[1] - a[0]*b[2] + a[1]*b[3] + a[2]*b[0];
+    double z = a[3]*b[2] + a[0]*b[1] - a[1]*b[0] + a[2]*b[3];
+    double w = a[3]*b[3] - a[0]*b[0] - a[1]*b[1] - a[2]*b[2];
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+    out[3] = w;
+}
+
+/**
+ * @brief rotates v by the conjugate of unit quaternion q
+ */
+static void rotateInverse(const double * q, const double * v, double * out){
+    double c[4] = {-q[0], -q[1], -q[2], q[3]};
+    double t[3] = {2.0 * (c[1]*v[2] - c[2]*v[1]),
+                   2.0 * (c[2]*v[0] - c[0]*v[2]),
+                   2.0 * (c[0]*v[1] - c[1]*v[0])};
+    out[0] = v[0] + c[3]*t[0] + c[1]*t[2] - c[2]*t[1];
+    out[1] = v[1] + c[3]*t[1] + c[2]*t[0] - c[0]*t[2];
+    out[2] = v[2] + c[3]*t[2] + c[0]*t[1] - c[1]*t[0];
+}
+
+/**
+ * @brief angle in degrees of unit quaternion q
+ * @action atan2 of the vector / scalar part stays accurate for small
+ *         angles, where acos of w does not
+ */
+static double angleOf(const double * q){
+    double v = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2]);
+    return 2.0 * atan2(v, fabs(q[3])) * 180.0 / M_PI;
+}
+
+/**
+ * @brief eigen decomposition of a symmetric 4x4 matrix (cyclic Jacobi)
+ * @param a matrix, diagonal holds the eigenvalues afterwards
+ * @param v eigenvectors as columns
+ */
+static void jacobiEigen(double a[4][4], double v[4][4]){
+    for(int i = 0; i < 4; i++){
+        for(int j = 0; j < 4; j++){
+            v[i][j] = (i == j) ? 1.0 : 0.0;
+        }
+    }
+    for(int sweep = 0; sweep < 50; sweep++){
+        double off = 0.0;
+        double diagonal = 0.0;
+        for(int p = 0; p < 4; p++){
+            diagonal += fabs(a[p][p]);
+            for(int q = p + 1; q < 4; q++){
+                off += fabs(a[p][q]);
+            }
+        }
+        if(off <= 1e-15 * diagonal){
+            return;
+        }
+        for(int p = 0; p < 4; p++){
+            for(int q = p + 1; q < 4; q++){
+                if(a[p][q] == 0.0){
+                    continue;
+                }
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = ((theta < 0.0) ? -1.0 : 1.0) /
+                           (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+                for(int k = 0; k < 4; k++){
+                    double kp = a[k][p];
+                    double kq = a[k][q];
+                    a[k][p] = c * kp - s * kq;
+                    a[k][q] = s * kp + c * kq;
+                }
+                for(int k = 0; k < 4; k++){
+                    double pk = a[p][k];
+                    double qk = a[q][k];
+                    a[p][k] = c * pk - s * qk;
+                    a[q][k] = s * pk + c * qk;
+                }
+                for(int k = 0; k < 4; k++){
+                    double kp = v[k][p];
+                    double kq = v[k][q];
+                    v[k][p] = c * kp - s * kq;
+                    v[k][q] = s * kp + c * kq;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief runs work on threads ranges of [0, n), the last one on the calling
+ *        thread
+ */
+static void runRanges(void (*work)(const CompareJob *, size_t, size_t),
+                      const CompareJob & job, size_t n, int threads){
+    size_t parts = (size_t)max(1, threads);
+    parts = max((size_t)1, min(parts, n / 4096));
+    vector<thread> workers;
+    for(size_t i = 0; i + 1 < parts; i++){
+        workers.push_back(thread(work, &job, n * i / parts,
+                                 n * (i + 1) / parts));
+    }
+    work(&job, n * (parts - 1) / parts, n);
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+}
+
+/**
+ * @brief pairs estimate poses [first, last) with the reference pose nearest
+ *        in time
+ */
+static void associateRange(const CompareJob * job, size_t first,
+                           size_t last){
+    const vector<TimeIndex> & times = *job->times;
+    for(size_t i = first; i < last; i++){
+        TimeIndex key;
+        key.time = job->estimate->timestamp(i);
+        key.index = 0;
+        vector<TimeIndex>::const_iterator it =
+            lower_bound(times.begin(), times.end(), key);
+        uint32_t best = NO_MATCH;
+        double difference = job->maxDifference;
+        if(it != times.end() && it->time - key.time <= difference){
+            best = it->index;
+            difference = it->time - key.time;
+        }
+        if(it != times.begin() && key.time - (it - 1)->time <= difference){
+            best = (it - 1)->index;
+        }
+        (*job->match)[i] = best;
+    }
+}
+
+/**
+ * @brief associates estimate poses [first, last) with their nearest
+ *        reference pose and takes the absolute errors
+ */
+static void absoluteRange(const CompareJob * job, size_t first,
+                          size_t last){
+    TrajectoryErrors & errors = *job->errors;
+    // consecutive poses are close, so the last answer prunes most of the
+    // next search
+    size_t hint = (size_t)-1;
+    for(size_t i = first; i < last; i++){
+        double distance2;
+        uint32_t r = job->tree->nearest(job->estimate->position(i),
+                                        distance2, &hint);
+        errors.association[i] = r;
+        errors.translation[i] = (float)sqrt(distance2);
+        errors.rotation[i] = (float)rotationAngle(
+            job->reference->rotation(r), job->estimate->rotation(i));
+    }
+}
+
+/**
+ * @brief relative pose errors of the estimate steps i -> i + 1, i in
+ *        [first, last), against the steps between their reference poses
+ * @action the translation error is the difference of the two steps in the
+ *         frame of their first pose, the rotation error the angle between
+ *         the two relative rotations
+ */
+static void relativeRange(const CompareJob * job, size_t first,
+                          size_t last){
+    const PoseStore & estimate = *job->estimate;
+    const PoseStore & reference = *job->reference;
+    const vector<uint32_t> & association = job->errors->association;
+    for(size_t i = first; i < last; i++){
+        double q[4][4];
+        const double * p[4];
+        size_t a = association[i];
+        size_t b = association[i + 1];
+        normalized(estimate.rotation(i), q[0]);
+        normalized(estimate.rotation(i + 1), q[1]);
+        normalized(reference.rotation(a), q[2]);
+        normalized(reference.rotation(b), q[3]);
+        p[0] = estimate.position(i);
+        p[1] = estimate.position(i + 1);
+        p[2] = reference.position(a);
+        p[3] = reference.position(b);
+
+        double step[3], referenceStep[3], d[3], e[3];
+        for(int k = 0; k < 3; k++){
+            d[k] = p[1][k] - p[0][k];
+            e[k] = p[3][k] - p[2][k];
+        }
+        rotateInverse(q[0], d, step);
+        rotateInverse(q[2], e, referenceStep);
+        double t2 = 0.0;
+        for(int k = 0; k < 3; k++){
+            t2 += (step[k] - referenceStep[k]) * (step[k] - referenceStep[k]);
+        }
+        // (q2^-1 q3)^-1 (q0^-1 q1)
+        double c0[4] = {-q[0][0], -q[0][1], -q[0][2], q[0][3]};
+        double c3[4] = {-q[3][0], -q[3][1], -q[3][2], q[3][3]};
+        double r0[4], r1[4], r[4];
+        multiply(c0, q[1], r0);
+        multiply(c3, q[2], r1);
+        multiply(r1, r0, r);
+        (*job->rpe)[i] = (float)sqrt(t2);
+        (*job->rpeRotation)[i] = (float)angleOf(r);
+    }
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              CLASS DEFINITION                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief Default Constructor
+ */
+PointKdTree::PointKdTree(){
+};
+
+/**
+ * @brief builds the tree over the positions of store
+ * @param store poses, their indices are returned by nearest
+ * @param threads threads splitting the top levels
+ * @action copies the positions with their indices, then splits every range
+ *         at the median of the longest side of its box
+ */
+void PointKdTree::build(const PoseStore & store, int threads){
+    size_t n = store.size();
+    points.resize(n);
+    axes.assign(n, 0);
+    Box box;
+    for(int k = 0; k < 3; k++){
+        box.lo[k] = numeric_limits<double>::infinity();
+        box.hi[k] = -numeric_limits<double>::infinity();
+    }
+    for(size_t i = 0; i < n; i++){
+        const double * p = store.position(i);
+        for(int k = 0; k < 3; k++){
+            points[i].p[k] = p[k];
+            box.lo[k] = min(box.lo[k], p[k]);
+            box.hi[k] = max(box.hi[k], p[k]);
+        }
+        points[i].index = (uint32_t)i;
+    }
+    if(n > 0){
+        buildRange(0, n, box, max(threads, 1));
+    }
+};
+
+/**
+ * @brief releases all points
+ */
+void PointKdTree::clear(){
+    vector<Point>().swap(points);
+    vector<unsigned char>().swap(axes);
+};
+
+/**
+ * @brief nearest point to p
+ * @param p x,y,z
+ * @param distance2 squared distance to the returned pose
+ * @param hint optional. in: tree slot of a point likely close to p (the
+ *        answer to a nearby query), whose distance bounds the search from
+ *        the start. out: tree slot of the answer
+ * @return index of the pose in the store the tree was built from
+ */
+uint32_t PointKdTree::nearest(const double * p, double & distance2,
+                              size_t * hint) const{
+    size_t best = 0;
+    distance2 = numeric_limits<double>::infinity();
+    if(hint && *hint < points.size()){
+        best = *hint;
+        double dx = points[best].p[0] - p[0];
+        double dy = points[best].p[1] - p[1];
+        double dz = points[best].p[2] - p[2];
+        distance2 = dx * dx + dy * dy + dz * dz;
+    }
+    search(0, points.size(), p, best, distance2);
+    if(hint){
+        *hint = best;
+    }
+    return points[best].index;
+};
+
+/**
+ * @brief splits range [first, last) until it fits a leaf
+ * @param box bounds of the range
+ * @param threads threads left for this range. the left half goes to a new
+ *        thread while more than one is left
+ * @action the median stays at the middle as the split point, the left
+ *         half is recursed into and the right half handled by the loop
+ */
+void PointKdTree::buildRange(size_t first, size_t last, Box box,
+                             int threads){
+    while(last - first > LEAF_SIZE){
+        int axis = 0;
+        for(int k = 1; k < 3; k++){
+            if(box.hi[k] - box.lo[k] > box.hi[axis] - box.lo[axis]){
+                axis = k;
+            }
+        }
+        size_t mid = first + (last - first) / 2;
+        nth_element(points.begin() + first, points.begin() + mid,
+                    points.begin() + last, AxisLess(axis));
+        axes[mid] = (unsigned char)axis;
+        Box left = box;
+        left.hi[axis] = points[mid].p[axis];
+        box.lo[axis] = points[mid].p[axis];
+        if(threads > 1){
+            thread worker(&PointKdTree::buildRange, this, first, mid, left,
+                          threads / 2);
+            buildRange(mid + 1, last, box, threads - threads / 2);
+            worker.join();
+            return;
+        }
+        buildRange(first, mid, left, 1);
+        first = mid + 1;
+    }
+};
+
+/**
+ * @brief nearest neighbor search in range [first, last)
+ * @param best tree position of the nearest point so far
+ * @param distance2 its squared distance
+ * @action descends into the half holding p first. the split point and the
+ *         other half are only looked at if the split plane is closer than
+ *         the best point
+ */
+void PointKdTree::search(size_t first, size_t last, const double * p,
+                         size_t & best, double & distance2) const{
+    if(last - first <= LEAF_SIZE){
+        for(size_t i = first; i < last; i++){
+            double dx = points[i].p[0] - p[0];
+            double dy = points[i].p[1] - p[1];
+            double dz = points[i].p[2] - p[2];
+            double d2 = dx * dx + dy * dy + dz * dz;
+            if(d2 < distance2){
+                distance2 = d2;
+                best = i;
+            }
+        }
+        return;
+    }
+    size_t mid = first + (last - first) / 2;
+    int axis = axes[mid];
+    double d = p[axis] - points[mid].p[axis];
+    if(d < 0.0){
+        search(first, mid, p, best, distance2);
+    } else {
+        search(mid + 1, last, p, best, distance2);
+    }
+    if(d * d < distance2){
+        double dx = points[mid].p[0] - p[0];
+        double dy = points[mid].p[1] - p[1];
+        double dz = points[mid].p[2] - p[2];
+        double d2 = dx * dx + dy * dy + dz * dz;
+        if(d2 < distance2){
+            distance2 = d2;
+            best = mid;
+        }
+        if(d < 0.0){
+            search(mid + 1, last, p, best, distance2);
+        } else {
+            search(first, mid, p, best, distance2);
+        }
+    }
+};
+//----------------------------------------------------------------------------//
+//                            END CLASS DEFINITION                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                            FUNCTION DEFINITIONS                            //
+//----------------------------------------------------------------------------//
+/**
+ * @brief pairs estimate poses with the reference pose nearest in time
+ * @param estimate estimated poses
+ * @param reference reference poses
+ * @param maxDifference largest time difference of a pair
+ * @param pairs output estimate / reference index pairs
+ * @param threads threads searching
+ * @return number of pairs
+ * @action reference timestamps are sorted once (skipped if they already
+ *         are), then every estimate pose is binary searched
+ */
+size_t associateByTime(const PoseStore & estimate,
+                       const PoseStore & reference, double maxDifference,
+                       vector<uint32_t> & pairs, int threads){
+    pairs.clear();
+    if(estimate.empty() || reference.empty()){
+        return 0;
+    }
+    vector<TimeIndex> times(reference.size());
+    for(size_t i = 0; i < times.size(); i++){
+        times[i].time = reference.timestamp(i);
+        times[i].index = (uint32_t)i;
+    }
+    if(!reference.sortedByTime()){
+        stable_sort(times.begin(), times.end());
+    }
+    vector<uint32_t> match(estimate.size());
+    CompareJob job;
+    job.estimate = &estimate;
+    job.reference = &reference;
+    job.times = &times;
+    job.maxDifference = maxDifference;
+    job.match = &match;
+    runRanges(associateRange, job, estimate.size(), threads);
+
+    for(size_t i = 0; i < match.size(); i++){
+        if(match[i] != NO_MATCH){
+            pairs.push_back((uint32_t)i);
+            pairs.push_back(match[i]);
+        }
+    }
+    return pairs.size() / 2;
+}
+
+/**
+ * @brief least squares similarity of paired positions
+ * @param estimate estimated poses
+ * @param reference reference poses
+ * @param pairs estimate / reference index pairs (see associateByTime)
+ * @param mode transform fitted
+ * @param alignment output transform mapping estimate onto reference
+ * @return false with fewer than 3 pairs (alignment is the identity then)
+ * @action both point sets are centered, the rotation is the eigenvector of
+ *         the largest eigenvalue of Horn's 4x4 matrix of the cross
+ *         covariance (no reflections possible) and the scale Umeyama's
+ *         ratio of the rotated cross term to the estimate variance
+ */
+bool fitAlignment(const PoseStore & estimate, const PoseStore & reference,
+                  const vector<uint32_t> & pairs, AlignMode mode,
+                  Alignment & alignment){
+    alignment.rotation[0] = 0.0;
+    alignment.rotation[1] = 0.0;
+    alignment.rotation[2] = 0.0;
+    alignment.rotation[3] = 1.0;
+    alignment.translation[0] = 0.0;
+    alignment.translation[1] = 0.0;
+    alignment.translation[2] = 0.0;
+    alignment.scale = 1.0;
+    alignment.pairs = pairs.size() / 2;
+    if(mode == ALIGN_NONE){
+        return true;
+    }
+    size_t n = pairs.size() / 2;
+    if(n < 3){
+        return false;
+    }
+
+    double mx[3] = {0.0, 0.0, 0.0};
+    double my[3] = {0.0, 0.0, 0.0};
+    for(size_t i = 0; i < n; i++){
+        const double * x = estimate.position(pairs[2 * i]);
+        const double * y = reference.position(pairs[2 * i + 1]);
+        for(int k = 0; k < 3; k++){
+            mx[k] += x[k];
+            my[k] += y[k];
+        }
+    }
+    for(int k = 0; k < 3; k++){
+        mx[k] /= n;
+        my[k] /= n;
+    }
+    // s[a][b] = sum of x_a * y_b over centered pairs
+    double s[3][3] = {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+    double variance = 0.0;
+    for(size_t i = 0; i < n; i++){
+        const double * x = estimate.position(pairs[2 * i]);
+        const double * y = reference.position(pairs[2 * i + 1]);
+        double cx[3] = {x[0] - mx[0], x[1] - mx[1], x[2] - mx[2]};
+        double cy[3] = {y[0] - my[0], y[1] - my[1], y[2] - my[2]};
+        for(int a = 0; a < 3; a++){
+            for(int b = 0; b < 3; b++){
+                s[a][b] += cx[a] * cy[b];
+            }
+        }
+        variance += cx[0] * cx[0] + cx[1] * cx[1] + cx[2] * cx[2];
+    }
+    if(variance <= 0.0){
+        return false;
+    }
+
+    // Horn's matrix, quaternion order w,x,y,z
+    double m[4][4] = {
+        {s[0][0] + s[1][1] + s[2][2], s[1][2] - s[2][1],
+         s[2][0] - s[0][2], s[0][1] - s[1][0]},
+        {s[1][2] - s[2][1], s[0][0] - s[1][1] - s[2][2],
+         s[0][1] + s[1][0], s[2][0] + s[0][2]},
+        {s[2][0] - s[0][2], s[0][1] + s[1][0],
+         -s[0][0] + s[1][1] - s[2][2], s[1][2] + s[2][1]},
+        {s[0][1] - s[1][0], s[2][0] + s[0][2],
+         s[1][2] + s[2][1], -s[0][0] - s[1][1] + s[2][2]}
+    };
+    double v[4][4];
+    jacobiEigen(m, v);
+    int largest = 0;
+    for(int k = 1; k < 4; k++){
+        if(m[k][k] > m[largest][largest]){
+            largest = k;
+        }
+    }
+    double q[4] = {v[1][largest], v[2][largest], v[3][largest],
+                   v[0][largest]};
+    normalized(q, alignment.rotation);
+
+    // sum of y . R x = trace(R^T s^T)
+    double rotated = 0.0;
+    double c[4] = {-alignment.rotation[0], -alignment.rotation[1],
+                   -alignment.rotation[2], alignment.rotation[3]};
+    double rx[3][3];
+    for(int a = 0; a < 3; a++){
+        double axis[3] = {0.0, 0.0, 0.0};
+        axis[a] = 1.0;
+        // column a of R
+        rotateInverse(c, axis, rx[a]);
+    }
+    for(int a = 0; a < 3; a++){
+        for(int b = 0; b < 3; b++){
+            rotated += rx[a][b] * s[a][b];
+        }
+    }
+    if(mode == ALIGN_SIM3){
+        alignment.scale = rotated / variance;
+    }
+    double rmx[3];
+    rotateInverse(c, mx, rmx);
+    for(int k = 0; k < 3; k++){
+        alignment.translation[k] = my[k] - alignment.scale * rmx[k];
+    }
+    return true;
+}
+
+/**
+ * @brief per pose and relative errors of estimate against reference
+ * @param estimate estimated poses, already aligned
+ * @param reference reference poses
+ * @param tree tree built over reference
+ * @param errors output errors and their statistics
+ * @param threads threads for the association / error passes
+ * @action every estimate pose is associated with the reference pose
+ *         nearest to its position. the relative errors compare each step
+ *         between consecutive estimate poses with the step between their
+ *         associated reference poses
+ */
+void compareTrajectories(const PoseStore & estimate,
+                         const PoseStore & reference,
+                         const PointKdTree & tree, TrajectoryErrors & errors,
+                         int threads){
+    size_t n = tree.empty() ? 0 : estimate.size();
+    errors.association.resize(n);
+    errors.translation.resize(n);
+    errors.rotation.resize(n);
+    vector<float> rpe(n ? n - 1 : 0);
+    vector<float> rpeRotation(rpe.size());
+    CompareJob job;
+    job.estimate = &estimate;
+    job.reference = &reference;
+    job.tree = &tree;
+    job.errors = &errors;
+    job.rpe = &rpe;
+    job.rpeRotation = &rpeRotation;
+    if(n > 0){
+        runRanges(absoluteRange, job, n, threads);
+        runRanges(relativeRange, job, n - 1, threads);
+    }
+
+    vector<float> values(errors.translation);
+    errorStats(values, errors.ate);
+    values = errors.rotation;
+    errorStats(values, errors.ateRotation);
+    errorStats(rpe, errors.rpe);
+    errorStats(rpeRotation, errors.rpeRotation);
+}
+
+/**
+ * @brief count / rmse / mean / median / standard deviation / min / max
+ * @param values error values, reordered by the median selection
+ * @param stats output, all zero for no values
+ */
+void errorStats(vector<float> & values, ErrorStats & stats){
+    stats.count = values.size();
+    stats.rmse = stats.mean = stats.median = stats.std = 0.0;
+    stats.min = stats.max = 0.0;
+    if(values.empty()){
+        return;
+    }
+    double sum = 0.0;
+    double sum2 = 0.0;
+    stats.min = stats.max = values[0];
+    for(size_t i = 0; i < values.size(); i++){
+        double v = values[i];
+        sum += v;
+        sum2 += v * v;
+        stats.min = min(stats.min, v);
+        stats.max = max(stats.max, v);
+    }
+    double n = (double)values.size();
+    stats.mean = sum / n;
+    stats.rmse = sqrt(sum2 / n);
+    stats.std = sqrt(max(0.0, sum2 / n - stats.mean * stats.mean));
+    nth_element(values.begin(), values.begin() + values.size() / 2,
+                values.end());
+    stats.median = values[values.size() / 2];
+}
+
+/**
+ * @brief alignment relative to a pose
+ * @param alignment estimate to reference similarity
+ * @param originPosition x,y,z of the origin pose
+ * @param originRotation x,y,z,w of the origin pose
+ * @param relative origin^-1 * alignment, same scale and pairs
+ */
+void relativeAlignment(const Alignment & alignment,
+                       const double * originPosition,
+                       const double * originRotation, Alignment & relative){
+    double q[4], r[4];
+    normalized(originRotation, q);
+    double d[3] = {alignment.translation[0] - originPosition[0],
+                   alignment.translation[1] - originPosition[1],
+                   alignment.translation[2] - originPosition[2]};
+    rotateInverse(q, d, relative.translation);
+    double c[4] = {-q[0], -q[1], -q[2], q[3]};
+    multiply(c, alignment.rotation, r);
+    normalized(r, relative.rotation);
+    relative.scale = alignment.scale;
+    relative.pairs = alignment.pairs;
+}
+
+/**
+ * @brief angle between two rotations
+ * @param a rotation x,y,z,w
+ * @param b rotation x,y,z,w
+ * @return angle of a^-1 b in degrees, 0..180
+ */
+double rotationAngle(const double * a, const double * b){
+    double qa[4], qb[4], r[4];
+    normalized(a, qa);
+    normalized(b, qb);
+    qa[0] = -qa[0];
+    qa[1] = -qa[1];
+    qa[2] = -qa[2];
+    multiply(qa, qb, r);
+    return angleOf(r);
+}
+//----------------------------------------------------------------------------//
+//                          END FUNCTION DEFINITIONS                          //
+//----------------------------------------------------------------------------//
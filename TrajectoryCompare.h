@@ -0,0 +1,169 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : TrajectoryCompare.h
+ * @brief      : Alignment and per pose errors of an estimated trajectory
+ *               against a reference trajectory
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+#ifndef TRAJECTORYCOMPARE_H
+#define TRAJECTORYCOMPARE_H
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "PoseStore.h"
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                          HELPER CLASS DEFINITION                           //
+//----------------------------------------------------------------------------//
+// how the estimate is fitted onto the reference before errors are taken
+enum AlignMode {
+    // poses are compared as they are
+    ALIGN_NONE = 0,
+    // rotation and translation
+    ALIGN_SE3,
+    // rotation, translation and scale
+    ALIGN_SIM3
+};
+
+// similarity transform x -> scale * R(rotation) * x + translation
+struct Alignment {
+    // x,y,z,w
+    double rotation[4];
+    double translation[3];
+    double scale;
+    // time associated pose pairs the fit used
+    size_t pairs;
+};
+
+// summary of one error series
+struct ErrorStats {
+    size_t count;
+    double rmse;
+    double mean;
+    double median;
+    double std;
+    double min;
+    double max;
+};
+
+// errors of every estimate pose against the reference pose associated with
+// it, translations in reference units, rotations in degrees
+struct TrajectoryErrors {
+    // reference pose associated with each estimate pose
+    vector<uint32_t> association;
+    vector<float> translation;
+    vector<float> rotation;
+    // absolute trajectory error
+    ErrorStats ate;
+    ErrorStats ateRotation;
+    // relative pose error between consecutive estimate poses
+    ErrorStats rpe;
+    ErrorStats rpeRotation;
+};
+
+// 3-d tree over pose positions for nearest neighbor queries. points are
+// kept in one array in tree order: the middle element of every range
+// [first, last) is its split point, on the axis stored for it, with the
+// smaller points before and the larger ones after it, so no nodes are
+// stored. ranges of LEAF_SIZE points or less are searched linearly
+class PointKdTree
+{
+public:
+    PointKdTree();
+
+    // builds the tree over all positions of store. the top levels are
+    // split on up to threads threads
+    void build(const PoseStore & store, int threads = 1);
+    void clear();
+    size_t size() const { return points.size(); };
+    bool empty() const { return points.empty(); };
+
+    // index of the pose nearest to p, with its squared distance. hint
+    // carries the tree slot of the answer from one query to the next
+    // nearby one. the tree must not be empty
+    uint32_t nearest(const double * p, double & distance2,
+                     size_t * hint = 0) const;
+
+    static const size_t LEAF_SIZE = 8;
+private:
+    struct Point {
+        double p[3];
+        uint32_t index;
+    };
+    struct Box {
+        double lo[3];
+        double hi[3];
+    };
+    struct AxisLess {
+        int axis;
+        AxisLess(int axis) : axis(axis) {};
+        bool operator()(const Point & a, const Point & b) const {
+            return a.p[axis] < b.p[axis];
+        };
+    };
+
+    void buildRange(size_t first, size_t last, Box box, int threads);
+    void search(size_t first, size_t last, const double * p, size_t & best,
+                double & distance2) const;
+
+    vector<Point> points;
+    // split axis of the range whose middle element is at this index
+    vector<unsigned char> axes;
+};
+//----------------------------------------------------------------------------//
+//                        END HELPER CLASS DEFINITION                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           FUNCTION DECLARATIONS                            //
+//----------------------------------------------------------------------------//
+// Pairs each estimate pose with the reference pose nearest in time, if they
+// are at most maxDifference apart. pairs gets estimate / reference index
+// pairs. poses of files without timestamps are numbered 0, 1, ..., so they
+// pair by index. returns the number of pairs
+size_t associateByTime(const PoseStore & estimate,
+                       const PoseStore & reference, double maxDifference,
+                       vector<uint32_t> & pairs, int threads = 1);
+
+// least squares similarity (Horn / Umeyama) mapping the estimate positions
+// of pairs onto their reference positions. scale stays 1 for ALIGN_SE3,
+// ALIGN_NONE gives the identity. false with fewer than 3 pairs
+bool fitAlignment(const PoseStore & estimate, const PoseStore & reference,
+                  const vector<uint32_t> & pairs, AlignMode mode,
+                  Alignment & alignment);
+
+// errors of every estimate pose against the reference pose nearest to its
+// position, found through tree (built over reference). runs on threads
+// threads
+void compareTrajectories(const PoseStore & estimate,
+                         const PoseStore & reference,
+                         const PointKdTree & tree, TrajectoryErrors & errors,
+                         int threads = 1);
+
+// alignment expressed in the frame of the pose origin (origin^-1 *
+// alignment), e.g. relative to the tag origin
+void relativeAlignment(const Alignment & alignment,
+                       const double * originPosition,
+                       const double * originRotation, Alignment & relative);
+
+// statistics of values. median by selection, values is reordered
+void errorStats(vector<float> & values, ErrorStats & stats);
+
+// angle in degrees of rotation b relative to rotation a (x,y,z,w each, not
+// necessarily normalized)
+double rotationAngle(const double * a, const double * b);
+//----------------------------------------------------------------------------//
+//                         END FUNCTION DECLARATIONS                          //
+//----------------------------------------------------------------------------//
+#endif
@@ -8,7 +8,17 @@
 //                                  INCLUDES                                  //
 //----------------------------------------------------------------------------//
 #include "TagViewer.h"
+#include "PoseLoader.h"
+#include "PoseFile.h"
+#include "PoseTree.h"
+#include "ImageWriter.h"
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <unistd.h>
+#include <sys/wait.h>
 //----------------------------------------------------------------------------//
 //                                END INCLUDES                                //
 //----------------------------------------------------------------------------//
@@ -17,6 +27,13 @@
 //----------------------------------------------------------------------------//
 TagViewer * tv = 0;
 using namespace std;
+
+// world camera orbit parameters of one headless snapshot
+struct Viewpoint {
+    double r;
+    double theta;
+    double distance;
+};
 //----------------------------------------------------------------------------//
 //                      END GLOBAL VARIABLE DEFINITIONS                       //
 //----------------------------------------------------------------------------//
@@ -42,34 +59,680 @@ void mouse(int button, int state, int x, int y){
 void motion(int x, int y){
     tv->mouseMoveCB(x,y);
 };
-void idle(void){
-    tv->idleCB();
+void passiveMotion(int x, int y){
+    tv->passiveMouseMoveCB(x,y);
+};
+void windowClose(void){
+    tv->closeCB();
 };
 //----------------------------------------------------------------------------//
 //                           END CALLBACK FUNCTIONS                           //
 //----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+/**
+ * @brief converts binary / TUM / CSV poses into a mapped pose file
+ * @param input source pose file
+ * @param output destination pose file
+ * @param encoding record encoding of output
+ * @return process exit code
+ */
+int packPoses(const char * input, const char * output, PoseEncoding encoding){
+    PoseLoader loader;
+    if(!loader.open(input)){
+        return 1;
+    }
+    vector<double> positions;
+    vector<double> rotations;
+    positions.reserve(loader.expectedCount() * 3);
+    rotations.reserve(loader.expectedCount() * 4);
+    PoseChunk chunk;
+    while(loader.nextChunk(chunk)){
+        positions.insert(positions.end(), chunk.positions.begin(),
+                         chunk.positions.end());
+        rotations.insert(rotations.end(), chunk.rotations.begin(),
+                         chunk.rotations.end());
+    }
+    size_t n = positions.size() / 3;
+    if(loader.failed() || n == 0 ||
+       !PoseFile::write(output, &positions[0], &rotations[0], n, encoding)){
+        return 1;
+    }
+    cout << "packed " << n << " poses into " << output << endl;
+    return 0;
+}
+/**
+ * @brief packs binary / TUM / CSV poses into an out-of-core pose tree
+ * @param input source pose file
+ * @param output destination pose tree
+ * @param memoryBytes RAM used for sorting
+ * @return process exit code
+ */
+int packTree(const char * input, const char * output, size_t memoryBytes){
+    PoseTreePackStats stats;
+    if(!PoseTree::pack(input, output, memoryBytes, stats)){
+        return 1;
+    }
+    cout << "packed " << stats.poses << " poses into " << stats.nodes
+         << " nodes (" << stats.levels << " levels, " << stats.runs
+         << " sorted runs) in " << output << endl;
+    return 0;
+}
+/**
+ * @brief loads cameras / tag into global viewer
+ * @param path pose file, or 0 for the built in test scene
+ * @param stream load pose file in the background while the window shows
+ *        what is loaded so far
+ */
+void loadScene(const char * path, bool stream){
+    if(path){
+        // load camera poses from file. tag origin stays at the origin,
+        // tags of a mapped file's tag table are added next to it
+        double origin[3] = {0,0,0};
+        double identity[4] = {0,0,0,1};
+        tv->setTagOrigin(origin,identity);
+        if(PoseFile::probe(path)){
+            tv->openPoseFile(path);
+        } else if(PoseTree::probe(path)){
+            tv->openPoseTree(path);
+        } else if(stream){
+            tv->streamPoses(path);
+        } else {
+            size_t n = tv->loadPoses(path);
+            cout << "loaded " << n << " poses from " << path << endl;
+        }
+    } else {
+        // defining test cases
+        double pos1[3] = {10,0,6};
+        double pos2[3] = {0,10,2};
+        double pos3[3] = {0,0,0};
+        double pos4[3] = {0,0,0};
+        
+        double rot1[4] = {1,1,1,1};
+        double rot2[4] = {1,0,1,1};
+        double rot3[4] = {0,0,0,1};
+        double rot4[4] = {0,0,0,1};
+        
+        tv->addCamera(pos1,rot1);
+        tv->addCamera(pos2,rot2);
+        tv->addCamera(pos3,rot3);
+        tv->setTagOrigin(pos4,rot4);
+    }
+}
+
+/**
+ * @brief adds tags, one "id tx ty tz qx qy qz qw" per line
+ * @param path tag file
+ * @return number of tags read
+ */
+size_t readTags(const char * path){
+    FILE * f = fopen(path, "r");
+    if(!f){
+        cerr << "could not open tag file " << path << endl;
+        return 0;
+    }
+    size_t n = 0;
+    char line[256];
+    while(fgets(line, sizeof(line), f)){
+        unsigned long long id;
+        double position[3];
+        double rotation[4];
+        if(line[0] != '#' &&
+           sscanf(line, "%llu %lf %lf %lf %lf %lf %lf %lf", &id,
+                  &position[0], &position[1], &position[2], &rotation[0],
+                  &rotation[1], &rotation[2], &rotation[3]) == 8){
+            tv->setTag(id, position, rotation);
+            n++;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+/**
+ * @brief adds observation edges, one "camera_index tag_id" per line
+ * @param path observation file
+ * @return number of edges read. lines naming unknown tags are skipped
+ */
+size_t readObservations(const char * path){
+    FILE * f = fopen(path, "r");
+    if(!f){
+        cerr << "could not open observation file " << path << endl;
+        return 0;
+    }
+    size_t n = 0;
+    char line[256];
+    while(fgets(line, sizeof(line), f)){
+        unsigned long long camera, id;
+        if(line[0] != '#' && sscanf(line, "%llu %llu", &camera, &id) == 2 &&
+           tv->addObservation(camera, id)){
+            n++;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+/**
+ * @brief sets camera images, one "camera_index path" per line
+ * @param path image list. relative image paths are relative to its
+ *        directory
+ * @return number of images set
+ */
+size_t readCameraImages(const char * path){
+    FILE * f = fopen(path, "r");
+    if(!f){
+        cerr << "could not open image list " << path << endl;
+        return 0;
+    }
+    string directory(path);
+    size_t slash = directory.rfind('/');
+    directory = (slash == string::npos) ? "" : directory.substr(0, slash + 1);
+    size_t n = 0;
+    char line[4096];
+    while(fgets(line, sizeof(line), f)){
+        unsigned long long camera;
+        int start = 0;
+        if(line[0] == '#' || sscanf(line, "%llu %n", &camera, &start) != 1){
+            continue;
+        }
+        string image(line + start);
+        image.erase(image.find_last_not_of("\r\n") + 1);
+        if(image.empty()){
+            continue;
+        }
+        tv->setCameraImage(camera, image[0] == '/' ? image
+                                                   : directory + image);
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+/**
+ * @brief prints one error series
+ */
+void printErrorStats(const char * name, const ErrorStats & stats){
+    cout << name << ": rmse " << stats.rmse << " mean " << stats.mean
+         << " median " << stats.median << " std " << stats.std
+         << " min " << stats.min << " max " << stats.max
+         << " (" << stats.count << ")" << endl;
+}
+
+/**
+ * @brief compares the loaded cameras against a reference trajectory and
+ *        prints the alignment and error statistics
+ * @param path reference pose file
+ * @param mode alignment fitted before the errors are taken
+ * @param maxTimeDifference largest timestamp difference of a fitted pair
+ * @return false if nothing could be compared
+ */
+bool compareReference(const char * path, AlignMode mode,
+                      double maxTimeDifference){
+    size_t n = tv->loadReference(path);
+    cout << "loaded " << n << " reference poses from " << path << endl;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Alignment alignment;
+    TrajectoryErrors errors;
+    if(!tv->compareToReference(mode, maxTimeDifference, alignment, errors)){
+        // mapped pose files / trees are not held as cameras
+        cerr << "could not compare to " << path << ": no loaded cameras or"
+             << " too few poses paired in time" << endl;
+        return false;
+    }
+    double seconds = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+    cout << "compared " << errors.translation.size() << " poses in "
+         << seconds << " s" << endl;
+
+    // fitted transform as seen from the tag origin
+    double origin[3] = {0,0,0};
+    double identity[4] = {0,0,0,1};
+    tv->getTagPose(TAG_ORIGIN_ID, origin, identity);
+    Alignment relative;
+    relativeAlignment(alignment, origin, identity, relative);
+    cout << "alignment (" << alignment.pairs << " pairs, tag origin frame):"
+         << " t " << relative.translation[0] << " "
+         << relative.translation[1] << " " << relative.translation[2]
+         << " q " << relative.rotation[0] << " " << relative.rotation[1]
+         << " " << relative.rotation[2] << " " << relative.rotation[3]
+         << " s " << relative.scale << endl;
+    printErrorStats("ATE", errors.ate);
+    printErrorStats("ATE rotation (deg)", errors.ateRotation);
+    printErrorStats("RPE", errors.rpe);
+    printErrorStats("RPE rotation (deg)", errors.rpeRotation);
+    return true;
+}
+
+/**
+ * @brief reads world camera viewpoints, one "r theta distance" per line
+ * @param path viewpoint file
+ * @param views viewpoints are appended here
+ */
+void readViewpoints(const char * path, vector<Viewpoint> & views){
+    FILE * f = fopen(path, "r");
+    if(!f){
+        cerr << "could not open viewpoint file " << path << endl;
+        return;
+    }
+    char line[256];
+    while(fgets(line, sizeof(line), f)){
+        Viewpoint v;
+        if(line[0] != '#' &&
+           sscanf(line, "%lf %lf %lf", &v.r, &v.theta, &v.distance) == 3){
+            views.push_back(v);
+        }
+    }
+    fclose(f);
+}
+
+/**
+ * @brief reads camera path keys, one "time r theta distance" per line
+ * @param path key file
+ * @param keys keys are added here
+ * @return false if the file cannot be opened
+ */
+bool readCameraPath(const char * path, CameraPath & keys){
+    FILE * f = fopen(path, "r");
+    if(!f){
+        cerr << "could not open camera path " << path << endl;
+        return false;
+    }
+    char line[256];
+    while(fgets(line, sizeof(line), f)){
+        double time, r, theta, distance;
+        if(line[0] != '#' && sscanf(line, "%lf %lf %lf %lf", &time, &r,
+                                    &theta, &distance) == 4){
+            keys.add(time, r, theta, distance);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+/**
+ * @brief parses a viewport layout like "orbit,top,camera"
+ * @param list comma separated view modes, one viewport each
+ * @param layout modes are appended here. unknown names are skipped
+ */
+void readLayout(const char * list, vector<ViewMode> & layout){
+    static const char * names[3] = {"orbit", "top", "camera"};
+    while(*list){
+        size_t length = strcspn(list, ",");
+        bool known = false;
+        for(int m = 0; m < 3; m++){
+            if(strlen(names[m]) == length &&
+               strncmp(list, names[m], length) == 0){
+                layout.push_back((ViewMode)m);
+                known = true;
+            }
+        }
+        if(!known){
+            cerr << "unknown viewport " << string(list, length) << endl;
+        }
+        list += length;
+        if(*list == ','){
+            list++;
+        }
+    }
+}
+
+/**
+ * @brief renders every viewpoint offscreen and writes one image each
+ * @param views world camera viewpoints
+ * @param pattern printf style output name taking the viewpoint index
+ * @param workers number of worker processes. 0 uses one per core
+ * @param trace Chrome trace file recorded by the first worker, or 0
+ * @return process exit code
+ * @action scene is loaded once and shared copy-on-write with forked
+ *         workers. each worker creates its own context and renders every
+ *         workers-th viewpoint
+ */
+int renderHeadless(const vector<Viewpoint> & views, const char * pattern,
+                   int workers, const char * trace){
+    if(workers <= 0){
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    workers = max(1, min(workers, (int)views.size()));
+
+    int worker = 0;
+    vector<pid_t> children;
+    for(int k = 1; k < workers; k++){
+        pid_t pid = fork();
+        if(pid == 0){
+            worker = k;
+            children.clear();
+            break;
+        }
+        if(pid > 0){
+            children.push_back(pid);
+        } else {
+            // fork failed. render the rest here
+            workers = k;
+            break;
+        }
+    }
+
+    int status = 0;
+    if(!tv->initOffscreen()){
+        status = 1;
+    }
+    if(trace && worker == 0){
+        tv->startTrace(trace);
+    }
+    for(size_t i = worker; status == 0 && i < views.size(); i += workers){
+        // every viewport orbits the same viewpoint, in its own view mode
+        for(size_t v = 0; v < tv->viewportCount(); v++){
+            WorldCamera & camera = tv->viewportCamera(v);
+            camera.r = views[i].r;
+            camera.theta = views[i].theta;
+            camera.distance = views[i].distance;
+        }
+        char name[1024];
+        snprintf(name, sizeof(name), pattern, (int)i);
+        if(!tv->saveFrame(name)){
+            status = 1;
+            break;
+        }
+        const CullStats & stats = tv->cullStats();
+        cout << name << ": " << stats.visibleCameras << "/"
+             << stats.totalCameras << " cameras visible ("
+             << stats.pyramidCameras << " pyramids, "
+             << stats.lineCameras << " lines, "
+             << stats.clusteredCameras << " in "
+             << stats.clusterProxies << " clusters), "
+             << stats.visitedNodes << "/" << stats.totalNodes
+             << " octree nodes visited" << endl;
+    }
+    if(worker != 0){
+        _exit(status);
+    }
+
+    // collect workers
+    for(size_t k = 0; k < children.size(); k++){
+        int childStatus = 0;
+        waitpid(children[k], &childStatus, 0);
+        if(!WIFEXITED(childStatus) || WEXITSTATUS(childStatus) != 0){
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/**
+ * @brief prints command line usage
+ * @param program argv[0]
+ * @return exit status for a bad command line
+ */
+int usage(const char * program){
+    cerr << "usage: " << program << " [pose file] [-fps N] [-novsync]"
+         << " [-lod P,C] [-trace trace.json] [-time T] [-window W]"
+         << " [-speed S] [-tags tags.txt] [-observations edges.txt]"
+         << " [-target ID] [-viewports orbit,top,camera] [-path keys.txt]"
+         << " [-rate R] [-record target] [-listen address]"
+         << " [-log session.tvs] [-replay session.tvs] [-replay-speed S]"
+         << " [-seek MS] [-tree-memory MB] [-tree-error P]"
+         << " [-images images.txt] [-thumbnail-memory MB]"
+         << " [-thumbnail-pixels P] [-reference gt.txt]"
+         << " [-align none|se3|sim3] [-max-dt S] [-error-range R]"
+         << " [-headless [-size WxH] [-view R,THETA,DISTANCE]"
+         << " [-views views.txt] [-o frame_%04d.png] [-j N]]" << endl
+         << "       " << program << " -pack input output [-q]" << endl
+         << "       " << program << " -pack-tree input output [-memory MB]"
+         << endl;
+    return 1;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
 
 int main(int argv, char** argc){
-    tv = new TagViewer(800,600);
-    tv->initWindow(argv,argc);
-    
-
-    // defining test cases
-    double pos1[3] = {10,0,6};
-    double pos2[3] = {0,10,2};
-    double pos3[3] = {0,0,0};
-    double pos4[3] = {0,0,0};
-    
-    double rot1[4] = {1,1,1,1};
-    double rot2[4] = {1,0,1,1};
-    double rot3[4] = {0,0,0,1};
-    double rot4[4] = {0,0,0,1};
-    
-    tv->addCamera(pos1,rot1);
-    tv->addCamera(pos2,rot2);
-    tv->addCamera(pos3,rot3);
-    tv->setTagOrigin(pos4,rot4);
+    // TagViewer -pack input output [-q]
+    if(argv >= 4 && strcmp(argc[1], "-pack") == 0){
+        bool quantize = (argv >= 5 && strcmp(argc[4], "-q") == 0);
+        return packPoses(argc[2], argc[3],
+                         quantize ? POSE_QUANTIZED16 : POSE_FLOAT32);
+    }
+    // TagViewer -pack-tree input output [-memory MB]
+    if(argv >= 4 && strcmp(argc[1], "-pack-tree") == 0){
+        size_t memory = (size_t)1 << 30;
+        if(argv >= 6 && strcmp(argc[4], "-memory") == 0){
+            memory = (size_t)(atof(argc[5]) * (1 << 20));
+        }
+        return packTree(argc[2], argc[3], memory);
+    }
+
+    // parse options
+    const char * poseFile = 0;
+    bool headless = false;
+    int width = 800;
+    int height = 600;
+    int workers = 1;
+    double maxFPS = 0.0;
+    bool vsync = true;
+    const char * trace = 0;
+    double pyramidPixels = LOD_PYRAMID_PIXELS;
+    double clusterPixels = LOD_CLUSTER_PIXELS;
+    const char * pattern = "frame_%04d.png";
+    double playTime = NAN;
+    double playWindow = -1.0;
+    double playSpeed = 1.0;
+    const char * tagFile = 0;
+    const char * observationFile = 0;
+    const char * target = 0;
+    vector<ViewMode> layout;
+    const char * pathFile = 0;
+    double pathRate = 30.0;
+    const char * record = 0;
+    const char * listenAddress = 0;
+    const char * logFile = 0;
+    const char * replayFile = 0;
+    double replaySpeed = 1.0;
+    double seek = -1.0;
+    double treeMemory = TREE_MEMORY_BYTES / (double)(1 << 20);
+    double treeError = TREE_ERROR_PIXELS;
+    const char * imageFile = 0;
+    double thumbnailMemory = THUMBNAIL_MEMORY_BYTES / (double)(1 << 20);
+    double thumbnailPixels = THUMBNAIL_PIXELS;
+    const char * referenceFile = 0;
+    AlignMode align = ALIGN_SE3;
+    double maxTimeDifference = 0.02;
+    double errorRange = 0.0;
+    vector<Viewpoint> views;
+    for(int i = 1; i < argv; i++){
+        const char * arg = argc[i];
+        bool hasValue = (i + 1 < argv);
+        if(strcmp(arg, "-headless") == 0){
+            headless = true;
+        } else if(strcmp(arg, "-size") == 0 && hasValue){
+            const char * size = argc[++i];
+            if(sscanf(size, "%dx%d", &width, &height) != 2 || width <= 0 ||
+               height <= 0){
+                cerr << "bad size " << size << " (expected WxH)" << endl;
+                return usage(argc[0]);
+            }
+        } else if(strcmp(arg, "-view") == 0 && hasValue){
+            Viewpoint v;
+            if(sscanf(argc[++i], "%lf,%lf,%lf", &v.r, &v.theta,
+                      &v.distance) == 3){
+                views.push_back(v);
+            }
+        } else if(strcmp(arg, "-views") == 0 && hasValue){
+            readViewpoints(argc[++i], views);
+        } else if(strcmp(arg, "-o") == 0 && hasValue){
+            pattern = argc[++i];
+        } else if(strcmp(arg, "-j") == 0 && hasValue){
+            workers = atoi(argc[++i]);
+        } else if(strcmp(arg, "-fps") == 0 && hasValue){
+            maxFPS = atof(argc[++i]);
+        } else if(strcmp(arg, "-novsync") == 0){
+            vsync = false;
+        } else if(strcmp(arg, "-trace") == 0 && hasValue){
+            trace = argc[++i];
+        } else if(strcmp(arg, "-lod") == 0 && hasValue){
+            sscanf(argc[++i], "%lf,%lf", &pyramidPixels, &clusterPixels);
+        } else if(strcmp(arg, "-time") == 0 && hasValue){
+            playTime = atof(argc[++i]);
+        } else if(strcmp(arg, "-window") == 0 && hasValue){
+            playWindow = atof(argc[++i]);
+        } else if(strcmp(arg, "-speed") == 0 && hasValue){
+            playSpeed = atof(argc[++i]);
+        } else if(strcmp(arg, "-tags") == 0 && hasValue){
+            tagFile = argc[++i];
+        } else if(strcmp(arg, "-observations") == 0 && hasValue){
+            observationFile = argc[++i];
+        } else if(strcmp(arg, "-target") == 0 && hasValue){
+            target = argc[++i];
+        } else if(strcmp(arg, "-viewports") == 0 && hasValue){
+            readLayout(argc[++i], layout);
+        } else if(strcmp(arg, "-path") == 0 && hasValue){
+            pathFile = argc[++i];
+        } else if(strcmp(arg, "-rate") == 0 && hasValue){
+            pathRate = atof(argc[++i]);
+        } else if(strcmp(arg, "-record") == 0 && hasValue){
+            record = argc[++i];
+        } else if(strcmp(arg, "-listen") == 0 && hasValue){
+            listenAddress = argc[++i];
+        } else if(strcmp(arg, "-log") == 0 && hasValue){
+            logFile = argc[++i];
+        } else if(strcmp(arg, "-replay") == 0 && hasValue){
+            replayFile = argc[++i];
+        } else if(strcmp(arg, "-replay-speed") == 0 && hasValue){
+            replaySpeed = atof(argc[++i]);
+        } else if(strcmp(arg, "-seek") == 0 && hasValue){
+            seek = atof(argc[++i]);
+        } else if(strcmp(arg, "-tree-memory") == 0 && hasValue){
+            treeMemory = atof(argc[++i]);
+        } else if(strcmp(arg, "-tree-error") == 0 && hasValue){
+            treeError = atof(argc[++i]);
+        } else if(strcmp(arg, "-images") == 0 && hasValue){
+            imageFile = argc[++i];
+        } else if(strcmp(arg, "-thumbnail-memory") == 0 && hasValue){
+            thumbnailMemory = atof(argc[++i]);
+        } else if(strcmp(arg, "-thumbnail-pixels") == 0 && hasValue){
+            thumbnailPixels = atof(argc[++i]);
+        } else if(strcmp(arg, "-reference") == 0 && hasValue){
+            referenceFile = argc[++i];
+        } else if(strcmp(arg, "-align") == 0 && hasValue){
+            const char * mode = argc[++i];
+            if(strcmp(mode, "none") == 0){
+                align = ALIGN_NONE;
+            } else if(strcmp(mode, "se3") == 0){
+                align = ALIGN_SE3;
+            } else if(strcmp(mode, "sim3") == 0){
+                align = ALIGN_SIM3;
+            } else {
+                cerr << "unknown alignment " << mode << endl;
+                return usage(argc[0]);
+            }
+        } else if(strcmp(arg, "-max-dt") == 0 && hasValue){
+            maxTimeDifference = atof(argc[++i]);
+        } else if(strcmp(arg, "-error-range") == 0 && hasValue){
+            errorRange = atof(argc[++i]);
+        } else if(arg[0] != '-'){
+            poseFile = arg;
+        }
+    }
+    // headless runs end after their snapshots / path, there is no live
+    // session to record. frames go to -o instead
+    if(headless && record){
+        cerr << "-record needs a window, use -o with -headless" << endl;
+        return usage(argc[0]);
+    }
+    // -o is used as printf format, only path export may pipe to a command
+    if(headless && !(pathFile && pattern[0] == '|') &&
+       !validFramePattern(pattern)){
+        cerr << "bad output pattern " << pattern << " (needs exactly one %d)"
+             << endl;
+        return usage(argc[0]);
+    }
 
+    tv = new TagViewer(width,height);
+    tv->setLodThresholds(pyramidPixels, clusterPixels);
+    tv->setTreeBudget((size_t)(treeMemory * (1 << 20)), treeError);
+    tv->setThumbnailBudget((size_t)(thumbnailMemory * (1 << 20)),
+                           thumbnailPixels);
+    // logging starts first so the log holds the whole scene
+    if(logFile && !tv->startSessionLog(logFile)){
+        cerr << "could not create session log " << logFile << endl;
+    }
+    if(replayFile){
+        if(!tv->replaySession(replayFile, replaySpeed)){
+            return 1;
+        }
+        // snapshots show the end of the session unless -seek says otherwise
+        if(seek >= 0.0 || headless){
+            tv->seekReplay(seek >= 0.0 ? seek : tv->replayDuration());
+        }
+    } else {
+        // snapshots and comparisons need every pose, the window starts
+        // drawing right away otherwise
+        loadScene(poseFile, !headless && !referenceFile);
+    }
+    if(tagFile){
+        cout << "loaded " << readTags(tagFile) << " tags from " << tagFile
+             << endl;
+    }
+    if(observationFile){
+        cout << "loaded " << readObservations(observationFile)
+             << " observations from " << observationFile << endl;
+    }
+    if(imageFile){
+        cout << "loaded " << readCameraImages(imageFile)
+             << " camera images from " << imageFile << endl;
+    }
+    if(referenceFile){
+        tv->setErrorRange(errorRange);
+        compareReference(referenceFile, align, maxTimeDifference);
+    }
+    if(target && !tv->setOrbitTarget(strtoull(target, 0, 10))){
+        cerr << "unknown target tag " << target << endl;
+    }
+    // -time / -window start in playback mode
+    if(!isnan(playTime) || playWindow >= 0.0){
+        tv->setPlayback(true);
+        tv->setPlaybackWindow(max(playWindow, 0.0));
+        if(!isnan(playTime)){
+            tv->setPlaybackTime(playTime);
+        }
+    }
+    tv->setPlaybackSpeed(playSpeed);
+    if(!layout.empty()){
+        tv->setViewportLayout(layout);
+    }
+    if(pathFile){
+        CameraPath keys;
+        readCameraPath(pathFile, keys);
+        tv->setCameraPath(keys);
+    }
+
+    if(headless && pathFile){
+        // camera path export, -j encoder threads
+        int status = 1;
+        if(tv->initOffscreen()){
+            if(trace){
+                tv->startTrace(trace);
+            }
+            status = tv->exportCameraPath(pattern, pathRate, workers) ? 0 : 1;
+        }
+        tv->stopTrace();
+        tv->stopSessionLog();
+        return status;
+    }
+    if(headless){
+        if(views.empty()){
+            // default orbit view
+            Viewpoint v = {0.0, 0.0, tv->worldCamera.distance};
+            views.push_back(v);
+        }
+        int status = renderHeadless(views, pattern, workers, trace);
+        tv->stopTrace();
+        tv->stopSessionLog();
+        return status;
+    }
+
+    tv->initWindow(argv,argc);
 
     // Register callbacks:
     glutDisplayFunc (display);
@@ -77,11 +740,28 @@ int main(int argv, char** argc){
     glutKeyboardFunc (keyboard);
     glutMouseFunc (mouse);
     glutMotionFunc (motion);
-    glutIdleFunc (idle);   
+    glutPassiveMotionFunc (passiveMotion);
+    glutCloseFunc (windowClose);
 
-    while(1){
-        tv->renderFrame();
-    };
+    // idle work is driven by TagViewer::run, which blocks while nothing
+    // changes instead of spinning
+    tv->setFrameRateLimit(maxFPS);
+    tv->setVSync(vsync);
+    if(trace){
+        tv->startTrace(trace);
+    }
+    if(record && !tv->startRecording(record)){
+        cerr << "could not record to " << record << endl;
+    }
+    if(listenAddress && !tv->startServer(listenAddress)){
+        cerr << "could not listen on " << listenAddress << endl;
+    }
+    tv->playCameraPath();
+    tv->run();
+    tv->stopRecording();
+    tv->stopSessionLog();
+
+    delete tv;
     return 0;
-    
+
 }
@@ -0,0 +1,300 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : CameraOctreeTest.cpp
+ * @brief      : Checks camera octree culling and ray casts against testing
+ *               every camera, with indices that have holes
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include "../CameraOctree.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+static const size_t CAMERAS = 20000;
+// one in REJECTED positions is not finite and never indexed
+static const size_t REJECTED = 50;
+static const size_t INDEXED = CAMERAS - CAMERAS / REJECTED;
+// camera i of the sparse tree has index SPARSE_STEP * i + 1
+static const uint32_t SPARSE_STEP = 3;
+// radius of the cameras the ray test hits
+static const double HIT_RADIUS = 0.5;
+
+/**
+ * @brief uniform random double in [lo, hi)
+ */
+static double uniform(double lo, double hi){
+    return lo + (hi - lo) * (rand() / (RAND_MAX + 1.0));
+}
+
+// cameras as the octree stores them, for testing one by one
+struct Cameras {
+    // float rounded x,y,z by index
+    vector<double> positions;
+    vector<char> indexed;
+};
+
+/**
+ * @brief random cameras, half in dense clusters, with non finite ones
+ * @param step index step, cameras are indexed step * i + 1 (1 for a bulk
+ *        insert from 0)
+ */
+static void randomCameras(CameraOctree & octree, Cameras & cameras,
+                          uint32_t step){
+    vector<double> positions(3 * CAMERAS);
+    for(size_t i = 0; i < CAMERAS; i++){
+        double center = (i % 2) ? 50.0 * (i % 5) : 0.0;
+        double spread = (i % 2) ? 5.0 : 300.0;
+        for(int k = 0; k < 3; k++){
+            positions[3*i + k] = center + uniform(-spread, spread);
+        }
+        if(i % REJECTED == 7){
+            positions[3*i + i % 3] = NAN;
+        }
+    }
+    size_t indices = (step == 1) ? CAMERAS : step * CAMERAS + 1;
+    cameras.positions.assign(3 * indices, 0.0);
+    cameras.indexed.assign(indices, 0);
+    for(size_t i = 0; i < CAMERAS; i++){
+        uint32_t index = (step == 1) ? (uint32_t)i : step * (uint32_t)i + 1;
+        bool finite = (i % REJECTED != 7);
+        if(step != 1 && octree.insert(index, &positions[3*i]) != finite){
+            cerr << "insert of camera " << i << " returned " << !finite
+                 << endl;
+        }
+        cameras.indexed[index] = finite;
+        for(int k = 0; k < 3; k++){
+            cameras.positions[3*index + k] = (float)positions[3*i + k];
+        }
+    }
+    if(step == 1 && octree.insert(0, &positions[0], CAMERAS) != INDEXED){
+        cerr << "bulk insert indexed a rejected camera" << endl;
+    }
+}
+
+/**
+ * @brief culls by testing every camera of [first, last)
+ * @return number of indexed cameras in the range
+ */
+static size_t cullEach(const Cameras & cameras, const Frustum & frustum,
+                       const LodParams & lod, uint32_t first, uint32_t last,
+                       CullResult & result){
+    result.pyramids.clear();
+    result.lines.clear();
+    size_t inRange = 0;
+    size_t end = min((size_t)last, cameras.indexed.size());
+    for(size_t i = first; i < end; i++){
+        if(!cameras.indexed[i]){
+            continue;
+        }
+        inRange++;
+        const double * p = &cameras.positions[3*i];
+        if(!frustum.contains(p, CAMERA_RADIUS)){
+            continue;
+        }
+        double d = sqrt((p[0] - lod.eye[0]) * (p[0] - lod.eye[0]) +
+                        (p[1] - lod.eye[1]) * (p[1] - lod.eye[1]) +
+                        (p[2] - lod.eye[2]) * (p[2] - lod.eye[2]));
+        double pixels = (d > 0) ? 2 * CAMERA_RADIUS * lod.pixelsPerUnit / d
+                                : HUGE_VAL;
+        if(pixels >= lod.pyramidPixels){
+            result.pyramids.push_back((uint32_t)i);
+        } else {
+            result.lines.push_back((uint32_t)i);
+        }
+    }
+    return inRange;
+}
+
+/**
+ * @brief random view of the cameras with its lod parameters
+ */
+static void randomView(Frustum & frustum, LodParams & lod, double fovy){
+    double target[3], up[3] = {0.0, 0.0, 1.0};
+    for(int k = 0; k < 3; k++){
+        lod.eye[k] = uniform(-400.0, 400.0);
+        target[k] = uniform(-50.0, 250.0);
+    }
+    frustum.set(lod.eye, target, up, fovy, 1.5, 0.1, 2000.0);
+    lod.pixelsPerUnit = 600.0 / (2.0 * tan(fovy * 0.5 * M_PI / 180.0));
+    lod.pyramidPixels = 20.0;
+    lod.clusterPixels = 0.0;
+}
+
+/**
+ * @brief compares octree culls of several ranges with cullEach
+ * @return number of mismatching culls
+ */
+static long checkCull(const CameraOctree & octree, const Cameras & cameras,
+                      const Frustum & frustum, const LodParams & lod){
+    const uint32_t ranges[][2] = {{0, UINT32_MAX}, {0, 1000},
+                                  {3000, 9000}, {20000, 70000},
+                                  {40000, 41000}, {5, 5}};
+    long errors = 0;
+    for(int r = 0; r < 6; r++){
+        uint32_t first = ranges[r][0];
+        uint32_t last = ranges[r][1];
+        CullResult culled, expected;
+        CullStats stats;
+        size_t inRange = cullEach(cameras, frustum, lod, first, last,
+                                  expected);
+        bool allVisible = octree.cull(frustum, lod, culled, stats, first,
+                                      last);
+        sort(culled.pyramids.begin(), culled.pyramids.end());
+        sort(culled.lines.begin(), culled.lines.end());
+        // all visible may skip listing the range
+        bool listed = (allVisible && culled.pyramids.empty()) ||
+                      culled.pyramids == expected.pyramids;
+        errors += !listed || culled.lines != expected.lines ||
+                  stats.totalCameras != inRange ||
+                  allVisible != (expected.pyramids.size() == inRange);
+    }
+    return errors;
+}
+
+/**
+ * @brief ray test against spheres of HIT_RADIUS around the cameras
+ */
+class SphereHit : public RayHitTest
+{
+public:
+    SphereHit(const Cameras & cameras, const double * origin,
+              const double * dir)
+        : cameras(cameras), origin(origin), dir(dir), tests(0) {};
+
+    // entry distance of the ray into the sphere of camera index
+    bool hit(uint32_t index, double & t){
+        tests++;
+        const double * p = &cameras.positions[3 * index];
+        double c[3] = {p[0] - origin[0], p[1] - origin[1], p[2] - origin[2]};
+        double along = c[0] * dir[0] + c[1] * dir[1] + c[2] * dir[2];
+        double d2 = c[0] * c[0] + c[1] * c[1] + c[2] * c[2] - along * along;
+        if(d2 > HIT_RADIUS * HIT_RADIUS){
+            return false;
+        }
+        t = along - sqrt(HIT_RADIUS * HIT_RADIUS - d2);
+        return t >= 0;
+    };
+
+    const Cameras & cameras;
+    const double * origin;
+    const double * dir;
+    size_t tests;
+};
+
+/**
+ * @brief compares ray casts with testing every camera, for rays aimed at
+ *        cameras and random rays
+ * @return number of mismatching rays
+ */
+static long checkRaycast(const CameraOctree & octree,
+                         const Cameras & cameras){
+    long errors = 0;
+    size_t tests = 0;
+    for(int ray = 0; ray < 200; ray++){
+        double origin[3], dir[3];
+        size_t aim = rand() % cameras.indexed.size();
+        for(int k = 0; k < 3; k++){
+            origin[k] = uniform(-400.0, 400.0);
+            dir[k] = (ray % 2 && cameras.indexed[aim]) ?
+                     cameras.positions[3*aim + k] - origin[k] :
+                     uniform(-1.0, 1.0);
+        }
+        double norm = sqrt(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+        for(int k = 0; k < 3; k++){
+            dir[k] /= norm;
+        }
+        SphereHit each(cameras, origin, dir);
+        uint32_t expected = 0;
+        double nearest = HUGE_VAL;
+        for(size_t i = 0; i < cameras.indexed.size(); i++){
+            double t;
+            if(cameras.indexed[i] && each.hit((uint32_t)i, t) &&
+               t < nearest){
+                nearest = t;
+                expected = (uint32_t)i;
+            }
+        }
+        SphereHit test(cameras, origin, dir);
+        uint32_t index = 0;
+        double t = 0.0;
+        bool hit = octree.raycast(origin, dir, test, index, t);
+        errors += hit != (nearest != HUGE_VAL) ||
+                  (hit && (index != expected || t != nearest));
+        tests += test.tests;
+    }
+    // the tree passes only cameras near the ray to the test
+    errors += tests > 200 * CAMERAS / 10;
+    return errors;
+}
+
+/**
+ * @brief prints and counts the result of one check
+ */
+static long report(const char * what, long errors){
+    cout << what << ": " << (errors ? "FAILED" : "ok") << endl;
+    return errors;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                                    MAIN                                    //
+//----------------------------------------------------------------------------//
+int main(){
+    long failures = 0;
+    srand(1);
+    CameraOctree sparse, bulk;
+    Cameras sparseCameras, bulkCameras;
+    randomCameras(sparse, sparseCameras, SPARSE_STEP);
+    randomCameras(bulk, bulkCameras, 1);
+    failures += report("insert", (sparse.size() != INDEXED) +
+                                 (bulk.size() != INDEXED));
+
+    long errors = 0;
+    for(int view = 0; view < 20; view++){
+        Frustum frustum;
+        LodParams lod;
+        randomView(frustum, lod, 30.0 + 3 * view);
+        errors += checkCull(sparse, sparseCameras, frustum, lod);
+        errors += checkCull(bulk, bulkCameras, frustum, lod);
+    }
+    failures += report("cull", errors);
+
+    // everything in view as pyramids, with a range the root only partly
+    // covers: the result must say so from the cameras actually indexed
+    Frustum frustum;
+    LodParams lod = {{0.0, -5000.0, 0.0}, 500.0, 0.0, 0.0};
+    double target[3] = {0.0, 0.0, 0.0};
+    double up[3] = {0.0, 0.0, 1.0};
+    frustum.set(lod.eye, target, up, 60.0, 1.5, 0.1, 20000.0);
+    errors = checkCull(sparse, sparseCameras, frustum, lod) +
+             checkCull(bulk, bulkCameras, frustum, lod);
+    CullResult culled;
+    CullStats stats;
+    errors += !sparse.cull(frustum, lod, culled, stats, 3000, 9000);
+    failures += report("all visible", errors);
+
+    failures += report("raycast", checkRaycast(sparse, sparseCameras) +
+                                  checkRaycast(bulk, bulkCameras));
+    return failures ? 1 : 0;
+}
+//----------------------------------------------------------------------------//
+//                                  END MAIN                                  //
+//----------------------------------------------------------------------------//
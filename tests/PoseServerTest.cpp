@@ -0,0 +1,340 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseServerTest.cpp
+ * @brief      : Sends pose messages to a PoseServer over a UNIX domain
+ *               socket and checks the updates it parses from them
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include "../PoseServer.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+static const char * SOCKET_PATH = "PoseServerTest.sock";
+static const char * ADDRESS = "unix:PoseServerTest.sock";
+// more than PoseServer::READ_BYTES, so messages are split across reads
+static const size_t CLIENT_CAMERAS = 40000;
+
+/**
+ * @brief uniform random double in [lo, hi)
+ */
+static double uniform(double lo, double hi){
+    return lo + (hi - lo) * (rand() / (RAND_MAX + 1.0));
+}
+
+/**
+ * @brief n random updates of type, with ids if the type carries them
+ */
+static vector<PoseUpdate> randomUpdates(uint32_t type, size_t n){
+    vector<PoseUpdate> updates(n);
+    for(size_t i = 0; i < n; i++){
+        PoseUpdate & u = updates[i];
+        memset(&u, 0, sizeof(u));
+        u.type = type;
+        u.time = NAN;
+        if(type == PoseUpdate::CAMERA_UPSERT ||
+           type == PoseUpdate::TAG_UPSERT){
+            u.id = ((uint64_t)rand() << 32) | (uint64_t)rand();
+        }
+        if(type != PoseUpdate::CAMERA_CLEAR){
+            for(int k = 0; k < 3; k++){
+                u.position[k] = uniform(-100.0, 100.0);
+            }
+            for(int k = 0; k < 4; k++){
+                u.rotation[k] = uniform(-1.0, 1.0);
+            }
+        }
+    }
+    return updates;
+}
+
+/**
+ * @brief appends a message of type holding updates to stream
+ */
+static void appendMessage(vector<char> & stream, uint32_t type,
+                          const vector<PoseUpdate> & updates){
+    bool withIds = (type == POSE_MESSAGE_CAMERA_UPDATES ||
+                    type == POSE_MESSAGE_TAGS);
+    size_t size = withIds ? sizeof(PoseIdRecord) : sizeof(PoseRecord);
+    PoseMessageHeader header;
+    header.type = type;
+    header.bytes = (type == POSE_MESSAGE_CLEAR) ? 0 :
+                   (uint32_t)(updates.size() * size);
+    stream.insert(stream.end(), (const char *)&header,
+                  (const char *)&header + sizeof(header));
+    for(size_t i = 0; header.bytes && i < updates.size(); i++){
+        PoseIdRecord r;
+        r.id = updates[i].id;
+        memcpy(r.position, updates[i].position, sizeof(r.position));
+        memcpy(r.rotation, updates[i].rotation, sizeof(r.rotation));
+        const char * bytes = (const char *)&r + (withIds ? 0 : sizeof(r.id));
+        stream.insert(stream.end(), bytes, bytes + size);
+    }
+}
+
+/**
+ * @brief connects a plain socket to the server
+ */
+static int connectRaw(){
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, SOCKET_PATH, sizeof(address.sun_path) - 1);
+    if(fd >= 0 && connect(fd, (sockaddr *)&address, sizeof(address)) != 0){
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief writes stream in pieces of at most piece bytes, pausing between
+ *        them so the server reads partial headers / records
+ */
+static bool writePieces(int fd, const vector<char> & stream, size_t piece){
+    for(size_t at = 0; at < stream.size(); at += piece){
+        size_t n = min(piece, stream.size() - at);
+        if(write(fd, &stream[at], n) != (ssize_t)n){
+            return false;
+        }
+        usleep(200);
+    }
+    return true;
+}
+
+/**
+ * @brief takes updates from server until it received count in total and
+ *        has clients connections, or 5 seconds passed
+ */
+static void waitFor(PoseServer & server, size_t count, size_t clients,
+                    vector<PoseUpdate> & taken){
+    vector<PoseUpdate> batch;
+    for(int i = 0; i < 5000; i++){
+        if(server.take(batch)){
+            taken.insert(taken.end(), batch.begin(), batch.end());
+        }
+        if(taken.size() >= count && server.clients() == clients){
+            return;
+        }
+        usleep(1000);
+    }
+}
+
+/**
+ * @brief number of updates in read that differ from expected, counting
+ *        missing / extra updates
+ */
+static long compare(const vector<PoseUpdate> & read,
+                    const vector<PoseUpdate> & expected){
+    long errors = (long)max(read.size(), expected.size()) -
+                  (long)min(read.size(), expected.size());
+    for(size_t i = 0; i < min(read.size(), expected.size()); i++){
+        const PoseUpdate & a = read[i];
+        const PoseUpdate & b = expected[i];
+        errors += a.type != b.type || a.id != b.id || !isnan(a.time) ||
+                  memcmp(a.position, b.position, sizeof(a.position)) != 0 ||
+                  memcmp(a.rotation, b.rotation, sizeof(a.rotation)) != 0;
+    }
+    return errors;
+}
+
+/**
+ * @brief number of sockets of this process without close on exec
+ */
+static long inheritedSockets(){
+    long errors = 0;
+    DIR * dir = opendir("/proc/self/fd");
+    dirent * entry;
+    while(dir && (entry = readdir(dir))){
+        int fd = atoi(entry->d_name);
+        struct stat s;
+        if(entry->d_name[0] == '.' || fd == dirfd(dir) ||
+           fstat(fd, &s) != 0 || !S_ISSOCK(s.st_mode)){
+            continue;
+        }
+        errors += (fcntl(fd, F_GETFD) & FD_CLOEXEC) == 0;
+    }
+    if(dir){
+        closedir(dir);
+    }
+    return errors;
+}
+
+/**
+ * @brief prints and counts the result of one check
+ */
+static long report(const char * what, long errors){
+    cout << what << ": " << (errors ? "FAILED" : "ok") << endl;
+    return errors;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                                    MAIN                                    //
+//----------------------------------------------------------------------------//
+int main(){
+    long failures = 0;
+    srand(1);
+
+    // wire format: 8 byte header, 56 byte records, 64 with an id
+    failures += report("layout", (sizeof(PoseMessageHeader) != 8) +
+                                 (sizeof(PoseRecord) != 56) +
+                                 (sizeof(PoseIdRecord) != 64));
+
+    unlink(SOCKET_PATH);
+    PoseServer server;
+    if(!server.start(ADDRESS)){
+        return report("start", 1) ? 1 : 0;
+    }
+
+    // every message type and an unknown one, a few bytes per write
+    vector<PoseUpdate> expected;
+    vector<char> stream;
+    const uint32_t types[] = {POSE_MESSAGE_CAMERAS,
+                              POSE_MESSAGE_CAMERA_UPDATES, 99,
+                              POSE_MESSAGE_TAGS, POSE_MESSAGE_CLEAR,
+                              POSE_MESSAGE_CAMERAS};
+    const uint32_t updateTypes[] = {PoseUpdate::CAMERA_APPEND,
+                                    PoseUpdate::CAMERA_UPSERT, 0,
+                                    PoseUpdate::TAG_UPSERT,
+                                    PoseUpdate::CAMERA_CLEAR,
+                                    PoseUpdate::CAMERA_APPEND};
+    for(int m = 0; m < 6; m++){
+        if(types[m] == 99){
+            PoseMessageHeader unknown = {99, 10};
+            stream.insert(stream.end(), (const char *)&unknown,
+                          (const char *)&unknown + sizeof(unknown));
+            stream.insert(stream.end(), 10, 'x');
+            continue;
+        }
+        size_t n = (types[m] == POSE_MESSAGE_CLEAR) ? 1 : 3 + m;
+        vector<PoseUpdate> updates = randomUpdates(updateTypes[m], n);
+        appendMessage(stream, types[m], updates);
+        expected.insert(expected.end(), updates.begin(), updates.end());
+    }
+    int fd = connectRaw();
+    long errors = (fd < 0) || !writePieces(fd, stream, 5);
+    vector<PoseUpdate> taken;
+    waitFor(server, expected.size(), 1, taken);
+    errors += compare(taken, expected);
+    failures += report("short reads", errors);
+
+    // a record size that does not divide the payload closes the connection
+    // after the messages before it
+    stream.clear();
+    vector<PoseUpdate> before = randomUpdates(PoseUpdate::CAMERA_APPEND, 2);
+    appendMessage(stream, POSE_MESSAGE_CAMERAS, before);
+    appendMessage(stream, POSE_MESSAGE_CAMERA_UPDATES,
+                  randomUpdates(PoseUpdate::CAMERA_UPSERT, 1));
+    stream.resize(stream.size() - 8);
+    ((PoseMessageHeader *)&stream[stream.size() - 64])->bytes = 56;
+    appendMessage(stream, POSE_MESSAGE_CAMERAS,
+                  randomUpdates(PoseUpdate::CAMERA_APPEND, 1));
+    errors = !writePieces(fd, stream, stream.size());
+    taken.clear();
+    waitFor(server, before.size(), 0, taken);
+    char c;
+    errors += compare(taken, before) + (server.clients() != 0) +
+              (read(fd, &c, 1) != 0);
+    close(fd);
+
+    // so does a payload over POSE_MESSAGE_MAX_BYTES
+    fd = connectRaw();
+    PoseMessageHeader huge = {POSE_MESSAGE_CAMERAS,
+                              (POSE_MESSAGE_MAX_BYTES / 56 + 1) * 56};
+    errors += (fd < 0) || write(fd, &huge, sizeof(huge)) != sizeof(huge);
+    taken.clear();
+    waitFor(server, 0, 0, taken);
+    errors += !taken.empty() + (server.clients() != 0) +
+              (read(fd, &c, 1) != 0);
+    close(fd);
+    failures += report("bad messages", errors);
+
+    // PoseClient mixing 56 and 64 byte records in messages larger than a
+    // read, while a raw socket stays connected
+    int idle = connectRaw();
+    PoseClient client;
+    errors = !client.connect(ADDRESS);
+    expected.clear();
+    for(int round = 0; round < 3; round++){
+        vector<PoseUpdate> cameras =
+            randomUpdates(PoseUpdate::CAMERA_APPEND, CLIENT_CAMERAS);
+        vector<PoseUpdate> moved =
+            randomUpdates(PoseUpdate::CAMERA_UPSERT, 1000 + round);
+        vector<PoseUpdate> tags = randomUpdates(PoseUpdate::TAG_UPSERT, 7);
+        vector<double> positions, rotations;
+        vector<uint64_t> ids;
+        for(size_t i = 0; i < cameras.size(); i++){
+            positions.insert(positions.end(), cameras[i].position,
+                             cameras[i].position + 3);
+            rotations.insert(rotations.end(), cameras[i].rotation,
+                             cameras[i].rotation + 4);
+        }
+        errors += !client.sendCameras(&positions[0], &rotations[0],
+                                      cameras.size());
+        expected.insert(expected.end(), cameras.begin(), cameras.end());
+        const vector<PoseUpdate> * withIds[2] = {&moved, &tags};
+        for(int t = 0; t < 2; t++){
+            const vector<PoseUpdate> & u = *withIds[t];
+            positions.clear();
+            rotations.clear();
+            ids.clear();
+            for(size_t i = 0; i < u.size(); i++){
+                ids.push_back(u[i].id);
+                positions.insert(positions.end(), u[i].position,
+                                 u[i].position + 3);
+                rotations.insert(rotations.end(), u[i].rotation,
+                                 u[i].rotation + 4);
+            }
+            errors += t ? !client.sendTags(&ids[0], &positions[0],
+                                           &rotations[0], u.size())
+                        : !client.sendCameras(&ids[0], &positions[0],
+                                              &rotations[0], u.size());
+            expected.insert(expected.end(), u.begin(), u.end());
+        }
+    }
+    errors += !client.sendClear() || !client.flush();
+    expected.push_back(randomUpdates(PoseUpdate::CAMERA_CLEAR, 1)[0]);
+    taken.clear();
+    waitFor(server, expected.size(), 2, taken);
+    errors += compare(taken, expected) + (server.clients() != 2);
+    failures += report("mixed records", errors);
+
+    // accepted sockets must not leak into processes the viewer starts
+    failures += report("close on exec", inheritedSockets());
+
+    client.close();
+    close(idle);
+    server.stop();
+    unlink(SOCKET_PATH);
+    return failures ? 1 : 0;
+}
+//----------------------------------------------------------------------------//
+//                                  END MAIN                                  //
+//----------------------------------------------------------------------------//
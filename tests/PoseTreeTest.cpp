@@ -0,0 +1,307 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : PoseTreeTest.cpp
+ * @brief      : Packs poses into a pose tree, opens it and checks that the
+ *               tree and the records read back hold every pose
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include "../PoseTree.h"
+#include "../PoseLoader.h"
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// more than one sort run of 65536 poses, and leaves several levels deep
+static const size_t POSES = 150000;
+static const char * INPUT_PATH = "PoseTreeTest.bin";
+static const char * TREE_PATH = "PoseTreeTest.tvt";
+static const char * DAMAGED_PATH = "PoseTreeTest_damaged.tvt";
+
+/**
+ * @brief uniform random double in [lo, hi)
+ */
+static double uniform(double lo, double hi){
+    return lo + (hi - lo) * (rand() / (RAND_MAX + 1.0));
+}
+
+/**
+ * @brief dense clusters in a sparse cloud, random unit quaternions
+ */
+static void randomPoses(vector<double> & positions,
+                        vector<double> & rotations){
+    positions.resize(3 * POSES);
+    rotations.resize(4 * POSES);
+    for(size_t i = 0; i < POSES; i++){
+        double center = (i % 4 == 0) ? 0.0 : 10.0 * (i % 3);
+        double spread = (i % 4 == 0) ? 100.0 : 0.5;
+        for(int k = 0; k < 3; k++){
+            positions[3*i + k] = center + uniform(-spread, spread);
+        }
+        double norm = 0.0;
+        for(int k = 0; k < 4; k++){
+            rotations[4*i + k] = uniform(-1.0, 1.0);
+            norm += rotations[4*i + k] * rotations[4*i + k];
+        }
+        for(int k = 0; k < 4; k++){
+            rotations[4*i + k] /= sqrt(norm);
+        }
+    }
+}
+
+/**
+ * @brief record of pose i as pack writes it into the node cube of node,
+ *        from the same float position / rotation pack spools
+ */
+static PoseRecordQ16 expectedRecord(const PoseTreeNode & node,
+                                    const double * p, const double * q){
+    PoseRecordQ16 r;
+    memset(&r, 0, sizeof(r));
+    for(int k = 0; k < 3; k++){
+        float position = (float)p[k];
+        double t = (node.edge > 0) ? (position - node.lo[k]) / node.edge
+                                   : 0.0;
+        t = min(max(t, 0.0), 1.0);
+        r.position[k] = (uint16_t)lround(t * 65535.0);
+    }
+    double norm = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+    norm = (norm > 0) ? 1.0 / norm : 0.0;
+    for(int k = 0; k < 4; k++){
+        float rotation = (float)(q[k] * norm);
+        r.rotation[k] = (int16_t)lround(rotation * 32767.0);
+    }
+    return r;
+}
+
+/**
+ * @brief leaf holding position, found by descending the octants of its
+ *        Morton code in the root cube as pack does
+ */
+static uint32_t leafOf(const PoseTree & tree, const double * p){
+    const float * lo = tree.boundsMin();
+    const float * hi = tree.boundsMax();
+    double edge = max(max((double)hi[0] - lo[0], (double)hi[1] - lo[1]),
+                      (double)hi[2] - lo[2]);
+    edge = (edge > 0) ? edge * (1.0 + 1e-6) : 1.0;
+    const double cells = (double)(1 << POSE_TREE_DEPTH);
+    uint64_t cell[3];
+    for(int k = 0; k < 3; k++){
+        float position = (float)p[k];
+        double t = floor((position - (double)lo[k]) / edge * cells);
+        cell[k] = (uint64_t)min(max(t, 0.0), cells - 1.0);
+    }
+    uint32_t node = tree.root();
+    while(!tree.node(node).isLeaf()){
+        int shift = POSE_TREE_DEPTH - 1 - tree.node(node).level;
+        int c = (int)(((cell[0] >> shift) & 1) << 2 |
+                      ((cell[1] >> shift) & 1) << 1 |
+                      ((cell[2] >> shift) & 1));
+        node = (uint32_t)tree.node(node).children[c];
+    }
+    return node;
+}
+
+/**
+ * @brief orders records bytewise, to compare them as multisets
+ */
+static bool recordLess(const PoseRecordQ16 & a, const PoseRecordQ16 & b){
+    return memcmp(&a, &b, sizeof(a)) < 0;
+}
+
+/**
+ * @brief checks the node table: every node reached once from the root,
+ *        children are octants of their parent one level down and pose
+ *        counts add up
+ * @return number of errors
+ */
+static long checkNodes(const PoseTree & tree){
+    long errors = 0;
+    vector<char> reached(tree.nodeCount(), 0);
+    vector<uint32_t> stack(1, tree.root());
+    while(!stack.empty()){
+        uint32_t i = stack.back();
+        stack.pop_back();
+        const PoseTreeNode & n = tree.node(i);
+        errors += reached[i]++ != 0;
+        if(n.isLeaf()){
+            errors += n.count != n.poses || n.samples > n.count;
+            continue;
+        }
+        uint64_t poses = 0;
+        for(int c = 0; c < 8; c++){
+            if(n.children[c] < 0){
+                continue;
+            }
+            const PoseTreeNode & child = tree.node(n.children[c]);
+            float half = n.edge * 0.5f;
+            float lo[3] = {n.lo[0] + ((c >> 2) & 1) * half,
+                           n.lo[1] + ((c >> 1) & 1) * half,
+                           n.lo[2] + (c & 1) * half};
+            // corners are rounded to float at the scale of the position
+            for(int k = 0; k < 3; k++){
+                errors += fabs(child.lo[k] - lo[k]) >
+                          1e-6 * (n.edge + fabs(n.lo[k]));
+            }
+            errors += child.level != n.level + 1 ||
+                      fabs(child.edge - half) > 1e-6 * n.edge;
+            poses += child.poses;
+            stack.push_back((uint32_t)n.children[c]);
+        }
+        errors += poses != n.poses || n.samples != n.count ||
+                  n.count > POSE_TREE_GRID * POSE_TREE_GRID * POSE_TREE_GRID;
+    }
+    for(size_t i = 0; i < reached.size(); i++){
+        errors += reached[i] != 1;
+    }
+    return errors;
+}
+
+/**
+ * @brief compares the records of every leaf with the input poses that
+ *        belong to it
+ * @return number of errors
+ */
+static long checkRecords(const PoseTree & tree,
+                         const vector<double> & positions,
+                         const vector<double> & rotations){
+    map<uint32_t, vector<PoseRecordQ16> > expected;
+    for(size_t i = 0; i < POSES; i++){
+        uint32_t leaf = leafOf(tree, &positions[3*i]);
+        expected[leaf].push_back(expectedRecord(tree.node(leaf),
+                                                &positions[3*i],
+                                                &rotations[4*i]));
+    }
+    long errors = 0;
+    size_t leaves = 0;
+    vector<unsigned char> bytes;
+    for(size_t i = 0; i < tree.nodeCount(); i++){
+        if(!tree.node(i).isLeaf()){
+            continue;
+        }
+        leaves++;
+        if(!tree.read(i, bytes)){
+            errors++;
+            continue;
+        }
+        const PoseRecordQ16 * r = (const PoseRecordQ16 *)&bytes[0];
+        vector<PoseRecordQ16> read(r, r + tree.node(i).count);
+        vector<PoseRecordQ16> & want = expected[(uint32_t)i];
+        sort(read.begin(), read.end(), recordLess);
+        sort(want.begin(), want.end(), recordLess);
+        if(read.size() != want.size() ||
+           (!read.empty() && memcmp(&read[0], &want[0],
+                                    read.size() * sizeof(read[0])) != 0)){
+            if(errors < 5){
+                cerr << "leaf " << i << ": " << read.size() << " records, "
+                     << want.size() << " expected" << endl;
+            }
+            errors++;
+        }
+    }
+    errors += expected.size() != leaves;
+    return errors;
+}
+
+/**
+ * @brief copies the tree to DAMAGED_PATH with child c of node i set to
+ *        child
+ */
+static void damage(const PoseTree & tree, size_t i, int c, int32_t child){
+    FILE * in = fopen(TREE_PATH, "rb");
+    vector<unsigned char> data;
+    int byte;
+    while((byte = fgetc(in)) != EOF){
+        data.push_back((unsigned char)byte);
+    }
+    fclose(in);
+    PoseTreeHeader header;
+    memcpy(&header, &data[0], sizeof(header));
+    PoseTreeNode node = tree.node(i);
+    node.children[c] = child;
+    memcpy(&data[header.nodeOffset + i * sizeof(PoseTreeNode)], &node,
+           sizeof(node));
+    FILE * out = fopen(DAMAGED_PATH, "wb");
+    fwrite(&data[0], 1, data.size(), out);
+    fclose(out);
+}
+
+/**
+ * @brief prints and counts the result of one check
+ */
+static long report(const char * what, long errors){
+    cout << what << ": " << (errors ? "FAILED" : "ok") << endl;
+    return errors;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                                    MAIN                                    //
+//----------------------------------------------------------------------------//
+int main(){
+    long failures = 0;
+    srand(1);
+    vector<double> positions, rotations;
+    randomPoses(positions, rotations);
+    PoseLoader::writeBinary(INPUT_PATH, &positions[0], &rotations[0], POSES);
+
+    // smallest sort memory, so runs are merged
+    PoseTreePackStats stats;
+    long errors = PoseTree::pack(INPUT_PATH, TREE_PATH, 0, stats) ? 0 : 1;
+    errors += stats.poses != POSES || stats.runs < 2 || stats.levels < 3;
+    failures += report("pack", errors);
+
+    PoseTree tree;
+    errors = tree.open(TREE_PATH) ? 0 : 1;
+    if(!errors){
+        errors += tree.poses() != POSES || tree.nodeCount() != stats.nodes;
+        errors += checkNodes(tree);
+    }
+    failures += report("open", errors);
+    failures += report("records", errors ? 1 : checkRecords(tree, positions,
+                                                            rotations));
+
+    // a root pointing at itself or a leaf pointing at the root (a later
+    // node) would loop traversal, open rejects both
+    uint32_t root = tree.root();
+    int c = 0;
+    while(tree.node(root).children[c] < 0){
+        c++;
+    }
+    PoseTree damaged;
+    damage(tree, root, c, (int32_t)root);
+    errors = damaged.open(DAMAGED_PATH);
+    damage(tree, 0, 0, (int32_t)root);
+    errors += damaged.open(DAMAGED_PATH);
+    damage(tree, root, c, (int32_t)tree.nodeCount());
+    errors += damaged.open(DAMAGED_PATH);
+    failures += report("bad children", errors);
+
+    tree.close();
+    remove(INPUT_PATH);
+    remove(TREE_PATH);
+    remove(DAMAGED_PATH);
+    return failures ? 1 : 0;
+}
+//----------------------------------------------------------------------------//
+//                                  END MAIN                                  //
+//----------------------------------------------------------------------------//
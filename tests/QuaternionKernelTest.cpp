@@ -0,0 +1,192 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : QuaternionKernelTest.cpp
+ * @brief      : Checks every pose packing path against a double precision
+ *               reference
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include "../QuaternionKernel.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// largest batch tested, all sizes 1..MAX_BATCH run so every SIMD tail
+// length is covered
+static const size_t MAX_BATCH = 1001;
+// written past the last instance, must survive every call
+static const float GUARD = -12345.0f;
+// allowed difference to the double reference. inputs are rounded to float
+// before normalizing, so components are off by a few float ulps
+static const double TOLERANCE = 4e-7;
+
+/**
+ * @brief uniform random double in [lo, hi)
+ */
+static double uniform(double lo, double hi){
+    return lo + (hi - lo) * (rand() / (RAND_MAX + 1.0));
+}
+
+/**
+ * @brief random poses. rotations are unnormalized with norms from 1e-3 to
+ *        1e3, every 7th is zero and every 13th too small to normalize
+ */
+static void randomPoses(size_t n, vector<double> & positions,
+                        vector<double> & rotations){
+    positions.resize(3*n);
+    rotations.resize(4*n);
+    for(size_t i = 0; i < n; i++){
+        for(int k = 0; k < 3; k++){
+            positions[3*i + k] = uniform(-1e4, 1e4);
+        }
+        double scale = pow(10.0, uniform(-3.0, 3.0));
+        if(i % 7 == 3){
+            scale = 0.0;
+        } else if(i % 13 == 5){
+            scale = 1e-20;
+        }
+        for(int k = 0; k < 4; k++){
+            rotations[4*i + k] = scale * uniform(-1.0, 1.0);
+        }
+    }
+}
+
+/**
+ * @brief expected instance of one pose in double precision
+ */
+static void referenceInstance(const double * t, const double * q,
+                              double * out){
+    out[0] = t[0];
+    out[1] = t[1];
+    out[2] = t[2];
+    out[3] = 1.0;
+    // same threshold as the kernel: squared norm of the float quaternion
+    double n2 = 0.0;
+    for(int k = 0; k < 4; k++){
+        double f = (float)q[k];
+        n2 += f * f;
+    }
+    if(n2 > 1e-30){
+        double s = 1.0 / sqrt(n2);
+        for(int k = 0; k < 4; k++){
+            out[4 + k] = (float)q[k] * s;
+        }
+    } else {
+        out[4] = out[5] = out[6] = 0.0;
+        out[7] = 1.0;
+    }
+}
+
+/**
+ * @brief packs n poses with path and compares them to the reference
+ * @return number of mismatching floats, -1 if the path is not available
+ */
+static long checkPath(const char * path, size_t n,
+                      const vector<double> & positions,
+                      const vector<double> & rotations){
+    vector<float> instances(8*n + 8, GUARD);
+    if(!posesToInstancesPath(path, &positions[0], &rotations[0], n,
+                             &instances[0])){
+        return -1;
+    }
+    long errors = 0;
+    for(size_t i = 0; i < n; i++){
+        double expected[8];
+        referenceInstance(&positions[3*i], &rotations[4*i], expected);
+        for(int k = 0; k < 8; k++){
+            float got = instances[8*i + k];
+            // positions are rounded to float, nothing else
+            bool match = (k < 4) ? (got == (float)expected[k])
+                                 : (fabs(got - expected[k]) <= TOLERANCE);
+            if(!match){
+                if(errors < 5){
+                    cerr.precision(9);
+                    cerr << path << " n=" << n << " pose " << i << " float "
+                         << k << ": " << got << " expected " << expected[k]
+                         << endl;
+                }
+                errors++;
+            }
+        }
+    }
+    for(int k = 0; k < 8; k++){
+        if(instances[8*n + k] != GUARD){
+            cerr << path << " n=" << n << " wrote past the last instance"
+                 << endl;
+            errors++;
+        }
+    }
+    return errors;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                                    MAIN                                    //
+//----------------------------------------------------------------------------//
+int main(){
+    const char * paths[] = {"scalar", "sse", "avx2"};
+    long failures = 0;
+    srand(1);
+    for(int p = 0; p < 3; p++){
+        vector<double> positions, rotations;
+        long errors = 0;
+        bool available = true;
+        for(size_t n = 1; n <= MAX_BATCH && available; n++){
+            randomPoses(n, positions, rotations);
+            long e = checkPath(paths[p], n, positions, rotations);
+            if(e < 0){
+                available = false;
+            } else {
+                errors += e;
+            }
+        }
+        if(!available){
+            cout << paths[p] << ": not available, skipped" << endl;
+            continue;
+        }
+        cout << paths[p] << ": " << (errors ? "FAILED" : "ok") << " ("
+             << errors << " mismatches)" << endl;
+        failures += errors;
+    }
+
+    // the dispatched path on every tail length
+    vector<double> positions, rotations;
+    vector<float> dispatched, scalar;
+    long errors = 0;
+    for(size_t n = 1; n <= MAX_BATCH; n++){
+        randomPoses(n, positions, rotations);
+        dispatched.assign(8*n, GUARD);
+        scalar.assign(8*n, GUARD);
+        posesToInstances(&positions[0], &rotations[0], n, &dispatched[0]);
+        posesToInstancesScalar(&positions[0], &rotations[0], n, &scalar[0]);
+        for(size_t k = 0; k < 8*n; k++){
+            if(!(fabs(dispatched[k] - scalar[k]) <= TOLERANCE)){
+                errors++;
+            }
+        }
+    }
+    cout << "posesToInstances (" << quaternionKernelName() << "): "
+         << (errors ? "FAILED" : "ok") << " (" << errors << " mismatches)"
+         << endl;
+    failures += errors;
+    return failures ? 1 : 0;
+}
+//----------------------------------------------------------------------------//
+//                                  END MAIN                                  //
+//----------------------------------------------------------------------------//
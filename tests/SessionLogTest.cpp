@@ -0,0 +1,311 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : SessionLogTest.cpp
+ * @brief      : Writes session logs and checks that reading, seeking and
+ *               keyframe seeking return what was written
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include "../SessionLog.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// session events, several blocks of SESSION_BLOCK_EVENTS
+static const size_t EVENTS = 30000;
+// a keyframe of KEYFRAME_EVENTS updates is written after this event
+static const size_t KEYFRAME_AFTER = 20000;
+static const size_t KEYFRAME_EVENTS = 3;
+static const char * LOG_PATH = "SessionLogTest.tvs";
+static const char * DAMAGED_PATH = "SessionLogTest_damaged.tvs";
+
+struct Event {
+    PoseUpdate update;
+    uint64_t micros;
+};
+
+/**
+ * @brief uniform random double in [lo, hi)
+ */
+static double uniform(double lo, double hi){
+    return lo + (hi - lo) * (rand() / (RAND_MAX + 1.0));
+}
+
+/**
+ * @brief value the reader returns for v logged in steps of 1 / steps
+ */
+static double dequantized(double v, double steps){
+    double q = max(min(v * steps, SESSION_MAX_QUANTUM), -SESSION_MAX_QUANTUM);
+    return (double)llround(q) / steps;
+}
+
+/**
+ * @brief update as it reads back from a log
+ */
+static PoseUpdate expected(const PoseUpdate & update){
+    PoseUpdate e = update;
+    for(int k = 0; k < 3; k++){
+        e.position[k] = llround(max(min(update.position[k] /
+                                        SESSION_POSITION_QUANTUM,
+                                        SESSION_MAX_QUANTUM),
+                                    -SESSION_MAX_QUANTUM)) *
+                        SESSION_POSITION_QUANTUM;
+    }
+    for(int k = 0; k < 4; k++){
+        e.rotation[k] = dequantized(update.rotation[k],
+                                    SESSION_ROTATION_STEPS);
+    }
+    if(update.type == PoseUpdate::CAMERA_CLEAR){
+        memset(e.position, 0, sizeof(e.position));
+        memset(e.rotation, 0, sizeof(e.rotation));
+    }
+    if(update.type != PoseUpdate::CAMERA_UPSERT &&
+       update.type != PoseUpdate::TAG_UPSERT){
+        e.id = 0;
+    }
+    if(update.type != PoseUpdate::CAMERA_APPEND &&
+       update.type != PoseUpdate::CAMERA_UPSERT){
+        e.time = NAN;
+    }
+    return e;
+}
+
+/**
+ * @brief random walk of camera / tag updates with ids, timestamps (some
+ *        missing), clears and positions beyond what the log can hold
+ */
+static void randomEvents(vector<Event> & events){
+    double position[3] = {0, 0, 0};
+    double time = 1.5e9;
+    for(size_t i = 0; i < EVENTS; i++){
+        Event e;
+        memset(&e.update, 0, sizeof(e.update));
+        e.micros = i * 1000 + (i % 3);
+        int r = rand() % 100;
+        e.update.type = (r < 80) ? PoseUpdate::CAMERA_APPEND
+                      : (r < 90) ? PoseUpdate::CAMERA_UPSERT
+                      : (r < 97) ? PoseUpdate::TAG_UPSERT
+                      : (r < 99) ? PoseUpdate::TAG_ORIGIN
+                                 : PoseUpdate::CAMERA_CLEAR;
+        e.update.id = (i % 7 == 0) ? UINT64_MAX - i : (uint64_t)rand();
+        for(int k = 0; k < 3; k++){
+            position[k] += uniform(-0.1, 0.1);
+            e.update.position[k] = position[k];
+        }
+        for(int k = 0; k < 4; k++){
+            e.update.rotation[k] = uniform(-1.0, 1.0);
+        }
+        if(i % 1000 == 500){
+            // clamped, and the next delta jumps back
+            e.update.position[0] = 1e30;
+            e.update.position[1] = -1e30;
+            e.update.rotation[3] = 1e20;
+        }
+        time += 1.0 / 30.0;
+        e.update.time = (i % 11 == 0) ? NAN : time;
+        events.push_back(e);
+    }
+}
+
+/**
+ * @brief true if read matches the expected update and time
+ */
+static bool same(const PoseUpdate & read, uint64_t micros,
+                 const Event & event){
+    PoseUpdate e = expected(event.update);
+    bool match = read.type == e.type && read.id == e.id &&
+                 micros == event.micros &&
+                 (read.time == e.time || (isnan(read.time) && isnan(e.time)));
+    for(int k = 0; k < 3; k++){
+        match = match && read.position[k] == e.position[k];
+    }
+    for(int k = 0; k < 4; k++){
+        match = match && read.rotation[k] == e.rotation[k];
+    }
+    return match;
+}
+
+/**
+ * @brief reads events from reader and compares them to events[first..]
+ * @return number of mismatches, counting missing / extra events
+ */
+static long readsBack(SessionReader & reader, const vector<Event> & events,
+                      size_t first, const char * what){
+    long errors = 0;
+    PoseUpdate update;
+    uint64_t micros;
+    size_t i = first;
+    while(reader.next(update, micros)){
+        if(i >= events.size() || !same(update, micros, events[i])){
+            if(errors < 5){
+                cerr << what << ": event " << i << " differs" << endl;
+            }
+            errors++;
+        }
+        i++;
+    }
+    if(i != events.size()){
+        cerr << what << ": read " << i - first << " events, expected "
+             << events.size() - first << endl;
+        errors++;
+    }
+    return errors;
+}
+
+/**
+ * @brief writes events with a keyframe after KEYFRAME_AFTER
+ * @return keyframe updates
+ */
+static vector<Event> writeLog(const vector<Event> & events){
+    SessionWriter writer;
+    writer.open(LOG_PATH);
+    vector<Event> keyframe;
+    for(size_t i = 0; i < events.size(); i++){
+        writer.write(events[i].update, events[i].micros);
+        if(i + 1 == KEYFRAME_AFTER){
+            // stamped with the last event time, the session clock is behind
+            writer.beginKeyframe();
+            for(size_t k = 0; k < KEYFRAME_EVENTS; k++){
+                Event e = events[k];
+                e.micros = events[i].micros;
+                writer.write(e.update);
+                keyframe.push_back(e);
+            }
+            writer.endKeyframe();
+        }
+    }
+    writer.close();
+    return keyframe;
+}
+
+/**
+ * @brief copies the log to DAMAGED_PATH and overwrites bytes at offset
+ *        (from the end if negative)
+ */
+static void damage(long offset, const void * bytes, size_t n){
+    FILE * in = fopen(LOG_PATH, "rb");
+    vector<unsigned char> data;
+    int c;
+    while((c = fgetc(in)) != EOF){
+        data.push_back((unsigned char)c);
+    }
+    fclose(in);
+    size_t at = (offset < 0) ? data.size() + offset : (size_t)offset;
+    memcpy(&data[at], bytes, n);
+    FILE * out = fopen(DAMAGED_PATH, "wb");
+    fwrite(&data[0], 1, data.size(), out);
+    fclose(out);
+}
+
+/**
+ * @brief prints and counts the result of one check
+ */
+static long report(const char * what, long errors){
+    cout << what << ": " << (errors ? "FAILED" : "ok") << endl;
+    return errors;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                                    MAIN                                    //
+//----------------------------------------------------------------------------//
+int main(){
+    long failures = 0;
+    srand(1);
+    vector<Event> events;
+    randomEvents(events);
+    vector<Event> keyframe = writeLog(events);
+
+    // everything in order, keyframe skipped
+    SessionReader reader;
+    long errors = reader.open(LOG_PATH) ? 0 : 1;
+    errors += reader.events() != EVENTS;
+    errors += reader.duration() != events.back().micros;
+    errors += readsBack(reader, events, 0, "read");
+    failures += report("round trip", errors);
+
+    // seek to event times and between them
+    errors = 0;
+    for(size_t i = 0; i < EVENTS; i += 997){
+        uint64_t t = events[i].micros - (i ? 1 : 0);
+        uint64_t at;
+        if(!reader.seek(t) || !reader.peek(at) || at != events[i].micros){
+            errors++;
+        }
+        PoseUpdate update;
+        if(!reader.next(update, at) || !same(update, at, events[i])){
+            errors++;
+        }
+    }
+    errors += reader.seek(events.back().micros + 1);
+    failures += report("seek", errors);
+
+    // keyframe, then the events logged after it
+    errors = 0;
+    uint64_t keyframeMicros = events[KEYFRAME_AFTER - 1].micros;
+    uint64_t found;
+    errors += reader.keyframeTime(keyframeMicros - 1, found);
+    errors += reader.seekKeyframe(keyframeMicros - 1);
+    if(!reader.keyframeTime(events.back().micros, found) ||
+       found != keyframeMicros || !reader.seekKeyframe(found)){
+        errors++;
+    } else {
+        for(size_t k = 0; k < KEYFRAME_EVENTS; k++){
+            PoseUpdate update;
+            uint64_t micros;
+            if(!reader.next(update, micros) ||
+               !same(update, micros, keyframe[k])){
+                errors++;
+            }
+        }
+        errors += readsBack(reader, events, KEYFRAME_AFTER, "keyframe");
+    }
+    failures += report("keyframe seek", errors);
+    reader.close();
+
+    // an index claiming 2^32 - 1 blocks is ignored and the blocks scanned
+    uint32_t blocks = UINT32_MAX;
+    damage(-8, &blocks, sizeof(blocks));
+    errors = reader.open(DAMAGED_PATH) ? 0 : 1;
+    errors += reader.events() != EVENTS;
+    errors += readsBack(reader, events, 0, "scanned");
+    failures += report("bad index", errors);
+    reader.close();
+
+    // a first block claiming 4 GB of events is rejected, not allocated
+    uint32_t sizes[2] = {UINT32_MAX, UINT32_MAX};
+    damage(8 + 4 + 4 + 8 + 8, sizes, sizeof(sizes));
+    errors = 0;
+    if(reader.open(DAMAGED_PATH)){
+        PoseUpdate update;
+        uint64_t micros;
+        errors += reader.next(update, micros);
+    }
+    failures += report("bad block", errors);
+    reader.close();
+
+    remove(LOG_PATH);
+    remove(DAMAGED_PATH);
+    return failures ? 1 : 0;
+}
+//----------------------------------------------------------------------------//
+//                                  END MAIN                                  //
+//----------------------------------------------------------------------------//
@@ -0,0 +1,250 @@
+/*============================================================================
+ * @author     : Jae Yong Lee (leejaeyong7@gmail.com)
+ * @file       : TrajectoryCompareTest.cpp
+ * @brief      : Aligns copies of a trajectory moved by a known similarity
+ *               back onto it and checks the fitted transform and the
+ *               absolute / relative errors
+ * Copyright (c) Jae Yong Lee / UIUC Fall 2016
+ =============================================================================*/
+//----------------------------------------------------------------------------//
+//                                  INCLUDES                                  //
+//----------------------------------------------------------------------------//
+#include "../TrajectoryCompare.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstring>
+//----------------------------------------------------------------------------//
+//                                END INCLUDES                                //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                           NAMESPACE DECLARATIONS                           //
+//----------------------------------------------------------------------------//
+using namespace std;
+//----------------------------------------------------------------------------//
+//                         END NAMESPACE DECLARATIONS                         //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                              HELPER FUNCTIONS                              //
+//----------------------------------------------------------------------------//
+// more than one PoseStore block
+static const size_t POSES = 70000;
+// reference timestamps step, estimate timestamps are late by TIME_OFFSET
+static const double TIME_STEP = 0.01;
+static const double TIME_OFFSET = 0.001;
+static const int THREADS = 2;
+
+/**
+ * @brief quaternion product a * b (x,y,z,w)
+ */
+static void multiply(const double * a, const double * b, double * out){
+    out[0] = a[3]*b[0] + a[0]*b[3] + a[1]*b[2] - a[2]*b[1];
+    out[1] = a[3]*b[1] - a[0]*b[2] + a[1]*b[3] + a[2]*b[0];
+    out[2] = a[3]*b[2] + a[0]*b[1] - a[1]*b[0] + a[2]*b[3];
+    out[3] = a[3]*b[3] - a[0]*b[0] - a[1]*b[1] - a[2]*b[2];
+}
+
+/**
+ * @brief rotates v by unit quaternion q
+ */
+static void rotateVector(const double * q, const double * v, double * out){
+    double p[4] = {v[0], v[1], v[2], 0.0};
+    double c[4] = {-q[0], -q[1], -q[2], q[3]};
+    double t[4], r[4];
+    multiply(q, p, t);
+    multiply(t, c, r);
+    out[0] = r[0];
+    out[1] = r[1];
+    out[2] = r[2];
+}
+
+/**
+ * @brief unit quaternion of angle radians about axis
+ */
+static void axisAngle(double x, double y, double z, double angle,
+                      double * q){
+    double norm = sqrt(x*x + y*y + z*z);
+    double s = sin(0.5 * angle) / norm;
+    q[0] = x * s;
+    q[1] = y * s;
+    q[2] = z * s;
+    q[3] = cos(0.5 * angle);
+}
+
+/**
+ * @brief helix of POSES poses looking along it, rolling slowly
+ */
+static void helix(PoseStore & reference){
+    vector<double> positions(3 * POSES), rotations(4 * POSES);
+    vector<double> timestamps(POSES);
+    for(size_t i = 0; i < POSES; i++){
+        double a = 0.002 * i;
+        positions[3*i] = 10.0 * cos(a);
+        positions[3*i + 1] = 10.0 * sin(a);
+        positions[3*i + 2] = 0.5 * a;
+        double yaw[4], roll[4];
+        axisAngle(0, 0, 1, a + M_PI / 2, yaw);
+        axisAngle(1, 0, 0, 0.3 * sin(5.0 * a), roll);
+        multiply(yaw, roll, &rotations[4*i]);
+        timestamps[i] = TIME_STEP * i;
+    }
+    reference.add(&positions[0], &rotations[0], POSES, &timestamps[0]);
+}
+
+/**
+ * @brief copy of reference moved by the inverse of x -> scale * R x +
+ *        translation, plus offset, with late timestamps
+ */
+static void moved(const PoseStore & reference, const double * rotation,
+                  const double * translation, double scale,
+                  const double * offset, PoseStore & estimate){
+    double c[4] = {-rotation[0], -rotation[1], -rotation[2], rotation[3]};
+    vector<double> positions(3 * POSES), rotations(4 * POSES);
+    vector<double> timestamps(POSES);
+    for(size_t i = 0; i < POSES; i++){
+        const double * p = reference.position(i);
+        double d[3] = {(p[0] - translation[0]) / scale,
+                       (p[1] - translation[1]) / scale,
+                       (p[2] - translation[2]) / scale};
+        rotateVector(c, d, &positions[3*i]);
+        for(int k = 0; k < 3; k++){
+            positions[3*i + k] += offset[k];
+        }
+        multiply(c, reference.rotation(i), &rotations[4*i]);
+        timestamps[i] = reference.timestamp(i) + TIME_OFFSET;
+    }
+    estimate.clear();
+    estimate.add(&positions[0], &rotations[0], POSES, &timestamps[0]);
+}
+
+/**
+ * @brief number of pairs that are not (i, i) for every pose
+ */
+static long checkPairs(const vector<uint32_t> & pairs, size_t found){
+    long errors = (found != POSES) + (pairs.size() != 2 * POSES);
+    for(size_t i = 0; !errors && i < POSES; i++){
+        errors += pairs[2*i] != i || pairs[2*i + 1] != i;
+    }
+    return errors;
+}
+
+/**
+ * @brief number of fitted values further than tolerance from the truth
+ */
+static long checkAlignment(const Alignment & alignment,
+                           const double * rotation,
+                           const double * translation, double scale,
+                           double tolerance){
+    long errors = (alignment.pairs != POSES) +
+                  (fabs(alignment.scale - scale) > tolerance) +
+                  (rotationAngle(alignment.rotation, rotation) > tolerance);
+    for(int k = 0; k < 3; k++){
+        errors += fabs(alignment.translation[k] - translation[k]) > tolerance;
+    }
+    return errors;
+}
+
+/**
+ * @brief aligns estimate like the viewer does, then checks that the
+ *        absolute error is ate and the relative errors vanish
+ */
+static long checkErrors(PoseStore & estimate, const PoseStore & reference,
+                        const Alignment & alignment, double ate){
+    estimate.transform(alignment.rotation, alignment.translation,
+                       alignment.scale);
+    PointKdTree tree;
+    tree.build(reference, THREADS);
+    TrajectoryErrors errors;
+    compareTrajectories(estimate, reference, tree, errors, THREADS);
+    long wrong = 0;
+    for(size_t i = 0; i < errors.association.size(); i++){
+        wrong += errors.association[i] != i;
+    }
+    return (wrong != 0) + (errors.ate.count != POSES) +
+           (fabs(errors.ate.rmse - ate) > 1e-6) +
+           (fabs(errors.ate.max - ate) > 1e-6) +
+           (errors.ateRotation.max > 1e-4) +
+           (errors.rpe.count != POSES - 1) + (errors.rpe.max > 1e-6) +
+           (errors.rpeRotation.max > 1e-4);
+}
+
+/**
+ * @brief prints and counts the result of one check
+ */
+static long report(const char * what, long errors){
+    cout << what << ": " << (errors ? "FAILED" : "ok") << endl;
+    return errors;
+}
+//----------------------------------------------------------------------------//
+//                            END HELPER FUNCTIONS                            //
+//----------------------------------------------------------------------------//
+//----------------------------------------------------------------------------//
+//                                    MAIN                                    //
+//----------------------------------------------------------------------------//
+int main(){
+    long failures = 0;
+    PoseStore reference;
+    helix(reference);
+    double rotation[4];
+    axisAngle(1, -2, 0.5, 2.0, rotation);
+    double translation[3] = {4.0, -7.5, 120.0};
+    const double none[3] = {0.0, 0.0, 0.0};
+
+    // rotated, scaled and translated: Umeyama scale, zero errors
+    PoseStore estimate;
+    moved(reference, rotation, translation, 2.5, none, estimate);
+    vector<uint32_t> pairs;
+    size_t found = associateByTime(estimate, reference, 0.5 * TIME_STEP,
+                                   pairs, THREADS);
+    failures += report("association", checkPairs(pairs, found));
+    Alignment alignment;
+    long errors = !fitAlignment(estimate, reference, pairs, ALIGN_SIM3,
+                                alignment);
+    errors += checkAlignment(alignment, rotation, translation, 2.5, 1e-6);
+    errors += checkErrors(estimate, reference, alignment, 0.0);
+    failures += report("sim3", errors);
+
+    // rotated and translated only
+    moved(reference, rotation, translation, 1.0, none, estimate);
+    errors = !fitAlignment(estimate, reference, pairs, ALIGN_SE3, alignment);
+    errors += checkAlignment(alignment, rotation, translation, 1.0, 1e-6);
+    errors += checkErrors(estimate, reference, alignment, 0.0);
+    failures += report("se3", errors);
+
+    // a constant offset in the reference frame is all absolute error and
+    // no relative error. 5e-4 is far below the spacing of the poses
+    double offset[3] = {3e-4, 0.0, 4e-4};
+    double c[4] = {-rotation[0], -rotation[1], -rotation[2], rotation[3]};
+    double estimateOffset[3];
+    rotateVector(c, offset, estimateOffset);
+    // the true transform puts the estimate at reference - offset, the fit
+    // makes up for it with translation + offset
+    for(int k = 0; k < 3; k++){
+        estimateOffset[k] /= -2.5;
+    }
+    moved(reference, rotation, translation, 2.5, estimateOffset, estimate);
+    errors = !fitAlignment(estimate, reference, pairs, ALIGN_SIM3, alignment);
+    double shifted[3];
+    for(int k = 0; k < 3; k++){
+        shifted[k] = translation[k] + offset[k];
+    }
+    errors += checkAlignment(alignment, rotation, shifted, 2.5, 1e-6);
+    // the fit absorbs the offset, so apply the true transform instead
+    Alignment truth = alignment;
+    memcpy(truth.rotation, rotation, sizeof(truth.rotation));
+    memcpy(truth.translation, translation, sizeof(truth.translation));
+    truth.scale = 2.5;
+    errors += checkErrors(estimate, reference, truth, 5e-4);
+    failures += report("offset", errors);
+
+    // too few pairs leaves the identity
+    pairs.resize(4);
+    errors = fitAlignment(estimate, reference, pairs, ALIGN_SIM3, alignment);
+    errors += alignment.scale != 1.0 || alignment.rotation[3] != 1.0 ||
+              alignment.translation[0] != 0.0;
+    failures += report("few pairs", errors);
+    return failures ? 1 : 0;
+}
+//----------------------------------------------------------------------------//
+//                                  END MAIN                                  //
+//----------------------------------------------------------------------------//